@@ -37,6 +37,9 @@ volatile uint32_t *registers;
 #define Z3660_MEMBASE_ADDR  0x00200000
 #define Z3_SOFT3DDATA_ADDR  0x04200000
 static volatile struct Soft3dData *soft3ddata;
+static volatile struct Soft3dRing *soft3dring;
+static uint32_t ringwrite;                   /* local copy of soft3dring->write */
+static UBYTE usering;                        /* firmware know OP_RING */
 #define KPrintF(...)
 //#include <stdio.h>
 //#define KPrintF printf
@@ -50,6 +53,38 @@ void open_soft3d56(void)
     soft3ddata = (volatile struct Soft3dData*)(((uint32_t)cd->cd_BoardAddr) + (uint32_t)Z3_SOFT3DDATA_ADDR);
     KPrintF((const char *)"Soft3dData   0x%lx\n",(uint32_t)soft3ddata);
     memset((void *)soft3ddata, 0x00, sizeof(struct Soft3dData));
+    soft3dring = (volatile struct Soft3dRing*)(((uint32_t)soft3ddata) + SOFT3D_RING_OFFSET);
+    soft3dring->write=soft3dring->read=0;
+    ringwrite=0;
+}
+
+static void ring_rewind(void)
+{
+    /* the firmware draw all the ring then rewind it */
+    ZZ_REGS_WRITE(REG_ZZ_SOFT3D_OP, OP_RING);
+    usering=(ZZ_REGS_READ(REG_ZZ_SOFT3D_OP)==SOFT3D_RING_MAGIC);
+    ringwrite=0;
+}
+static UBYTE ring_append(APTR sc,uint32_t op,APTR data,uint32_t len,uint32_t Pnb,uint32_t primitive)
+{
+    /* append a record to the ring: 0 if it must be done with a register write */
+    uint32_t size=sizeof(struct Soft3dCmd)+((len+3)&~3);
+    volatile struct Soft3dCmd *cmd;
+
+    if(!usering || sizeof(soft3dring->data)<size)
+        return(0);
+    if(sizeof(soft3dring->data)<ringwrite+size)
+        ring_rewind();
+    cmd=(volatile struct Soft3dCmd *)((uint32_t)soft3dring->data+ringwrite);
+    cmd->op=op;
+    cmd->size=size;
+    cmd->sc=(uint32_t)sc;
+    cmd->Pnb=Pnb;
+    cmd->primitive=primitive;
+    CopyMem(data,(APTR)(cmd+1),len);
+    ringwrite+=size;
+    soft3dring->write=ringwrite;
+    return(1);
 }
 
 void *SOFT3D_Start(APTR PrefsWazp3D, ULONG len)
@@ -60,7 +95,8 @@ void *SOFT3D_Start(APTR PrefsWazp3D, ULONG len)
     ZZ_REGS_WRITE(REG_ZZ_SOFT3D_OP, OP_START);
     CachePostDMA((APTR)PrefsWazp3D,&len2,0);
     uint32_t *a=(uint32_t *)ZZ_REGS_READ(REG_ZZ_SOFT3D_OP);
-    KPrintF((const char *)"%s  start\n",__FUNCTION__);
+    ring_rewind();                           /* also tell if the firmware has the ring */
+    KPrintF((const char *)"%s  start ring %ld\n",__FUNCTION__,(ULONG)usering);
     return(a);
 }
 void SOFT3D_End(APTR sc)
@@ -95,6 +131,8 @@ void  SOFT3D_SetClipping(APTR sc,UWORD xmin,UWORD xmax,UWORD ymin,UWORD ymax)
 }
 void SOFT3D_SetDrawState(APTR sc,APTR sta)
 {
+    if(ring_append(sc,OP_SETDRAWSTATE,sta,15*4,0,0))
+        return;
     soft3ddata->offset[0]=(uint32_t)sc;
     soft3ddata->offset[1]=(uint32_t)sta;
     uint32_t len2=15*4; //struct state3D
@@ -104,6 +142,8 @@ void SOFT3D_SetDrawState(APTR sc,APTR sta)
 }
 void SOFT3D_DrawPrimitive(APTR sc,APTR p,ULONG Pnb,ULONG primitive)
 {
+    if(ring_append(sc,OP_DRAWPRIMITIVE,p,7*4*Pnb,Pnb,primitive))
+        return;
     soft3ddata->offset[0]=(uint32_t)sc;
     soft3ddata->offset[1]=(uint32_t)p;
     soft3ddata->format[0]=Pnb;
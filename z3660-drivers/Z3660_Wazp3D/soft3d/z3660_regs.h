@@ -286,6 +286,7 @@ enum gfx_soft3d_op {
     OP_CLEARZBUFFER,
     OP_READZSPAN,
     OP_WRITEZSPAN,
+    OP_RING,
     OP_SOFT3D_NUM,
 };
 #pragma pack(4)
@@ -309,3 +310,21 @@ struct Soft3dData {
     volatile uint32_t format[2];
     volatile uint16_t x[2], y[2];
 };
+/* Command ring: SETDRAWSTATE/DRAWPRIMITIVE records with their state3D/point3D copied after */
+/* the header, drawn by the firmware before any other op (so FLUSH and DOUPDATE are fences) */
+#define SOFT3D_RING_OFFSET 0x1000            /* from the Soft3dData */
+#define SOFT3D_RING_SIZE   0x80000
+#define SOFT3D_RING_MAGIC  0x52494E47        /* "RING" returned by OP_RING */
+struct Soft3dRing {
+    volatile uint32_t write;                 /* bytes appended in data[] */
+    volatile uint32_t read;                  /* bytes already drawn by the firmware */
+    volatile uint32_t pad[6];
+    volatile uint32_t data[(SOFT3D_RING_SIZE-32)/4];
+};
+struct Soft3dCmd {
+    uint32_t op;                             /* OP_SETDRAWSTATE or OP_DRAWPRIMITIVE */
+    uint32_t size;                           /* bytes with this header */
+    uint32_t sc;
+    uint32_t Pnb;
+    uint32_t primitive;
+};
@@ -174,6 +174,9 @@ enum zz_reg_offsets {
 };
 
 #define AUDIO_TX_FRAME_ADDRESS 0x07DE0000
+#define AUDIO_MIXER_SAMPLE_ADDRESS 0x07400000
+#define AUDIO_MIXER_SAMPLE_SIZE    0x00800000
+#define AUDIO_MIXER_CMD_ADDRESS    0x07C00000
 #define AUDIO_RX_FRAME_ADDRESS 0x07E00000
 #define TX_FRAME_ADDRESS 0x07F00000
 
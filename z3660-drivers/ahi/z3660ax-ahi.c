@@ -51,7 +51,7 @@
 #define DEVICE_NAME "z3660ax.audio"
 #define DEVICE_DATE "(27 Sep 2023)"
 #define DEVICE_VERSION 4
-#define DEVICE_REVISION 19
+#define DEVICE_REVISION 20
 #define DEVICE_ID_STRING "Z3660AX " XSTR(DEVICE_VERSION) "." XSTR(DEVICE_REVISION) " " DEVICE_DATE
 #define DEVICE_PRIORITY 0
 
@@ -222,6 +222,111 @@ static uint32_t __attribute__((used)) SoundFunc(struct Hook *hook asm("a0"), str
   return 0;
 }
 
+static uint32_t mixer_frame_bytes(uint32_t type)
+{
+  switch (type) {
+    case AHIST_M8S:  return 1;
+    case AHIST_M16S: return 2;
+    case AHIST_S8S:  return 2;
+    case AHIST_S16S: return 4;
+  }
+  return 0;
+}
+
+// TW: hw mixer, upload the changed channels and the dynamic sounds marked dirty before the period is mixed.
+static void mixer_upload(struct z9ax* ahi_data)
+{
+  struct AHIAudioCtrlDrv* AudioCtrl = ahi_data->audioctrl;
+  volatile struct z9ax_mixer_cmd* hw = (struct z9ax_mixer_cmd*)(ahi_data->hw_addr + AUDIO_MIXER_CMD_ADDRESS);
+
+  hw->num_channels = ahi_data->mixer.num_channels;
+  hw->master_volume = ahi_data->mixer.master_volume;
+
+  uint32_t dirty = ahi_data->mixer_dirty;
+  ahi_data->mixer_dirty = 0;
+  for (uint32_t i = 0; dirty; i++, dirty >>= 1) {
+    if (dirty & 1) {
+      CopyMem(&ahi_data->mixer.ch[i], (void*)&hw->ch[i], sizeof(struct z9ax_mixer_channel));
+    }
+  }
+
+  for (uint32_t i = 0; i < AudioCtrl->ahiac_Sounds; i++) {
+    struct z9ax_sound* snd = &ahi_data->sounds[i];
+    if (snd->dirty && snd->address) {
+      CopyMem(snd->address, (void*)(ahi_data->hw_addr + snd->card_offset), snd->length * mixer_frame_bytes(snd->type));
+    }
+    snd->dirty = 0;
+  }
+}
+
+// TW: hw mixer, a dynamic sound is read again from Amiga memory when it is
+// set, and when the application had a chance to write it from the SoundFunc.
+static void mixer_mark_dirty(struct z9ax* ahi_data, uint16_t sound)
+{
+  struct AHIAudioCtrlDrv* AudioCtrl = ahi_data->audioctrl;
+
+  if (sound < AudioCtrl->ahiac_Sounds && ahi_data->sounds[sound].dynamic) {
+    ahi_data->sounds[sound].dirty = 1;
+  }
+}
+
+static void mixer_call_sound_func(struct z9ax* ahi_data, uint16_t channel, uint32_t count)
+{
+  struct AHIAudioCtrlDrv* AudioCtrl = ahi_data->audioctrl;
+  struct AHISoundMessage msg;
+
+  msg.ahism_Channel = channel;
+  while (count--) {
+    if (AudioCtrl->ahiac_SoundFunc) {
+      CallHookPkt(AudioCtrl->ahiac_SoundFunc, AudioCtrl, &msg);
+    }
+    mixer_mark_dirty(ahi_data, ahi_data->next_sound[channel]);
+  }
+}
+
+// TW: hw mixer, call the SoundFunc for the AHISF_IMM sounds set before the
+// period and for every queued sound the firmware started during it.
+static void mixer_sound_func(struct z9ax* ahi_data)
+{
+  volatile struct z9ax_mixer_cmd* hw = (struct z9ax_mixer_cmd*)(ahi_data->hw_addr + AUDIO_MIXER_CMD_ADDRESS);
+
+  uint32_t imm_started = ahi_data->imm_started;
+  ahi_data->imm_started = 0;
+  for (uint16_t i = 0; imm_started; i++, imm_started >>= 1) {
+    if (imm_started & 1) {
+      mixer_call_sound_func(ahi_data, i, 1);
+    }
+  }
+
+  uint32_t started_mask = hw->started_mask;
+  for (uint16_t i = 0; started_mask; i++, started_mask >>= 1) {
+    if (started_mask & 1) {
+      uint32_t started = hw->sound_started[i];
+      uint32_t count = started - ahi_data->sound_started[i];
+      ahi_data->sound_started[i] = started;
+      mixer_call_sound_func(ahi_data, i, count);
+    }
+  }
+}
+
+// TW: With the adaptive ring the firmware picks the ring position and every
+// period goes to the staging area right after the ring, so there is no reset.
+static uint32_t next_buf_offset(struct z9ax* ahi_data, uint32_t buf_offset, int overrun)
+{
+  if (ahi_data->flags & DEVF_ADAPTIVE) {
+    return AUDIO_BUFSZ;
+  }
+  if (overrun == 1) {
+    //memset((void*)ahi_data->audio_buf_addr, 0, AUDIO_BUFSZ);
+    return 0;
+  }
+  buf_offset += ZZ_BYTES_PER_PERIOD;
+  if (buf_offset>=AUDIO_BUFSZ) {
+    buf_offset = 0;
+  }
+  return buf_offset;
+}
+
 void WorkerProcess() {
   struct Process* proc = (struct Process *) FindTask(NULL);
   struct z9ax* ahi_data = proc->pr_Task.tc_UserData;
@@ -235,7 +340,7 @@ void WorkerProcess() {
   ahi_data->enable_signal = AllocSignal(-1);
 
   uint32_t signals = 0;
-  uint32_t buf_offset = 0;
+  uint32_t buf_offset = (ahi_data->flags & DEVF_ADAPTIVE) ? AUDIO_BUFSZ : 0;
 
   Signal(ahi_data->t_mainproc, 1L << ahi_data->mainproc_signal);
 
@@ -247,6 +352,20 @@ void WorkerProcess() {
 
     if (!(*AudioCtrl->ahiac_PreTimer)()) {
 #ifdef REAL_HARDWARE
+      if (ahi_data->flags & DEVF_HWMIX) {
+        int overrun;
+        mixer_upload(ahi_data);
+        write_reg(ahi_data->hw_addr, REG_ZZ_AUDIO_SCALE, AudioCtrl->ahiac_BuffSamples);
+        // mix, resample and play buffer, no byteswap needed
+        write_reg(ahi_data->hw_addr, REG_ZZ_AUDIO_SWAB, AUDIO_SWAB_MIX | (1<<15) | (buf_offset>>8));
+        overrun = read_reg(ahi_data->hw_addr, REG_ZZ_AUDIO_SWAB);
+        mixer_sound_func(ahi_data);
+
+        buf_offset = next_buf_offset(ahi_data, buf_offset, overrun);
+
+        (*AudioCtrl->ahiac_PostTimer)();
+        continue;
+      }
       CallHookPkt(AudioCtrl->ahiac_MixerFunc, AudioCtrl, (void*)ahi_data->audio_buf_addr);
 #else
       CallHookPkt(AudioCtrl->ahiac_MixerFunc, AudioCtrl, glob_buf);
@@ -266,15 +385,7 @@ void WorkerProcess() {
       overrun = read_reg(ahi_data->hw_addr, REG_ZZ_AUDIO_SWAB);
 #endif
 
-      if (overrun == 1) {
-        //memset((void*)ahi_data->audio_buf_addr, 0, AUDIO_BUFSZ);
-        buf_offset = 0;
-      } else {
-        buf_offset += ZZ_BYTES_PER_PERIOD;
-        if (buf_offset>=AUDIO_BUFSZ) {
-          buf_offset = 0;
-        }
-      }
+      buf_offset = next_buf_offset(ahi_data, buf_offset, overrun);
 
       (*AudioCtrl->ahiac_PostTimer)();
     }
@@ -421,9 +532,46 @@ static uint32_t __attribute__((used)) intAHIsub_AllocAudio(struct TagItem *tagLi
     lpf_freq = 23900;
   }
 
+  // TW: firmware mixing is opt-in, AHI software mixing is the default.
+  if ((ax_present & AUDIO_CONFIG_HWMIX) && AudioCtrl->ahiac_Channels <= MIXER_MAX_CHANNELS) {
+    if ((f = Open((APTR)"ENV:Z3660AX-HWMIX", MODE_OLDFILE))) {
+      Close(f);
+      ahi_data->sounds = AllocVec(sizeof(struct z9ax_sound) * AudioCtrl->ahiac_Sounds, MEMF_PUBLIC | MEMF_CLEAR);
+      if (ahi_data->sounds) {
+        ahi_data->flags |= DEVF_HWMIX;
+      }
+    }
+  }
+
+  if (ax_present & AUDIO_CONFIG_ADAPTIVE) {
+    if ((f = Open((APTR)"ENV:Z3660AX-ADAPTIVE", MODE_OLDFILE))) {
+      Close(f);
+      ahi_data->flags |= DEVF_ADAPTIVE;
+    }
+  }
+
+  if (ahi_data->flags & DEVF_HWMIX) {
+    ahi_data->mixer.num_channels = AudioCtrl->ahiac_Channels;
+    ahi_data->mixer.master_volume = 0x10000;
+    for (uint32_t i = 0; i < AudioCtrl->ahiac_Channels; i++) {
+      ahi_data->mixer.ch[i].next_offset = MIXER_NOSOUND;
+      ahi_data->next_sound[i] = AHI_NOSOUND;
+    }
+    CopyMem(&ahi_data->mixer, (void*)(hw_addr + AUDIO_MIXER_CMD_ADDRESS), sizeof(struct z9ax_mixer_cmd));
+  }
+
   Forbid();
   // set tx buffer address
   write_audio_param(hw_addr, 0, offset_tx);
+  if (ahi_data->flags & DEVF_HWMIX) {
+    // set mixer command block address, this resets the firmware channels
+    write_audio_param(hw_addr, AP_MIXER_CMD_OFFS, AUDIO_MIXER_CMD_ADDRESS);
+  }
+  if (ahi_data->flags & DEVF_ADAPTIVE) {
+    write_audio_param(hw_addr, AP_RING_PERIODS, RING_PERIODS);
+    write_audio_param(hw_addr, AP_RING_PERIOD_BYTES, RING_PERIOD_BYTES);
+    write_audio_param(hw_addr, AP_RING_LATENCY, RING_LATENCY);
+  }
   //write_audio_param(hw_addr, 2, offset_rx>>16);
   //write_audio_param(hw_addr, 3, offset_rx&0xffff);
 
@@ -461,6 +609,10 @@ static uint32_t __attribute__((used)) intAHIsub_AllocAudio(struct TagItem *tagLi
   // yields 960 samples (3840 bytes) for 48000Hz
   AudioCtrl->ahiac_BuffSamples = AudioCtrl->ahiac_MixFreq/50;
 
+  if (ahi_data->flags & DEVF_HWMIX) {
+    return AHISF_KNOWSTEREO;
+  }
+
   // none of that weird timing
   return AHISF_KNOWSTEREO | AHISF_MIXING; // | AHISF_TIMING;
 }
@@ -471,6 +623,13 @@ static void __attribute__((used)) intAHIsub_FreeAudio(struct AHIAudioCtrlDrv *Au
 
     destroy_interrupt(ahi_data);
 
+    if (ahi_data->flags & DEVF_ADAPTIVE) {
+      // back to the fixed ring for the next user
+      write_audio_param(ahi_data->hw_addr, AP_RING_LATENCY, 0);
+      write_audio_param(ahi_data->hw_addr, AP_RING_PERIODS, 8);
+      write_audio_param(ahi_data->hw_addr, AP_RING_PERIOD_BYTES, ZZ_BYTES_PER_PERIOD);
+    }
+
     if (ahi_data->worker_process) {
       Signal((struct Task *)ahi_data->worker_process, SIGBREAKF_CTRL_C);
       Wait(1L << ahi_data->mainproc_signal);
@@ -483,6 +642,10 @@ static void __attribute__((used)) intAHIsub_FreeAudio(struct AHIAudioCtrlDrv *Au
       FreeVec((void*)ahi_data->audio_buf_addr);
     }
 
+    if (ahi_data->sounds) {
+      FreeVec(ahi_data->sounds);
+    }
+
     FreeVec(AudioCtrl->ahiac_DriverData);
     AudioCtrl->ahiac_DriverData = NULL;
   }
@@ -582,14 +745,62 @@ static uint32_t __attribute__((used)) intAHIsub_SetEffect(uint8_t *effect asm("a
   return AHIS_UNKNOWN;
 }
 
+// TW: hw mixer sounds live in the card sample pool. Allocation is a simple
+// bump pointer: a reloaded sound reuses its slot if it fits, and only the
+// topmost sound gives its memory back when unloaded.
 static uint32_t __attribute__((used)) intAHIsub_LoadSound(uint16_t sound asm("d0"), uint32_t type asm("d1"), struct AHISampleInfo *info asm("a0"), struct AHIAudioCtrlDrv *AudioCtrl asm("a2"))
 {
-  return AHIS_UNKNOWN;
+  struct z9ax *ahi_data = AudioCtrl->ahiac_DriverData;
+  if (!(ahi_data->flags & DEVF_HWMIX)) return AHIS_UNKNOWN;
+
+  if (type != AHIST_SAMPLE && type != AHIST_DYNAMICSAMPLE) return AHIE_BADSOUNDTYPE;
+  uint32_t frame_bytes = mixer_frame_bytes(info->ahisi_Type);
+  if (!frame_bytes) return AHIE_BADSAMPLETYPE;
+  if (sound >= AudioCtrl->ahiac_Sounds) return AHIE_UNKNOWN;
+
+  struct z9ax_sound *snd = &ahi_data->sounds[sound];
+  uint32_t bytes = (info->ahisi_Length * frame_bytes + 15) & ~15;
+
+  if (snd->alloc_size < bytes) {
+    if (snd->alloc_size && snd->card_offset + snd->alloc_size == AUDIO_MIXER_SAMPLE_ADDRESS + ahi_data->sample_top) {
+      ahi_data->sample_top -= snd->alloc_size;
+    }
+    if (ahi_data->sample_top + bytes > AUDIO_MIXER_SAMPLE_SIZE) {
+      snd->alloc_size = 0;
+      return AHIE_NOMEM;
+    }
+    snd->card_offset = AUDIO_MIXER_SAMPLE_ADDRESS + ahi_data->sample_top;
+    snd->alloc_size = bytes;
+    ahi_data->sample_top += bytes;
+  }
+
+  snd->type = info->ahisi_Type;
+  snd->length = info->ahisi_Length;
+  snd->address = info->ahisi_Address;
+  snd->dynamic = (type == AHIST_DYNAMICSAMPLE);
+  snd->dirty = 0;
+
+  CopyMem(snd->address, (void*)(ahi_data->hw_addr + snd->card_offset), snd->length * frame_bytes);
+
+  return AHIE_OK;
 }
 
 static uint32_t __attribute__((used)) intAHIsub_UnloadSound(uint16_t sound asm("d0"), struct AHIAudioCtrlDrv *AudioCtrl asm("a2"))
 {
-  return AHIS_UNKNOWN;
+  struct z9ax *ahi_data = AudioCtrl->ahiac_DriverData;
+  if (!(ahi_data->flags & DEVF_HWMIX)) return AHIS_UNKNOWN;
+  if (sound >= AudioCtrl->ahiac_Sounds) return AHIE_OK;
+
+  struct z9ax_sound *snd = &ahi_data->sounds[sound];
+  if (snd->alloc_size && snd->card_offset + snd->alloc_size == AUDIO_MIXER_SAMPLE_ADDRESS + ahi_data->sample_top) {
+    ahi_data->sample_top -= snd->alloc_size;
+  }
+  snd->alloc_size = 0;
+  snd->address = NULL;
+  snd->dynamic = 0;
+  snd->dirty = 0;
+
+  return AHIE_OK;
 }
 
 // TW: C routines called by ASM wrappers which preserve all registers.
@@ -611,19 +822,76 @@ static void __attribute__((used)) intAHIsub_Update(uint32_t flags asm("d0"), str
 {
 }
 
+// TW: The hw mixer channel setters only touch the local copy of the command
+// block, mixer_upload() sends the changed channels once per period. Without
+// AHISF_IMM the new value is used when the current sound ends.
 static uint32_t __attribute__((used)) intAHIsub_SetVol(uint16_t channel asm("d0"), uint32_t volume asm("d1"), uint32_t pan asm("d2"), struct AHIAudioCtrlDrv *AudioCtrl asm("a2"), uint32_t flags asm("d3"))
 {
-  return AHIS_UNKNOWN;
+  struct z9ax *ahi_data = AudioCtrl->ahiac_DriverData;
+  if (!(ahi_data->flags & DEVF_HWMIX)) return AHIS_UNKNOWN;
+  if (channel >= AudioCtrl->ahiac_Channels) return AHIE_UNKNOWN;
+
+  struct z9ax_mixer_channel *ch = &ahi_data->mixer.ch[channel];
+  ch->next_volume = volume;
+  ch->next_pan = pan;
+  if (flags & AHISF_IMM) {
+    ch->volume = volume;
+    ch->pan = pan;
+    ch->vol_seq++;
+  }
+  ahi_data->mixer_dirty |= 1L << channel;
+
+  return AHIE_OK;
 }
 
 static uint32_t __attribute__((used)) intAHIsub_SetFreq(uint16_t channel asm("d0"), uint32_t freq asm("d1"), struct AHIAudioCtrlDrv *AudioCtrl asm("a2"), uint32_t flags asm("d2"))
 {
-  return AHIS_UNKNOWN;
+  struct z9ax *ahi_data = AudioCtrl->ahiac_DriverData;
+  if (!(ahi_data->flags & DEVF_HWMIX)) return AHIS_UNKNOWN;
+  if (channel >= AudioCtrl->ahiac_Channels) return AHIE_UNKNOWN;
+
+  if (freq == AHI_MIXFREQ) freq = AudioCtrl->ahiac_MixFreq;
+
+  struct z9ax_mixer_channel *ch = &ahi_data->mixer.ch[channel];
+  ch->next_freq = freq;
+  if (flags & AHISF_IMM) {
+    ch->freq = freq;
+    ch->freq_seq++;
+  }
+  ahi_data->mixer_dirty |= 1L << channel;
+
+  return AHIE_OK;
 }
 
 static uint32_t __attribute__((used)) intAHIsub_SetSound(uint16_t channel asm("d0"), uint16_t sound asm("d1"), uint32_t offset asm("d2"), int32_t length asm("d3"), struct AHIAudioCtrlDrv *AudioCtrl asm("a2"), uint32_t flags asm("d4"))
 {
-  return AHIS_UNKNOWN;
+  struct z9ax *ahi_data = AudioCtrl->ahiac_DriverData;
+  if (!(ahi_data->flags & DEVF_HWMIX)) return AHIS_UNKNOWN;
+  if (channel >= AudioCtrl->ahiac_Channels) return AHIE_UNKNOWN;
+
+  struct z9ax_mixer_channel *ch = &ahi_data->mixer.ch[channel];
+  if (sound == AHI_NOSOUND) {
+    ch->next_offset = MIXER_NOSOUND;
+  } else {
+    if (sound >= AudioCtrl->ahiac_Sounds) return AHIE_UNKNOWN;
+    struct z9ax_sound *snd = &ahi_data->sounds[sound];
+    if (!snd->alloc_size) return AHIE_UNKNOWN;
+
+    if (!length) length = snd->length - offset;
+    ch->next_offset = snd->card_offset + offset * mixer_frame_bytes(snd->type);
+    ch->next_type = snd->type;
+    ch->next_length = length;
+    mixer_mark_dirty(ahi_data, sound);
+  }
+  ahi_data->next_sound[channel] = sound;
+  if (flags & AHISF_IMM) {
+    // like the AHI mixers, an immediate sound change calls the SoundFunc too
+    ch->sound_seq++;
+    ahi_data->imm_started |= 1L << channel;
+  }
+  ahi_data->mixer_dirty |= 1L << channel;
+
+  return AHIE_OK;
 }
 
 extern void __attribute__((used)) intAHIsub_Enable(struct AHIAudioCtrlDrv *AudioCtrl asm("a2"));
@@ -1,4 +1,58 @@
 #define DEVF_INT2MODE 1
+#define DEVF_HWMIX    2 // TW: AHI channels are mixed by the firmware
+#define DEVF_ADAPTIVE 4 // TW: the firmware places the periods in the ring
+
+#define AP_MIXER_CMD_OFFS    23
+#define AP_RING_PERIODS      24
+#define AP_RING_PERIOD_BYTES 25
+#define AP_RING_LATENCY      26
+#define AUDIO_SWAB_MIX       (1<<16)
+#define AUDIO_CONFIG_HWMIX   2
+#define AUDIO_CONFIG_ADAPTIVE 4
+
+// adaptive ring: 16 periods of 5 ms, 40 ms target latency (48 kHz frames)
+#define RING_PERIODS         16
+#define RING_PERIOD_BYTES    1920
+#define RING_LATENCY         1920
+
+#define MIXER_MAX_CHANNELS   32
+#define MIXER_NOSOUND        0xFFFFFFFF
+
+// Firmware mixer command block, keep in sync with ax_mixer.h
+struct z9ax_mixer_channel {
+  uint32_t sound_seq;
+  uint32_t freq_seq;
+  uint32_t vol_seq;
+  uint32_t freq;
+  int32_t volume;
+  uint32_t pan;
+  uint32_t next_freq;
+  int32_t next_volume;
+  uint32_t next_pan;
+  uint32_t next_offset;
+  uint32_t next_type;
+  int32_t next_length;
+};
+
+struct z9ax_mixer_cmd {
+  uint32_t num_channels;
+  int32_t master_volume;
+  uint32_t started_mask;
+  uint32_t reserved;
+  uint32_t sound_started[MIXER_MAX_CHANNELS];
+  struct z9ax_mixer_channel ch[MIXER_MAX_CHANNELS];
+};
+
+// Sound loaded into the card sample pool
+struct z9ax_sound {
+  uint32_t card_offset;
+  uint32_t alloc_size;
+  uint32_t type;
+  uint32_t length;
+  APTR address;
+  uint8_t dynamic;
+  uint8_t dirty;     // dynamic sound to copy again before the next period
+};
 
 // Driver data
 struct z9ax {
@@ -19,6 +73,14 @@ struct z9ax {
   struct AHIAudioCtrlDrv *audioctrl;
   uint16_t play_start;
   uint8_t flags;
+  // hw mixer state, see DEVF_HWMIX
+  struct z9ax_mixer_cmd mixer;
+  uint32_t mixer_dirty;
+  uint32_t imm_started;  // channels with an AHISF_IMM SetSound for the SoundFunc
+  uint32_t sound_started[MIXER_MAX_CHANNELS];
+  uint16_t next_sound[MIXER_MAX_CHANNELS];
+  struct z9ax_sound *sounds;
+  uint32_t sample_top;
 };
 
 // TW: Driver base includes hardware address and zorro version besides library base.
@@ -50,6 +50,11 @@
 
 #define FIFOSIZE (1152*4*8)
 //#define FIFOSIZE (16*1024+1)
+// Data kept back in operational mode (adapted between MIN and MAX) and the
+// fill level below which the decoder is considered close to running dry.
+#define FIFO_MAX_RESERVE (FIFOSIZE/2)
+#define FIFO_MIN_RESERVE (FIFOSIZE/8)
+#define FIFO_LOW_WATER   (FIFOSIZE/8)
 
 typedef enum {
 	DECODE_INIT,
@@ -95,16 +100,66 @@ static void setDecoderParam(struct MhiPlayer *mp, ULONG Param, ULONG Value) {
 static void clearFifo(struct MhiPlayer *mp) {
 	mp->FifoMode = FIFO_PREFILL;
 	mp->FifoWriteIdx = 0;
+	mp->FifoReserve = FIFO_MAX_RESERVE;
 	// ZZ_DECODE (clear)
 	setRegister(mp, REG_ZZ_DECODE, DECODE_CLEAR_FIFO);
 }
 
-static void fillFifo(struct MhiPlayer *mp) {
+// Copy one contiguous segment into the FIFO (no wrap inside).
+static void copySegment(volatile UBYTE *dst, UBYTE *src, LONG Bytes) {
+	#ifdef OPTIMIZED_TRANSFER
+	LONG LongBytes;
+
+	// 1. Single bytes until the destination is 32-bit aligned.
+	while(Bytes && ((ULONG)dst & 3)) {
+		*dst++ = *src++;
+		Bytes--;
+	}
+
+	// 2. Longwords. CopyMemQuick needs both sides aligned (and uses MOVE16
+	// where the CPU has it), otherwise let the 68020+ read unaligned longs.
+	LongBytes = Bytes & ~3;
+	if(LongBytes) {
+		if(((ULONG)src & 3) == 0) {
+			CopyMemQuick(src, (APTR)dst, LongBytes);
+		}
+		else {
+			ULONG *s = (ULONG*)src;
+			volatile ULONG *d = (volatile ULONG*)dst;
+			LONG i;
+			for(i=0; i<LongBytes/4; i++) *d++ = *s++;
+		}
+		src   += LongBytes;
+		dst   += LongBytes;
+		Bytes -= LongBytes;
+	}
+	#endif
+
+	// 3. Remainder.
+	while(Bytes--) *dst++ = *src++;
+}
+
+// Copy into the FIFO in at most two contiguous segments (before and after the wrap).
+static void copyToFifo(struct MhiPlayer *mp, UBYTE *src, LONG Bytes) {
 	volatile UBYTE *Buffer = (volatile UBYTE *)mp->mp3_addr;
+
+	while(Bytes > 0) {
+		LONG Chunk = FIFOSIZE - mp->FifoWriteIdx;
+		if(Chunk > Bytes) Chunk = Bytes;
+		copySegment(&Buffer[mp->FifoWriteIdx], src, Chunk);
+		src   += Chunk;
+		Bytes -= Chunk;
+		mp->FifoWriteIdx += Chunk;
+		if(mp->FifoWriteIdx >= FIFOSIZE) mp->FifoWriteIdx = 0;
+	}
+}
+
+static void fillFifo(struct MhiPlayer *mp) {
 	LONG Space = 0;
+	LONG Fill;
 	ULONG FifoReadIdx;
 	struct ListNode *BufferNode;
-	LONG i;
+	BOOL BufferPlayed = FALSE;
 
 	// 1. Get FIFO Read Index from Z3660 (we are the slave).
 	FifoReadIdx = getRegister(mp, REG_ZZ_DECODER_FIFORX);
@@ -114,76 +169,51 @@ static void fillFifo(struct MhiPlayer *mp) {
 	else {
 		Space = FifoReadIdx-mp->FifoWriteIdx;
 	}
+	Fill = FIFOSIZE-Space;
 
 	// 2. Calculate space left in FIFO.
 	// In prefill mode fill the FIFO completely.
 	if(mp->FifoMode == FIFO_PREFILL) {
 		Space -= 1; // Note: Fill level limited for technical reasons.
 	}
-	// In operational mode fill it only half way to leave data for seeking back.
+	// In operational mode leave some data for seeking back. If the decoder
+	// got close to running dry (buffers arriving late), keep less back so
+	// the next buffers fill it further, and slowly go back when it's fine.
 	else {
-		Space -= FIFOSIZE/2;
+		if(Fill < FIFO_LOW_WATER) {
+			mp->FifoReserve /= 2;
+			if(mp->FifoReserve < FIFO_MIN_RESERVE) mp->FifoReserve = FIFO_MIN_RESERVE;
+		}
+		else if(Fill > FIFOSIZE-mp->FifoReserve-FIFO_LOW_WATER && mp->FifoReserve < FIFO_MAX_RESERVE) {
+			mp->FifoReserve += FIFO_MIN_RESERVE/4;
+			if(mp->FifoReserve > FIFO_MAX_RESERVE) mp->FifoReserve = FIFO_MAX_RESERVE;
+		}
+		Space -= mp->FifoReserve;
 	}
 	if(Space <= 0) return;
 
 	// 3. Fill the FIFO
-	// Find first node in list that has not been completely played.
-	for(BufferNode = (struct ListNode *)mp->BufferList->mlh_Head; BufferNode->Header.mln_Succ; BufferNode = (struct ListNode *)BufferNode->Header.mln_Succ) {
+	// Walk the buffers that have not been completely played until the FIFO is full.
+	for(BufferNode = (struct ListNode *)mp->BufferList->mlh_Head; BufferNode->Header.mln_Succ && Space > 0; BufferNode = (struct ListNode *)BufferNode->Header.mln_Succ) {
 		if(BufferNode->Played == FALSE) {
 			LONG BytesToCopy = BufferNode->Size - BufferNode->Index;
 			if(BytesToCopy > Space) BytesToCopy = Space;
 
-			#ifdef OPTIMIZED_TRANSFER
-			// 3.1 Copy single bytes until we reach a 32-bit aligned destination address.
-			if(BytesToCopy >= 3) {
-				for(i=0; i<3; i++) {
-					if((mp->FifoWriteIdx & 3) == 0) break;
-					if(Space) {
-						Buffer[mp->FifoWriteIdx++] = BufferNode->Buffer[BufferNode->Index++];
-						if(mp->FifoWriteIdx >= FIFOSIZE) mp->FifoWriteIdx = 0;
-						Space--;
-						BytesToCopy--;
-					}
-				}
-			}
+			copyToFifo(mp, &BufferNode->Buffer[BufferNode->Index], BytesToCopy);
+			BufferNode->Index += BytesToCopy;
+			Space             -= BytesToCopy;
 
-			// 3.2 Optimized longword copy routine.
-			LONG LongsToCopy = BytesToCopy/4;
-			ULONG *src = (ULONG*)&BufferNode->Buffer[BufferNode->Index];
-			ULONG *dst = (ULONG*)&Buffer[mp->FifoWriteIdx];
-			for(i=0; i<LongsToCopy; i++) {
-				*dst++ = *src++;
-				mp->FifoWriteIdx  += 4;
-				if(mp->FifoWriteIdx >= FIFOSIZE) {
-					mp->FifoWriteIdx = 0;
-					dst = (ULONG*)Buffer;
-				}
-			}
-			Space             -= 4*LongsToCopy;
-			BytesToCopy       -= 4*LongsToCopy;
-			BufferNode->Index += 4*LongsToCopy;
-
-			// 3.3 Copy remainder.
-			#endif
-			for(i=0; i<BytesToCopy; i++) {
-				if(Space) {
-					Buffer[mp->FifoWriteIdx++] = BufferNode->Buffer[BufferNode->Index++];
-					if(mp->FifoWriteIdx >= FIFOSIZE) mp->FifoWriteIdx = 0;
-					Space--;
-				}
-			}
-
-			// If we have reached the end of the current buffer then...
+			// If we have reached the end of the current buffer then mark this buffer as 'played'.
 			if(BufferNode->Index >= BufferNode->Size) {
-				// ... mark this buffer as 'played'.
 				BufferNode->Played = TRUE;
-				// ... signal the calling task that a buffer has been played.
-				Signal(mp->MhiTask, mp->MhiMask);
+				BufferPlayed = TRUE;
 			}
-			break;
 		}
 	}
 
+	// ... signal the calling task that a buffer has been played.
+	if(BufferPlayed) Signal(mp->MhiTask, mp->MhiMask);
+
 	mp->FifoMode = FIFO_OPERATIONAL;
 
 	// 4. Set FIFO Write Index in Z3660 (we are the master).
@@ -360,6 +390,7 @@ APTR i_MHIAllocDecoder(REGA0(struct Task *mhi_task), REGD0(ULONG mhi_sigmask), R
 
 		mp->FifoMode     = FIFO_PREFILL;
 		mp->FifoWriteIdx = 0;
+		mp->FifoReserve  = FIFO_MAX_RESERVE;
 		mp->buf_offset   = 0;
 		mp->volume       = 100;
 		mp->panning      = 50;
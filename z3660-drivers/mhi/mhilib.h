@@ -33,6 +33,7 @@ struct MhiPlayer {
 
 	FIFO_MODE FifoMode;
 	ULONG FifoWriteIdx;
+	ULONG FifoReserve;
 
 	struct Task *t_mainproc;
 	struct Process *worker_process;
@@ -7,6 +7,8 @@
 #include "sleep.h"
 #include <stdlib.h>
 #include "ax.h"
+#include "ax_mixer.h"
+#include "mp3/mp3.h"
 #include "memorymap.h"
 #include "xtime_l.h"
 #include <math.h>
@@ -18,6 +20,7 @@
 
 extern DEBUG_CONSOLE debug_console;
 void DEBUG_AUDIO(const char *format, ...);
+extern uint32_t audio_params[];
 
 float cut_freq=2.*M_PI*23900.;
 float a1[11]={0};
@@ -36,6 +39,22 @@ XI2s_Tx i2s;
 XAudioFormatter audio_formatter;
 
 static uint8_t* audio_tx_buffer = (uint8_t*)(RTG_BASE+AUDIO_TX_BUFFER_ADDRESS);
+
+// I2S ring geometry, can be changed by the driver (AP_RING_PERIODS, AP_RING_PERIOD_BYTES)
+static uint32_t audio_num_periods = AUDIO_NUM_PERIODS;
+static uint32_t audio_bytes_per_period = AUDIO_BYTES_PER_PERIOD;
+
+// Adaptive ring. With a target latency set, the driver writes every period
+// to the staging area and the firmware copies it into the ring at its own
+// write position. A slow fill level controller stretches or drops a few
+// samples per period to keep the ring around the target, so jitter of the
+// producer doesn't need ring resets any more.
+#define RING_MAX_ADJUST 8  // frames per period (< 1% pitch change)
+#define RING_DEADBAND   32 // frames
+static uint32_t ring_target = 0; // frames, 0 = fixed ring, the driver picks the offsets
+static volatile uint32_t ring_read_total = 0; // bytes, advanced by the audio interrupt
+static uint32_t ring_write_total = 0;          // bytes
+static int32_t ring_avg_error = 0;             // frames * 16
 //static uint8_t* audio_rx_buffer = (uint8_t*)(RTG_BASE+AUDIO_RX_BUFFER_ADDRESS);
 
 static __inline__ __attribute__((always_inline)) int32_t ssat16(int32_t a)
@@ -72,10 +91,15 @@ void audio_init_i2s() {
    XAudioFormatterHwParams af_params;
    af_params.buf_addr = (uint32_t)audio_tx_buffer;
    af_params.bits_per_sample = BIT_DEPTH_16;
-   af_params.periods = AUDIO_NUM_PERIODS; // 1 second = 192000 bytes
+   af_params.periods = audio_num_periods; // 1 second = 192000 bytes
    af_params.active_ch = 2;
    // must be multiple of 32*channels = 64
-   af_params.bytes_per_period = AUDIO_BYTES_PER_PERIOD;
+   af_params.bytes_per_period = audio_bytes_per_period;
+
+   // the DMA starts again from the beginning of the ring
+   ring_read_total = 0;
+   ring_write_total = 0;
+   ring_avg_error = 0;
 
    XAudioFormatterSetFsMultiplier(&audio_formatter, (384*48)>>JUSTIFY_ENABLE, 48); // mclk = 256 * Fs // this doesn't really seem to change anything?!
    XAudioFormatterSetHwParams(&audio_formatter, &af_params);
@@ -131,8 +155,12 @@ void isr_audio_tx(void *dummy) {
       isra_count = 0;
    }
 */
+   ring_read_total += audio_bytes_per_period;
+
    if (interrupt_enabled_audio) {
-      amiga_interrupt_set(AMIGA_INTERRUPT_AUDIO);
+      // adaptive ring: ask for a new period only when the fill level is at the target
+      if (ring_target == 0 || (int32_t)(ring_write_total - ring_read_total) <= (int32_t)(ring_target * 4))
+         amiga_interrupt_set(AMIGA_INTERRUPT_AUDIO);
    }
 }
 
@@ -151,6 +179,117 @@ void audio_set_interrupt_enabled(int en) {
    audio_silence();
 }
 
+uint32_t audio_get_ring_size(void) {
+   return(audio_num_periods * audio_bytes_per_period);
+}
+
+// contiguous bytes that can be written at addr without reaching data the
+// DMA has not played yet (or the end of the ring), 0 if addr is not in the ring
+uint32_t audio_ring_space(uint8_t* addr) {
+   uint32_t size = audio_get_ring_size();
+   if (addr < audio_tx_buffer || addr >= audio_tx_buffer + size)
+      return(0);
+   uint32_t wp = addr - audio_tx_buffer;
+   uint32_t rp = ring_read_total % size;
+   uint32_t space = (rp + size - wp) % size;
+   if (space > size - wp)
+      space = size - wp;
+   return(space);
+}
+
+// returns 0 if the geometry is not valid (the formatter needs multiples of 64 bytes)
+int audio_set_ring(uint32_t periods, uint32_t bytes_per_period) {
+   if (periods < AUDIO_MIN_PERIODS || bytes_per_period < AUDIO_MIN_BYTES_PER_PERIOD
+         || (bytes_per_period & 63) || bytes_per_period > AUDIO_BYTES_PER_PERIOD
+         || periods * bytes_per_period > AUDIO_TX_BUFFER_SIZE) {
+      printf("[audio] illegal ring: %ld x %ld bytes\n", periods, bytes_per_period);
+      audio_params[AP_RING_PERIODS] = audio_num_periods;
+      audio_params[AP_RING_PERIOD_BYTES] = audio_bytes_per_period;
+      return(0);
+   }
+   DEBUG_AUDIO("[audio] ring: %ld x %ld bytes\n", periods, bytes_per_period);
+   audio_num_periods = periods;
+   audio_bytes_per_period = bytes_per_period;
+   audio_params[AP_RING_PERIODS] = periods;
+   audio_params[AP_RING_PERIOD_BYTES] = bytes_per_period;
+   return(1);
+}
+
+// frames, 0 = fixed ring
+void audio_set_ring_latency(uint32_t frames) {
+   uint32_t max = (audio_get_ring_size() - audio_bytes_per_period - AUDIO_BYTES_PER_PERIOD) / 4;
+   if ((int32_t)max < 0)
+      max = 0;
+   if (frames > max)
+      frames = max;
+   DEBUG_AUDIO("[audio] ring latency: %ld frames\n", frames);
+   ring_target = frames;
+   ring_write_total = ring_read_total;
+   ring_avg_error = 0;
+   audio_params[AP_RING_LATENCY] = frames;
+}
+
+// copy into the ring at the write position, NULL = silence
+static void ring_write(int16_t* data, uint32_t bytes) {
+   uint32_t size = audio_get_ring_size();
+   uint32_t wp = ring_write_total % size;
+   uint32_t first = size - wp;
+   if (first > bytes)
+      first = bytes;
+
+   if (data) {
+      memcpy(audio_tx_buffer + wp, data, first);
+      memcpy(audio_tx_buffer, (uint8_t*)data + first, bytes - first);
+   } else {
+      memset(audio_tx_buffer + wp, 0, first);
+      memset(audio_tx_buffer, 0, bytes - first);
+   }
+   ring_write_total += bytes;
+}
+
+// fill level controller, returns the number of 48 kHz frames this period
+// should be resampled to, or 0 to drop it
+static int ring_next_frames(int frames) {
+   int32_t fill = (int32_t)(ring_write_total - ring_read_total) / 4;
+
+   if (fill < 0) {
+      // the reader overtook us: start again at the target latency
+      audio_params[AP_STAT_UNDERRUNS]++;
+      ring_write_total = ring_read_total;
+      ring_write(NULL, ring_target * 4);
+      ring_avg_error = 0;
+      fill = ring_target;
+   }
+   audio_params[AP_STAT_LATENCY] = fill;
+
+   // never overwrite the period the DMA is reading
+   if ((uint32_t)(fill + frames + RING_MAX_ADJUST) * 4 > audio_get_ring_size() - audio_bytes_per_period) {
+      audio_params[AP_STAT_OVERRUNS]++;
+      audio_params[AP_STAT_DROPPED] += frames;
+      return(0);
+   }
+
+   // the producer is asked for data when the fill level drops to the target,
+   // so the periods arrive up to one ring period below it
+   int32_t error = fill - (int32_t)ring_target + (int32_t)(audio_bytes_per_period / 8);
+   ring_avg_error += (error * 16 - ring_avg_error) / 8;
+
+   int32_t avg = ring_avg_error / 16;
+   int adjust = 0;
+   if (avg > RING_DEADBAND || avg < -RING_DEADBAND) {
+      adjust = -avg / 32;
+      if (adjust > RING_MAX_ADJUST) adjust = RING_MAX_ADJUST;
+      if (adjust < -RING_MAX_ADJUST) adjust = -RING_MAX_ADJUST;
+      if (adjust == 0) adjust = avg > 0 ? -1 : 1;
+   }
+   if (adjust > 0)
+      audio_params[AP_STAT_STRETCHED] += adjust;
+   else
+      audio_params[AP_STAT_DROPPED] -= adjust;
+
+   return(frames + adjust);
+}
+
 // offset = offset from audio tx buffer
 // returns audio_buffer_collision (1 or 0)
 int audio_swab(uint16_t audio_buf_samples, uint32_t offset, int byteswap) {
@@ -174,6 +313,28 @@ int audio_swab(uint16_t audio_buf_samples, uint32_t offset, int byteswap) {
          sdata[i]=ssat16((sdata[i]*preamp)>>6);
       }
    }
+   if (ring_target) {
+      // adaptive ring: offset is the staging area, resample to 48 kHz
+      // with the controller adjustment and copy into the ring
+      // the period received lasts audio_buf_samples / audio_freq seconds,
+      // whatever the ring period is (5 ms periods for 20 ms of data)
+      int16_t* temp = (int16_t*)((uint8_t*)audio_tx_buffer+AUDIO_TX_BUFFER_SIZE*2);
+      int period_frames = audio_freq ? (int)(((uint32_t)audio_buf_samples * 48000 + audio_freq / 2) / audio_freq) : 0;
+      if (period_frames > AUDIO_BYTES_PER_PERIOD/4)
+         period_frames = AUDIO_BYTES_PER_PERIOD/4;
+      int frames = period_frames ? ring_next_frames(period_frames) : 0;
+      if (frames) {
+         if (audio_freq == 48000 && frames == audio_buf_samples)
+            memcpy(temp, sdata, frames * 4);
+         else
+            resample_s16(sdata, temp, audio_buf_samples, frames, frames);
+         equalizer(temp, frames);
+         lowpass_filter(temp, frames);
+         ring_write(temp, frames * 4);
+      }
+      return(0);
+   }
+
    // FIXME missing filter, wonky address calculation
    // resample if other freq
 
@@ -182,10 +343,10 @@ int audio_swab(uint16_t audio_buf_samples, uint32_t offset, int byteswap) {
             (int16_t*)((uint8_t*)audio_tx_buffer+AUDIO_TX_BUFFER_SIZE*2),
             audio_freq,
             48000,
-            AUDIO_BYTES_PER_PERIOD/4);
-      equalizer((int16_t*)((uint8_t*)audio_tx_buffer+AUDIO_TX_BUFFER_SIZE*2),AUDIO_BYTES_PER_PERIOD/4);
-      lowpass_filter((int16_t*)((uint8_t*)audio_tx_buffer+AUDIO_TX_BUFFER_SIZE*2),AUDIO_BYTES_PER_PERIOD/4);
-      memcpy(audio_tx_buffer + offset, (uint8_t*)audio_tx_buffer+AUDIO_TX_BUFFER_SIZE*2, AUDIO_BYTES_PER_PERIOD);
+            audio_bytes_per_period/4);
+      equalizer((int16_t*)((uint8_t*)audio_tx_buffer+AUDIO_TX_BUFFER_SIZE*2),audio_bytes_per_period/4);
+      lowpass_filter((int16_t*)((uint8_t*)audio_tx_buffer+AUDIO_TX_BUFFER_SIZE*2),audio_bytes_per_period/4);
+      memcpy(audio_tx_buffer + offset, (uint8_t*)audio_tx_buffer+AUDIO_TX_BUFFER_SIZE*2, audio_bytes_per_period);
    }
    else
    {
@@ -197,7 +358,7 @@ int audio_swab(uint16_t audio_buf_samples, uint32_t offset, int byteswap) {
 
    // is the distance of reader (audio dma) and writer (amiga) in the ring buffer too small?
    // then signal this condition so amiga can adjust
-   if (abs(txcount-offset) < AUDIO_BYTES_PER_PERIOD) {
+   if (abs(txcount-offset) < audio_bytes_per_period) {
       audio_buffer_collision = 1;
       //DEBUG_AUDIO("[aswap] ring collision %d\n", abs(txcount-offset));
    } else {
@@ -206,6 +367,9 @@ int audio_swab(uint16_t audio_buf_samples, uint32_t offset, int byteswap) {
 
    if (audio_buffer_collision) {
       DEBUG_AUDIO("[ax]:audio_buffer_collision\n");
+      // the driver restarts at the start of the ring, the mp3 read-ahead
+      // after this period is being played where it is
+      decode_mp3_drop_ahead();
 //      DEBUG_AUDIO("[aswap] d-a: %ld\n",txcount-offset);
 //      DEBUG_AUDIO("offset: %ld\n",offset);
 //      DEBUG_AUDIO("txcount: %ld\n",txcount);
@@ -214,6 +378,12 @@ int audio_swab(uint16_t audio_buf_samples, uint32_t offset, int byteswap) {
    return(audio_buffer_collision);
 }
 
+// hw mixer: mix all the AHI channels into the period at offset,
+// native endian, so the swab must be called without byteswap
+void audio_mix(uint16_t audio_buf_samples, uint32_t offset) {
+   ax_mixer_render((int16_t*)(audio_tx_buffer + offset), audio_buf_samples, audio_buf_samples * 50);
+}
+
 double resample_cur = 0;
 double resample_psampl = 0;
 double resample_psampr = 0;
@@ -225,7 +395,7 @@ void resample_s16(int16_t *input, int16_t *output, int in_sample_rate,
    int in_pos1 = 0, in_pos2 = 0;
    double sample1l = 0, sample2l = 0, sample1r = 0, sample2r = 0;
 
-   int inmax = (int) (step_dist * 960.0) - 1;
+   int inmax = (int) (step_dist * output_samples) - 1;
 
    for (int i = 0; i < output_samples; i++) {
       cur=i*step_dist+resample_cur;
@@ -396,7 +566,6 @@ void bandpass_filter(int band, int16_t *output, int output_samples)
    }
 #endif
 }
-extern uint32_t audio_params[];
 void equalizer(int16_t *output, int output_samples)
 {
    for(int i=0;i<10;i++)
@@ -423,7 +592,8 @@ void audio_set_rx_buffer(uint8_t* addr) {
 }
 */
 void audio_silence() {
-   memset(audio_tx_buffer, 0, AUDIO_TX_BUFFER_SIZE);
+   decode_mp3_park_ahead(); // it may be in the ring
+   memset(audio_tx_buffer, 0, audio_get_ring_size());
    reset_resampling();
 }
 
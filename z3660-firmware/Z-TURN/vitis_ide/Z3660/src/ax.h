@@ -29,7 +29,16 @@ enum {
 	AP_DSP_SET_EQ_BAND9,      // 20
 	AP_DSP_SET_EQ_BAND10,     // 21
 	AP_DSP_SET_STEREO_VOLUME, // 22
-	ZZ_NUM_AUDIO_PARAMS       // 23
+	AP_MIXER_CMD_OFFS,        // 23
+	AP_RING_PERIODS,          // 24
+	AP_RING_PERIOD_BYTES,     // 25
+	AP_RING_LATENCY,          // 26
+	AP_STAT_LATENCY,          // 27
+	AP_STAT_UNDERRUNS,        // 28
+	AP_STAT_OVERRUNS,         // 29
+	AP_STAT_STRETCHED,        // 30
+	AP_STAT_DROPPED,          // 31
+	ZZ_NUM_AUDIO_PARAMS       // 32
 
 };
 int audio_adau_init(int program_dsp);
@@ -41,6 +50,11 @@ void audio_clear_interrupt();
 uint32_t audio_get_interrupt();
 uint32_t audio_get_dma_transfer_count();
 int audio_swab(uint16_t audio_buf_samples, uint32_t offset, int byteswap);
+void audio_mix(uint16_t audio_buf_samples, uint32_t offset);
+int audio_set_ring(uint32_t periods, uint32_t bytes_per_period);
+void audio_set_ring_latency(uint32_t frames);
+uint32_t audio_get_ring_size(void);
+uint32_t audio_ring_space(uint8_t* addr);
 void audio_set_tx_buffer(uint8_t* addr);
 void audio_set_rx_buffer(uint8_t* addr);
 
@@ -61,6 +75,13 @@ void audio_adau_set_eq_gain(int band, double gain);
 
 void audio_reset(void);
 
+// REG_ZZ_AUDIO_SWAB flag: run the hw mixer into the period before the swab
+#define AUDIO_SWAB_MIX (1<<16)
+// REG_ZZ_AUDIO_CONFIG read bits
+#define AUDIO_CONFIG_PRESENT 1
+#define AUDIO_CONFIG_HWMIX   2
+#define AUDIO_CONFIG_ADAPTIVE 4
+
 #define JUSTIFY_ENABLE 1
 #define JUSTIFY_DISABLE 0
 
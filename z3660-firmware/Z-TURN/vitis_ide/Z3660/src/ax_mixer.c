@@ -0,0 +1,293 @@
+/*
+ * ax_mixer.c
+ *
+ *  Firmware side AHI mixer (see ax_mixer.h).
+ *
+ *  Every channel plays a sound from the sample pool. When the sound ends
+ *  the queued one (next_*) starts, with its queued frequency, volume and
+ *  pan, and the channel is flagged in started_mask so the driver can call
+ *  the AHI SoundFunc. Looping is just the queued sound being the same
+ *  sound, one-shot is AX_MIXER_NOSOUND queued, and double buffering is the
+ *  application queueing the other buffer from its SoundFunc.
+ *
+ *  There is no interpolation, the same as the AHI "fast" mixers.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
+#include "ax_mixer.h"
+#include "memorymap.h"
+#include "rtg/gfx.h"
+
+void DEBUG_AUDIO(const char *format, ...);
+
+#define AX_MIXER_MAX_FRAMES (AUDIO_BYTES_PER_PERIOD/4)
+
+typedef struct {
+   int active;
+   const uint8_t* data;   // first frame of the sound
+   uint32_t type;
+   uint32_t length;       // frames
+   int32_t dir;           // 1 forward, -1 backwards
+   uint32_t pos;          // frames played
+   uint32_t frac;         // 16 bit fraction of pos
+   uint32_t freq;
+   int32_t volume;
+   uint32_t pan;
+   uint32_t sound_seq;
+   uint32_t freq_seq;
+   uint32_t vol_seq;
+   uint32_t started;
+} AX_MIXER_VOICE;
+
+static volatile AX_MIXER_CMD* mixer_cmd = NULL;
+static AX_MIXER_VOICE voices[AX_MIXER_MAX_CHANNELS];
+static int32_t mix_buffer[AX_MIXER_MAX_FRAMES*2] __attribute__((aligned(16)));
+
+static const uint32_t frame_bytes[AX_MIXER_TYPE_NUM] = { 1, 2, 2, 4 };
+
+void ax_mixer_reset(void) {
+   memset(voices, 0, sizeof(voices));
+}
+
+void ax_mixer_set_cmd_block(uint8_t* addr) {
+   DEBUG_AUDIO("[mixer] command block: %p\n", addr);
+   mixer_cmd = (volatile AX_MIXER_CMD*)addr;
+   ax_mixer_reset();
+}
+
+static void voice_start_next(AX_MIXER_VOICE* v, volatile AX_MIXER_CHANNEL* c, int queued) {
+   uint32_t offset = swap32(c->next_offset);
+   uint32_t type = swap32(c->next_type);
+   int32_t length = (int32_t)swap32(c->next_length);
+
+   if (queued) {
+      v->freq = swap32(c->next_freq);
+      v->volume = (int32_t)swap32(c->next_volume);
+      v->pan = swap32(c->next_pan);
+   }
+   v->pos = 0;
+   v->active = 0;
+
+   if (offset == AX_MIXER_NOSOUND || type >= AX_MIXER_TYPE_NUM || length == 0)
+      return;
+
+   uint32_t fb = frame_bytes[type];
+   uint32_t frames = length < 0 ? -length : length;
+   int legal = offset >= AUDIO_MIXER_SAMPLE_ADDRESS
+         && offset < AUDIO_MIXER_SAMPLE_ADDRESS + AUDIO_MIXER_SAMPLE_SIZE
+         && frames <= AUDIO_MIXER_SAMPLE_SIZE / fb;
+   // never read outside the sample pool, whatever the Amiga sends
+   if (legal) {
+      if (length < 0)
+         legal = (frames - 1) * fb <= offset - AUDIO_MIXER_SAMPLE_ADDRESS;
+      else
+         legal = frames * fb <= AUDIO_MIXER_SAMPLE_ADDRESS + AUDIO_MIXER_SAMPLE_SIZE - offset;
+   }
+   if (!legal) {
+      DEBUG_AUDIO("[mixer] illegal sound: 0x%08lx (%ld)\n", offset, length);
+      return;
+   }
+
+   v->data = (const uint8_t*)(RTG_BASE + offset);
+   v->type = type;
+   v->length = frames;
+   v->dir = length < 0 ? -1 : 1;
+   v->active = 1;
+}
+
+// AHI volume and pan to Q14 gains (clamped to +/-2.0)
+static int32_t gain_q14(int64_t g) {
+   g >>= 2;
+   if (g > 0x7FFF) g = 0x7FFF;
+   if (g < -0x8000) g = -0x8000;
+   return((int32_t)g);
+}
+
+static void voice_gains(AX_MIXER_VOICE* v, int32_t master, int32_t* gl, int32_t* gr) {
+   int64_t vol = ((int64_t)v->volume * master) >> 16;
+   uint32_t pan = v->pan > 0x10000 ? 0x10000 : v->pan;
+   uint32_t pl = 0x10000 - pan;
+   uint32_t pr = pan;
+
+   // stereo sounds use pan as balance, so the center is full volume on both sides
+   if (v->type == AX_MIXER_TYPE_S8S || v->type == AX_MIXER_TYPE_S16S) {
+      pl = pl >= 0x8000 ? 0x10000 : pl << 1;
+      pr = pr >= 0x8000 ? 0x10000 : pr << 1;
+   }
+   *gl = gain_q14((vol * pl) >> 16);
+   *gr = gain_q14((vol * pr) >> 16);
+}
+
+static inline __attribute__((always_inline)) void fetch_frame(const uint8_t* data, int32_t idx, uint32_t type, int16_t* l, int16_t* r) {
+   const uint8_t* p;
+   switch (type) {
+   case AX_MIXER_TYPE_M8S:
+      *l = *r = (int16_t)(((int8_t)data[idx]) << 8);
+      break;
+   case AX_MIXER_TYPE_M16S:
+      p = data + idx * 2;
+      *l = *r = (int16_t)((p[0] << 8) | p[1]);
+      break;
+   case AX_MIXER_TYPE_S8S:
+      p = data + idx * 2;
+      *l = (int16_t)(((int8_t)p[0]) << 8);
+      *r = (int16_t)(((int8_t)p[1]) << 8);
+      break;
+   default: // AX_MIXER_TYPE_S16S
+      p = data + idx * 4;
+      *l = (int16_t)((p[0] << 8) | p[1]);
+      *r = (int16_t)((p[2] << 8) | p[3]);
+      break;
+   }
+}
+
+// reference mixer, also used for the span tails by the NEON version
+static void mix_span_c(AX_MIXER_VOICE* v, int32_t* acc, int count, uint32_t step, int32_t gl, int32_t gr) {
+   uint32_t pos = v->pos, frac = v->frac;
+   int16_t l, r;
+
+   for (int i = 0; i < count; i++) {
+      fetch_frame(v->data, v->dir * (int32_t)pos, v->type, &l, &r);
+      acc[i*2+0] += (l * gl) >> 14;
+      acc[i*2+1] += (r * gr) >> 14;
+      frac += step;
+      pos += frac >> 16;
+      frac &= 0xFFFF;
+   }
+   v->pos = pos;
+   v->frac = frac;
+}
+
+#ifdef __ARM_NEON__
+static void mix_span_neon(AX_MIXER_VOICE* v, int32_t* acc, int count, uint32_t step, int32_t gl, int32_t gr) {
+   int16_t sl[4] __attribute__((aligned(8)));
+   int16_t sr[4] __attribute__((aligned(8)));
+   int16x4_t vgl = vdup_n_s16(gl);
+   int16x4_t vgr = vdup_n_s16(gr);
+   uint32_t pos = v->pos, frac = v->frac;
+   int i;
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      for (int k = 0; k < 4; k++) {
+         fetch_frame(v->data, v->dir * (int32_t)pos, v->type, &sl[k], &sr[k]);
+         frac += step;
+         pos += frac >> 16;
+         frac &= 0xFFFF;
+      }
+      int32x4x2_t a = vld2q_s32(acc + i*2);
+      a.val[0] = vaddq_s32(a.val[0], vshrq_n_s32(vmull_s16(vld1_s16(sl), vgl), 14));
+      a.val[1] = vaddq_s32(a.val[1], vshrq_n_s32(vmull_s16(vld1_s16(sr), vgr), 14));
+      vst2q_s32(acc + i*2, a);
+   }
+   v->pos = pos;
+   v->frac = frac;
+   if (i < count)
+      mix_span_c(v, acc + i*2, count - i, step, gl, gr);
+}
+#define mix_span mix_span_neon
+#else
+#define mix_span mix_span_c
+#endif
+
+// returns the number of queued sounds started
+static int mix_voice(AX_MIXER_VOICE* v, volatile AX_MIXER_CHANNEL* c, int32_t* acc, int frames, int mix_freq, int32_t master) {
+   int starts = 0;
+
+   while (frames > 0 && v->active) {
+      uint32_t step = (uint32_t)(((uint64_t)v->freq << 16) / mix_freq);
+      int32_t gl, gr;
+      voice_gains(v, master, &gl, &gr);
+
+      // output frames until the end of the sound
+      uint32_t count = frames;
+      if (step) {
+         uint64_t left = (((uint64_t)(v->length - v->pos)) << 16) - v->frac;
+         uint64_t to_end = (left + step - 1) / step;
+         if (to_end < count)
+            count = (uint32_t)to_end;
+      }
+      mix_span(v, acc, count, step, gl, gr);
+      acc += count * 2;
+      frames -= count;
+
+      if (v->pos >= v->length) {
+         uint32_t over = v->pos - v->length;
+         voice_start_next(v, c, 1);
+         starts++;
+         if (v->active)
+            v->pos = over % v->length;
+      }
+   }
+   return(starts);
+}
+
+static inline int16_t sat16(int32_t a) {
+   if (a > 32767) return(32767);
+   if (a < -32768) return(-32768);
+   return((int16_t)a);
+}
+
+// output is native endian interleaved stereo, output_samples frames
+void ax_mixer_render(int16_t* output, int output_samples, int mix_freq) {
+   if (output_samples > AX_MIXER_MAX_FRAMES)
+      output_samples = AX_MIXER_MAX_FRAMES;
+
+   memset(mix_buffer, 0, output_samples * 2 * sizeof(int32_t));
+
+   if (mixer_cmd && mix_freq > 0) {
+      uint32_t num_channels = swap32(mixer_cmd->num_channels);
+      int32_t master = (int32_t)swap32(mixer_cmd->master_volume);
+      uint32_t started_mask = 0;
+
+      if (num_channels > AX_MIXER_MAX_CHANNELS)
+         num_channels = AX_MIXER_MAX_CHANNELS;
+
+      for (uint32_t i = 0; i < num_channels; i++) {
+         volatile AX_MIXER_CHANNEL* c = &mixer_cmd->ch[i];
+         AX_MIXER_VOICE* v = &voices[i];
+         uint32_t seq;
+
+         seq = swap32(c->freq_seq);
+         if (seq != v->freq_seq) {
+            v->freq_seq = seq;
+            v->freq = swap32(c->freq);
+         }
+         seq = swap32(c->vol_seq);
+         if (seq != v->vol_seq) {
+            v->vol_seq = seq;
+            v->volume = (int32_t)swap32(c->volume);
+            v->pan = swap32(c->pan);
+         }
+         seq = swap32(c->sound_seq);
+         if (seq != v->sound_seq) {
+            v->sound_seq = seq;
+            v->frac = 0;
+            voice_start_next(v, c, 0);
+         }
+
+         int starts = mix_voice(v, c, mix_buffer, output_samples, mix_freq, master);
+         if (starts) {
+            v->started += starts;
+            mixer_cmd->sound_started[i] = swap32(v->started);
+            started_mask |= 1UL << i;
+         }
+      }
+      mixer_cmd->started_mask = swap32(started_mask);
+   }
+
+#ifdef __ARM_NEON__
+   int i;
+   for (i = 0; i + 4 <= output_samples * 2; i += 4)
+      vst1_s16(output + i, vqmovn_s32(vld1q_s32(mix_buffer + i)));
+   for (; i < output_samples * 2; i++)
+      output[i] = sat16(mix_buffer[i]);
+#else
+   for (int i = 0; i < output_samples * 2; i++)
+      output[i] = sat16(mix_buffer[i]);
+#endif
+}
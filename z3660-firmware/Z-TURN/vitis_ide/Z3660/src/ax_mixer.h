@@ -0,0 +1,59 @@
+/*
+ * ax_mixer.h
+ *
+ *  Firmware side AHI mixer. The AHI driver uploads the channel state
+ *  (sound, volume, pan, frequency) to a command block in card memory and
+ *  the mixing is done here, straight into the I2S ring.
+ *
+ *  All the fields of the command block are written by the Amiga, so they
+ *  are big endian.
+ */
+
+#ifndef SRC_AX_MIXER_H_
+#define SRC_AX_MIXER_H_
+
+#include <stdint.h>
+
+#define AX_MIXER_MAX_CHANNELS 32
+#define AX_MIXER_NOSOUND      0xFFFFFFFF
+
+// same values as AHIST_M8S, AHIST_M16S, AHIST_S8S, AHIST_S16S
+enum {
+   AX_MIXER_TYPE_M8S,
+   AX_MIXER_TYPE_M16S,
+   AX_MIXER_TYPE_S8S,
+   AX_MIXER_TYPE_S16S,
+   AX_MIXER_TYPE_NUM
+};
+
+// AHISF_IMM changes bump the *_seq counters, the rest is used when the
+// current sound ends (AHI semantics)
+typedef struct {
+   uint32_t sound_seq;
+   uint32_t freq_seq;
+   uint32_t vol_seq;
+   uint32_t freq;          // Hz
+   int32_t  volume;        // Fixed 16.16
+   uint32_t pan;           // Fixed 16.16, 0 = left, 0x10000 = right
+   uint32_t next_freq;
+   int32_t  next_volume;
+   uint32_t next_pan;
+   uint32_t next_offset;   // card offset of the first frame, AX_MIXER_NOSOUND = stop
+   uint32_t next_type;
+   int32_t  next_length;   // frames, negative = play backwards
+} AX_MIXER_CHANNEL;
+
+typedef struct {
+   uint32_t num_channels;
+   int32_t  master_volume; // Fixed 16.16
+   uint32_t started_mask;  // written by ARM: channels that started a queued sound
+   uint32_t reserved;
+   uint32_t sound_started[AX_MIXER_MAX_CHANNELS]; // written by ARM
+   AX_MIXER_CHANNEL ch[AX_MIXER_MAX_CHANNELS];
+} AX_MIXER_CMD;
+
+void ax_mixer_set_cmd_block(uint8_t* addr);
+void ax_mixer_reset(void);
+void ax_mixer_render(int16_t* output, int output_samples, int mix_freq);
+
+#endif /* SRC_AX_MIXER_H_ */
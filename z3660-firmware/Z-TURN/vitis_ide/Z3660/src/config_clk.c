@@ -188,6 +188,8 @@ void configure_clk(int clk, int verbose, int nbr)
 	   usleep(1000000);
 	   NBR_ARM(1);
    }
+   if(shared)
+      shared->bus_clock_changes++; // core1 calibrates its bus timing again
 #else
    printf("Clk config bypassed ...\n");
    verbose=1;
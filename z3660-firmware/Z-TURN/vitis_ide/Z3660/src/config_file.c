@@ -75,6 +75,7 @@ const char *config_item_names[CONFITEM_NUM] = {
       "ext_kickstart9",
 	  "enable_test",
 	  "bootscreen_resolution",
+	  "mobo_ram_shadow",
 };
 const char *bootmode_names[BOOTMODE_NUM] = {
       "CPU",
@@ -91,6 +92,11 @@ const char *yesnomin_names[YESNOMIN_NUM] = {
       "YES",
 	  "MIN",
 };
+const char *mobo_shadow_names[MOBOSHADOW_NUM] = {
+      "NO",
+      "WRITETHROUGH",
+      "WRITEBACK",
+};
 const char *resolution_names[RES_NUM] = {
       "1920x1080",
       "1280x720",
@@ -142,6 +148,7 @@ void load_default_config(void)
    config.ext_kickstart9[0]=0;
    config.enable_test=0;
    config.bootscreen_resolution=RES_800x600;
+   config.mobo_ram_shadow=SHADOW_NO;
 }
 void write_config_file(char *filename)
 {
@@ -216,6 +223,15 @@ void write_config_file(char *filename)
    print_line(&fil,"# Select a boot screen resolution (1920x1080, 1280x720 or 800x600)\n");
    print_line(&fil,"bootscreen_resolution 1920x1080\n");
    print_line(&fil,"\n");
+   print_line(&fil,"# Emulation: keep a copy of the motherboard fast RAM in ARM memory and run from it\n");
+   print_line(&fil,"# (NO, WRITETHROUGH to write the board too, or WRITEBACK to write it on demand)\n");
+   print_line(&fil,"# WRITEBACK: the board RAM is only written at an Amiga reset, a boot mode change\n");
+   print_line(&fil,"# or MRW in the console. Until then it is stale: a Zorro bus master reading it,\n");
+   print_line(&fil,"# an ARM crash or a power off loses what the 68k wrote.\n");
+   print_line(&fil,"mobo_ram_shadow NO\n");
+   print_line(&fil,"#mobo_ram_shadow WRITETHROUGH\n");
+   print_line(&fil,"#mobo_ram_shadow WRITEBACK\n");
+   print_line(&fil,"\n");
    f_close(&fil);
 
    printf("File %s written OK\n",filename);
@@ -304,6 +320,14 @@ int get_yesnomin_type(char *cmd) {
   }
   return NO;
 }
+int get_mobo_shadow_type(char *cmd) {
+  for (int i = 0; i < MOBOSHADOW_NUM; i++) {
+    if (strcmp(cmd, mobo_shadow_names[i]) == 0) {
+      return i;
+    }
+  }
+  return SHADOW_NO;
+}
 int get_resolution_type(char *cmd) {
   for (int i = 0; i < RES_NUM; i++) {
     if (strcmp(cmd, resolution_names[i]) == 0) {
@@ -553,6 +577,12 @@ retry:
          printf("[CFG] Boot Screen Resolution %s\n", resolution_names[config.bootscreen_resolution]);
          break;
 
+      case CONFITEM_MOBO_RAM_SHADOW:
+         get_next_string(parse_line, cur_cmd, &str_pos, ' ');
+         config.mobo_ram_shadow=get_mobo_shadow_type(cur_cmd);
+         printf("[CFG] Motherboard RAM shadow %s\n", mobo_shadow_names[config.mobo_ram_shadow]);
+         break;
+
       case CONFITEM_NONE:
       default:
          printf("[CFG] Unknown config item %s on line %d.\n", cur_cmd, cur_line);
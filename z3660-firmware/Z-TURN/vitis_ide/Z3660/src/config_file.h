@@ -27,6 +27,12 @@ enum YESNOMIN{
 	_MIN,
 	YESNOMIN_NUM
 };
+enum MOBOSHADOW{
+	SHADOW_NO,
+	SHADOW_WRITETHROUGH,
+	SHADOW_WRITEBACK,
+	MOBOSHADOW_NUM
+};
 enum BOOTSCREEN_RES{
 	RES_1920x1080,
 	RES_1280x720,
@@ -68,6 +74,7 @@ typedef struct {
 	char ext_kickstart9[150];
 	int enable_test;
 	int bootscreen_resolution;
+	int mobo_ram_shadow;
 } CONFIG;
 typedef struct {
 	int bootmode;
@@ -139,6 +146,7 @@ enum CONFITEM {
 	CONFITEM_EXT_KICKSTART9,
 	CONFITEM_ENABLE_TEST,
 	CONFITEM_BOOTSCREEN_RESOLUTION,
+	CONFITEM_MOBO_RAM_SHADOW,
 	CONFITEM_NUM
 };
 
@@ -14,6 +14,11 @@
 #include "config_file.h"
 #include "xscuwdt.h"
 #include "scsi/scsi.h"
+#include "memorymap.h"
+#include "xtime_l.h"
+
+#define JIT_ROMCACHE_FILE DEFAULT_ROOT "z3660_jit_rom.bin"
+#define JIT_PROFILE_FILE  DEFAULT_ROOT "z3660_jit_profile.bin"
 
 void write_rtg_register(uint16_t zaddr,uint32_t zdata);
 uint32_t read_rtg_register(uint16_t zaddr);
@@ -24,6 +29,7 @@ SHARED *shared;
 void init_shared(void)
 {
    shared=(SHARED *)0xFFFF0000;
+   shared->bus_clock_changes=0;
 }
 
 void other_tasks(void);
@@ -31,6 +37,70 @@ extern CONFIG config;
 extern ENV_FILE_VARS env_file_vars_temp;
 //extern int bm,sb,ar,cr,ks,ext_ks,*scsi_num;
 
+// JIT traces of the kickstart saved on a previous boot, core1 checks
+// they belong to this kickstart and JIT build (see jit/compemu_romcache.h)
+static void load_jit_romcache(void)
+{
+   static FIL fil;
+   unsigned int NumBytesRead=0;
+
+   shared->jit_romcache_size=0;
+   if(f_open(&fil,JIT_ROMCACHE_FILE, FA_OPEN_EXISTING | FA_READ)!=FR_OK)
+      return;
+   f_read(&fil,(void *)JIT_ROMCACHE_ADDRESS,JIT_ROMCACHE_SIZE,&NumBytesRead);
+   f_close(&fil);
+   shared->jit_romcache_size=NumBytesRead;
+   printf("JIT ROM cache %d bytes\n",NumBytesRead);
+}
+
+// writes a buffer filled by core1 to the SD card
+static int save_core1_buffer(const char *name,uint32_t address,uint32_t size)
+{
+   static FIL fil;
+   static FATFS fatfs;
+   unsigned int NumBytesWritten=0;
+   int mounted=0;
+
+   Xil_L1DCacheInvalidateRange(address,size); // written by core1, L2 is shared
+   int ret=f_open(&fil,name, FA_CREATE_ALWAYS | FA_WRITE);
+   if(ret==FR_NOT_ENABLED) // the SD is only kept mounted by the SCSI emulation
+   {
+      f_mount(&fatfs, DEFAULT_ROOT, 1); // 1 mount immediately
+      mounted=1;
+      ret=f_open(&fil,name, FA_CREATE_ALWAYS | FA_WRITE);
+   }
+   if(ret==FR_OK)
+   {
+      f_write(&fil,(void *)address,size,&NumBytesWritten);
+      f_close(&fil);
+   }
+   if(mounted)
+      f_mount(NULL, DEFAULT_ROOT, 1); // NULL unmount
+   if(NumBytesWritten!=size)
+   {
+      printf("Error writing %s\n",name);
+      return(0);
+   }
+   return(1);
+}
+
+// core1 asks for it once the boot has settled
+static void save_jit_romcache(void)
+{
+   save_core1_buffer(JIT_ROMCACHE_FILE,JIT_ROMCACHE_ADDRESS,shared->jit_romcache_size);
+   dsb();
+   shared->jit_romcache_save=0;
+}
+
+// JIT hot block profile, asked by the debug console (see jit/compemu_profile.h)
+static void save_jit_profile(void)
+{
+   if(save_core1_buffer(JIT_PROFILE_FILE,JIT_PROFILE_ADDRESS,shared->jit_profile_size))
+      printf("JIT profile saved to %s (%ld bytes)\n",JIT_PROFILE_FILE,shared->jit_profile_size);
+   dsb();
+   shared->jit_profile_save=0;
+}
+
 int load_rom(void)
 {
 //#define DUMP_ROM
@@ -105,6 +175,7 @@ retry:
       }
       f_close(&fil);
       printf("\nFile read OK\n");
+      load_jit_romcache();
    }
    else
    {
@@ -261,6 +332,23 @@ void hard_reboot(void)
    XScuWdt_SetWdMode(&instance);
    while(1);
 }
+// With mobo_ram_shadow WRITEBACK the 68k writes only core1's copy of the
+// motherboard RAM, so it is written to the board before the ARM reboots:
+// the next boot mode, or the emulator loading its copy again, finds what
+// the 68k left there. Core1 does it in z3660_tasks() and clears the request
+// when done, a core1 that doesn't answer leaves the board as it is.
+#define MOBO_RAM_WRITEBACK_TIMEOUT 5000 // ms, 16 MB over the bus
+void mobo_ram_writeback_wait(void)
+{
+   if(shared->mobo_ram_shadow!=SHADOW_WRITEBACK)
+      return;
+   printf("[Core0] Writing back the motherboard RAM...\n");
+   shared->mobo_ram_writeback=1;
+   for(int i=0;i<MOBO_RAM_WRITEBACK_TIMEOUT && shared->mobo_ram_writeback;i++)
+      usleep(1000);
+   if(shared->mobo_ram_writeback)
+      printf("[Core0] Core1 didn't write back the motherboard RAM\n");
+}
 extern int no_init;
 void cpu_emulator(void)
 {
@@ -271,6 +359,7 @@ void cpu_emulator(void)
 
    printf("Starting CPU emulator on Core1\n");
    printf("Waiting ack from core1...\n");
+   shared->core1_worker=0;
    *(volatile uint32_t *)(0xFFFFFFF0)=0x30000000;
    Xil_DCacheFlush();
    Xil_ICacheInvalidate();
@@ -364,6 +453,10 @@ void cpu_emulator(void)
 //      else
       {
          other_tasks();
+         if(shared->jit_romcache_save==1)
+            save_jit_romcache();
+         if(shared->jit_profile_save==2)
+            save_jit_profile();
          static int counter=0;
          counter++;
          if(counter==10240)
@@ -421,6 +514,7 @@ void cpu_emulator(void)
                   }
                }
 //               printf("[Core1] Reset inactive (UP)...\n");
+               mobo_ram_writeback_wait();
                hard_reboot();
             }
          }
@@ -428,3 +522,83 @@ void cpu_emulator(void)
    }
 }
 
+// In CPU boot mode core1 never runs an emulator, so core0 can use it as
+// a worker. It is started the first time a job is requested, with the MMU
+// table of core0 so the job code and data are at the same addresses.
+// L2 is shared by both cores, so only L1 maintenance is needed.
+static int core1_worker_state=0; // 0 stopped, 1 running, -1 not available
+extern uint32_t MMUTable;
+int core1_job_available(void)
+{
+   if(config.boot_mode!=CPU)
+      return(0);
+   if(core1_worker_state==0)
+   {
+      printf("Starting worker on Core1\n");
+      shared->core1_worker=1;
+      shared->core1_job=0;
+      shared->core1_job_arg=(uint32_t)&MMUTable;
+      *(volatile uint32_t *)(0xFFFFFFF0)=0x30000000;
+      Xil_DCacheFlush();
+      Xil_ICacheInvalidate();
+      __asm__("sev");
+      shared->shared_data=1;
+      for(int i=0;i<1000 && shared->shared_data==1;i++)
+         usleep(1000);
+      core1_worker_state=shared->shared_data==1?-1:1;
+      if(core1_worker_state<0)
+         printf("Core1 worker not answering\n");
+   }
+   return(core1_worker_state==1);
+}
+// Hold core1 in reset for good (XAPP1079 sequence, without the release).
+// The video codecs use its memory (0x30000000 up) as scratch, so they call
+// this before, and a worker that doesn't finish its job is stopped too.
+#define SLCR_LOCK            0xF8000004
+#define SLCR_UNLOCK          0xF8000008
+#define SLCR_A9_CPU_RST_CTRL 0xF8000244
+#define A9_RST1_MASK         0x02
+#define A9_CLKSTOP1_MASK     0x20
+void core1_worker_stop(void)
+{
+   if(core1_worker_state==1)
+   {
+      printf("Stopping worker on Core1\n");
+      Xil_Out32(SLCR_UNLOCK, 0xDF0D);
+      uint32_t RegVal = Xil_In32(SLCR_A9_CPU_RST_CTRL);
+      RegVal |= A9_RST1_MASK;
+      Xil_Out32(SLCR_A9_CPU_RST_CTRL, RegVal);
+      RegVal |= A9_CLKSTOP1_MASK;
+      Xil_Out32(SLCR_A9_CPU_RST_CTRL, RegVal);
+      Xil_Out32(SLCR_LOCK, 0x767B);
+      shared->core1_worker=0;
+      shared->core1_job=0;
+   }
+   core1_worker_state=-1;
+}
+void core1_job_start(void (*job)(void *),void *arg)
+{
+   Xil_L1DCacheFlush();
+   shared->core1_job_arg=(uint32_t)arg;
+   dsb();
+   shared->core1_job=(uint32_t)job;
+}
+// returns 0 if the job didn't finish in a second: core1 is then stopped
+// and the caller has to do the job itself
+int core1_job_wait(void)
+{
+   XTime start,now;
+   XTime_GetTime(&start);
+   while(shared->core1_job!=0)
+   {
+      XTime_GetTime(&now);
+      if(now-start>COUNTS_PER_SECOND)
+      {
+         printf("Core1 worker timeout\n");
+         core1_worker_stop();
+         return(0);
+      }
+   }
+   Xil_L1DCacheFlush();
+   return(1);
+}
@@ -31,5 +31,11 @@ unsigned int READ_NBG_ARM(void);
 
 void M68K_StartEmu(void *addr, void *fdt);
 
+int core1_job_available(void);
+void core1_job_start(void (*job)(void *),void *arg);
+int core1_job_wait(void);
+void core1_worker_stop(void);
+void mobo_ram_writeback_wait(void);
+
 
 #endif /* SRC_CPU_EMULATOR_H_ */
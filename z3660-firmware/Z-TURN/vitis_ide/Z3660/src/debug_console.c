@@ -8,6 +8,7 @@
 #include "xuartps_hw.h"
 #include "config_clk.h"
 #include "config_file.h"
+#include "cpu_emulator.h"
 #include <stdlib.h>
 
 void debug_console_help(void);
@@ -49,6 +50,10 @@ typedef enum {
 	RFPGA,   RESET_FPGA,
 	RAMIGA,  RESET_AMIGA,
 	RARM,    RESET_ARM,
+	MRW,     MOBO_RAM_WRITEBACK,
+	JP,      JIT_PROFILE,
+	JPT,     JIT_PROFILE_TOP,
+	JPS,     JIT_PROFILE_SAVE,
 
 	NUM_COMMANDS
 } COMMANDS;
@@ -85,6 +90,10 @@ const char *command_names[NUM_COMMANDS] = {
 	"RFPGA",   "RESET FPGA",
 	"RAMIGA",  "RESET AMIGA",
 	"RARM",    "RESET ARM",
+	"MRW",     "MOBO RAM WRITEBACK",
+	"JP",      "JIT PROFILE",
+	"JPT",     "JIT PROFILE TOP",
+	"JPS",     "JIT PROFILE SAVE",
 };
 extern clock_data cd[];
 extern CONFIG config;
@@ -549,9 +558,44 @@ void debug_console_loop(void)
 							break;
 						case RARM:
 						case RESET_ARM:
+							mobo_ram_writeback_wait();
 							hard_reboot();
 							debug_console.subcmd=0;
 							break;
+						case MRW:
+						case MOBO_RAM_WRITEBACK:
+							if(shared->mobo_ram_shadow==SHADOW_WRITEBACK)
+							{
+								shared->mobo_ram_writeback=1; // core1 writes its copy to the board
+								xil_printf("Writing back the motherboard RAM\r\n");
+							}
+							else
+								xil_printf("Motherboard RAM shadow is not in WRITEBACK mode\r\n");
+							debug_console.subcmd=0;
+							break;
+						case JP:
+						case JIT_PROFILE:
+							shared->jit_profile=!shared->jit_profile;
+							if(shared->jit_profile)
+								xil_printf("JIT PROFILE ON\r\n");
+							else
+								xil_printf("JIT PROFILE OFF\r\n");
+							debug_console.subcmd=0;
+							break;
+						case JPT:
+						case JIT_PROFILE_TOP:
+							shared->jit_profile_top=20; // core1 lists the 20 hottest blocks
+							debug_console.subcmd=0;
+							break;
+						case JPS:
+						case JIT_PROFILE_SAVE:
+							if(shared->jit_profile_save==0)
+							{
+								shared->jit_profile_save=1; // core1 fills the buffer and core0 writes it
+								xil_printf("Saving the JIT profile\r\n");
+							}
+							debug_console.subcmd=0;
+							break;
 						default:
 							xil_printf("Not defined command '%s'. Type 'help' or 'h' for help.\r\n",debug_console.cmd_buf);
 							debug_console.subcmd=0;
@@ -793,5 +837,9 @@ void debug_console_help(void)
 	xil_printf("'RFPGA'   or 'RESET FPGA' for toggling reset FPGA\r\n");
 	xil_printf("'RAMIGA'  or 'RESET AMIGA' for resetting the AMIGA (sequence of the two above)\r\n");
 	xil_printf("'RARM'    or 'RESET ARM' for resetting the ARM (reboot the entire system)\r\n");
+	xil_printf("'MRW'     or 'MOBO RAM WRITEBACK' for writing the motherboard RAM shadow back to the board\r\n");
+	xil_printf("'JP'      or 'JIT PROFILE' for toggling the JIT hot block profiler (UAEJIT only)\r\n");
+	xil_printf("'JPT'     or 'JIT PROFILE TOP' list the hottest JIT blocks (UAEJIT only)\r\n");
+	xil_printf("'JPS'     or 'JIT PROFILE SAVE' save the JIT profile to the SD card (UAEJIT only)\r\n");
 }
 #endif
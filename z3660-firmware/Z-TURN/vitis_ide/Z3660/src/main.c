@@ -952,6 +952,14 @@ int main()
 
    shared->load_rom_addr=(uint32_t)0x00F80000;
    shared->load_ext_rom_addr=(uint32_t)0x00F00000;
+   shared->jit_romcache_size=0;
+   shared->jit_romcache_save=0;
+   shared->mobo_ram_shadow=config.mobo_ram_shadow;
+   shared->mobo_ram_writeback=0;
+   shared->jit_profile=0;
+   shared->jit_profile_top=0;
+   shared->jit_profile_save=0;
+   shared->jit_profile_size=0;
 
    if(config.kickstart!=0 && (kickstart_pointer[config.kickstart]!=0))
    {
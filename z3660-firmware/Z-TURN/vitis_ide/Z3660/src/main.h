@@ -103,6 +103,18 @@ typedef struct {
 	volatile uint32_t disassemble;         // 0xFFFF0088
 	volatile uint32_t musashi_step;        // 0xFFFF008C
 	volatile uint32_t reset_emulator_dis;  // 0xFFFF0090
+	volatile uint32_t core1_worker;        // 0xFFFF0094
+	volatile uint32_t core1_job;           // 0xFFFF0098
+	volatile uint32_t core1_job_arg;       // 0xFFFF009C
+	volatile uint32_t jit_romcache_size;   // 0xFFFF00A0
+	volatile uint32_t jit_romcache_save;   // 0xFFFF00A4
+	volatile uint32_t bus_clock_changes;   // 0xFFFF00A8
+	volatile uint32_t mobo_ram_shadow;     // 0xFFFF00AC
+	volatile uint32_t mobo_ram_writeback;  // 0xFFFF00B0
+	volatile uint32_t jit_profile;         // 0xFFFF00B4
+	volatile uint32_t jit_profile_top;     // 0xFFFF00B8
+	volatile uint32_t jit_profile_save;    // 0xFFFF00BC
+	volatile uint32_t jit_profile_size;    // 0xFFFF00C0
 } SHARED;
 extern SHARED *shared;
 #define REG_BASE_ADDRESS XPAR_Z3660_0_BASEADDR
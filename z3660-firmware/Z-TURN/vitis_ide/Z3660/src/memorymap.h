@@ -16,7 +16,13 @@
 #define RTG_BASE                    0x18000000
 
 #define FRAMEBUFFER_ADDRESS         (RTG_BASE+0x00200000)
+#define FRAMEBUFFER_AREA_SIZE       (Z3_SCRATCH_ADDR-FRAMEBUFFER_ADDRESS) // screens, up to the Z3 scratch
 #define AUDIO_TX_BUFFER_SIZE        (AUDIO_BYTES_PER_PERIOD * AUDIO_NUM_PERIODS)
+// the ring size can be changed at runtime, but never above AUDIO_TX_BUFFER_SIZE
+#define AUDIO_MIN_PERIODS           2
+#define AUDIO_MIN_BYTES_PER_PERIOD  256
+// adaptive ring: the driver writes each period here and the firmware copies it into the ring
+#define AUDIO_TX_STAGING_OFFSET     AUDIO_TX_BUFFER_SIZE
 
 #define Z3_SCRATCH_ADDR             (RTG_BASE+0x03200000) // FIXME @ _Bnu
 #define ADDR_ADJ                    0x001F0000 // FIXME @ _Bnu
@@ -27,11 +33,19 @@
 
 #define AUDIO_TX_BUFFER_ADDRESS     0x07CE0000 // default, changed by driver
 #define AUDIO_RX_BUFFER_ADDRESS     0x07D00000 // default, changed by driver
+#define AUDIO_MIXER_SAMPLE_ADDRESS  0x07400000 // AHI hw mixer sounds, managed by the driver
+#define AUDIO_MIXER_SAMPLE_SIZE     0x00800000
+#define AUDIO_MIXER_CMD_ADDRESS     0x07C00000 // AHI hw mixer command block (default, changed by driver)
 #define TX_BD_LIST_START_ADDRESS    0x07E00000 //---------------------------------
 #define RX_BD_LIST_START_ADDRESS    0x07E80000 //                                 | <- 1 MB STRONG_ORDERED
 #define RX_BACKLOG_ADDRESS          0x07EF0000 // 32 * 2048 space (64 kB) --------
 #define TX_FRAME_ADDRESS            0x07F00000
 #define RX_FRAME_ADDRESS            0x07F10000
+#define MOBO_RAM_SHADOW_ADDRESS     0x17000000 // copy of the motherboard RAM (0x07000000-0x07FFFFFF), free DDR below RTG_BASE, core1's MMU maps it at 0x07000000
+#define JIT_PROFILE_ADDRESS         0x3FC00000 // JIT hot block profile, core1 memory, saved by core0
+#define JIT_PROFILE_SIZE            0x00100000
+#define JIT_ROMCACHE_ADDRESS        0x3FD00000 // JIT traces of the kickstart, core1 memory, loaded and saved by core0
+#define JIT_ROMCACHE_SIZE           0x00100000
 #define USB_BLOCK_STORAGE_ADDRESS   0x3FE10000 // FIXME move all of these to a memory table header file
 #define SCSI_NO_DMA_ADDRESS         (RTG_BASE+0x80000)
 #define BOOT_ROM_ADDRESS            (RTG_BASE+0x6000)
@@ -16,21 +16,51 @@ unsigned long FifoSize = 0;
 unsigned long FifoWriteIdx = 0; // in
 unsigned long FifoReadIdx  = 0; // out
 
+// Whole frames are decoded directly into the output, also when they don't
+// fit in max_samples, as long as they fit in room_samples. What goes past
+// max_samples is kept as read-ahead for the next call, which normally asks
+// for the output right after this one (the next period in the ring), so the
+// samples are already in place.
+static mp3d_sample_t *ahead_ptr = NULL;
+static int ahead_samples = 0;
+static mp3d_sample_t ahead_spill[MINIMP3_MAX_SAMPLES_PER_FRAME];
+
+static void decode_ahead_clear(void) {
+	ahead_ptr = NULL;
+	ahead_samples = 0;
+}
+
+// Underrun: the DMA has reached the read-ahead where it was decoded (or is
+// about to), and the next call starts somewhere else. Moving it there would
+// play the same samples twice, so drop it.
+void decode_mp3_drop_ahead(void) {
+	decode_ahead_clear();
+}
+
+// The read-ahead is about to be overwritten (ring silenced), keep a copy.
+void decode_mp3_park_ahead(void) {
+	if(ahead_samples && ahead_ptr != ahead_spill) {
+		memmove(ahead_spill, ahead_ptr, ahead_samples * sizeof(mp3d_sample_t));
+		ahead_ptr = ahead_spill;
+	}
+}
+
 static size_t read_cb(void *buf, size_t size, void *user_data) {
+	const uint8_t *src = user_data;
+	uint8_t *dst = buf;
+	unsigned long WriteIdx = FifoWriteIdx;
 	unsigned long BytesRead = 0;
-	long BytesToRead = size;
-	volatile unsigned char *src = user_data;
-	volatile unsigned char *dst = buf;
-//	unsigned long origFifoReadIdx=FifoReadIdx;
-
-	while(BytesToRead) {
-		// If FiFo is empty then exit the loop.
-		if(FifoReadIdx == FifoWriteIdx) break;
-		dst[BytesRead++] = src[FifoReadIdx++];
+
+	// At most two contiguous segments: up to the write index or the end of
+	// the FIFO, then from the start of the FIFO after a wrap.
+	while(BytesRead < size && FifoReadIdx != WriteIdx) {
+		unsigned long Chunk = (WriteIdx > FifoReadIdx ? WriteIdx : FifoSize) - FifoReadIdx;
+		if(Chunk > size - BytesRead) Chunk = size - BytesRead;
+		memcpy(dst + BytesRead, src + FifoReadIdx, Chunk);
+		BytesRead   += Chunk;
+		FifoReadIdx += Chunk;
 		if(FifoReadIdx >= FifoSize) FifoReadIdx = 0;
-		BytesToRead--;
 	}
-//	printf("BytesRead=%ld from %p to %p\n",BytesRead,src+origFifoReadIdx,dst);
 	return(BytesRead);
 }
 
@@ -40,6 +70,7 @@ static int seek_cb(uint64_t position, void *user_data) {
 }
 
 void fifo_clear(void) {
+	decode_ahead_clear();
 	FifoReadIdx  = 0;
 	FifoWriteIdx = 0;
 }
@@ -67,49 +98,112 @@ unsigned long fifo_get_read_index(void) {
 }
 size_t read_samples;
 
-int decode_mp3_samples(void* output_buffer, int max_samples) {
-	int max_bytes = max_samples * 2;
-	int out_offset = 0;
-	int total_bytes_decoded = 0;
+// Decode the next frame straight into out, bypassing the mp3d->buffer copy
+// of mp3dec_ex_read_frame(). Only used in FIFO mode with nothing left in
+// mp3d->buffer and nothing to skip, otherwise it returns -1 and the caller
+// goes the mp3dec_ex_read_frame() way. The input side is the same as in
+// mp3dec_ex_read_frame(), so the PCM is exactly the same.
+static int decode_frame_direct(mp3d_sample_t *out) {
+	mp3dec_ex_t *dec = &mp3d;
+
+	if(!dec->io || dec->last_error || dec->to_skip
+		|| (dec->detected_samples && dec->cur_sample >= dec->detected_samples)
+		|| dec->buffer_consumed != dec->buffer_samples)
+		return(-1);
+
+	if((dec->input_filled - dec->input_consumed) < MINIMP3_BUF_SIZE) {
+		int eof = 0;
+		memmove((uint8_t*)dec->file.buffer, (uint8_t*)dec->file.buffer + dec->input_consumed, dec->input_filled - dec->input_consumed);
+		dec->input_filled -= dec->input_consumed;
+		dec->input_consumed = 0;
+		size_t readed = dec->io->read((uint8_t*)dec->file.buffer + dec->input_filled, dec->file.size - dec->input_filled, dec->io->read_data);
+		if(readed > (dec->file.size - dec->input_filled)) {
+			dec->last_error = MP3D_E_IOERROR;
+			readed = 0;
+		}
+		if(readed != (dec->file.size - dec->input_filled))
+			eof = 1;
+		dec->input_filled += readed;
+		if(eof)
+			mp3dec_skip_id3v1((uint8_t*)dec->file.buffer, &dec->input_filled);
+	}
+	if(!(dec->input_filled - dec->input_consumed))
+		return(-1); // no input, let mp3dec_ex_read_frame() say so
+
+	int samples = mp3dec_decode_frame(&dec->mp3d, dec->file.buffer + dec->input_consumed,
+		dec->input_filled - dec->input_consumed, out, &frame_info);
+	dec->input_consumed += frame_info.frame_bytes;
+	dec->offset += frame_info.frame_bytes;
+	if(dec->info.hz != frame_info.hz || dec->info.layer != frame_info.layer
+		|| (samples && dec->info.channels != frame_info.channels)) {
+		dec->last_error = MP3D_E_DECODE;
+		return(0);
+	}
+	samples *= frame_info.channels;
+	// the padding at the end, as given by the Xing/LAME header
+	if(dec->detected_samples && dec->cur_sample + samples >= dec->detected_samples)
+		samples = dec->detected_samples - dec->cur_sample;
+	dec->cur_sample += samples;
+	return(samples);
+}
 
-	// Clear destination buffer before trying to decode.
-	memset(output_buffer, 0, max_bytes);
+int decode_mp3_samples(void* output_buffer, int max_samples, int room_samples) {
+	mp3d_sample_t *out = output_buffer;
+	int done = 0;
 
 	// this will point into mp3d->buffer, which is defined on the stack
 	// as mp3d_sample_t buffer[MINIMP3_MAX_SAMPLES_PER_FRAME]
 	mp3d_sample_t * pcm_buffer = NULL;
 
-	while (1) {
-		read_samples = mp3dec_ex_read_frame(&mp3d, &pcm_buffer, &frame_info, max_samples);
-		max_samples -= read_samples;
-
-		int bytes_decoded = read_samples * sizeof(mp3d_sample_t);
-		total_bytes_decoded += bytes_decoded;
-/*
-		if(bytes_decoded>0)
-		{
-			printf("[mp3] decoded: %d bytes\n", bytes_decoded);
-			printf("[mp3] output_buffer: %p max_bytes: %d\n", output_buffer, max_bytes);
-		}
-*/
-		if (bytes_decoded > 0) {
-			int bytes_to_copy = bytes_decoded;
-			memcpy(output_buffer + out_offset, pcm_buffer, bytes_to_copy);
-			out_offset += bytes_decoded;
+	if(ahead_samples) {
+		// Not where we stopped (ring wrap, overrun restart, resample buffer).
+		// If the read-ahead is bigger than this call, park it first so the
+		// rest doesn't get overwritten.
+		if(ahead_ptr != out && ahead_samples > max_samples)
+			decode_mp3_park_ahead();
+		done = ahead_samples < max_samples ? ahead_samples : max_samples;
+		if(ahead_ptr != out)
+			memmove(out, ahead_ptr, done * sizeof(mp3d_sample_t));
+		ahead_ptr += done;
+		ahead_samples -= done;
+	}
 
-			if (out_offset >= max_bytes) {
+	while(done < max_samples) {
+		int direct = -1;
+		if(room_samples - done >= MINIMP3_MAX_SAMPLES_PER_FRAME)
+			direct = decode_frame_direct(out + done);
+		if(direct > 0) {
+			read_samples = direct;
+		} else if(direct == 0) {
+			// the decoder skipped some garbage, try again
+			if(mp3d.last_error)
 				break;
-			}
+			continue;
 		} else {
-			break;
+			read_samples = mp3dec_ex_read_frame(&mp3d, &pcm_buffer, &frame_info, max_samples - done);
+			if(read_samples == 0)
+				break;
+			memcpy(out + done, pcm_buffer, read_samples * sizeof(mp3d_sample_t));
 		}
+		done += read_samples;
+	}
+
+	if(done > max_samples) {
+		ahead_ptr = out + max_samples;
+		ahead_samples = done - max_samples;
+		done = max_samples;
+	}
+	// Only the part that was not decoded has to be silenced.
+	else if(done < max_samples) {
+		memset(out + done, 0, (max_samples - done) * sizeof(mp3d_sample_t));
 	}
 
-	return(total_bytes_decoded);
+	return(done * sizeof(mp3d_sample_t));
 }
 
 int decode_mp3_init_fifo(uint8_t* input_buffer, size_t input_buffer_size) {
 	memset(&frame_info, 0, sizeof(frame_info));
+	decode_ahead_clear();
 
 	FifoSize   = input_buffer_size;
 	FifoAddr   = input_buffer;
@@ -127,6 +221,7 @@ int decode_mp3_init_fifo(uint8_t* input_buffer, size_t input_buffer_size) {
 
 int decode_mp3_init(uint8_t* input_buffer, size_t input_buffer_size) {
 	memset(&frame_info, 0, sizeof(frame_info));
+	decode_ahead_clear();
 
 	// sets up input_buffer as mp3d->file.buffer
 	int ret = mp3dec_ex_open_buf(&mp3d, input_buffer, input_buffer_size, MP3D_DO_NOT_SCAN);
@@ -19,7 +19,13 @@ int decode_mp3_init_fifo(uint8_t* input_buffer, size_t input_buffer_size);
 void fifo_clear(void);
 void fifo_set_write_index(unsigned long aWriteIndex);
 unsigned long fifo_get_read_index(void);
-int decode_mp3_samples(void* output_buffer, int max_samples);
+// room_samples: samples that can be written at output_buffer, >= max_samples
+int decode_mp3_samples(void* output_buffer, int max_samples, int room_samples);
+void decode_mp3_park_ahead(void);
+void decode_mp3_drop_ahead(void);
 int mp3_get_hz();
 int mp3_get_channels();
+
+// read-ahead room for one whole frame (MINIMP3_MAX_SAMPLES_PER_FRAME)
+#define MP3_FRAME_ROOM_SAMPLES (1152*2)
 #endif //_MP3_H_
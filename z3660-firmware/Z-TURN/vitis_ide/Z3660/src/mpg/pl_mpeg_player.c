@@ -7,6 +7,11 @@
 #include "pl_mpeg_player.h"
 #include "ff.h"
 #include "../rtg/fonts.h"
+#include "../rtg/gfx.h"
+#include "../main.h"
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
 
 #define APP_TEXTURE_MODE_YCRCB 1
 #define APP_TEXTURE_MODE_RGB 2
@@ -19,6 +24,15 @@ typedef struct {
 	uint8_t texture_mode;
 
 	uint8_t *rgb_data;
+
+	// video output, straight into the screen format
+	uint8_t *fb[2];      // front and back screen (double buffered with the pan offset)
+	int back;
+	uint32_t flip_ticks;
+	uint32_t pitch;      // bytes
+	uint16_t colormode;
+	int dst_x, dst_y, dst_w, dst_h;
+	int scale_mode;
 } app_t;
 
 app_t App_t;
@@ -51,6 +65,8 @@ void app_destroy(app_t *self);
 
 void app_on_video(plm_t *player, plm_frame_t *frame, void *user);
 void app_on_audio(plm_t *player, plm_samples_t *samples, void *user);
+void app_set_output(app_t *self, int x, int y, int w, int h, int scale_mode);
+void set_palette(uint32_t zdata,uint16_t op_palette);
 
 app_t * app_create(XFILE *fh,const char *filename, int texture_mode) {
 	app_t *self = &App_t;
@@ -116,15 +132,61 @@ app_t * app_create(XFILE *fh,const char *filename, int texture_mode) {
 
 	self->rgb_data = (uint8_t *)vs.framebuffer;
 
+	// Two screens, the back one right after the visible one. The frame is
+	// converted into the back screen and shown with the pan offset on the
+	// next vblank, so there is no tearing.
+	int bpp = vs.colormode == MNTVA_COLOR_32BIT ? 4 : vs.colormode == MNTVA_COLOR_8BIT ? 1 : 2;
+	int screen_w = vs.vmode_hsize / vs.vmode_hdiv;
+	int screen_h = vs.vmode_vsize / vs.vmode_vdiv;
+	self->colormode = vs.colormode;
+	self->pitch = screen_w * bpp;
+	self->fb[0] = (uint8_t *)vs.framebuffer;
+	self->fb[1] = self->fb[0] + ((vs.framebuffer_size + 0xFFF) & ~0xFFF);
+	// the back screen has to fit in the framebuffer area, below the Z3
+	// scratch, otherwise draw into the visible one (with tearing)
+	if ((uint32_t)self->fb[1] + vs.framebuffer_size > FRAMEBUFFER_ADDRESS + FRAMEBUFFER_AREA_SIZE)
+		self->fb[1] = self->fb[0];
+	self->back = 1;
+	vs.framebuffer_pan_offset = 0;
+	memset(self->fb[1], 0, vs.framebuffer_size);
+
+	if (self->colormode == MNTVA_COLOR_8BIT) {
+		// RGB 3-3-2 for the dithered output
+		for (int i = 0; i < 256; i++) {
+			uint32_t r = ((i >> 5) & 7) * 255 / 7;
+			uint32_t g = ((i >> 2) & 7) * 255 / 7;
+			uint32_t b = (i & 3) * 255 / 3;
+			set_palette((i << 24) | (r << 16) | (g << 8) | b, OP_PALETTE);
+		}
+	}
+
+	// Centered, scaled down to the screen keeping the aspect if it doesn't fit.
+	int w = plm_get_width(self->plm);
+	int h = plm_get_height(self->plm);
+	int scale_mode = PLM_SCALE_NONE;
+	if (w > screen_w || h > screen_h) {
+		if (w * screen_h > h * screen_w) {
+			h = h * screen_w / w;
+			w = screen_w;
+		}
+		else {
+			w = w * screen_h / h;
+			h = screen_h;
+		}
+		scale_mode = PLM_SCALE_NEAREST;
+	}
+	app_set_output(self, (screen_w - w) / 2, (screen_h - h) / 2, w, h, scale_mode);
+
 	return(self);
 }
 
 void app_destroy(app_t *self) {
 	plm_destroy(self->plm);
+	vs.framebuffer_pan_offset = 0;
 
 	free(self);
 }
-extern uint32_t ticks;
+extern volatile uint32_t ticks;
 uint32_t getTicks(void)
 {
 	return(ticks);
@@ -233,6 +295,287 @@ void plm_frame_to_bgra_shanshe(plm_frame_t *frame, uint8_t *dest) {
 	}
 }
 
+// Frame output into the RTG screen formats.
+// Every output line is first put together as full resolution Y, Cb and Cr
+// (chroma upsampled, and scaled if needed), then converted and stored in
+// the screen format. The conversion is the same BT.601 as above, with the
+// coefficients in Q6 so that NEON can do it in 16 bits:
+//   y' = (y-16)*75, r = y'+cr*102, g = y'-cb*25-cr*52, b = y'+cb*129
+#define PLM_MAX_LINE 2048
+
+static uint8_t line_y[PLM_MAX_LINE+16] __attribute__((aligned(16)));
+static uint8_t line_cb[PLM_MAX_LINE+16] __attribute__((aligned(16)));
+static uint8_t line_cr[PLM_MAX_LINE+16] __attribute__((aligned(16)));
+static uint8_t line_t0[PLM_MAX_LINE+16] __attribute__((aligned(16)));
+static uint8_t line_t1[PLM_MAX_LINE+16] __attribute__((aligned(16)));
+static uint8_t line_t2[PLM_MAX_LINE+16] __attribute__((aligned(16)));
+// horizontal scaling: source index and 7 bit weight of the next pixel
+static uint16_t scale_x[PLM_MAX_LINE];
+static uint8_t scale_fx[PLM_MAX_LINE];
+static uint16_t scale_cx[PLM_MAX_LINE];
+static uint8_t scale_cfx[PLM_MAX_LINE];
+static int scale_src_w = 0;
+static int scale_dst_w = 0;
+
+// 4x4 ordered dither, 0..15
+static const uint8_t dither_4x4[4][4] = {
+	{  0,  8,  2, 10 },
+	{ 12,  4, 14,  6 },
+	{  3, 11,  1,  9 },
+	{ 15,  7, 13,  5 },
+};
+
+static inline void yuv_to_rgb(int y, int cb, int cr, int *r, int *g, int *b) {
+	int yq = (y - 16) * 75;
+	cb -= 128;
+	cr -= 128;
+	*r = yq + cr * 102;
+	*g = yq - cb * 25 - cr * 52;
+	*b = yq + cb * 129;
+}
+
+static inline uint8_t q6_to_u8(int v) {
+	return(plm_clamp((v + 32) >> 6));
+}
+
+#ifdef __ARM_NEON__
+typedef struct {
+	int16x8_t r, g, b;
+} plm_rgb16_t;
+
+static inline __attribute__((always_inline)) plm_rgb16_t yuv_to_rgb_neon(const uint8_t *y, const uint8_t *cb, const uint8_t *cr) {
+	plm_rgb16_t o;
+	int16x8_t yq = vmulq_n_s16(vreinterpretq_s16_u16(vsubl_u8(vld1_u8(y), vdup_n_u8(16))), 75);
+	int16x8_t u = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(cb), vdup_n_u8(128)));
+	int16x8_t v = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(cr), vdup_n_u8(128)));
+	o.r = vqaddq_s16(yq, vmulq_n_s16(v, 102));
+	o.g = vqsubq_s16(yq, vmlaq_n_s16(vmulq_n_s16(u, 25), v, 52));
+	o.b = vqaddq_s16(yq, vmulq_n_s16(u, 129));
+	return(o);
+}
+#endif
+
+static void line_to_bgra(const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint32_t *dst, int n) {
+	int i = 0;
+#ifdef __ARM_NEON__
+	for (; i + 8 <= n; i += 8) {
+		plm_rgb16_t c = yuv_to_rgb_neon(y + i, cb + i, cr + i);
+		uint8x8x4_t p;
+		p.val[0] = vqrshrun_n_s16(c.b, 6);
+		p.val[1] = vqrshrun_n_s16(c.g, 6);
+		p.val[2] = vqrshrun_n_s16(c.r, 6);
+		p.val[3] = vdup_n_u8(0);
+		vst4_u8((uint8_t *)(dst + i), p);
+	}
+#endif
+	for (; i < n; i++) {
+		int r, g, b;
+		yuv_to_rgb(y[i], cb[i], cr[i], &r, &g, &b);
+		dst[i] = q6_to_u8(b) | (q6_to_u8(g) << 8) | (q6_to_u8(r) << 16);
+	}
+}
+
+// big endian, like the Amiga writes it
+static void line_to_rgb565(const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint16_t *dst, int n) {
+	int i = 0;
+#ifdef __ARM_NEON__
+	for (; i + 8 <= n; i += 8) {
+		plm_rgb16_t c = yuv_to_rgb_neon(y + i, cb + i, cr + i);
+		uint16x8_t p = vshll_n_u8(vqrshrun_n_s16(c.r, 6), 8);
+		p = vsriq_n_u16(p, vshll_n_u8(vqrshrun_n_s16(c.g, 6), 8), 5);
+		p = vsriq_n_u16(p, vshll_n_u8(vqrshrun_n_s16(c.b, 6), 8), 11);
+		vst1q_u8((uint8_t *)(dst + i), vrev16q_u8(vreinterpretq_u8_u16(p)));
+	}
+#endif
+	for (; i < n; i++) {
+		int r, g, b;
+		yuv_to_rgb(y[i], cb[i], cr[i], &r, &g, &b);
+		uint16_t p = ((q6_to_u8(r) & 0xF8) << 8) | ((q6_to_u8(g) & 0xFC) << 3) | (q6_to_u8(b) >> 3);
+		dst[i] = swap16(p);
+	}
+}
+
+// RGB 3-3-2 with ordered dither, x and row are screen coordinates for the pattern
+static void line_to_clut8(const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *dst, int n, int x, int row) {
+	const uint8_t *d = dither_4x4[row & 3];
+	int i = 0;
+#ifdef __ARM_NEON__
+	// the pattern for 8 pixels starting at x, as the offset added in Q6:
+	// half a step below to half a step above (R, G step 32, B step 64)
+	int16_t dp[8];
+	for (int k = 0; k < 8; k++)
+		dp[k] = (d[(x + k) & 3] * 2 - 15) << 6;
+	int16x8_t drg = vld1q_s16(dp);
+	int16x8_t db = vshlq_n_s16(drg, 1);
+	for (; i + 8 <= n; i += 8) {
+		plm_rgb16_t c = yuv_to_rgb_neon(y + i, cb + i, cr + i);
+		uint8x8_t r = vqrshrun_n_s16(vqaddq_s16(c.r, drg), 6);
+		uint8x8_t g = vqrshrun_n_s16(vqaddq_s16(c.g, drg), 6);
+		uint8x8_t b = vqrshrun_n_s16(vqaddq_s16(c.b, db), 6);
+		uint8x8_t p = vand_u8(r, vdup_n_u8(0xE0));
+		p = vorr_u8(p, vand_u8(vshr_n_u8(g, 3), vdup_n_u8(0x1C)));
+		p = vorr_u8(p, vshr_n_u8(b, 6));
+		vst1_u8(dst + i, p);
+	}
+#endif
+	for (; i < n; i++) {
+		int r, g, b;
+		int o = d[(x + i) & 3] * 2 - 15;
+		yuv_to_rgb(y[i], cb[i], cr[i], &r, &g, &b);
+		r = q6_to_u8(r + (o << 6));
+		g = q6_to_u8(g + (o << 6));
+		b = q6_to_u8(b + (o << 7));
+		dst[i] = (r & 0xE0) | ((g >> 3) & 0x1C) | (b >> 6);
+	}
+}
+
+// full resolution chroma from a half resolution line
+static void chroma_upsample(const uint8_t *src, uint8_t *dst, int n) {
+	int i = 0;
+#ifdef __ARM_NEON__
+	for (; i + 16 <= n; i += 16) {
+		uint8x8_t c = vld1_u8(src + i / 2);
+		uint8x8x2_t z = vzip_u8(c, c);
+		vst1_u8(dst + i, z.val[0]);
+		vst1_u8(dst + i + 8, z.val[1]);
+	}
+#endif
+	for (; i < n; i++)
+		dst[i] = src[i >> 1];
+}
+
+// (a*(128-f)+b*f)/128 for a whole line
+static void blend_lines(const uint8_t *a, const uint8_t *b, uint8_t *dst, int n, int f) {
+	int i = 0;
+#ifdef __ARM_NEON__
+	uint8x8_t wa = vdup_n_u8(128 - f);
+	uint8x8_t wb = vdup_n_u8(f);
+	for (; i + 8 <= n; i += 8) {
+		uint16x8_t acc = vmull_u8(vld1_u8(a + i), wa);
+		acc = vmlal_u8(acc, vld1_u8(b + i), wb);
+		vst1_u8(dst + i, vrshrn_n_u16(acc, 7));
+	}
+#endif
+	for (; i < n; i++)
+		dst[i] = (a[i] * (128 - f) + b[i] * f + 64) >> 7;
+}
+
+static void scale_line(const uint8_t *src, uint8_t *dst, const uint16_t *sx, const uint8_t *fx, int n, int bilinear) {
+	if (bilinear) {
+		for (int i = 0; i < n; i++) {
+			const uint8_t *p = src + sx[i];
+			dst[i] = fx[i] ? (p[0] * (128 - fx[i]) + p[1] * fx[i] + 64) >> 7 : p[0];
+		}
+	}
+	else {
+		for (int i = 0; i < n; i++)
+			dst[i] = src[sx[i]];
+	}
+}
+
+// 16.16 source position of the output pixel center, 'size' source pixels on 'n' output pixels
+static inline int32_t scale_pos(int i, int size, int n) {
+	int32_t pos = (int32_t)((((int64_t)(2 * i + 1) * size) << 15) / n) - 32768;
+	return(pos < 0 ? 0 : pos);
+}
+
+static void scale_tables(int src_w, int dst_w) {
+	int cw = (src_w + 1) >> 1;
+	for (int i = 0; i < dst_w; i++) {
+		int32_t pos = scale_pos(i, src_w, dst_w);
+		scale_x[i] = pos >> 16;
+		scale_fx[i] = scale_x[i] < src_w - 1 ? (pos >> 9) & 0x7F : 0;
+		pos = scale_pos(i, cw, dst_w);
+		scale_cx[i] = pos >> 16;
+		scale_cfx[i] = scale_cx[i] < cw - 1 ? (pos >> 9) & 0x7F : 0;
+	}
+	scale_src_w = src_w;
+	scale_dst_w = dst_w;
+}
+
+// One output line of the target rect into line_y, line_cb, line_cr. Returns
+// the luma line, which is the frame itself when not scaling.
+static const uint8_t *frame_line(app_t *self, plm_frame_t *frame, int oy) {
+	int src_w = frame->width, src_h = frame->height;
+	int yw = frame->y.width, cw = frame->cb.width;
+	int w = self->dst_w;
+
+	if (self->scale_mode == PLM_SCALE_NONE) {
+		chroma_upsample(frame->cb.data + (oy >> 1) * cw, line_cb, w);
+		chroma_upsample(frame->cr.data + (oy >> 1) * cw, line_cr, w);
+		return(frame->y.data + oy * yw);
+	}
+
+	int bilinear = self->scale_mode == PLM_SCALE_BILINEAR;
+	int ch = (src_h + 1) >> 1;
+	int32_t py = scale_pos(oy, src_h, self->dst_h);
+	int32_t pc = scale_pos(oy, ch, self->dst_h);
+	int y0 = py >> 16, c0 = pc >> 16;
+	int fy = y0 < src_h - 1 ? (py >> 9) & 0x7F : 0;
+	int fc = c0 < ch - 1 ? (pc >> 9) & 0x7F : 0;
+	const uint8_t *ys = frame->y.data + y0 * yw;
+	const uint8_t *cbs = frame->cb.data + c0 * cw;
+	const uint8_t *crs = frame->cr.data + c0 * cw;
+
+	if (bilinear) {
+		if (fy) {
+			blend_lines(ys, ys + yw, line_t0, src_w, fy);
+			ys = line_t0;
+		}
+		if (fc) {
+			blend_lines(cbs, cbs + cw, line_t1, (src_w + 1) >> 1, fc);
+			blend_lines(crs, crs + cw, line_t2, (src_w + 1) >> 1, fc);
+			cbs = line_t1;
+			crs = line_t2;
+		}
+	}
+	scale_line(ys, line_y, scale_x, scale_fx, w, bilinear);
+	scale_line(cbs, line_cb, scale_cx, scale_cfx, w, bilinear);
+	scale_line(crs, line_cr, scale_cx, scale_cfx, w, bilinear);
+	return(line_y);
+}
+
+void app_set_output(app_t *self, int x, int y, int w, int h, int scale_mode) {
+	if (w > PLM_MAX_LINE)
+		w = PLM_MAX_LINE;
+	self->dst_x = x;
+	self->dst_y = y;
+	self->dst_w = w;
+	self->dst_h = h;
+	self->scale_mode = scale_mode;
+	scale_dst_w = 0; // tables are made for the next frame
+}
+
+void plm_frame_to_screen(app_t *self, plm_frame_t *frame, uint8_t *dest) {
+	if (self->scale_mode == PLM_SCALE_NONE) {
+		// 1:1, clipped to the frame
+		if (self->dst_w > (int)frame->width)
+			self->dst_w = frame->width;
+		if (self->dst_h > (int)frame->height)
+			self->dst_h = frame->height;
+	}
+	else if (scale_src_w != (int)frame->width || scale_dst_w != self->dst_w) {
+		scale_tables(frame->width, self->dst_w);
+	}
+
+	for (int oy = 0; oy < self->dst_h; oy++) {
+		const uint8_t *ys = frame_line(self, frame, oy);
+		int row = self->dst_y + oy;
+		uint8_t *d = dest + row * self->pitch;
+		switch (self->colormode) {
+			case MNTVA_COLOR_32BIT:
+				line_to_bgra(ys, line_cb, line_cr, (uint32_t *)d + self->dst_x, self->dst_w);
+				break;
+			case MNTVA_COLOR_8BIT:
+				line_to_clut8(ys, line_cb, line_cr, d + self->dst_x, self->dst_w, self->dst_x, row);
+				break;
+			default:
+				line_to_rgb565(ys, line_cb, line_cr, (uint16_t *)d + self->dst_x, self->dst_w);
+				break;
+		}
+	}
+}
+
 uint32_t frame_count=0;
 
 void app_on_video(plm_t *mpeg, plm_frame_t *frame, void *user) {
@@ -242,7 +585,12 @@ void app_on_video(plm_t *mpeg, plm_frame_t *frame, void *user) {
 	// YCrCb->RGB conversion is done on the CPU.
 #define RENDER_YCBCR
 #ifdef RENDER_YCBCR
-	plm_frame_to_bgra_shanshe(frame, self->rgb_data);
+	// don't draw into the buffer that is still on screen until the flip
+	// (on the vblank) has happened
+	while (ticks == self->flip_ticks);
+	uint8_t *back = self->fb[self->back];
+	plm_frame_to_screen(self, frame, back);
+	set_fb((uint32_t *)back, vs.vmode_hsize/vs.vmode_hdiv);
 #endif
 	frame_count++;
 	static int last_int_time=0;
@@ -258,6 +606,12 @@ void app_on_video(plm_t *mpeg, plm_frame_t *frame, void *user) {
 	char str[20];
 	sprintf(str,"fps=%2.2f",fps);
 	displayStringAt(&Font20,10,10,(uint8_t*)str,LEFT_MODE);
+#ifdef RENDER_YCBCR
+	// show it on the next vblank
+	vs.framebuffer_pan_offset = back - self->fb[0];
+	self->flip_ticks = ticks;
+	self->back ^= 1;
+#endif
 }
 
 void app_on_audio(plm_t *mpeg, plm_samples_t *samples, void *user) {
@@ -22,6 +22,11 @@ size_t Xtell(FIL *);
 size_t Xread(BYTE* P, size_t L, size_t B, FIL *F);
 
 void player_mpeg(FIL *fh,char *filename);
+
+// scaling of the video into the output rect
+#define PLM_SCALE_NONE     0
+#define PLM_SCALE_NEAREST  1
+#define PLM_SCALE_BILINEAR 2
 typedef void AudioCallback(void* userdata, uint8_t* stream, uint32_t len);
 typedef struct {
 	int freq;
@@ -25,6 +25,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include "../cpu_emulator.h"
 
 #define inline
 
@@ -554,6 +555,7 @@ void Codec47Decoder_Init(int idx, int width, int height) {
 	dc->_lastTableWidth = -1;
 	dc->_width = width;
 	dc->_height = height;
+	core1_worker_stop(); // the scratch is in core1 memory
 	dc->_tableBig = (byte *)0x30000000 + num_decoders * 0x1000000;
 	dc->_tableSmall = (byte *)0x30800000 + num_decoders * 0x1000000;
 	if ((dc->_tableBig != NULL) && (dc->_tableSmall != NULL)) {
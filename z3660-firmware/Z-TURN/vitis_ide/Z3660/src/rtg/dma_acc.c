@@ -141,6 +141,39 @@ void handle_acc_op(uint16_t zdata)
             acc_fill_flat_tri(data->offset[0], &tridef, data->x[0], data->y[0], data->rgb[0], data->u8_user[0]);
             break;
         }
+        case ACC_OP_DRAW_TEX_TRI: {
+            // offset[0]: dest, pitch[0]: dest pitch (pixels), x[0]/y[0]: clip size
+            // offset[1]: texture, pitch[1]: texture pitch (pixels), x[1]/y[1]: texture size
+            // u8_user[0]: bpp, u8_user[1]: ACC_TEXTRI_* flags, rgb[1]: colour key
+            // clut4: x, y, u, v, q for the 3 vertices, x u v q in 16.16, y in pixels
+            TriangleDef tridef;
+            int32_t *pts_ptr = (int32_t *)data->clut4;
+            int32_t *vtx[3] = { tridef.a, tridef.b, tridef.c };
+
+            SWAP16(data->x[0]); SWAP16(data->y[0]);
+            SWAP16(data->x[1]); SWAP16(data->y[1]);
+
+            SWAP32(data->offset[0]);
+            SWAP32(data->offset[1]);
+            SWAP16(data->pitch[0]);
+            SWAP16(data->pitch[1]);
+            data->offset[0] += ADDR_ADJ;
+            data->offset[1] += ADDR_ADJ;
+
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 5; j++)
+                    vtx[i][j] = (int32_t)swap32(pts_ptr[i * 5 + j]);
+                // keep the edge walking in range
+                if (vtx[i][0] < -(8191 << 16)) vtx[i][0] = -(8191 << 16);
+                if (vtx[i][0] > (8191 << 16)) vtx[i][0] = 8191 << 16;
+                if (vtx[i][1] < -8191) vtx[i][1] = -8191;
+                if (vtx[i][1] > 8191) vtx[i][1] = 8191;
+            }
+
+            acc_draw_tex_tri(data->offset[0], data->pitch[0], &tridef, data->x[0], data->y[0],
+                data->offset[1], data->x[1], data->y[1], data->pitch[1], data->u8_user[0], data->u8_user[1], data->rgb[1]);
+            break;
+        }
         // ALLOC/DATA OPS
         case ACC_OP_ALLOC_SURFACE: {
             unsigned int sfc_size = 0;
@@ -19,6 +19,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
 #include "gfx.h"
 #include "../main.h"
 
@@ -1373,252 +1376,358 @@ void acc_fill_circle(uint32_t dest, uint16_t pitch, int16_t x0, int16_t y0, int1
 	}
 }
 
-uint8_t *tri_array = 0;
-
-void TriTexLine(int32_t x1, int32_t x2, int32_t y, int32_t tx1, int32_t tx2, int32_t ty1, int32_t ty2, uint16_t w, uint16_t h, uint32_t fg_color)
+/*
+ * Triangles for the acc_* surfaces.
+ *
+ * The vertices are TriangleDef a/b/c: [0] x in 16.16, [1] y in pixels,
+ * [2] u and [3] v in texels 16.16, [4] q = 1/w in 16.16 (only used by the
+ * perspective correct textured triangles).
+ *
+ * The edges are walked in fixed point with an exact quotient/remainder
+ * step, rows are drawn from the top vertex to the row before the bottom
+ * one and pixels from ceil(left x) to the pixel before ceil(right x), so
+ * triangles sharing an edge never overlap nor leave a gap.
+ */
+
+typedef struct {
+	int32_t x;     // 16.16
+	int32_t step;  // floor(dx/dy)
+	int32_t rem;   // dx - step*dy
+	int32_t dy;
+	int32_t err;
+} AccTriEdge;
+
+typedef void (*AccTriSpan)(void *ctx, int32_t y, int32_t x1, int32_t x2);
+
+static void acc_tri_edge_init(AccTriEdge *e, int32_t *from, int32_t *to)
 {
-	// Round to ensure that problems caused by rounding errors don't occur (jumping lines)
-	x2 &= 0xFFFF0000;
-	x1 &= 0xFFFF0000;
-	uint8_t u8_fg = fg_color >> 24;
+	int32_t dx = to[0] - from[0];
 
-	// Sort values to make drawing from left to right possible
-	if (x2 < x1) {
-		int32_t temp = x2;
-		x2 = x1;
-		x1 = temp;
-		temp = tx2;
-		tx2 = tx1;
-		tx1 = temp;
-		temp = ty2;
-		ty2 = ty1;
-		ty1 = temp;
-	}
-
-	int32_t xdelta = (x2 - x1) >>16;
-	if (xdelta <1)
+	e->x = from[0];
+	e->dy = to[1] - from[1];
+	e->err = 0;
+	if (e->dy <= 0) {
+		e->step = e->rem = 0;
 		return;
+	}
+	e->step = dx / e->dy;
+	e->rem = dx - e->step * e->dy;
+	if (e->rem < 0) {
+		e->step--;
+		e->rem += e->dy;
+	}
+}
 
-	int xd = xdelta;
-
-	//Calculate start Tex-X and Tex-X-Increment
-	int txi = tx1; //fixed point
-	int32_t txd = (tx2 - tx1) / xdelta;
-	int txdi = txd; //same here
+static inline void acc_tri_edge_next(AccTriEdge *e)
+{
+	e->x += e->step;
+	e->err += e->rem;
+	if (e->err >= e->dy) {
+		e->x++;
+		e->err -= e->dy;
+	}
+}
 
-	//Same for Tex-Y and Tex-Y-Increment
-	int tyi = ty1; //fixed point
-	int32_t tyd = (ty2 - ty1) / xdelta;
-	int tydi = tyd; //same here
+static void acc_tri_walk(TriangleDef *d, int32_t w, int32_t h, AccTriSpan span, void *ctx)
+{
+	int32_t *pa = d->a, *pb = d->b, *pc = d->c, *tmp;
+	AccTriEdge long_edge, short_edge;
+	AccTriEdge *left, *right;
 
+	if (pa[1] > pb[1]) { tmp = pa; pa = pb; pb = tmp; }
+	if (pb[1] > pc[1]) { tmp = pb; pb = pc; pc = tmp; }
+	if (pa[1] > pb[1]) { tmp = pa; pa = pb; pb = tmp; }
 
-	//Clipping begin
-	//If line isn't inside screen -> outta here
-	x1 >>= 16;
-	x2 >>= 16;
+	if (pa[1] == pc[1])
+		return;
 
-	if (x1 > ((w - 1)) || (x2 < 0))
+	// the short edges are on the left if b is left of the long edge
+	int64_t cross = (int64_t)(pb[0] - pa[0]) * (pc[1] - pa[1]) - (int64_t)(pc[0] - pa[0]) * (pb[1] - pa[1]);
+	if (cross == 0)
 		return;
 
-	/*If the line is clipped at the left screen border (where we start), the left out
-	gouraud and texture steps have to be calculated; x is set to 0 */
-	if (x1 < 0) {
-		//int xm=-x1;
-		x1 = 0;
+	acc_tri_edge_init(&long_edge, pa, pc);
+	acc_tri_edge_init(&short_edge, pa, pb);
+	left = (cross < 0) ? &short_edge : &long_edge;
+	right = (cross < 0) ? &long_edge : &short_edge;
+
+	for (int32_t y = pa[1]; y < pc[1] && y < h; y++) {
+		if (y == pb[1])
+			acc_tri_edge_init(&short_edge, pb, pc);
+		if (y >= 0) {
+			int32_t x1 = (left->x + 0xFFFF) >> 16;
+			int32_t x2 = (right->x + 0xFFFF) >> 16;
+			if (x1 < 0) x1 = 0;
+			if (x2 > w) x2 = w;
+			if (x1 < x2)
+				span(ctx, y, x1, x2);
+		}
+		acc_tri_edge_next(&long_edge);
+		acc_tri_edge_next(&short_edge);
 	}
-	/* x is simply clipped at the right border. That's where the loop is going to end
-	then */
-	if (x2 > (w - 1))
-		x2= (w - 1);
-	//End of clipping and calculation of screen start address
-		int arrayptr = (y * w) + (x1);
-
-	//Recalculate X-Delta because of clipping
-	xdelta = (x2 - x1);
-	if (xdelta <= 0)
-		return;
-	xd = (int)(xdelta);
+}
 
-	for (int x = 0; x <= xd; x++) {
-		//Fetch a pixel from the texture (256*256)
-		*(tri_array + (arrayptr++)) = u8_fg;
-		//*(tri_array + (arrayptr++)) = array_tex1[(txi >> 16) + ((tyi >> 8) & 0xff00)];
+typedef struct {
+	uint8_t *dest;
+	uint32_t pitch;
+	uint32_t color;
+	uint8_t color_format;
+} AccFlatTri;
 
-		//Increase Texture- and Gouraud-counter
-		txi += txdi;
-		tyi += tydi;
+static void acc_flat_tri_span(void *ctx, int32_t y, int32_t x1, int32_t x2)
+{
+	AccFlatTri *t = ctx;
+	uint8_t *dp = t->dest + y * t->pitch;
+
+	switch (t->color_format) {
+		case MNTVA_COLOR_8BIT:
+			memset(dp + x1, t->color >> 24, x2 - x1);
+			break;
+		case MNTVA_COLOR_16BIT565:
+		case MNTVA_COLOR_15BIT:
+			for (int32_t x = x1; x < x2; x++)
+				((uint16_t *)dp)[x] = t->color;
+			break;
+		case MNTVA_COLOR_32BIT:
+			for (int32_t x = x1; x < x2; x++)
+				((uint32_t *)dp)[x] = t->color;
+			break;
+		default:
+			break;
 	}
 }
 
-// filled tri code viciously stolen from mntmn...!
 void acc_fill_flat_tri(uint32_t dest, TriangleDef *d, uint16_t w, uint16_t h, uint32_t fg_color, uint8_t bpp)
 {
-	uint8_t u8_fg = fg_color >> 24;
-	int32_t *dataa, *datab, *datac;
+	AccFlatTri t;
 
-	int32_t xs1, xs2, xs3, txs1, txs2, txs3, tys1, tys2, tys3;
-	int32_t *tempdata;
+	t.color_format = MNTVA_COLOR_8BIT;
+	MNTVA_FROM_BPP(t.color_format, bpp)
+	t.dest = (uint8_t *)dest;
+	t.pitch = w * ((bpp == 3) ? 2 : (bpp ? bpp : 1));
+	t.color = fg_color;
 
-	dataa = d->a;
-	datab = d->b;
-	datac = d->c;
-
-	tri_array = (uint8_t *)dest;
+	acc_tri_walk(d, w, h, acc_flat_tri_span, &t);
+}
 
-	// Very simple sorting of the three y coordinates
-	if (dataa[1] > datab[1]) {
-		tempdata = dataa;
-		dataa = datab;
-		datab = tempdata;
-	}
-	if (datab[1] > datac[1]) {
-		tempdata = datab;
-		datab = datac;
-		datac = tempdata;
-	}
-	if (dataa[1] > datab[1]) {
-		tempdata = dataa;
-		dataa = datab;
-		datab = tempdata;
+typedef struct {
+	uint8_t *dest;
+	uint32_t pitch;          // bytes
+	const uint8_t *tex;
+	int32_t tex_pitch;       // texels
+	int32_t umask, vmask;    // size-1 for power of two sizes (wrap), else -1
+	int32_t umax, vmax;      // size-1 (clamp)
+	uint8_t bytes;
+	uint8_t use_key;
+	uint32_t key;            // texel as stored in memory
+	uint8_t persp;
+	// attribute = a0 + dadx * (x - x0) + dady * (y - y0), with u & v premultiplied by q if persp
+	float x0, y0;
+	float u0, dudx, dudy;
+	float v0, dvdx, dvdy;
+	float q0, dqdx, dqdy;
+	int32_t du, dv;          // affine steps, 16.16
+} AccTexTri;
+
+#define ACC_TEX_FETCH(t, u, v) \
+	((((int32_t)(v) >> 16) & t->vmask) < 0 ? 0 : (((int32_t)(v) >> 16) & t->vmask) > t->vmax ? t->vmax : (((int32_t)(v) >> 16) & t->vmask)) * t->tex_pitch + \
+	((((int32_t)(u) >> 16) & t->umask) < 0 ? 0 : (((int32_t)(u) >> 16) & t->umask) > t->umax ? t->umax : (((int32_t)(u) >> 16) & t->umask))
+
+// reference span, also used for the span tails by the NEON version
+static void acc_tex_span_c(AccTexTri *t, uint8_t *dp, int32_t n, uint32_t u, int32_t du, uint32_t v, int32_t dv)
+{
+	for (int32_t i = 0; i < n; i++) {
+		int32_t idx = ACC_TEX_FETCH(t, u, v);
+		switch (t->bytes) {
+			case 1: {
+				uint8_t c = t->tex[idx];
+				if (!t->use_key || c != (uint8_t)t->key)
+					dp[i] = c;
+				break;
+			}
+			case 2: {
+				uint16_t c = ((const uint16_t *)t->tex)[idx];
+				if (!t->use_key || c != (uint16_t)t->key)
+					((uint16_t *)dp)[i] = c;
+				break;
+			}
+			default: {
+				uint32_t c = ((const uint32_t *)t->tex)[idx];
+				if (!t->use_key || c != t->key)
+					((uint32_t *)dp)[i] = c;
+				break;
+			}
+		}
+		u += du;
+		v += dv;
 	}
+}
 
-	// Calculate some deltas
-	int32_t xd1 = datab[0] - dataa[0];
-	int32_t xd2 = datac[0] - dataa[0];
-	int32_t xd3 = datac[0] - datab[0];
-	int32_t yd1 = datab[1] - dataa[1];
-	int32_t yd2 = datac[1] - dataa[1];
-	int32_t yd3 = datac[1] - datab[1];
-	int32_t txd1 = datab[2] - dataa[2];
-	int32_t txd2 = datac[2] - dataa[2];
-	int32_t txd3 = datac[2] - datab[2];
-	int32_t tyd1 = datab[3] - dataa[3];
-	int32_t tyd2 = datac[3] - dataa[3];
-	int32_t tyd3 = datac[3] - datab[3];
-
-	// Calculate steps per line while taking care of division by 0
-	if(yd1 != 0) {
-		xs1 = xd1 / yd1;
-		txs1 = txd1 / yd1;
-		tys1 = tyd1 / yd1;
-	}
-	else {
-		xs1 = xd1;
-		txs1 = txd1;
-		tys1 = tyd1;
-	}
-	if(yd2 != 0) {
-		xs2 = xd2 / yd2;
-		txs2 = txd2 / yd2;
-		tys2 = tyd2 / yd2;
-	}
-	else {
-		xs2 = xd2;
-		txs2 = txd2;
-		tys2 = tyd2;
-	}
-	if(yd3 != 0) {
-		xs3 = xd3 / yd3;
-		txs3 = txd3 / yd3;
-		tys3 = tyd3 / yd3;
-	}
-	else  {
-		xs3 = xd3;
-		txs3 = txd3;
-		tys3 = tyd3;
-	}
+#ifdef __ARM_NEON__
+static inline __attribute__((always_inline)) int32x4_t acc_tex_coord(int32x4_t c, int32_t mask, int32_t max)
+{
+	c = vandq_s32(vshrq_n_s32(c, 16), vdupq_n_s32(mask));
+	return vminq_s32(vmaxq_s32(c, vdupq_n_s32(0)), vdupq_n_s32(max));
+}
 
-	/*
-	 Variable meanings:
-
-	 xs? xstep=delta x
-	 txs? delta tx
-	 tys? delta ty
-	 xd? xdelta
-	 yd? dunno
-	 txd?  "
-	 tyd?  "
-	 xw? current x-value used in loop
-	 txw? for tx
-	 tyw? for ty
-	*/
-	/*
-	 Start values for the first part (up to y of point 2)
-	 xw1 and xw2 are x-values for the current line. The triangle is drawn from
-	 top to bottom line after line...
-	 txw, tyw and gw are values for texture and brightness
-	 always for start- and ending-point of the current line
-	 A line is also called "Span".
-	*/
-
-	int32_t xw1 = dataa[0]; //pax
-	int32_t xw2 = dataa[0];
-	int32_t txw1 = dataa[2]; //tax
-	int32_t txw2 = dataa[2];
-	int32_t tyw1 = dataa[3]; //tay
-	int32_t tyw2 = dataa[3];
-
-	if (yd1) {
-		for (int sz = dataa[1]; sz <= datab[1]; sz++) {
-			// draw if y is inside the screen (clipping)
-			if (sz >=h )
+static void acc_tex_span_neon(AccTexTri *t, uint8_t *dp, int32_t n, uint32_t u, int32_t du, uint32_t v, int32_t dv)
+{
+	static const int32_t lane[4] = { 0, 1, 2, 3 };
+	int32_t idx[8] __attribute__((aligned(16)));
+	int32x4_t k = vld1q_s32(lane);
+	int32x4_t u0 = vmlaq_n_s32(vdupq_n_s32(u), k, du);
+	int32x4_t v0 = vmlaq_n_s32(vdupq_n_s32(v), k, dv);
+	int32x4_t u4 = vdupq_n_s32(du * 4), v4 = vdupq_n_s32(dv * 4);
+	int32_t i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		int32x4_t u1 = vaddq_s32(u0, u4), v1 = vaddq_s32(v0, v4);
+		vst1q_s32(idx, vmlaq_n_s32(acc_tex_coord(u0, t->umask, t->umax), acc_tex_coord(v0, t->vmask, t->vmax), t->tex_pitch));
+		vst1q_s32(idx + 4, vmlaq_n_s32(acc_tex_coord(u1, t->umask, t->umax), acc_tex_coord(v1, t->vmask, t->vmax), t->tex_pitch));
+		u0 = vaddq_s32(u1, u4);
+		v0 = vaddq_s32(v1, v4);
+
+		switch (t->bytes) {
+			case 1: {
+				uint8_t c[8] __attribute__((aligned(8)));
+				for (int j = 0; j < 8; j++)
+					c[j] = t->tex[idx[j]];
+				uint8x8_t tc = vld1_u8(c);
+				if (t->use_key)
+					tc = vbsl_u8(vceq_u8(tc, vdup_n_u8(t->key)), vld1_u8(dp + i), tc);
+				vst1_u8(dp + i, tc);
+				break;
+			}
+			case 2: {
+				uint16_t c[8] __attribute__((aligned(16)));
+				for (int j = 0; j < 8; j++)
+					c[j] = ((const uint16_t *)t->tex)[idx[j]];
+				uint16x8_t tc = vld1q_u16(c);
+				if (t->use_key)
+					tc = vbslq_u16(vceqq_u16(tc, vdupq_n_u16(t->key)), vld1q_u16((uint16_t *)dp + i), tc);
+				vst1q_u16((uint16_t *)dp + i, tc);
+				break;
+			}
+			default: {
+				uint32_t c[8] __attribute__((aligned(16)));
+				for (int j = 0; j < 8; j++)
+					c[j] = ((const uint32_t *)t->tex)[idx[j]];
+				uint32x4_t tc0 = vld1q_u32(c), tc1 = vld1q_u32(c + 4);
+				if (t->use_key) {
+					uint32x4_t key = vdupq_n_u32(t->key);
+					tc0 = vbslq_u32(vceqq_u32(tc0, key), vld1q_u32((uint32_t *)dp + i), tc0);
+					tc1 = vbslq_u32(vceqq_u32(tc1, key), vld1q_u32((uint32_t *)dp + i + 4), tc1);
+				}
+				vst1q_u32((uint32_t *)dp + i, tc0);
+				vst1q_u32((uint32_t *)dp + i + 4, tc1);
 				break;
-			if (sz >= 0 && sz < h) {
-				uint32_t xed = (xw1 < xw2) ? xw1 : xw2;
-				uint32_t xed2 = (xw1 < xw2) ? xw2 : xw1;
-				xed = ((xed & 0xFFFF0000) >> 16);
-				xed2 = ((xed2 & 0xFFFF0000) >> 16);
-				if ((xed < 0 && xed2 < 0) || (xed >= w && xed2 >= w) || (xed == xed2))
-					goto skip_span;
-				if (xed < 0) xed = 0;
-				if (xed2 >= w) xed2 = w - 1;
-
-				int clear_w = (xed == xed2) ? 1 : xed2 - xed;
-				memset((uint8_t *)(uint32_t)(dest + xed + (sz * w)), u8_fg, clear_w);
-				skip_span:;
 			}
-			xw1 += xs1;
-			xw2 += xs2;
-			txw1 += txs1;
-			txw2 += txs2;
-			tyw1 += tys1;
-			tyw2 += tys2;
 		}
 	}
+	if (i < n)
+		acc_tex_span_c(t, dp + i * t->bytes, n - i, u + i * du, du, v + i * dv, dv);
+}
+#define acc_tex_span acc_tex_span_neon
+#else
+#define acc_tex_span acc_tex_span_c
+#endif
 
-	/*
-	 New start values for the second part of the triangle
-	*/
-	xw1 = datab[0] + xs3;
-	txw1 = datab[2] + txs3;
-	tyw1 = datab[3] + tys3;
-
-	if (yd3) { //If Span-Height 1 or higher
-		for (int sz=datab[1] + 1; sz < datac[1]; sz++)
-		{
-			if (sz >=h )
-				break;
+static inline uint32_t acc_tex_fixed(float f)
+{
+	return (uint32_t)(int32_t)floorf(f * 65536.0f);
+}
 
-			if (sz >= 0 && sz < (h - 1)) {
-				int xed = (xw1 < xw2) ? xw1 : xw2;
-				int xed2 = (xw1 < xw2) ? xw2 : xw1;
-				xed = ((xed & 0xFFFF0000) >> 16);
-				xed2 = ((xed2 & 0xFFFF0000) >> 16);
-				if ((xed < 0 && xed2 < 0) || (xed >= w && xed2 >= w) || (xed == xed2))
-					goto skip_span2;
-				if (xed < 0) xed = 0;
-				if (xed2 >= w) xed2 = w - 1;
-
-				int clear_w = (xed == xed2) ? 1 : xed2 - xed;
-				memset((uint8_t *)(uint32_t)(dest + xed + (sz * w)), u8_fg, clear_w);
-				skip_span2:;
-			}
-			xw1 += xs3;
-			xw2 += xs2;
-			txw1 += txs3;
-			txw2 += txs2;
-			tyw1 += tys3;
-			tyw2 += tys2;
-		}
+#define ACC_TEX_SUBSPAN 8
+
+static void acc_tex_tri_span(void *ctx, int32_t y, int32_t x1, int32_t x2)
+{
+	AccTexTri *t = ctx;
+	uint8_t *dp = t->dest + y * t->pitch + x1 * t->bytes;
+	float fx = x1 - t->x0, fy = y - t->y0;
+	float u = t->u0 + t->dudx * fx + t->dudy * fy;
+	float v = t->v0 + t->dvdx * fx + t->dvdy * fy;
+
+	if (!t->persp) {
+		acc_tex_span(t, dp, x2 - x1, acc_tex_fixed(u), t->du, acc_tex_fixed(v), t->dv);
+		return;
+	}
+
+	// exact u/q v/q every ACC_TEX_SUBSPAN pixels, affine in between
+	float q = t->q0 + t->dqdx * fx + t->dqdy * fy;
+	float qmin = 1.0f / 65536.0f;
+	uint32_t us = acc_tex_fixed(u / (q > qmin ? q : qmin));
+	uint32_t vs = acc_tex_fixed(v / (q > qmin ? q : qmin));
+
+	for (int32_t x = x1; x < x2; x += ACC_TEX_SUBSPAN) {
+		int32_t n = (x2 - x < ACC_TEX_SUBSPAN) ? x2 - x : ACC_TEX_SUBSPAN;
+		u += t->dudx * n;
+		v += t->dvdx * n;
+		q += t->dqdx * n;
+		uint32_t ue = acc_tex_fixed(u / (q > qmin ? q : qmin));
+		uint32_t ve = acc_tex_fixed(v / (q > qmin ? q : qmin));
+		acc_tex_span(t, dp, n, us, (int32_t)(ue - us) / n, vs, (int32_t)(ve - vs) / n);
+		dp += n * t->bytes;
+		us = ue;
+		vs = ve;
 	}
 }
+
+// gradients of an attribute over the triangle, ad[] are the values at the vertices a b c
+static void acc_tri_gradients(float *ad, float *p, float inv_area, float *dx, float *dy)
+{
+	float a1 = ad[1] - ad[0], a2 = ad[2] - ad[0];
+	*dx = (a1 * (p[5] - p[1]) - a2 * (p[3] - p[1])) * inv_area;
+	*dy = (a2 * (p[2] - p[0]) - a1 * (p[4] - p[0])) * inv_area;
+}
+
+void acc_draw_tex_tri(uint32_t dest, uint16_t dest_pitch, TriangleDef *d, uint16_t w, uint16_t h,
+	uint32_t tex, uint16_t tex_w, uint16_t tex_h, uint16_t tex_pitch, uint8_t bpp, uint8_t flags, uint32_t key)
+{
+	AccTexTri t;
+	int32_t *v[3] = { d->a, d->b, d->c };
+	float p[6], uq[3], vq[3], q[3];
+
+	if (!tex_w || !tex_h || !tex)
+		return;
+
+	t.bytes = (bpp == 3) ? 2 : (bpp ? bpp : 1);
+	if (t.bytes != 1 && t.bytes != 2 && t.bytes != 4)
+		return;
+	t.dest = (uint8_t *)dest;
+	t.pitch = dest_pitch * t.bytes;
+	t.tex = (const uint8_t *)tex;
+	t.tex_pitch = tex_pitch ? tex_pitch : tex_w;
+	t.umax = tex_w - 1;
+	t.vmax = tex_h - 1;
+	t.umask = (tex_w & (tex_w - 1)) ? -1 : tex_w - 1;
+	t.vmask = (tex_h & (tex_h - 1)) ? -1 : tex_h - 1;
+	t.persp = (flags & ACC_TEXTRI_PERSPECTIVE) != 0;
+	t.use_key = (flags & ACC_TEXTRI_COLORKEY) != 0;
+	// key is in the same byte order as the fill colours, 8 bit in the upper byte
+	t.key = (t.bytes == 1) ? key >> 24 : key;
+
+	for (int i = 0; i < 3; i++) {
+		p[i * 2] = v[i][0] / 65536.0f;
+		p[i * 2 + 1] = v[i][1];
+		q[i] = t.persp ? v[i][4] / 65536.0f : 1.0f;
+		if (q[i] <= 0.0f)
+			q[i] = 1.0f;
+		uq[i] = v[i][2] / 65536.0f * q[i];
+		vq[i] = v[i][3] / 65536.0f * q[i];
+	}
+
+	float area = (p[2] - p[0]) * (p[5] - p[1]) - (p[4] - p[0]) * (p[3] - p[1]);
+	if (area == 0.0f)
+		return;
+	float inv_area = 1.0f / area;
+
+	t.x0 = p[0]; t.y0 = p[1];
+	t.u0 = uq[0]; t.v0 = vq[0]; t.q0 = q[0];
+	acc_tri_gradients(uq, p, inv_area, &t.dudx, &t.dudy);
+	acc_tri_gradients(vq, p, inv_area, &t.dvdx, &t.dvdy);
+	acc_tri_gradients(q, p, inv_area, &t.dqdx, &t.dqdy);
+	t.du = (int32_t)(t.dudx * 65536.0f);
+	t.dv = (int32_t)(t.dvdx * 65536.0f);
+
+	acc_tri_walk(d, w, h, acc_tex_tri_span, &t);
+}
@@ -91,6 +91,8 @@ void acc_draw_circle(uint32_t dest, uint16_t pitch, int16_t x, int16_t y, int16_
 void acc_fill_circle(uint32_t dest, uint16_t pitch, int16_t x0, int16_t y0, int16_t r, int16_t w, int16_t h, uint32_t fg_color, uint8_t bpp);
 
 void acc_fill_flat_tri(uint32_t dest, TriangleDef *d, uint16_t w, uint16_t h, uint32_t fg_color, uint8_t bpp);
+void acc_draw_tex_tri(uint32_t dest, uint16_t dest_pitch, TriangleDef *d, uint16_t w, uint16_t h,
+	uint32_t tex, uint16_t tex_w, uint16_t tex_h, uint16_t tex_pitch, uint8_t bpp, uint8_t flags, uint32_t key);
 
 void *get_color_conversion_table(int index);
 
@@ -578,6 +580,12 @@ enum gfx_acc_op {
   ACC_OP_NUM,
 };
 
+// ACC_OP_DRAW_TEX_TRI flags (u8_user[1])
+enum acc_textri_flags {
+  ACC_TEXTRI_PERSPECTIVE = 1 << 0,
+  ACC_TEXTRI_COLORKEY = 1 << 1,
+};
+
 enum compression_types {
   ACC_CMPTYPE_SMUSH_CODEC1,
   ACC_CMPTYPE_SMUSH_CODEC37,
@@ -17,6 +17,7 @@
 #include "../ethernet.h"
 #include "../adc.h"
 #include "../ax.h"
+#include "../ax_mixer.h"
 #include "../mp3/mp3.h"
 #include "math.h"
 #include "sleep.h"
@@ -172,6 +173,8 @@ void rtg_init(void)
    audio_adau_set_lpf_params(23900);
    for(int i=0;i<10;i++)
       audio_adau_set_eq_gain(i,50);
+   audio_set_ring(AUDIO_NUM_PERIODS, AUDIO_BYTES_PER_PERIOD);
+   audio_set_ring_latency(0);
 
    env_file_vars_temp.bootmode=config.boot_mode;
    env_file_vars_temp.scsiboot=config.scsiboot;
@@ -512,7 +515,7 @@ uint32_t read_rtg_register(uint32_t zaddr)
       data=audio_params[audio_param]; // read param
       break;
    case REG_ZZ_AUDIO_CONFIG:
-      data=1; // AX is present
+      data=AUDIO_CONFIG_PRESENT|AUDIO_CONFIG_HWMIX|AUDIO_CONFIG_ADAPTIVE; // AX is present, with hw mixer and adaptive ring
       break;
    case REG_ZZ_DECODER_FIFORX:
       data=fifo_get_read_index();
@@ -1076,6 +1079,10 @@ void write_rtg_register(uint32_t zaddr,uint32_t zdata)
          int byteswap = 1;
          if (zdata&(1<<15)) byteswap = 0;
          audio_offset = (zdata&0x7fff)<<8; // *256
+         if (zdata&AUDIO_SWAB_MIX) {
+            audio_mix(audio_scale, audio_offset);
+            byteswap = 0;
+         }
          audio_buffer_collision = audio_swab(audio_scale, audio_offset, byteswap);
          //               DEBUG_AUDIO("audio_offset 0x%08lx\n",audio_offset);
          break;
@@ -1169,6 +1176,20 @@ void write_rtg_register(uint32_t zaddr,uint32_t zdata)
                audio_adau_set_eq_gain(audio_param-AP_DSP_SET_EQ_BAND1, zdata);
             } else if (audio_param == AP_DSP_SET_STEREO_VOLUME) {
                audio_adau_set_vol_pan(zdata&0xff, (zdata>>8)&0xff);
+            } else if (audio_param == AP_MIXER_CMD_OFFS) {
+               uint32_t addr = audio_params[AP_MIXER_CMD_OFFS];
+               if (addr>=0x06000000 && addr+sizeof(AX_MIXER_CMD)<=TX_BD_LIST_START_ADDRESS) {
+                  ax_mixer_set_cmd_block((uint8_t*)(RTG_BASE+addr));
+               } else {
+                  printf("[audio] illegal mixer address: 0x%08lx\n", addr);
+               }
+            } else if (audio_param == AP_RING_PERIOD_BYTES) {
+               // the period count is taken from AP_RING_PERIODS, write it first
+               if (audio_set_ring(audio_params[AP_RING_PERIODS], zdata)) {
+                  audio_request_init = 1;
+               }
+            } else if (audio_param == AP_RING_LATENCY) {
+               audio_set_ring_latency(zdata);
             }
          }
          break;
@@ -1236,7 +1257,8 @@ void write_rtg_register(uint32_t zaddr,uint32_t zdata)
                uint8_t* temp_buffer = output_buffer + AUDIO_TX_BUFFER_SIZE; // FIXME hack
                max_samples = mp3_freq/50 * 2;
 
-               decoder_bytes_decoded = decode_mp3_samples(temp_buffer, max_samples);
+               // the same buffer every time, so the read-ahead is moved back to the start
+               decoder_bytes_decoded = decode_mp3_samples(temp_buffer, max_samples, max_samples + MP3_FRAME_ROOM_SAMPLES);
 
                // resample
                if(decoder_bytes_decoded>0)
@@ -1245,7 +1267,9 @@ void write_rtg_register(uint32_t zaddr,uint32_t zdata)
                         mp3_freq, 48000, AUDIO_BYTES_PER_PERIOD / 4);
                }
             } else {
-               decoder_bytes_decoded = decode_mp3_samples(output_buffer, max_samples);
+               // decode ahead into the following periods, as far as they are already played
+               int room_samples = max_samples + audio_ring_space(output_buffer + max_samples * 2) / 2;
+               decoder_bytes_decoded = decode_mp3_samples(output_buffer, max_samples, room_samples);
             }
             //                     if(decoder_bytes_decoded>0)
             //                        DEBUG_AUDIO("[decode:mp3:%s] %p (%d) -> %p (%d) %ld %ld\n", decode_command_str[(int)zdata], input_buffer, input_buffer_size,
@@ -1623,6 +1647,9 @@ void write_rtg_register(uint32_t zaddr,uint32_t zdata)
 void audio_reset(void)
 {
    audio_set_interrupt_enabled(0);
+   ax_mixer_reset();
+   audio_set_ring(AUDIO_NUM_PERIODS, AUDIO_BYTES_PER_PERIOD);
+   audio_set_ring_latency(0);
    audio_silence();
    audio_init_i2s();
 }
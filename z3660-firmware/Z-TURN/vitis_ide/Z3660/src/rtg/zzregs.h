@@ -207,6 +207,7 @@ enum gfx_soft3d_op {
   OP_CLEARZBUFFER,
   OP_READZSPAN,
   OP_WRITEZSPAN,
+  OP_RING,
   OP_SOFT3D_NUM,
 };
 #endif
@@ -763,7 +763,7 @@ int init_vdma_irq(int hsize, int vsize, int hdiv, int vdiv, uint32_t bufpos) {
    return(XST_SUCCESS);
 }
 
-uint32_t ticks=0;
+volatile uint32_t ticks=0; // advanced by isr_video(), polled by the mpeg player
 void isr_video(void *dummy)
 {
    int vblank=video_formatter_read(0);
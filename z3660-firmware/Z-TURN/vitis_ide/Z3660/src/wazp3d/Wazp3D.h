@@ -932,6 +932,25 @@ struct Soft3DData {
   volatile uint16_t x[2], y[2];
 };
 
+/* Command ring: Wazp3D.library appends SETDRAWSTATE/DRAWPRIMITIVE records (with their */
+/* state3D/point3D copied after the header) and the firmware draws them before any other op */
+#define SOFT3D_RING_OFFSET 0x1000            /* from the Soft3DData */
+#define SOFT3D_RING_SIZE   0x80000
+#define SOFT3D_RING_MAGIC  0x52494E47        /* "RING" returned by OP_RING */
+struct Soft3DRing {
+  volatile uint32_t write;                   /* bytes appended in data[] by the Amiga */
+  volatile uint32_t read;                    /* bytes already drawn by the firmware */
+  volatile uint32_t pad[6];
+  volatile uint32_t data[(SOFT3D_RING_SIZE-32)/4];
+};
+struct Soft3DCmd {
+  uint32_t op;                               /* OP_SETDRAWSTATE or OP_DRAWPRIMITIVE */
+  uint32_t size;                             /* bytes with this header */
+  uint32_t sc;
+  uint32_t Pnb;
+  uint32_t primitive;
+};
+
 #endif
 
 
@@ -7,140 +7,235 @@
 uintptr_t *heap = (uintptr_t *)(Z3_SOFT3D_ADDR_BUFFERS);
 const uintptr_t *stack_base = 0;
 
-bool reachable_chunks[CHUNK_LIST_CAP] = {0};
-void *to_free[CHUNK_LIST_CAP] = {0};
-size_t to_free_count = 0;
-
-Chunk_List alloced_chunks = {0};
-Chunk_List freed_chunks = {
-    .count = 1,
-    .chunks = {
-        [0] = {.start = (uintptr_t *)(Z3_SOFT3D_ADDR_BUFFERS), .size = 0x01000000}
-    },
-};
-Chunk_List tmp_chunks = {0};
-
-void chunk_list_insert(Chunk_List *list, void *start, size_t size)
-{
-    assert(list->count < CHUNK_LIST_CAP);
-    list->chunks[list->count].start = start;
-    list->chunks[list->count].size  = size;
-
-    for (size_t i = list->count;
-            i > 0 && list->chunks[i].start < list->chunks[i - 1].start;
-            --i) {
-        const Chunk t = list->chunks[i];
-        list->chunks[i] = list->chunks[i - 1];
-        list->chunks[i - 1] = t;
-    }
+// free_lists[fl][sl] holds the free blocks of size class fl/sl, the
+// bitmaps tell which lists are not empty so a fitting list is found with ctz
+static Heap_Block *free_lists[HEAP_FL_COUNT][HEAP_SL_COUNT];
+static uint32_t fl_bitmap;
+static uint32_t sl_bitmap[HEAP_FL_COUNT];
+static Heap_Block *first_block;
+static bool heap_ready = false;
+static Heap_Stats stats;
 
-    list->count += 1;
+static inline int fls_size(size_t size)
+{
+    return (int)(sizeof(unsigned long) * 8 - 1) - __builtin_clzl((unsigned long)size);
 }
 
-void chunk_list_merge(Chunk_List *dst, const Chunk_List *src)
+static inline size_t block_size(const Heap_Block *block)
 {
-    dst->count = 0;
+    return block->size & ~(size_t)HEAP_BLOCK_FLAGS;
+}
 
-    for (size_t i = 0; i < src->count; ++i) {
-        const Chunk chunk = src->chunks[i];
+static inline bool block_is_free(const Heap_Block *block)
+{
+    return (block->size & HEAP_BLOCK_FREE) != 0;
+}
+
+static inline Heap_Block *block_next(const Heap_Block *block)
+{
+    return (Heap_Block *)((uint8_t *)block + block_size(block));
+}
 
-        if (dst->count > 0) {
-            Chunk *top_chunk = &dst->chunks[dst->count - 1];
+static inline void *block_to_ptr(const Heap_Block *block)
+{
+    return (uint8_t *)block + HEAP_BLOCK_HEADER;
+}
 
-            if (top_chunk->start + top_chunk->size == chunk.start) {
-                top_chunk->size += chunk.size;
-            } else {
-                chunk_list_insert(dst, chunk.start, chunk.size);
-            }
-        } else {
-            chunk_list_insert(dst, chunk.start, chunk.size);
-        }
-    }
+static inline Heap_Block *ptr_to_block(const void *ptr)
+{
+    return (Heap_Block *)((uint8_t *)ptr - HEAP_BLOCK_HEADER);
 }
 
-void chunk_list_dump(const Chunk_List *list, const char *name)
+static void mapping(size_t size, int *fl, int *sl)
 {
-    printf("%s Chunks (%zu):\n", name, list->count);
-    for (size_t i = 0; i < list->count; ++i) {
-        printf("  start: %p, size: %zu\n",
-               (void*) list->chunks[i].start,
-               list->chunks[i].size);
+    if (size < ((size_t)1 << HEAP_FL_SHIFT)) {
+        *fl = 0;
+        *sl = (int)(size >> HEAP_ALIGN_LOG2);
+    } else {
+        const int f = fls_size(size);
+        *sl = (int)(size >> (f - HEAP_SL_LOG2)) ^ HEAP_SL_COUNT;
+        *fl = f - HEAP_FL_SHIFT + 1;
     }
 }
 
-int chunk_list_find(const Chunk_List *list, uintptr_t *ptr)
+static void insert_free(Heap_Block *block)
 {
-    for (size_t i = 0; i < list->count; ++i) {
-        if (list->chunks[i].start == ptr) {
-            return (int) i;
-        }
+    int fl, sl;
+    mapping(block_size(block), &fl, &sl);
+
+    block->prev_free = NULL;
+    block->next_free = free_lists[fl][sl];
+    if (block->next_free != NULL)
+        block->next_free->prev_free = block;
+    free_lists[fl][sl] = block;
+    fl_bitmap |= 1u << fl;
+    sl_bitmap[fl] |= 1u << sl;
+    stats.free_blocks += 1;
+    stats.free_bytes += block_size(block);
+}
+
+static void remove_free(Heap_Block *block)
+{
+    int fl, sl;
+    mapping(block_size(block), &fl, &sl);
+
+    if (block->prev_free != NULL)
+        block->prev_free->next_free = block->next_free;
+    else
+        free_lists[fl][sl] = block->next_free;
+    if (block->next_free != NULL)
+        block->next_free->prev_free = block->prev_free;
+    if (free_lists[fl][sl] == NULL) {
+        sl_bitmap[fl] &= ~(1u << sl);
+        if (sl_bitmap[fl] == 0)
+            fl_bitmap &= ~(1u << fl);
     }
+    stats.free_blocks -= 1;
+    stats.free_bytes -= block_size(block);
+}
+
+// a block in the list of size itself, not all of them are big enough
+static Heap_Block *find_fitting(size_t size)
+{
+    int fl, sl;
+    mapping(size, &fl, &sl);
 
-    return -1;
+    for (Heap_Block *block = free_lists[fl][sl]; block != NULL; block = block->next_free)
+        if (block_size(block) >= size)
+            return block;
+    return NULL;
 }
 
-void chunk_list_remove(Chunk_List *list, size_t index)
+static Heap_Block *find_free(size_t size)
 {
-    assert(index < list->count);
-    for (size_t i = index; i < list->count - 1; ++i) {
-        list->chunks[i] = list->chunks[i + 1];
+    const size_t wanted = size;
+    int fl, sl;
+
+    // round up to the next list so any block found is big enough
+    if (size >= ((size_t)1 << HEAP_FL_SHIFT))
+        size += ((size_t)1 << (fls_size(size) - HEAP_SL_LOG2)) - 1;
+    mapping(size, &fl, &sl);
+    if (fl >= HEAP_FL_COUNT)
+        return find_fitting(wanted);
+
+    uint32_t sl_map = sl_bitmap[fl] & (~0u << sl);
+    if (sl_map == 0) {
+        const uint32_t fl_map = fl_bitmap & (~0u << (fl + 1));
+        if (fl_map == 0)
+            return find_fitting(wanted);
+        fl = __builtin_ctz(fl_map);
+        sl_map = sl_bitmap[fl];
     }
-    list->count -= 1;
+    sl = __builtin_ctz(sl_map);
+    return free_lists[fl][sl];
 }
 
-void *heap_alloc(size_t size_bytes)
+static void heap_init(void)
 {
-    const size_t size_words = (size_bytes + sizeof(uintptr_t) - 1) / sizeof(uintptr_t);
+    uint8_t *base = (uint8_t *)heap;
+    Heap_Block *last;
+
+    // the user data of every block is aligned, so the headers are just before a cache line
+    first_block = (Heap_Block *)(base + HEAP_ALIGN - HEAP_BLOCK_HEADER);
+    last = (Heap_Block *)(base + HEAP_SIZE_BYTES - HEAP_BLOCK_HEADER);
 
-    if (size_words > 0) {
-        chunk_list_merge(&tmp_chunks, &freed_chunks);
-        freed_chunks = tmp_chunks;
+    first_block->prev_phys = NULL;
+    first_block->size = (size_t)((uint8_t *)last - (uint8_t *)first_block) | HEAP_BLOCK_FREE;
+    last->prev_phys = first_block;
+    last->size = 0;                 // used block of size 0 that stops the walks
 
-        for (size_t i = 0; i < freed_chunks.count; ++i) {
-            const Chunk chunk = freed_chunks.chunks[i];
-            if (chunk.size >= size_words) {
-                chunk_list_remove(&freed_chunks, i);
+    memset(free_lists, 0, sizeof(free_lists));
+    memset(sl_bitmap, 0, sizeof(sl_bitmap));
+    memset(&stats, 0, sizeof(stats));
+    fl_bitmap = 0;
+    insert_free(first_block);
+    heap_ready = true;
+}
 
-                const size_t tail_size_words = chunk.size - size_words;
-                chunk_list_insert(&alloced_chunks, chunk.start, size_words);
+void *heap_alloc(size_t size_bytes)
+{
+    if (!heap_ready)
+        heap_init();
+    if (size_bytes == 0)
+        return NULL;
+    if (size_bytes > HEAP_SIZE_BYTES) {
+        stats.failed_allocs += 1;
+        return NULL;
+    }
 
-                if (tail_size_words > 0) {
-                    chunk_list_insert(&freed_chunks, chunk.start + size_words, tail_size_words);
-                }
+    const size_t size = (size_bytes + HEAP_BLOCK_HEADER + HEAP_ALIGN - 1) & ~(size_t)(HEAP_ALIGN - 1);
+    Heap_Block *block = find_free(size);
+    if (block == NULL) {
+        stats.failed_allocs += 1;
+        return NULL;
+    }
+    remove_free(block);
 
-                return chunk.start;
-            }
-        }
+    const size_t tail_size = block_size(block) - size;
+    if (tail_size >= HEAP_ALIGN) {
+        Heap_Block *tail = (Heap_Block *)((uint8_t *)block + size);
+        tail->prev_phys = block;
+        tail->size = tail_size | HEAP_BLOCK_FREE;
+        block_next(tail)->prev_phys = tail;
+        block->size = size;
+        insert_free(tail);
+    } else {
+        block->size = block_size(block);
     }
 
-    return NULL;
+    stats.used_blocks += 1;
+    stats.used_bytes += block_size(block);
+    if (stats.used_bytes > stats.peak_used_bytes)
+        stats.peak_used_bytes = stats.used_bytes;
+    stats.allocs += 1;
+    return block_to_ptr(block);
 }
 
 void heap_free(void *ptr)
 {
     if (ptr != NULL) {
-        const int index = chunk_list_find(&alloced_chunks, ptr);
-        assert(index >= 0);
-        assert(ptr == alloced_chunks.chunks[index].start);
-        chunk_list_insert(&freed_chunks,
-                          alloced_chunks.chunks[index].start,
-                          alloced_chunks.chunks[index].size);
-        chunk_list_remove(&alloced_chunks, (size_t) index);
+        Heap_Block *block = ptr_to_block(ptr);
+        assert(heap_ready);
+        assert(!block_is_free(block));
+
+        stats.used_blocks -= 1;
+        stats.used_bytes -= block_size(block);
+        stats.frees += 1;
+        block->size = block_size(block) | HEAP_BLOCK_FREE;
+
+        Heap_Block *prev = block->prev_phys;
+        if (prev != NULL && block_is_free(prev)) {
+            remove_free(prev);
+            prev->size += block_size(block);
+            block = prev;
+        }
+        Heap_Block *next = block_next(block);
+        if (block_is_free(next)) {
+            remove_free(next);
+            block->size += block_size(next);
+        }
+        block_next(block)->prev_phys = block;
+        insert_free(block);
+    }
+}
+
+static Heap_Block *find_used_block(const void *p)
+{
+    for (Heap_Block *block = first_block; block_size(block) != 0; block = block_next(block)) {
+        if ((const uint8_t *)p >= (uint8_t *)block_to_ptr(block)
+                && (const uint8_t *)p < (uint8_t *)block_next(block))
+            return block_is_free(block) ? NULL : block;
     }
+    return NULL;
 }
 
 static void mark_region(const uintptr_t *start, const uintptr_t *end)
 {
     for (; start < end; start += 1) {
-        const uintptr_t *p = (const uintptr_t *) *start;
-        for (size_t i = 0; i < alloced_chunks.count; ++i) {
-            Chunk chunk = alloced_chunks.chunks[i];
-            if (chunk.start <= p && p < chunk.start + chunk.size) {
-                if (!reachable_chunks[i]) {
-                    reachable_chunks[i] = true;
-                    mark_region(chunk.start, chunk.start + chunk.size);
-                }
-            }
+        Heap_Block *block = find_used_block((const void *) *start);
+        if (block != NULL && (block->size & HEAP_BLOCK_MARK) == 0) {
+            block->size |= HEAP_BLOCK_MARK;
+            mark_region(block_to_ptr(block), (const uintptr_t *)block_next(block));
         }
     }
 }
@@ -148,18 +243,89 @@ static void mark_region(const uintptr_t *start, const uintptr_t *end)
 void heap_collect()
 {
     const uintptr_t *stack_start = (const uintptr_t*)__builtin_frame_address(0);
-    memset(reachable_chunks, 0, sizeof(reachable_chunks));
+
+    if (!heap_ready)
+        return;
+    for (Heap_Block *block = first_block; block_size(block) != 0; block = block_next(block))
+        block->size &= ~(size_t)HEAP_BLOCK_MARK;
     mark_region(stack_start, stack_base + 1);
 
-    to_free_count = 0;
-    for (size_t i = 0; i < alloced_chunks.count; ++i) {
-        if (!reachable_chunks[i]) {
-            assert(to_free_count < CHUNK_LIST_CAP);
-            to_free[to_free_count++] = alloced_chunks.chunks[i].start;
+    Heap_Block *block = first_block;
+    while (block_size(block) != 0) {
+        if (!block_is_free(block) && (block->size & HEAP_BLOCK_MARK) == 0) {
+            // a freed block is merged into its free neighbours
+            Heap_Block *prev = block->prev_phys;
+            if (prev == NULL || !block_is_free(prev))
+                prev = block;
+            heap_free(block_to_ptr(block));
+            block = prev;
         }
+        block->size &= ~(size_t)HEAP_BLOCK_MARK;
+        block = block_next(block);
     }
+}
+
+void heap_get_stats(Heap_Stats *s)
+{
+    if (!heap_ready)
+        heap_init();
+    *s = stats;
+    s->largest_free = 0;
+    if (fl_bitmap != 0) {
+        const int fl = 31 - __builtin_clz(fl_bitmap);
+        const int sl = 31 - __builtin_clz(sl_bitmap[fl]);
+        for (Heap_Block *block = free_lists[fl][sl]; block != NULL; block = block->next_free)
+            if (block_size(block) > s->largest_free)
+                s->largest_free = block_size(block);
+        s->largest_free -= HEAP_BLOCK_HEADER;
+    }
+}
 
-    for (size_t i = 0; i < to_free_count; ++i) {
-        heap_free(to_free[i]);
+void heap_dump(const char *name)
+{
+    Heap_Stats s;
+
+    heap_get_stats(&s);
+    printf("%s heap: %zu used blocks (%zu bytes, peak %zu), %zu free blocks (%zu bytes, largest %zu)\n",
+           name, s.used_blocks, s.used_bytes, s.peak_used_bytes,
+           s.free_blocks, s.free_bytes, s.largest_free);
+    printf("  %lu allocs, %lu frees, %lu failed\n",
+           (unsigned long)s.allocs, (unsigned long)s.frees, (unsigned long)s.failed_allocs);
+}
+
+// walk the whole heap, returns the number of broken blocks or lists
+int heap_check(void)
+{
+    int errors = 0;
+    size_t free_blocks = 0;
+    Heap_Block *prev = NULL;
+
+    if (!heap_ready)
+        return 0;
+    for (Heap_Block *block = first_block; ; block = block_next(block)) {
+        if (block->prev_phys != prev)
+            errors++;
+        if (block_size(block) == 0)
+            break;
+        if ((((uintptr_t)block_to_ptr(block)) & (HEAP_ALIGN - 1)) != 0
+                || (block_size(block) & (HEAP_ALIGN - 1)) != 0)
+            errors++;
+        if (block_is_free(block)) {
+            int fl, sl;
+            free_blocks++;
+            if (prev != NULL && block_is_free(prev))
+                errors++;   // should have been merged
+            mapping(block_size(block), &fl, &sl);
+            if ((sl_bitmap[fl] & (1u << sl)) == 0 || (fl_bitmap & (1u << fl)) == 0)
+                errors++;
+        }
+        prev = block;
     }
+    if (free_blocks != stats.free_blocks)
+        errors++;
+    for (int fl = 0; fl < HEAP_FL_COUNT; fl++)
+        for (int sl = 0; sl < HEAP_SL_COUNT; sl++)
+            if ((free_lists[fl][sl] != NULL) != ((sl_bitmap[fl] >> sl) & 1))
+                errors++;
+    return errors;
 }
@@ -12,9 +12,17 @@
         abort(); \
     } while(0)
 
-#define HEAP_CAP_BYTES 640000
-
-#define HEAP_CAP_WORDS (HEAP_CAP_BYTES / sizeof(uintptr_t))
+// the soft3d heap is a TLSF (two level segregated fit) allocator over
+// Z3_SOFT3D_ADDR_BUFFERS: malloc and free are O(1), free blocks are merged
+// with their neighbours at once and every block starts on a cache line
+#define HEAP_SIZE_BYTES 0x01000000
+#define HEAP_ALIGN_LOG2 5
+#define HEAP_ALIGN      (1 << HEAP_ALIGN_LOG2)   // Cortex-A9 cache line
+
+#define HEAP_SL_LOG2    4                        // 16 second level lists per power of two
+#define HEAP_SL_COUNT   (1 << HEAP_SL_LOG2)
+#define HEAP_FL_SHIFT   (HEAP_SL_LOG2 + HEAP_ALIGN_LOG2)
+#define HEAP_FL_COUNT   17                       // up to HEAP_SIZE_BYTES
 
 extern uintptr_t *heap;
 extern const uintptr_t *stack_base;
@@ -23,26 +31,32 @@ void *heap_alloc(size_t size_bytes);
 void heap_free(void *ptr);
 void heap_collect();
 
-#define CHUNK_LIST_CAP 1024
+typedef struct Heap_Block {
+    struct Heap_Block *prev_phys;   // block just before this one in memory
+    size_t size;                    // bytes from this header to the next one, | HEAP_BLOCK_FREE
+    struct Heap_Block *next_free;   // only in free blocks, they overlap the user data
+    struct Heap_Block *prev_free;
+} Heap_Block;
 
-typedef struct {
-    uintptr_t *start;
-    size_t size;
-} Chunk;
+#define HEAP_BLOCK_FREE    1
+#define HEAP_BLOCK_MARK    2        // reachable for heap_collect()
+#define HEAP_BLOCK_FLAGS   (HEAP_BLOCK_FREE | HEAP_BLOCK_MARK)
+#define HEAP_BLOCK_HEADER  (2 * sizeof(void *))
 
 typedef struct {
-    size_t count;
-    Chunk chunks[CHUNK_LIST_CAP];
-} Chunk_List;
-
-extern Chunk_List alloced_chunks;
-extern Chunk_List freed_chunks;
-extern Chunk_List tmp_chunks;
-
-void chunk_list_insert(Chunk_List *list, void *start, size_t size);
-void chunk_list_merge(Chunk_List *dst, const Chunk_List *src);
-void chunk_list_dump(const Chunk_List *list, const char *name);
-int chunk_list_find(const Chunk_List *list, uintptr_t *ptr);
-void chunk_list_remove(Chunk_List *list, size_t index);
+    size_t used_bytes;              // in the allocated blocks, headers included
+    size_t peak_used_bytes;
+    size_t free_bytes;
+    size_t used_blocks;
+    size_t free_blocks;
+    size_t largest_free;            // biggest heap_alloc() that can't fail
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failed_allocs;
+} Heap_Stats;
+
+void heap_get_stats(Heap_Stats *stats);
+void heap_dump(const char *name);
+int heap_check(void);
 
 #endif // HEAP_H_
@@ -9,11 +9,15 @@
 #include <stdio.h>
 #include "../video.h"
 #include <xil_types.h>
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
 
 #include "../debug_console.h"
 #include "../memorymap.h"
 #include "str_soft3dop.h"
 #include "heap.h"
+#include "../cpu_emulator.h"
 
 extern DEBUG_CONSOLE debug_console;
 
@@ -106,12 +110,53 @@ void Libloadfile(void *filename,void *pt,ULONG size)
 
 volatile struct Soft3DData *data3d = NULL;//(volatile struct Soft3DData*)((uint32_t)Z3_SOFT3D_ADDR);
 struct Soft3DData local_data;
+static int ring_on=0;                /* the library asked for the ring with OP_RING */
+
+static void soft3d_ring_drain(void)
+{
+/* draw the records appended since the last op: every op is a fence for the ring */
+	volatile struct Soft3DRing *ring=(volatile struct Soft3DRing *)((uint32_t)data3d+SOFT3D_RING_OFFSET);
+	uint32_t write,read;
+
+	if(!ring_on)
+		return;
+	write=swap32(ring->write);
+	read=swap32(ring->read);
+
+	if(write>sizeof(ring->data))
+		write=sizeof(ring->data);
+	while(read<write)
+	{
+		struct Soft3DCmd *cmd=(struct Soft3DCmd *)((uint32_t)ring->data+read);
+		uint32_t op=swap32(cmd->op);
+		uint32_t size=swap32(cmd->size);
+		uint32_t *sc=(uint32_t *)swap32(cmd->sc);
+		uint32_t Pnb=swap32(cmd->Pnb);
+
+		/* the state or the points have to be in the record */
+		if(size<sizeof(struct Soft3DCmd) || write-read<size || (size&3)!=0
+		|| (op==OP_SETDRAWSTATE && size-sizeof(struct Soft3DCmd)<sizeof(struct state3D))
+		|| (op==OP_DRAWPRIMITIVE && (size-sizeof(struct Soft3DCmd))/sizeof(struct point3D)<Pnb))
+		{
+			printf("[soft3d] bad ring record at 0x%08lx (op %ld size %ld Pnb %ld)\n",read,op,size,Pnb);
+			read=write;
+			break;
+		}
+		if(op==OP_SETDRAWSTATE)
+			SOFT3D_SetDrawState(sc,cmd+1);
+		else if(op==OP_DRAWPRIMITIVE)
+			SOFT3D_DrawPrimitive(sc,cmd+1,Pnb,swap32(cmd->primitive));
+		read+=size;
+	}
+	ring->read=swap32(read);
+}
 
 void handle_soft3d_op(uint16_t zdata)
 {
 //    if(con.debug_rtg)
 //    printf("soft3d_op 0x%X  %s\n",zdata,soft3d_op_string[zdata]);
 
+	soft3d_ring_drain();
 	switch(zdata) {
     	case OP_START: {
     		local_data.offset[0]=swap32(data3d->offset[0]);
@@ -144,6 +189,7 @@ void handle_soft3d_op(uint16_t zdata)
     		DEBUG_SOFT3D("x %d y %d\n",local_data.x[0],local_data.y[0]);
     		DEBUG_SOFT3D("l %d h %d\n",local_data.x[1],local_data.y[1]);
 
+    		SOFT3D_BinDraw((uint32_t *)local_data.offset[0]);
     		SOFT3D_SetBitmap((uint32_t *)local_data.offset[0],
     				         (uint32_t *)local_data.offset[1],
 							 (uint32_t *)local_data.offset[2],
@@ -192,6 +238,7 @@ void handle_soft3d_op(uint16_t zdata)
     	case OP_DOUPDATE: {
     		local_data.offset[0]=swap32(data3d->offset[0]);
     		DEBUG_SOFT3D("SC 0x%08lx\n",local_data.offset[0]);
+    		SOFT3D_BinDraw((uint32_t *)local_data.offset[0]);
 //    		uint32_t dat=swap32((uint32_t)SOFT3D_DoUpdate((uint32_t *)local_data.offset[0]));
     		uint32_t dat=0; // why the amiga hangs when this returns true?
     		*(uint32_t*)(RTG_BASE+REG_ZZ_SOFT3D_OP)=dat;
@@ -201,6 +248,7 @@ void handle_soft3d_op(uint16_t zdata)
     		local_data.offset[0]=swap32(data3d->offset[0]);
     		DEBUG_SOFT3D("SC 0x%08lx\n",local_data.offset[0]);
 
+    		SOFT3D_BinDraw((uint32_t *)local_data.offset[0]);
     		SOFT3D_Flush((uint32_t *)local_data.offset[0]);
     		break;
     	case OP_CREATETEXTURE: {
@@ -229,6 +277,7 @@ void handle_soft3d_op(uint16_t zdata)
     		DEBUG_SOFT3D("SC 0x%08lx\n",local_data.offset[0]);
     		DEBUG_SOFT3D("ST 0x%08lx\n",local_data.offset[1]);
 
+    		SOFT3D_BinDraw((uint32_t *)local_data.offset[0]);
     		SOFT3D_FreeTexture((uint32_t *)local_data.offset[0],
     				           (uint32_t *)local_data.offset[1]);
     		break;
@@ -240,6 +289,7 @@ void handle_soft3d_op(uint16_t zdata)
     		DEBUG_SOFT3D("ST 0x%08lx\n",local_data.offset[1]);
     		DEBUG_SOFT3D("PT 0x%08lx\n",local_data.offset[2]);
 
+    		SOFT3D_BinDraw((uint32_t *)local_data.offset[0]);
     		SOFT3D_UpdateTexture((uint32_t *)local_data.offset[0],
     				             (uint32_t *)local_data.offset[1],
 								 (uint32_t *)local_data.offset[2]);
@@ -251,6 +301,7 @@ void handle_soft3d_op(uint16_t zdata)
     		DEBUG_SOFT3D("SC 0x%08lx\n",local_data.offset[0]);
     		DEBUG_SOFT3D("l %d h %d\n",local_data.x[0],local_data.y[0]);
 
+    		SOFT3D_BinDraw((uint32_t *)local_data.offset[0]);
     		uint32_t add=(uint32_t)
     				SOFT3D_AllocZbuffer((uint32_t *)local_data.offset[0],
 								        local_data.x[0],local_data.y[0]);
@@ -264,6 +315,7 @@ void handle_soft3d_op(uint16_t zdata)
     		DEBUG_SOFT3D("SC 0x%08lx\n",local_data.offset[0]);
     		DEBUG_SOFT3D("l %d h %d\n",local_data.x[0],local_data.y[0]);
 
+    		SOFT3D_BinDraw((uint32_t *)local_data.offset[0]);
     		SOFT3D_AllocImageBuffer((uint32_t *)local_data.offset[0],
 								     local_data.x[0],local_data.y[0]);
     		break;
@@ -274,6 +326,7 @@ void handle_soft3d_op(uint16_t zdata)
     		DEBUG_SOFT3D("SC 0x%08lx\n",local_data.offset[0]);
     		DEBUG_SOFT3D("format %f (0x%08lx)\n",*fz,local_data.format[0]);
 
+    		SOFT3D_BinDraw((uint32_t *)local_data.offset[0]);
     		SOFT3D_ClearZBuffer((uint32_t *)local_data.offset[0],
 								*fz);
     		}
@@ -289,6 +342,7 @@ void handle_soft3d_op(uint16_t zdata)
     		DEBUG_SOFT3D("N 0x%08lx\n",local_data.format[0]);
     		DEBUG_SOFT3D("Z 0x%08lx\n",local_data.offset[1]);
 
+    		SOFT3D_BinDraw((uint32_t *)local_data.offset[0]);
     		SOFT3D_ReadZSpan((uint32_t *)local_data.offset[0],
     				         local_data.x[0],local_data.y[0],
 							 local_data.format[0],
@@ -307,12 +361,21 @@ void handle_soft3d_op(uint16_t zdata)
     		DEBUG_SOFT3D("Z 0x%08lx\n",local_data.offset[1]);
     		DEBUG_SOFT3D("MASK 0x%08lx\n",local_data.offset[2]);
 
+    		SOFT3D_BinDraw((uint32_t *)local_data.offset[0]);
     		SOFT3D_WriteZSpan((uint32_t *)local_data.offset[0],
     				          local_data.x[0],local_data.y[0],
 							  local_data.format[0],
 							  (uint32_t *)local_data.offset[1],
 							  (uint32_t *)local_data.offset[2]);
     		break;
+    	case OP_RING: {
+    		/* the ring is drawn: rewind it for the Amiga */
+    		volatile struct Soft3DRing *ring=(volatile struct Soft3DRing *)((uint32_t)data3d+SOFT3D_RING_OFFSET);
+    		ring->read=ring->write=0;
+    		ring_on=1;
+    		*(uint32_t*)(RTG_BASE+REG_ZZ_SOFT3D_OP)=swap32(SOFT3D_RING_MAGIC);
+    	}
+    		break;
         default:
             break;
     }
@@ -498,6 +561,9 @@ struct SOFT3D_context{
     UBYTE *Image8;
     ULONG *ImageBuffer32;
     ZBUFF *Zbuffer;
+    struct ztile3D *Ztiles;            /* hierarchical Z: the Zbuffer as 8x8 tiles */
+    UWORD ZtilesLarge,Zlarge,Zhigh;
+    ZBUFF Zclear;                    /* z of the tiles flagged as cleared */
     UBYTE NoopRGBA[4];
     union
     {
@@ -554,6 +620,8 @@ struct SOFT3D_context{
     LONG dmin;
     UWORD yoffset;
     UBYTE UseHard;
+    WORD BandY,BandHigh;            /* drawing a band: only fill those lines (BandHigh=0 fill all) */
+    struct bin3D *Bins;            /* polygons waiting for SOFT3D_BinDraw */
     struct state3D state;
     struct HARD3D_context HC;
 #ifdef AMIGA                 /* of course the PC DLL cant manipulate an Amiga's bitmap */
@@ -564,20 +632,31 @@ struct SOFT3D_context{
 #endif
 };
 /*=================================================================*/
+/* The textures are drawn from ptmm = a RGBA copy made of 4x4 texels tiles (64 bytes) so a rotated polygon still read near texels */
+/* A texel offset is TILEX(x)+TILEY(y) so the fill loops keep using MM->Tex8U[u]+MM->Tex8V[v] as with lines of texels */
+#define TILES(large)    (((ULONG)(large)+3)/4)
+#define TILEX(x)        ((((ULONG)(x)>>2)<<6) + (((x)&3)<<2))
+#define TILEY(y,tiles)  (((((ULONG)(y)>>2)*(tiles))<<6) + (((y)&3)<<4))
+#define NEXTMIPMAP(l)   (((l)>1)?(l)/2:1)
 struct SOFT3D_mipmap{
     UBYTE *Tex8V[256];    /* adresse of the texture at this line */
-    ULONG  Tex8Vlow[256];
     UWORD  Tex8U[256];
-    UWORD  Tex8Ulow[256];
+    UWORD  TexU[256];     /* big textures: texel x,y for the high and the low byte of u,v */
+    UWORD  TexUlow[256];
+    UWORD  TexV[256];
+    UWORD  TexVlow[256];
+    ULONG  tiles;         /* tiles in a line of this mipmap */
 };
 /*=================================================================*/
 #define NBMIPMAPS 12
 struct SOFT3D_texture{
     struct SOFT3D_mipmap MMs[NBMIPMAPS];
     UBYTE *pt;            /* original  data from 3Dprog as RGB or RGBA */
-    UBYTE *ptmm;        /* mipmaps as RGB or RGBA */
+    UBYTE *ptmm;        /* texture and its mipmaps as RGBA tiles of 4x4 texels */
     UWORD large,high,format,bits;
     UBYTE TexFlags;
+    UBYTE NbMM;            /* mipmaps in ptmm */
+    ULONG checksum;        /* pt content when ptmm was built */
     UBYTE name[40];
     UWORD Tnum;
     void *nextST;
@@ -585,6 +664,65 @@ struct SOFT3D_texture{
     struct HARD3D_texture HT;
 };
 /*=================================================================*/
+/* Hierarchical Z: the min & max z of each line of a 8x8 tile of the Zbuffer */
+/* a cleared tile is not written in the Zbuffer until a span really need its z */
+#define ZTILE 8
+struct ztile3D{
+    ZBUFF zmin[ZTILE];
+    ZBUFF zmax[ZTILE];
+    ULONG cleared;
+    ULONG pad[7];                    /* 96 bytes: two cores never share a cache line */
+};
+/*=================================================================*/
+/* Binning: the polygons are stored until SOFT3D_BinDraw() then the screen is drawn as bands of BINHIGH lines */
+#define BINHIGH 32                    /* a 640 pixels band with its Zbuffer = 160K so stay in L2 */
+#define BINBUFFERSIZE (1024*1024)
+#define MAXBINSTATES 256
+
+struct binstate3D{
+    struct state3D state;
+    HOOKEDFUNCTION FunctionPoly;
+    HOOKEDFUNCTION FunctionEdge;
+    HOOKEDFUNCTION FunctionFill;
+    HOOKEDFUNCTION FunctionZtest;
+    HOOKEDFUNCTION FunctionIn;
+    HOOKEDFUNCTION FunctionBlend;
+    HOOKEDFUNCTION FunctionBlendFast;
+    HOOKEDFUNCTION FunctionTexEnv;
+    HOOKEDFUNCTION FunctionFog;
+    HOOKEDFUNCTION FunctionFilter;
+    HOOKEDFUNCTION FunctionSepia;
+    HOOKEDFUNCTION FunctionOut;
+    UBYTE SrcFunc,DstFunc;
+};
+struct binpix3D{                    /* what COPYPIX need */
+    ZBUFF z;
+    float w;
+    LONG u,v,R,G,B,A,x,y,F;
+};
+struct binpoly3D{
+    UWORD Snum;                    /* States[] used by this polygon */
+    UWORD Pnb;
+    WORD ymin,ymax;
+    ULONG FlatRGBA;
+    struct binpix3D Pix[1];            /* Pnb points */
+};
+struct bin3D{
+    struct SOFT3D_context *WorkSC;        /* context used by core1 */
+    struct binstate3D States[MAXBINSTATES];
+    UWORD Snb;
+    ULONG Polys;
+    ULONG Used;                    /* bytes used in Buffer */
+    ULONG PolyLarge;                /* as the last poly leave it in SC */
+    union pixel3D PolyPix[MAXPOLY];        /* SC->PolyPix saved while drawing */
+    ULONG Buffer[BINBUFFERSIZE/4];
+};
+struct binjob3D{
+    struct SOFT3D_context *SC;
+    struct bin3D *Bins;
+    WORD band,step;
+};
+/*=================================================================*/
 #ifdef WAZP3DDEBUG
 UBYTE font8x8[14*16*8] = {
         0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
@@ -752,6 +890,7 @@ void AntiAliasImage(void *image,UWORD large,UWORD high);
 void ClipPoly(struct SOFT3D_context *SC);
 void ClipLine(struct SOFT3D_context *SC);
 void CreateMipmaps(struct SOFT3D_texture *ST);
+BOOL ConvertTexture(struct SOFT3D_texture *ST,UBYTE UseMip);
 void DrawLinePix(struct SOFT3D_context *SC);
 void DrawPointPix(struct SOFT3D_context *SC);
 void DrawSimplePix(struct SOFT3D_context *SC,register union pixel3D *P);
@@ -799,7 +938,8 @@ void PixelsSrcAlpha_OneMinusSrcAlpha32perfect(struct SOFT3D_context *SC);
 void PixelsChroma32fast(struct SOFT3D_context *SC);
 void PrintPix(union pixel3D *Pix);
 void PrintST(struct SOFT3D_texture *ST);
-void ReduceBitmap(UBYTE *pt,UBYTE *pt2,UWORD large,UWORD high, WORD bits,WORD ratio);
+ULONG TextureChecksum(UBYTE *pt,ULONG size);
+void TileTexture(struct SOFT3D_texture *ST);
 void UnLockBM(struct SOFT3D_context *SC);
 void UVtoRGBA(struct SOFT3D_texture *ST,float u,float v,UBYTE *RGBA);
 void Ztest_zalways(struct SOFT3D_context *SC);
@@ -819,6 +959,17 @@ void Ztest_znequal_update(struct SOFT3D_context *SC);
 void Ztest_znever_update(struct SOFT3D_context *SC);
 void Ztest_znotequal(struct SOFT3D_context *SC);
 void Ztest_znotequal_update(struct SOFT3D_context *SC);
+void ZtileFill(struct SOFT3D_context *SC,ULONG tx,ULONG ty);
+void ZtilesFill(struct SOFT3D_context *SC,ULONG x,ULONG y,ULONG n);
+void ZtilesUpdate(struct SOFT3D_context *SC,ULONG x,ULONG y,ULONG n);
+#ifdef __ARM_NEON__
+void PixelsModulate24_neon(struct SOFT3D_context *SC);
+void PixelsModulate32_neon(struct SOFT3D_context *SC);
+void PixelsDecal32_neon(struct SOFT3D_context *SC);
+void PixelsBlend24_neon(struct SOFT3D_context *SC);
+void PixelsBlend32_neon(struct SOFT3D_context *SC);
+void PixelsSrcAlpha_OneMinusSrcAlpha32_neon(struct SOFT3D_context *SC);
+#endif
 void PixelsOut8(struct SOFT3D_context *SC);
 void PixelsIn8(struct SOFT3D_context *SC);
 void PixelsOut16(struct SOFT3D_context *SC);
@@ -841,6 +992,10 @@ void Edge_Persp_Tex(struct SOFT3D_context *SC);
 void Edge_Tex(struct SOFT3D_context *SC);
 void ChangeSoftPoint(APTR sc);
 void SOFT3D_SetDrawFunctions(APTR sc);
+BOOL BinUse(struct SOFT3D_context *SC);
+void BinPoly(struct SOFT3D_context *SC);
+void FillBand(struct SOFT3D_context *SC);
+struct SOFT3D_context *BinSC=NULL;        /* context that got binned polygons */
 /*==========================================================================*/
 #ifdef __amigaos4__
 
@@ -983,14 +1138,23 @@ SVAR(high)
         { SREM(will change an existing Zbuffer...); }
 
     FREEPTR(SC->Zbuffer);
+    FREEPTR(SC->Ztiles);
 
     if(high!=0)
     if(large!=0)
+    {
         SC->Zbuffer=Zbuffer=MMmalloc(large*high*sizeof(ZBUFF),"Zbuffer");
+        SC->ZtilesLarge=(large+ZTILE-1)/ZTILE;
+        SC->Ztiles=MMmalloc(SC->ZtilesLarge*((high+ZTILE-1)/ZTILE)*sizeof(struct ztile3D),"Ztiles");
+        if(SC->Ztiles==NULL)
+            {FREEPTR(SC->Zbuffer); Zbuffer=NULL;}
+    }
 //    chunk_list_dump(&alloced_chunks, "Alloced");
 //    chunk_list_dump(&freed_chunks, "Freed");
 
-    if(Zbuffer!=NULL)
+    SC->Zlarge=large;
+    SC->Zhigh=high;
+    if(Zbuffer!=NULL)                /* MMmalloc() clear so all the z and the tiles bounds start at 0 */
     YLOOP(high)
         { SC->edge1[y].L.ZbufferY = SC->edge2[y].L.ZbufferY =SC->edgeM[y].L.ZbufferY =Zbuffer;Zbuffer+=large;}
     }
@@ -1145,6 +1309,17 @@ SVAR(PrefsWazp3D)
 
     Functions.BlendFast[BLENDFASTALPHA]=                    (HOOKEDFUNCTION)PixelsSrcAlpha_OneMinusSrcAlpha32fast;
 
+#ifdef __ARM_NEON__
+/* NEON span versions of the most used functions: same pixels as the C ones */
+    Functions.TexEnv[W3D_MODULATE *2+0]=(HOOKEDFUNCTION)PixelsModulate24_neon;
+    Functions.TexEnv[W3D_MODULATE *2+1]=(HOOKEDFUNCTION)PixelsModulate32_neon;
+    Functions.TexEnv[W3D_DECAL    *2+1]=(HOOKEDFUNCTION)PixelsDecal32_neon;
+    Functions.TexEnv[W3D_BLEND    *2+0]=(HOOKEDFUNCTION)PixelsBlend24_neon;
+    Functions.TexEnv[W3D_BLEND    *2+1]=(HOOKEDFUNCTION)PixelsBlend32_neon;
+
+    Functions.BlendFast[W3D_SRC_ALPHA*16 + W3D_ONE_MINUS_SRC_ALPHA]= (HOOKEDFUNCTION)PixelsSrcAlpha_OneMinusSrcAlpha32_neon;
+#endif
+
 
 #ifdef SLOWCPU
 /* compute the precalculated tables */
@@ -1275,11 +1450,10 @@ SVAR(I32)
 void SOFT3D_ClearZBuffer(APTR sc,float fz)
 {
 struct SOFT3D_context *SC=sc;
-register ZBUFF *Zbuffer;
-register ULONG size=SC->high*SC->large/8;
 register ULONG n;
 register ZBUFF z;
 register float zresize=ZRESIZE;
+ULONG tiles=SC->ZtilesLarge*((SC->Zhigh+ZTILE-1)/ZTILE);
     DEBUG_SOFT3D("%s start\n",__FUNCTION__);
 
     if(!Wazp3D->PrefsIsOpened)        /* if the user dont changing debug states */
@@ -1289,18 +1463,15 @@ SFUNCTION(SOFT3D_ClearZBuffer)
 
     if(SC->Zbuffer!=NULL)    /* only happen in software mode */
     {
-    Zbuffer=SC->Zbuffer;
     SVARF(fz)
     z=fz*zresize;
     if (z < MINZ)    z=MINZ;
     if (MAXZ < z)    z=MAXZ;
     SVARF(z)
-    NLOOP(size)
-        {
-        Zbuffer[0]=z;    Zbuffer[1]=z;    Zbuffer[2]=z; Zbuffer[3]=z;
-        Zbuffer[4]=z;    Zbuffer[5]=z;    Zbuffer[6]=z; Zbuffer[7]=z;
-        Zbuffer+=8;
-        }
+    /* only flag the tiles of the whole Zbuffer: they will be cleared when used */
+    SC->Zclear=z;
+    NLOOP(tiles)
+        SC->Ztiles[n].cleared=TRUE;
     }
 
 #ifdef USEOPENGL
@@ -1324,6 +1495,7 @@ register ULONG i;
 SFUNCTION(SOFT3D_ReadZSpan)
     if(SC->Zbuffer!=NULL)    /* only happen in software mode */
     {
+    ZtilesFill(SC,x,y,n);
     Zbuffer=SC->edge1[y].L.ZbufferY + x;
     ILOOP(n)
         {
@@ -1354,6 +1526,7 @@ register ULONG i;
 SFUNCTION(SOFT3D_WriteZSpan)
     if(SC->Zbuffer!=NULL)    /* only happen in software mode */
     {
+    ZtilesFill(SC,x,y,n);
     Zbuffer=SC->edge1[y].L.ZbufferY + x;
     ILOOP(n)
         if(m[i]!=0)
@@ -1363,6 +1536,7 @@ SFUNCTION(SOFT3D_WriteZSpan)
             if (MAXZ < fz)    fz=MAXZ;
             Zbuffer[i]=fz*zresize;
             }
+    ZtilesUpdate(SC,x,y,n);
     }
 #ifdef USEOPENGL
     if(SC->UseHard) HARD3D_WriteZSpan(&SC->HC,x,y,n,z,mask);
@@ -1379,6 +1553,14 @@ void SOFT3D_End(APTR sc)
         LibDebug=Wazp3D->DebugWazp3D.ON;    /* synchronize soft3d's LibDebug with global debug value "DebugWazp3D" setted with Wazp3-Prefs */
 SFUNCTION(SOFT3D_End)
     if(SC==NULL) return;
+    if(SC->Bins!=NULL)
+    {
+        SOFT3D_BinDraw(SC);
+        if(BinSC==SC)
+            BinSC=NULL;
+        FREEPTR(SC->Bins->WorkSC);
+        FREEPTR(SC->Bins);
+    }
     if(SC->ImageBuffer32!=NULL)
     {
         SREM(Free ImageBuffer32)
@@ -1767,6 +1949,151 @@ SREM(PixelsBlend32)
     }
 }
 /*=============================================================*/
+#ifdef __ARM_NEON__
+/* NEON versions: 4 Frags per loop (the last loop may only have the 2 Frags of a pair) */
+/* the Frags are gathered to 16 bytes = 4 RGBA and the results are the same as MUL8 ones */
+static inline __attribute__((always_inline)) uint8x16_t Mul8x16(uint8x16_t a,uint8x16_t b)
+{
+/* x/255 = (x + 1 + x/256)/256 for x <= 255*255 */
+uint16x8_t lo=vmull_u8(vget_low_u8(a) ,vget_low_u8(b));
+uint16x8_t hi=vmull_u8(vget_high_u8(a),vget_high_u8(b));
+uint16x8_t one=vdupq_n_u16(1);
+
+    return(vcombine_u8(vaddhn_u16(vsraq_n_u16(lo,lo,8),one),vaddhn_u16(vsraq_n_u16(hi,hi,8),one)));
+}
+/*=============================================================*/
+static inline __attribute__((always_inline)) uint8x16_t Alpha8x16(uint8x16_t c)
+{
+/* copy each A to the R G B of its pixel */
+    return(vreinterpretq_u8_u32(vmulq_n_u32(vshrq_n_u32(vreinterpretq_u32_u8(c),24),0x01010101)));
+}
+/*=============================================================*/
+#define ALPHAMASK8x16 vreinterpretq_u8_u32(vdupq_n_u32(0xFF000000))
+#define FRAGGET4(dst,field,n) { dst=vdupq_n_u32(0); dst=vsetq_lane_u32(*(field(0)),dst,0); dst=vsetq_lane_u32(*(field(1)),dst,1); if(n==4) { dst=vsetq_lane_u32(*(field(2)),dst,2); dst=vsetq_lane_u32(*(field(3)),dst,3); } }
+#define FRAGSET4(src,field,n) { *(field(0))=vgetq_lane_u32(src,0); *(field(1))=vgetq_lane_u32(src,1); if(n==4) { *(field(2))=vgetq_lane_u32(src,2); *(field(3))=vgetq_lane_u32(src,3); } }
+#define FRAGCOLOR(k)  ((ULONG *)Frag[k].ColorRGBA.L)
+#define FRAGBUFFER(k) ((ULONG *)Frag[k].BufferRGBA.L)
+#define FRAGTEX32(k)  ((ULONG *)Frag[k].Tex8)
+/*=============================================================*/
+static inline __attribute__((always_inline)) uint8x16_t FragTex24(struct fragbuffer3D *Frag,ULONG n)
+{
+/* dont read the 4th byte: it is the next texel or after the texture */
+uint32_t T[4]={0,0,0,0};
+ULONG k;
+
+    for(k=0;k<n;k++)
+        T[k]=Frag[k].Tex8[0] + (Frag[k].Tex8[1]<<8) + (Frag[k].Tex8[2]<<16);
+    return(vreinterpretq_u8_u32(vld1q_u32(T)));
+}
+/*=============================================================*/
+void PixelsModulate24_neon(struct SOFT3D_context *SC)
+{
+register struct fragbuffer3D *Frag=SC->FragBuffer;
+register ULONG size=SC->FragSize2;
+ULONG n;
+uint32x4_t C;
+uint8x16_t T,R;
+
+SREM(PixelsModulate24_neon)
+    while(0<size)
+    {
+    n=(size>1)?4:2;
+    FRAGGET4(C,FRAGCOLOR,n)
+    T=FragTex24(Frag,n);
+    R=Mul8x16(T,vreinterpretq_u8_u32(C));
+    C=vreinterpretq_u32_u8(vbslq_u8(ALPHAMASK8x16,vreinterpretq_u8_u32(C),R));
+    FRAGSET4(C,FRAGCOLOR,n)
+    Frag+=n; size-=n/2;
+    }
+}
+/*=============================================================*/
+void PixelsModulate32_neon(struct SOFT3D_context *SC)
+{
+register struct fragbuffer3D *Frag=SC->FragBuffer;
+register ULONG size=SC->FragSize2;
+ULONG n;
+uint32x4_t C,T;
+
+SREM(PixelsModulate32_neon)
+    while(0<size)
+    {
+    n=(size>1)?4:2;
+    FRAGGET4(C,FRAGCOLOR,n)
+    FRAGGET4(T,FRAGTEX32,n)
+    C=vreinterpretq_u32_u8(Mul8x16(vreinterpretq_u8_u32(T),vreinterpretq_u8_u32(C)));
+    FRAGSET4(C,FRAGCOLOR,n)
+    Frag+=n; size-=n/2;
+    }
+}
+/*=============================================================*/
+void PixelsDecal32_neon(struct SOFT3D_context *SC)
+{
+register struct fragbuffer3D *Frag=SC->FragBuffer;
+register ULONG size=SC->FragSize2;
+ULONG n;
+uint32x4_t C,T;
+uint8x16_t A,R;
+
+SREM(PixelsDecal32_neon)
+    while(0<size)
+    {
+    n=(size>1)?4:2;
+    FRAGGET4(C,FRAGCOLOR,n)
+    FRAGGET4(T,FRAGTEX32,n)
+    A=Alpha8x16(vreinterpretq_u8_u32(T));
+    R=vaddq_u8(Mul8x16(vreinterpretq_u8_u32(T),A),Mul8x16(vreinterpretq_u8_u32(C),vmvnq_u8(A)));
+    C=vreinterpretq_u32_u8(vbslq_u8(ALPHAMASK8x16,vreinterpretq_u8_u32(C),R));    /* alpha from color */
+    FRAGSET4(C,FRAGCOLOR,n)
+    Frag+=n; size-=n/2;
+    }
+}
+/*=============================================================*/
+void PixelsBlend24_neon(struct SOFT3D_context *SC)
+{
+register struct fragbuffer3D *Frag=SC->FragBuffer;
+register ULONG size=SC->FragSize2;
+uint8x16_t Env=vreinterpretq_u8_u32(vdupq_n_u32(SC->state.EnvRGBA.L[0]));
+ULONG n;
+uint32x4_t C;
+uint8x16_t T,R;
+
+SREM(PixelsBlend24_neon)
+    while(0<size)
+    {
+    n=(size>1)?4:2;
+    FRAGGET4(C,FRAGCOLOR,n)
+    T=FragTex24(Frag,n);
+    R=vaddq_u8(Mul8x16(vreinterpretq_u8_u32(C),vmvnq_u8(T)),Mul8x16(Env,T));
+    C=vreinterpretq_u32_u8(vbslq_u8(ALPHAMASK8x16,vreinterpretq_u8_u32(C),R));
+    FRAGSET4(C,FRAGCOLOR,n)
+    Frag+=n; size-=n/2;
+    }
+}
+/*=============================================================*/
+void PixelsBlend32_neon(struct SOFT3D_context *SC)
+{
+register struct fragbuffer3D *Frag=SC->FragBuffer;
+register ULONG size=SC->FragSize2;
+uint8x16_t Env=vreinterpretq_u8_u32(vdupq_n_u32(SC->state.EnvRGBA.L[0]));
+ULONG n;
+uint32x4_t C,T;
+uint8x16_t R,A;
+
+SREM(PixelsBlend32_neon)
+    while(0<size)
+    {
+    n=(size>1)?4:2;
+    FRAGGET4(C,FRAGCOLOR,n)
+    FRAGGET4(T,FRAGTEX32,n)
+    R=vaddq_u8(Mul8x16(vreinterpretq_u8_u32(C),vmvnq_u8(vreinterpretq_u8_u32(T))),Mul8x16(Env,vreinterpretq_u8_u32(T)));
+    A=Mul8x16(vreinterpretq_u8_u32(C),vreinterpretq_u8_u32(T));
+    C=vreinterpretq_u32_u8(vbslq_u8(ALPHAMASK8x16,A,R));
+    FRAGSET4(C,FRAGCOLOR,n)
+    Frag+=n; size-=n/2;
+    }
+}
+#endif
+/*=============================================================*/
 void PixelsAdd24(struct SOFT3D_context *SC)
 {
 /* v50: add src & dst  (always) */
@@ -2231,6 +2558,39 @@ SREM(PixelsSrcAlpha_OneMinusSrcAlpha32)
     }
 }
 /*=============================================================*/
+#ifdef __ARM_NEON__
+void PixelsSrcAlpha_OneMinusSrcAlpha32_neon(struct SOFT3D_context *SC)
+{
+/* blend source & dest (if source not solid nor transparent) */
+register struct fragbuffer3D *Frag=SC->FragBuffer;
+register ULONG  size=SC->FragSize2;
+uint32x4_t S,D,Visible,Solid;
+uint8x16_t A,R;
+ULONG n;
+
+SREM(PixelsSrcAlpha_OneMinusSrcAlpha32_neon)
+    while(0<size)
+    {
+    n=(size>1)?4:2;
+    FRAGGET4(S,FRAGCOLOR,n)
+    FRAGGET4(D,FRAGBUFFER,n)
+    A=Alpha8x16(vreinterpretq_u8_u32(S));
+    R=vaddq_u8(Mul8x16(vreinterpretq_u8_u32(S),A),Mul8x16(vreinterpretq_u8_u32(D),vmvnq_u8(A)));
+    R=vbslq_u8(ALPHAMASK8x16,vreinterpretq_u8_u32(D),R);        /* dest alpha is kept */
+    if(Wazp3D->UseAlphaMinMax.ON)
+    {
+        Visible=vcgtq_u32(vshrq_n_u32(S,24),vdupq_n_u32(MINALPHA));
+        Solid  =vcgeq_u32(vshrq_n_u32(S,24),vdupq_n_u32(MAXALPHA));
+        R=vbslq_u8(vreinterpretq_u8_u32(Solid),vreinterpretq_u8_u32(S),R);
+        R=vbslq_u8(vreinterpretq_u8_u32(Visible),R,vreinterpretq_u8_u32(D));
+    }
+    D=vreinterpretq_u32_u8(R);
+    FRAGSET4(D,FRAGBUFFER,n)
+    Frag+=n; size-=n/2;
+    }
+}
+#endif
+/*=============================================================*/
 void PixelsChroma32fast(struct SOFT3D_context *SC)
 {
     /* copy source to dest (if not black)*/
@@ -3307,6 +3667,7 @@ register struct SOFT3D_mipmap *MM=SC->MM;
 register struct fragbuffer3D *Frag=SC->FragBufferDone;
 register WORD high  =SC->PolyHigh;
 register WORD large;
+register ULONG x,y;
 
 SREM(Fill_BigTexPersp2_Gouraud_Fog)
 
@@ -3321,8 +3682,9 @@ SREM(Fill_BigTexPersp2_Gouraud_Fog)
     if(*Ztest++)
         {
         Frag->Image8=Image8;
-        Frag->Tex8 =MM->Tex8U   [Pix->W.u ]+MM->Tex8V   [Pix->W.v ];
-        Frag->Tex8+=MM->Tex8Ulow[Pix->W.u3]+MM->Tex8Vlow[Pix->W.v3];
+        x=MM->TexU[Pix->W.u]+MM->TexUlow[Pix->W.u3];
+        y=MM->TexV[Pix->W.v]+MM->TexVlow[Pix->W.v3];
+        Frag->Tex8=MM->Tex8V[0]+TILEX(x)+TILEY(y,MM->tiles);
         Frag->ColorRGBA.b[0]=Pix->W.R;
         Frag->ColorRGBA.b[1]=Pix->W.G;
         Frag->ColorRGBA.b[2]=Pix->W.B;
@@ -3358,6 +3720,7 @@ register struct SOFT3D_mipmap *MM=SC->MM;
 register struct fragbuffer3D *Frag=SC->FragBufferDone;
 register WORD high  =SC->PolyHigh;
 register WORD large;
+register ULONG x,y;
 
 SREM(Fill_BigTexPersp2)
 
@@ -3372,8 +3735,9 @@ SREM(Fill_BigTexPersp2)
     if(*Ztest++)
         {
         Frag->Image8=Image8;
-        Frag->Tex8 =MM->Tex8U   [Pix->W.u ]+MM->Tex8V   [Pix->W.v ];
-        Frag->Tex8+=MM->Tex8Ulow[Pix->W.u3]+MM->Tex8Vlow[Pix->W.v3];
+        x=MM->TexU[Pix->W.u]+MM->TexUlow[Pix->W.u3];
+        y=MM->TexV[Pix->W.v]+MM->TexVlow[Pix->W.v3];
+        Frag->Tex8=MM->Tex8V[0]+TILEX(x)+TILEY(y,MM->tiles);
         COPYRGBA(Frag->ColorRGBA.L,SC->FlatRGBA.L);
         Frag++;
         }
@@ -3797,12 +4161,107 @@ SREM(Fill_Tex_Fog)
 SC->FragBufferDone=Frag;
 }
 /*=============================================================*/
+/* one span of Fill_Tex (persp=FALSE) or Fill_TexPersp2 (persp=TRUE) */
+static inline __attribute__((always_inline)) struct fragbuffer3D *TexSpan_c(struct SOFT3D_context *SC,union pixel3D *Pix,struct fragbuffer3D *Frag,UBYTE *Image8,UBYTE *Ztest,WORD large,ULONG persp)
+{
+register struct SOFT3D_mipmap *MM=SC->MM;
+
+    while(0<large--)
+    {
+        if(*Ztest++)
+        {
+            Frag->Image8=Image8;
+            Frag->Tex8 =MM->Tex8U   [Pix->W.u ]+MM->Tex8V   [Pix->W.v ];
+            COPYRGBA(Frag->ColorRGBA.L,SC->FlatRGBA.L);
+            Frag++;
+        }
+        Image8=Image8+Pix->L.bpp;
+        Pix->L.u +=Pix->L.du;
+        Pix->L.v +=Pix->L.dv;
+        if(persp)
+        {
+        Pix->L.du+=Pix->L.ddu;
+        Pix->L.dv+=Pix->L.ddv;
+        }
+    }
+    return(Frag);
+}
+/*=============================================================*/
+#ifdef __ARM_NEON__
+/* NEON version: u v are stepped for 8 pixels at once so the texels offsets come from 8 bytes u & 8 bytes v */
+/* lane k: u+k*du+k*(k-1)/2*ddu and du+k*ddu = same 32 bits integers as the scalar steps */
+static inline __attribute__((always_inline)) struct fragbuffer3D *TexSpan_neon(struct SOFT3D_context *SC,union pixel3D *Pix,struct fragbuffer3D *Frag,UBYTE *Image8,UBYTE *Ztest,WORD large,ULONG persp)
+{
+register struct SOFT3D_mipmap *MM=SC->MM;
+register UWORD bpp=Pix->L.bpp;
+ULONG ddu=persp?Pix->L.ddu:0;
+ULONG ddv=persp?Pix->L.ddv:0;
+uint32_t Lane[8] __attribute__((aligned(16)));
+UBYTE U[8] __attribute__((aligned(8)));
+UBYTE V[8] __attribute__((aligned(8)));
+uint32x4_t U0,U1,V0,V1,DU0,DU1,DV0,DV1,Step;
+ULONG k;
+
+    if(large<8)
+        return(TexSpan_c(SC,Pix,Frag,Image8,Ztest,large,persp));
+
+    for(k=0;k<8;k++) Lane[k]=(ULONG)Pix->L.du + k*ddu;
+    DU0=vld1q_u32(&Lane[0]); DU1=vld1q_u32(&Lane[4]);
+    for(k=0;k<8;k++) Lane[k]=(ULONG)Pix->L.u + k*(ULONG)Pix->L.du + k*(k-1)/2*ddu;
+    U0=vld1q_u32(&Lane[0]);  U1=vld1q_u32(&Lane[4]);
+    for(k=0;k<8;k++) Lane[k]=(ULONG)Pix->L.dv + k*ddv;
+    DV0=vld1q_u32(&Lane[0]); DV1=vld1q_u32(&Lane[4]);
+    for(k=0;k<8;k++) Lane[k]=(ULONG)Pix->L.v + k*(ULONG)Pix->L.dv + k*(k-1)/2*ddv;
+    V0=vld1q_u32(&Lane[0]);  V1=vld1q_u32(&Lane[4]);
+
+    while(8<=large)
+    {
+        if(vget_lane_u64(vreinterpret_u64_u8(vld1_u8(Ztest)),0))    /* else the 8 pixels are hidden */
+        {
+        vst1_u8(U,vmovn_u16(vcombine_u16(vshrn_n_u32(U0,16),vshrn_n_u32(U1,16))));
+        vst1_u8(V,vmovn_u16(vcombine_u16(vshrn_n_u32(V0,16),vshrn_n_u32(V1,16))));
+        for(k=0;k<8;k++)
+            if(Ztest[k])
+            {
+                Frag->Image8=Image8+k*bpp;
+                Frag->Tex8 =MM->Tex8U   [U[k]]+MM->Tex8V   [V[k]];
+                COPYRGBA(Frag->ColorRGBA.L,SC->FlatRGBA.L);
+                Frag++;
+            }
+        }
+        Image8+=8*bpp; Ztest+=8; large-=8;
+
+        Step=vdupq_n_u32(28*ddu);            /* 0+1+...+7 */
+        U0=vaddq_u32(U0,vaddq_u32(vshlq_n_u32(DU0,3),Step));
+        U1=vaddq_u32(U1,vaddq_u32(vshlq_n_u32(DU1,3),Step));
+        Step=vdupq_n_u32(28*ddv);
+        V0=vaddq_u32(V0,vaddq_u32(vshlq_n_u32(DV0,3),Step));
+        V1=vaddq_u32(V1,vaddq_u32(vshlq_n_u32(DV1,3),Step));
+        if(persp)
+        {
+        Step=vdupq_n_u32(8*ddu);
+        DU0=vaddq_u32(DU0,Step); DU1=vaddq_u32(DU1,Step);
+        Step=vdupq_n_u32(8*ddv);
+        DV0=vaddq_u32(DV0,Step); DV1=vaddq_u32(DV1,Step);
+        }
+    }
+
+    Pix->L.u =(LONG)vgetq_lane_u32(U0,0);
+    Pix->L.v =(LONG)vgetq_lane_u32(V0,0);
+    Pix->L.du=(LONG)vgetq_lane_u32(DU0,0);
+    Pix->L.dv=(LONG)vgetq_lane_u32(DV0,0);
+    return(TexSpan_c(SC,Pix,Frag,Image8,Ztest,large,persp));
+}
+#define TexSpan TexSpan_neon
+#else
+#define TexSpan TexSpan_c
+#endif
+/*=============================================================*/
 void Fill_TexPersp2(struct SOFT3D_context *SC)
 {
 register UBYTE *Image8;
 register UBYTE *Ztest;
 register union pixel3D *Pix=SC->Pix;
-register struct SOFT3D_mipmap *MM=SC->MM;
 register struct fragbuffer3D *Frag=SC->FragBufferDone;
 register WORD high  =SC->PolyHigh;
 register WORD large;
@@ -3820,21 +4279,7 @@ SREM(Fill_TexPersp2)
         SC->Pix=Pix;
         SC->FunctionZtest(SC);
         Ztest=SC->Ztest;
-        while(0<large--)
-        {
-            if(*Ztest++)
-            {
-                Frag->Image8=Image8;
-                Frag->Tex8 =MM->Tex8U   [Pix->W.u ]+MM->Tex8V   [Pix->W.v ];
-                COPYRGBA(Frag->ColorRGBA.L,SC->FlatRGBA.L);
-                Frag++;
-            }
-            Image8=Image8+Pix->L.bpp;
-            Pix->L.u +=Pix->L.du;
-            Pix->L.v +=Pix->L.dv;
-            Pix->L.du+=Pix->L.ddu;
-            Pix->L.dv+=Pix->L.ddv;
-        }
+        Frag=TexSpan(SC,Pix,Frag,Image8,Ztest,large,TRUE);
 
         if(Frag > SC->FragBufferMaxi)
         {
@@ -3896,7 +4341,6 @@ void Fill_Tex(struct SOFT3D_context *SC)
 register UBYTE *Image8;
 register UBYTE *Ztest;
 register union pixel3D *Pix=SC->Pix;
-register struct SOFT3D_mipmap *MM=SC->MM;
 register struct fragbuffer3D *Frag=SC->FragBufferDone;
 register WORD high  =SC->PolyHigh;
 register WORD large;
@@ -3919,19 +4363,7 @@ register WORD large;
         large    = Pix->W.large;
 
         SC->Pix=Pix; SC->FunctionZtest(SC); Ztest=SC->Ztest;
-        while(0<large--)
-        {
-            if(*Ztest++)
-            {
-                Frag->Image8=Image8;
-                Frag->Tex8 =MM->Tex8U   [Pix->W.u ]+MM->Tex8V   [Pix->W.v ];
-                COPYRGBA(Frag->ColorRGBA.L,SC->FlatRGBA.L);
-                Frag++;
-            }
-            Image8=Image8+Pix->L.bpp;
-            Pix->L.u +=Pix->L.du;
-            Pix->L.v +=Pix->L.dv;
-        }
+        Frag=TexSpan(SC,Pix,Frag,Image8,Ztest,large,FALSE);
 
         if(Frag > SC->FragBufferMaxi)
             {SC->FragBufferDone=Frag;  SOFT3D_Flush(SC); Frag=SC->FragBuffer;}
@@ -3985,175 +4417,234 @@ register WORD large=Pix->W.large;
     while(0<large--)
         { *Ztest=(FALSE);  Ztest++; }
 }
+/* void Ztest_znever(struct SOFT3D_context *SC) same as Ztest_znever_update */
 /*=============================================================*/
-void Ztest_zless_update(struct SOFT3D_context *SC)
-{
-    register UBYTE *Ztest=SC->Ztest;
-    register union pixel3D *Pix=SC->Pix;
-    register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
-    register ZBUFF dz=Pix->L.dz;
-    register WORD large=Pix->W.large;
-
-    while(0<large--)
-        { *Ztest=(ZVALUE < *Zbuffer ); if(*Ztest) *Zbuffer=ZVALUE; Ztest++; Zbuffer++; Pix->L.z+=dz;}
-}
-/*=============================================================*/
-void Ztest_zgequal_update(struct SOFT3D_context *SC)
+void Ztest_zalways(struct SOFT3D_context *SC)
 {
 register UBYTE *Ztest=SC->Ztest;
 register union pixel3D *Pix=SC->Pix;
-register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
-register ZBUFF dz=Pix->L.dz;
 register WORD large=Pix->W.large;
 
     while(0<large--)
-        { *Ztest=(ZVALUE >= *Zbuffer ); if(*Ztest) *Zbuffer=ZVALUE; Ztest++; Zbuffer++; Pix->L.z+=dz;}
+        { *Ztest=(TRUE);  Ztest++; }
 }
 /*=============================================================*/
-void Ztest_zlequal_update(struct SOFT3D_context *SC)
-{
-register UBYTE *Ztest=SC->Ztest;
-register union pixel3D *Pix=SC->Pix;
-register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
-register ZBUFF dz=Pix->L.dz;
-register WORD large=Pix->W.large;
-
-    while(0<large--)
-        { *Ztest=(ZVALUE <= *Zbuffer ); if(*Ztest) *Zbuffer=ZVALUE; Ztest++; Zbuffer++; Pix->L.z+=dz;}
-}
 /*=============================================================*/
-void Ztest_zgreater_update(struct SOFT3D_context *SC)
+/* Hierarchical Z: a span is cut at the 8x8 tiles limits and a part that cant pass the test against */
+/* the min & max z of this tile line is rejected without reading the Zbuffer */
+enum {ZLESS,ZLEQUAL,ZGREATER,ZGEQUAL,ZEQUAL,ZNOTEQUAL,ZALWAYS};
+/*=============================================================*/
+void ZtileLine(struct ztile3D *T,ZBUFF *Zbuffer,ULONG line,ULONG size)
 {
-register UBYTE *Ztest=SC->Ztest;
-register union pixel3D *Pix=SC->Pix;
-register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
-register ZBUFF dz=Pix->L.dz;
-register WORD large=Pix->W.large;
+/* new min & max for this line of the tile (Zbuffer = its first z) */
+register ZBUFF zmin=Zbuffer[0];
+register ZBUFF zmax=Zbuffer[0];
+register ULONG n;
 
-    while(0<large--)
-        { *Ztest=(ZVALUE > *Zbuffer ); if(*Ztest) *Zbuffer=ZVALUE; Ztest++; Zbuffer++; Pix->L.z+=dz;}
+    for(n=1;n<size;n++)
+    {
+        if(Zbuffer[n]<zmin) zmin=Zbuffer[n];
+        if(zmax<Zbuffer[n]) zmax=Zbuffer[n];
+    }
+    T->zmin[line]=zmin;
+    T->zmax[line]=zmax;
 }
 /*=============================================================*/
-void Ztest_znotequal_update(struct SOFT3D_context *SC)
+void ZtileFill(struct SOFT3D_context *SC,ULONG tx,ULONG ty)
 {
-register UBYTE *Ztest=SC->Ztest;
-register union pixel3D *Pix=SC->Pix;
-register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
-register ZBUFF dz=Pix->L.dz;
-register WORD large=Pix->W.large;
+/* really clear a tile flagged as cleared */
+struct ztile3D *T=&SC->Ztiles[ty*SC->ZtilesLarge+tx];
+ZBUFF *Zbuffer;
+ULONG x,y,large,high;
 
-    while(0<large--)
-        { *Ztest=(ZVALUE != *Zbuffer ); if(*Ztest) *Zbuffer=ZVALUE; Ztest++; Zbuffer++; Pix->L.z+=dz;}
+    large=SC->Zlarge-tx*ZTILE; if(ZTILE<large) large=ZTILE;
+    high =SC->Zhigh -ty*ZTILE; if(ZTILE<high)  high =ZTILE;
+    YLOOP(high)
+    {
+        Zbuffer=SC->Zbuffer + (ty*ZTILE+y)*SC->Zlarge + tx*ZTILE;
+        XLOOP(large)
+            Zbuffer[x]=SC->Zclear;
+        T->zmin[y]=T->zmax[y]=SC->Zclear;
+    }
+    T->cleared=FALSE;
 }
 /*=============================================================*/
-void Ztest_zequal_update(struct SOFT3D_context *SC)
+void ZtilesFill(struct SOFT3D_context *SC,ULONG x,ULONG y,ULONG n)
 {
-register UBYTE *Ztest=SC->Ztest;
-register union pixel3D *Pix=SC->Pix;
-register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
-register ZBUFF dz=Pix->L.dz;
-register WORD large=Pix->W.large;
+/* the n z from x,y will be accessed directly */
+ULONG tx,ty=y/ZTILE;
 
-    while(0<large--)
-        { *Ztest=(ZVALUE == *Zbuffer ); if(*Ztest) *Zbuffer=ZVALUE; Ztest++; Zbuffer++; Pix->L.z+=dz;}
+    if(n==0) return;
+    for(tx=x/ZTILE;tx<=(x+n-1)/ZTILE;tx++)
+        if(SC->Ztiles[ty*SC->ZtilesLarge+tx].cleared)
+            ZtileFill(SC,tx,ty);
 }
 /*=============================================================*/
-void Ztest_zalways_update(struct SOFT3D_context *SC)
+void ZtilesUpdate(struct SOFT3D_context *SC,ULONG x,ULONG y,ULONG n)
 {
-register UBYTE *Ztest=SC->Ztest;
-register union pixel3D *Pix=SC->Pix;
-register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
-register ZBUFF dz=Pix->L.dz;
-register WORD large=Pix->W.large;
+/* the n z from x,y were changed directly */
+ULONG tx,ty=y/ZTILE;
+ULONG size;
 
-    while(0<large--)
-        { *Ztest=(TRUE); *Zbuffer=ZVALUE; Ztest++; Zbuffer++; Pix->L.z+=dz;}
+    if(n==0) return;
+    for(tx=x/ZTILE;tx<=(x+n-1)/ZTILE;tx++)
+    {
+        size=SC->Zlarge-tx*ZTILE; if(ZTILE<size) size=ZTILE;
+        ZtileLine(&SC->Ztiles[ty*SC->ZtilesLarge+tx],SC->Zbuffer + y*SC->Zlarge + tx*ZTILE,y%ZTILE,size);
+    }
 }
 /*=============================================================*/
-/* void Ztest_znever(struct SOFT3D_context *SC) same as Ztest_znever_update */
-/*=============================================================*/
-void Ztest_zless(struct SOFT3D_context *SC)
+static inline __attribute__((always_inline)) BOOL Zhidden(ULONG mode,ZBUFF zmin,ZBUFF zmax,ZBUFF bmin,ZBUFF bmax)
 {
-register UBYTE *Ztest=SC->Ztest;
-register union pixel3D *Pix=SC->Pix;
-register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
-register ZBUFF dz=Pix->L.dz;
-register WORD large=Pix->W.large;
-
-    while(0<large--)
-        { *Ztest=(ZVALUE < *Zbuffer ); Ztest++; Zbuffer++; Pix->L.z+=dz; }
+/* TRUE if no z in zmin-zmax can pass the test against a z in bmin-bmax (always FALSE with a NaN) */
+    if(mode==ZLESS)     return(zmin >= bmax);
+    if(mode==ZLEQUAL)   return(zmin >  bmax);
+    if(mode==ZGREATER)  return(zmax <= bmin);
+    if(mode==ZGEQUAL)   return(zmax <  bmin);
+    if(mode==ZEQUAL)    return((zmin > bmax) ou (zmax < bmin));
+    return(FALSE);
 }
 /*=============================================================*/
-void Ztest_zgequal(struct SOFT3D_context *SC)
+static inline __attribute__((always_inline)) UBYTE Zcompare(ZBUFF z,ZBUFF zb,ULONG mode)
 {
-register UBYTE *Ztest=SC->Ztest;
-register union pixel3D *Pix=SC->Pix;
-register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
-register ZBUFF dz=Pix->L.dz;
-register WORD large=Pix->W.large;
-
-    while(0<large--)
-        { *Ztest=(ZVALUE >= *Zbuffer ); Ztest++; Zbuffer++; Pix->L.z+=dz; }
+    if(mode==ZLESS)     return(z <  zb);
+    if(mode==ZLEQUAL)   return(z <= zb);
+    if(mode==ZGREATER)  return(z >  zb);
+    if(mode==ZGEQUAL)   return(z >= zb);
+    if(mode==ZEQUAL)    return(z == zb);
+    if(mode==ZNOTEQUAL) return(z != zb);
+    return(TRUE);
 }
 /*=============================================================*/
-void Ztest_zlequal(struct SOFT3D_context *SC)
+static inline __attribute__((always_inline)) BOOL ZtestSegment_c(UBYTE *Ztest,ZBUFF *Zbuffer,ZBUFF *Z,WORD size,ULONG mode,ULONG update)
 {
-register UBYTE *Ztest=SC->Ztest;
-register union pixel3D *Pix=SC->Pix;
-register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
-register ZBUFF dz=Pix->L.dz;
-register WORD large=Pix->W.large;
+/* test the part of span inside a tile: return TRUE if the Zbuffer changed */
+BOOL changed=FALSE;
+WORD n;
 
-    while(0<large--)
-        { *Ztest=(ZVALUE <= *Zbuffer ); Ztest++; Zbuffer++; Pix->L.z+=dz; }
+    NLOOP(size)
+    {
+        Ztest[n]=Zcompare(Z[n],Zbuffer[n],mode);
+        if(update) if(Ztest[n]) {Zbuffer[n]=Z[n]; changed=TRUE;}
+    }
+    return(changed);
 }
 /*=============================================================*/
-void Ztest_zgreater(struct SOFT3D_context *SC)
+#if defined(__ARM_NEON__) && defined(FLOATZBUFFER)
+/* NEON version: a whole tile line is tested at once */
+static inline __attribute__((always_inline)) uint32x4_t Zcompare4(float32x4_t z,float32x4_t zb,ULONG mode)
 {
-register UBYTE *Ztest=SC->Ztest;
-register union pixel3D *Pix=SC->Pix;
-register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
-register ZBUFF dz=Pix->L.dz;
-register WORD large=Pix->W.large;
-
-    while(0<large--)
-        { *Ztest=(ZVALUE > *Zbuffer ); Ztest++; Zbuffer++; Pix->L.z+=dz; }
+    if(mode==ZLESS)     return(vcltq_f32(z,zb));
+    if(mode==ZLEQUAL)   return(vcleq_f32(z,zb));
+    if(mode==ZGREATER)  return(vcgtq_f32(z,zb));
+    if(mode==ZGEQUAL)   return(vcgeq_f32(z,zb));
+    if(mode==ZEQUAL)    return(vceqq_f32(z,zb));
+    if(mode==ZNOTEQUAL) return(vmvnq_u32(vceqq_f32(z,zb)));
+    return(vdupq_n_u32(0xFFFFFFFF));
 }
 /*=============================================================*/
-void Ztest_znotequal(struct SOFT3D_context *SC)
+static inline __attribute__((always_inline)) BOOL ZtestSegment_neon(UBYTE *Ztest,ZBUFF *Zbuffer,ZBUFF *Z,WORD size,ULONG mode,ULONG update)
 {
-register UBYTE *Ztest=SC->Ztest;
-register union pixel3D *Pix=SC->Pix;
-register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
-register ZBUFF dz=Pix->L.dz;
-register WORD large=Pix->W.large;
+float32x4_t Z0,Z1,Zb0,Zb1;
+uint32x4_t T0,T1;
+uint8x8_t T;
 
-    while(0<large--)
-        { *Ztest=(ZVALUE != *Zbuffer ); Ztest++; Zbuffer++; Pix->L.z+=dz; }
+    if(size!=ZTILE)
+        return(ZtestSegment_c(Ztest,Zbuffer,Z,size,mode,update));
+
+    Z0 =vld1q_f32(&Z[0]);       Z1 =vld1q_f32(&Z[4]);
+    Zb0=vld1q_f32(&Zbuffer[0]); Zb1=vld1q_f32(&Zbuffer[4]);
+    T0=Zcompare4(Z0,Zb0,mode);
+    T1=Zcompare4(Z1,Zb1,mode);
+    T=vand_u8(vmovn_u16(vcombine_u16(vmovn_u32(T0),vmovn_u32(T1))),vdup_n_u8(TRUE));
+    vst1_u8(Ztest,T);
+    if(!update)
+        return(FALSE);
+    vst1q_f32(&Zbuffer[0],vbslq_f32(T0,Z0,Zb0));
+    vst1q_f32(&Zbuffer[4],vbslq_f32(T1,Z1,Zb1));
+    return(vget_lane_u64(vreinterpret_u64_u8(T),0)!=0);
 }
+#define ZtestSegment ZtestSegment_neon
+#else
+#define ZtestSegment ZtestSegment_c
+#endif
 /*=============================================================*/
-void Ztest_zequal(struct SOFT3D_context *SC)
+static inline __attribute__((always_inline)) void ZtestTiles(struct SOFT3D_context *SC,ULONG mode,ULONG update)
 {
 register UBYTE *Ztest=SC->Ztest;
 register union pixel3D *Pix=SC->Pix;
 register ZBUFF  *Zbuffer= &(Pix->L.ZbufferY[Pix->W.x]);
 register ZBUFF dz=Pix->L.dz;
+register ZBUFF z=Pix->L.z;
 register WORD large=Pix->W.large;
+ULONG x=Pix->W.x;
+ULONG y=(Pix - SC->edge1) % MAXSCREEN;            /* edge1 edge2 edgeM follow each other in SC */
+ULONG line=y%ZTILE;
+struct ztile3D *T=&SC->Ztiles[(y/ZTILE)*SC->ZtilesLarge + x/ZTILE];
+ZBUFF Z[ZTILE] __attribute__((aligned(16)));
+ZBUFF zmin,zmax,bmin,bmax;
+WORD size,n;
 
-    while(0<large--)
-        { *Ztest=(ZVALUE == *Zbuffer ); Ztest++; Zbuffer++; Pix->L.z+=dz; }
-}
-/*=============================================================*/
-void Ztest_zalways(struct SOFT3D_context *SC)
-{
-register UBYTE *Ztest=SC->Ztest;
-register union pixel3D *Pix=SC->Pix;
-register WORD large=Pix->W.large;
+    while(0<large)
+    {
+    size=ZTILE-(x%ZTILE);
+    if(large<size) size=large;
 
-    while(0<large--)
-        { *Ztest=(TRUE);  Ztest++; }
+    /* the z are still summed one by one (so same rounding) */
+    NLOOP(size)
+        { Z[n]=z; z+=dz; }
+#ifdef FLOATZBUFFER
+    /* float z only go up or down along a span so the ends are the min & max */
+    zmin=Z[0]; zmax=Z[size-1];
+    if(zmax<zmin)
+        { zmin=Z[size-1]; zmax=Z[0]; }
+#else
+    /* integer z can wrap */
+    zmin=zmax=Z[0];
+    NLOOP(size)
+        {
+        if(Z[n]<zmin) zmin=Z[n];
+        if(zmax<Z[n]) zmax=Z[n];
+        }
+#endif
+
+    if(T->cleared)
+        { bmin=bmax=SC->Zclear; }
+    else
+        { bmin=T->zmin[line]; bmax=T->zmax[line]; }
+
+    if(Zhidden(mode,zmin,zmax,bmin,bmax))
+        {
+        NLOOP(size)
+            Ztest[n]=FALSE;
+        }
+    else
+        {
+        if(T->cleared)
+            ZtileFill(SC,x/ZTILE,y/ZTILE);
+        if(ZtestSegment(Ztest,Zbuffer,Z,size,mode,update))
+            ZtilesUpdate(SC,x,y,size);
+        }
+
+    Ztest+=size; Zbuffer+=size; x+=size; large-=size; T++;
+    }
+    Pix->L.z=z;
 }
 /*=============================================================*/
+void Ztest_zless(struct SOFT3D_context *SC)             { ZtestTiles(SC,ZLESS,FALSE);     }
+void Ztest_zlequal(struct SOFT3D_context *SC)           { ZtestTiles(SC,ZLEQUAL,FALSE);   }
+void Ztest_zgreater(struct SOFT3D_context *SC)          { ZtestTiles(SC,ZGREATER,FALSE);  }
+void Ztest_zgequal(struct SOFT3D_context *SC)           { ZtestTiles(SC,ZGEQUAL,FALSE);   }
+void Ztest_zequal(struct SOFT3D_context *SC)            { ZtestTiles(SC,ZEQUAL,FALSE);    }
+void Ztest_znotequal(struct SOFT3D_context *SC)         { ZtestTiles(SC,ZNOTEQUAL,FALSE); }
+void Ztest_zless_update(struct SOFT3D_context *SC)      { ZtestTiles(SC,ZLESS,TRUE);      }
+void Ztest_zlequal_update(struct SOFT3D_context *SC)    { ZtestTiles(SC,ZLEQUAL,TRUE);    }
+void Ztest_zgreater_update(struct SOFT3D_context *SC)   { ZtestTiles(SC,ZGREATER,TRUE);   }
+void Ztest_zgequal_update(struct SOFT3D_context *SC)    { ZtestTiles(SC,ZGEQUAL,TRUE);    }
+void Ztest_zequal_update(struct SOFT3D_context *SC)     { ZtestTiles(SC,ZEQUAL,TRUE);     }
+void Ztest_znotequal_update(struct SOFT3D_context *SC)  { ZtestTiles(SC,ZNOTEQUAL,TRUE);  }
+void Ztest_zalways_update(struct SOFT3D_context *SC)    { ZtestTiles(SC,ZALWAYS,TRUE);    }
+/*=============================================================*/
 void EdgeMinDeltas(struct SOFT3D_context *SC,union pixel3D *P1,union pixel3D *P2)
 {
 /* for selecting mipmap find the minimum uv linear delta */
@@ -5045,6 +5536,32 @@ double v0,v2,dv,ddv;
 
 }
 /*=============================================================*/
+void FillBand(struct SOFT3D_context *SC)
+{
+/* when drawing a band only fill the lines of this band */
+register union pixel3D *Pix=SC->Pix;
+register LONG high=SC->PolyHigh;
+register LONG y,y2,line;
+
+    if(SC->BandHigh==0)
+        {SC->FunctionFill(SC); return;}
+
+    line=(Pix - SC->edge1) % MAXSCREEN;    /* edge1 edge2 edgeM follow each other in SC */
+    y =line;
+    y2=line+high;
+    if(y < SC->BandY)
+        y=SC->BandY;
+    if(SC->BandY+SC->BandHigh < y2)
+        y2=SC->BandY+SC->BandHigh;
+    if(y2<=y)
+        return;
+
+    SC->Pix=Pix+(y-line);
+    SC->PolyHigh=y2-y;
+    SC->FunctionFill(SC);
+    SC->PolyHigh=high;                /* Poly_Persp2x2 fill twice the same lines */
+}
+/*=============================================================*/
 void Poly_Persp0_Tex(struct SOFT3D_context *SC)
 {
     register union pixel3D *P1=SC->P1;
@@ -5102,7 +5619,7 @@ PrintPix(&DeltaX);
 
     SC->Pix=SC->P1;
     SelectMipMap(SC);
-    SC->FunctionFill(SC);
+    FillBand(SC);
 }
 /*=============================================================*/
 void Poly_Persp0_Gouraud(struct SOFT3D_context *SC)
@@ -5156,7 +5673,7 @@ SFUNCTION(Poly_Persp0_Gouraud)
     }
 
     SC->Pix=SC->P1;
-    SC->FunctionFill(SC);
+    FillBand(SC);
 }
 /*=============================================================*/
 void Poly_Persp0_Flat(struct SOFT3D_context *SC)
@@ -5181,7 +5698,7 @@ SFUNCTION(Poly_Persp0_Flat)
     }
 
     SC->Pix=SC->P1;
-    SC->FunctionFill(SC);
+    FillBand(SC);
 }
 /*=============================================================*/
 void Poly_Persp0_Tex_Gouraud_Fog(struct SOFT3D_context *SC)
@@ -5247,7 +5764,7 @@ void Poly_Persp0_Tex_Gouraud_Fog(struct SOFT3D_context *SC)
 
     SC->Pix=SC->P1;
     SelectMipMap(SC);
-    SC->FunctionFill(SC);
+    FillBand(SC);
 }
 /*=============================================================*/
 void Poly_Persp1_Tex(struct SOFT3D_context *SC)
@@ -5278,7 +5795,7 @@ SFUNCTION(Poly_Persp1_Tex)
 
     SC->Pix=SC->P1;
     SelectMipMap(SC);
-    SC->FunctionFill(SC);
+    FillBand(SC);
 }
 /*=============================================================*/
 void Poly_Persp1_Gouraud(struct SOFT3D_context *SC)
@@ -5307,7 +5824,7 @@ SFUNCTION(Poly_Persp1_Gouraud)
     }
 
     SC->Pix=SC->P1;
-    SC->FunctionFill(SC);
+    FillBand(SC);
 }
 /*=============================================================*/
 void Poly_Persp1_Flat(struct SOFT3D_context *SC)
@@ -5332,7 +5849,7 @@ SFUNCTION(Poly_Persp1_Flat)
     }
 
     SC->Pix=SC->P1;
-    SC->FunctionFill(SC);
+    FillBand(SC);
 }
 /*=============================================================*/
 void Poly_Persp1_Tex_Gouraud_Fog(struct SOFT3D_context *SC)
@@ -5367,7 +5884,7 @@ SFUNCTION(Poly_Persp1_Tex_Gouraud_Fog)
 
     SC->Pix=SC->P1;
     SelectMipMap(SC);
-    SC->FunctionFill(SC);
+    FillBand(SC);
 }
 /*=============================================================*/
 void Poly_Persp2_Tex_Gouraud_Fog(struct SOFT3D_context *SC,union pixel3D *P1,union pixel3D *P2)
@@ -5396,7 +5913,7 @@ SFUNCTION(Poly_Persp2_Tex_Gouraud_Fog)
         P1++;P2++;
     }
     SelectMipMap(SC);
-    SC->FunctionFill(SC);
+    FillBand(SC);
 }
 /*=============================================================*/
 void Poly_Persp2x2_Tex_Gouraud_Fog(struct SOFT3D_context *SC)
@@ -5729,6 +6246,293 @@ SFUNCTION(ChangeSoftFog)
 
 
 
+}
+/*================================================================*/
+BOOL BinUse(struct SOFT3D_context *SC)
+{
+    if(SC->UseHard)                return(FALSE);
+    if(LibDebug)                return(FALSE);    /* debugger want to see each polygon drawn */
+    if(Wazp3D->DebugSOFT3D.ON)        return(FALSE);
+    if(Wazp3D->StepSOFT3D.ON)        return(FALSE);
+
+    if(SC->Bins==NULL)
+        SC->Bins=MMmalloc(sizeof(struct bin3D),"SOFT3D_Bins");
+    return(SC->Bins!=NULL);
+}
+/*================================================================*/
+void BinGetState(struct SOFT3D_context *SC,struct binstate3D *S)
+{
+    S->state            =SC->state;
+    S->FunctionPoly     =SC->FunctionPoly;
+    S->FunctionEdge     =SC->FunctionEdge;
+    S->FunctionFill     =SC->FunctionFill;
+    S->FunctionZtest    =SC->FunctionZtest;
+    S->FunctionIn       =SC->FunctionIn;
+    S->FunctionBlend    =SC->FunctionBlend;
+    S->FunctionBlendFast=SC->FunctionBlendFast;
+    S->FunctionTexEnv   =SC->FunctionTexEnv;
+    S->FunctionFog      =SC->FunctionFog;
+    S->FunctionFilter   =SC->FunctionFilter;
+    S->FunctionSepia    =SC->FunctionSepia;
+    S->FunctionOut      =SC->FunctionOut;
+    S->SrcFunc          =SC->SrcFunc;
+    S->DstFunc          =SC->DstFunc;
+}
+/*================================================================*/
+void BinSetState(struct SOFT3D_context *SC,struct binstate3D *S)
+{
+    SC->state            =S->state;
+    SC->FunctionPoly     =S->FunctionPoly;
+    SC->FunctionEdge     =S->FunctionEdge;
+    SC->FunctionFill     =S->FunctionFill;
+    SC->FunctionZtest    =S->FunctionZtest;
+    SC->FunctionIn       =S->FunctionIn;
+    SC->FunctionBlend    =S->FunctionBlend;
+    SC->FunctionBlendFast=S->FunctionBlendFast;
+    SC->FunctionTexEnv   =S->FunctionTexEnv;
+    SC->FunctionFog      =S->FunctionFog;
+    SC->FunctionFilter   =S->FunctionFilter;
+    SC->FunctionSepia    =S->FunctionSepia;
+    SC->FunctionOut      =S->FunctionOut;
+    SC->SrcFunc          =S->SrcFunc;
+    SC->DstFunc          =S->DstFunc;
+}
+/*================================================================*/
+void BinPoly(struct SOFT3D_context *SC)
+{
+/* store the polygon (already clipped) with its drawing functions */
+    struct bin3D *Bins=SC->Bins;
+    struct binstate3D S;
+    struct binpoly3D *R;
+    union pixel3D *Pix=SC->PolyPix;
+    ULONG size;
+    WORD n,xmin,xmax;
+
+SFUNCTION(BinPoly)
+    if((BinSC!=NULL) && (BinSC!=SC))
+        SOFT3D_BinDraw(BinSC);
+    BinSC=SC;
+
+    size=sizeof(struct binpoly3D)+(SC->PolyPnb-1)*sizeof(struct binpix3D);
+    if(BINBUFFERSIZE < Bins->Used+size)
+        SOFT3D_BinDraw(SC);
+
+    memset(&S,0,sizeof(S));
+    BinGetState(SC,&S);
+    if((Bins->Snb==0) ou (memcmp(&S,&Bins->States[Bins->Snb-1],sizeof(S))!=0))
+    {
+        if(Bins->Snb==MAXBINSTATES)
+            SOFT3D_BinDraw(SC);
+        Bins->States[Bins->Snb++]=S;
+    }
+
+    R=(struct binpoly3D *)((UBYTE *)Bins->Buffer+Bins->Used);
+    R->Snum=Bins->Snb-1;
+    R->Pnb=SC->PolyPnb;
+    R->ymin=R->ymax=Pix->W.y;
+    xmin=xmax=Pix->W.x;
+    COPYRGBA(&R->FlatRGBA,SC->FlatRGBA.L);
+    NLOOP(SC->PolyPnb)
+    {
+        R->Pix[n].z=Pix->L.z;
+        R->Pix[n].w=Pix->L.w;
+        R->Pix[n].u=Pix->L.u;
+        R->Pix[n].v=Pix->L.v;
+        R->Pix[n].R=Pix->L.R;
+        R->Pix[n].G=Pix->L.G;
+        R->Pix[n].B=Pix->L.B;
+        R->Pix[n].A=Pix->L.A;
+        R->Pix[n].x=Pix->L.x;
+        R->Pix[n].y=Pix->L.y;
+        R->Pix[n].F=Pix->L.F;
+        if(Pix->W.y < R->ymin) R->ymin=Pix->W.y;
+        if(R->ymax < Pix->W.y) R->ymax=Pix->W.y;
+        if(Pix->W.x < xmin) xmin=Pix->W.x;
+        if(xmax < Pix->W.x) xmax=Pix->W.x;
+        Pix++;
+    }
+    Bins->Used+=size;
+    Bins->Polys++;
+    Bins->PolyLarge=xmax-xmin;        /* lines use it too (Poly_Persp2x2) */
+}
+/*================================================================*/
+BOOL BinFlatOut(struct SOFT3D_context *SC)
+{
+/* the _Flat outputs write the color of the first fragment for all the fragments */
+    if(SC->FunctionOut==(HOOKEDFUNCTION)PixelsOutRGBA_Flat) return(TRUE);
+    if(SC->FunctionOut==(HOOKEDFUNCTION)PixelsOutBGRA_Flat) return(TRUE);
+    if(SC->FunctionOut==(HOOKEDFUNCTION)PixelsOutARGB_Flat) return(TRUE);
+    if(SC->FunctionOut==(HOOKEDFUNCTION)PixelsOutABGR_Flat) return(TRUE);
+    return(FALSE);
+}
+/*================================================================*/
+void BinDrawBand(struct SOFT3D_context *SC,struct bin3D *Bins,WORD y)
+{
+    struct binpoly3D *R=(struct binpoly3D *)Bins->Buffer;
+    struct binstate3D *S=NULL;
+    union pixel3D *Pix;
+    ULONG p;
+    WORD n;
+
+    SC->BandY=y;
+    SC->BandHigh=BINHIGH;
+
+    for(p=0;p<Bins->Polys;p++)
+    {
+        if(y <= R->ymax)
+        if(R->ymin < y+BINHIGH)
+        {
+            if(S!=&Bins->States[R->Snum])
+            {
+                SOFT3D_Flush(SC);        /* fragments are drawn with the functions that filled them */
+                S=&Bins->States[R->Snum];
+                BinSetState(SC,S);
+            }
+            else if(BinFlatOut(SC))
+            if(NOTSAMERGBA(SC->FlatRGBA.L,&R->FlatRGBA))
+                SOFT3D_Flush(SC);
+
+            COPYRGBA(SC->FlatRGBA.L,&R->FlatRGBA);
+            Pix=SC->PolyPix;
+            NLOOP(R->Pnb)
+            {
+                Pix->L.z=R->Pix[n].z;
+                Pix->L.w=R->Pix[n].w;
+                Pix->L.u=R->Pix[n].u;
+                Pix->L.v=R->Pix[n].v;
+                Pix->L.R=R->Pix[n].R;
+                Pix->L.G=R->Pix[n].G;
+                Pix->L.B=R->Pix[n].B;
+                Pix->L.A=R->Pix[n].A;
+                Pix->L.x=R->Pix[n].x;
+                Pix->L.y=R->Pix[n].y;
+                Pix->L.F=R->Pix[n].F;
+                Pix++;
+            }
+            SC->PolyPnb=R->Pnb;
+            DrawPolyPix(SC);
+        }
+        R=(struct binpoly3D *)&R->Pix[R->Pnb];
+    }
+    SOFT3D_Flush(SC);
+    SC->BandHigh=0;
+}
+/*================================================================*/
+void BinDrawBands(void *job)
+{
+/* core0 and core1 draw one band of two */
+    struct binjob3D *Job=job;
+    struct SOFT3D_context *SC=Job->SC;
+    WORD y;
+
+    for(y=Job->band*BINHIGH; y<SC->high; y+=Job->step*BINHIGH)
+        BinDrawBand(SC,Job->Bins,y);
+}
+/*================================================================*/
+BOOL BinCanShare(struct SOFT3D_context *SC)
+{
+/* two cores can write the two sides of a band limit only if they dont share a cache line */
+    if(SC->high <= BINHIGH)                        return(FALSE);
+    if(((ULONG)SC->Image8 AND 31)!=0)                return(FALSE);
+    if(((SC->large*SC->bits/8) AND 31)!=0)            return(FALSE);
+    if(SC->Zbuffer!=NULL)
+    {
+        if(((ULONG)SC->Zbuffer AND 31)!=0)            return(FALSE);
+        if(((SC->large*sizeof(ZBUFF)) AND 31)!=0)    return(FALSE);
+        if(((ULONG)SC->Ztiles AND 31)!=0)            return(FALSE);
+    }
+    return(TRUE);
+}
+/*================================================================*/
+struct SOFT3D_context *BinWorkSC(struct SOFT3D_context *SC)
+{
+/* the context for core1 draw with the same Image Zbuffer tables fog as SC */
+    struct SOFT3D_context *W=SC->Bins->WorkSC;
+    UWORD y;
+
+    if(W==NULL)
+        W=SC->Bins->WorkSC=MMmalloc(sizeof(struct SOFT3D_context),"SOFT3D_WorkSC");
+    if(W==NULL)
+        return(NULL);
+
+    Libmemcpy(W,SC,(UBYTE *)SC->PointLarges - (UBYTE *)SC);
+    YLOOP(SC->high)
+    {
+        W->edge1[y].L.Image8Y =W->edge2[y].L.Image8Y =W->edgeM[y].L.Image8Y =SC->edge1[y].L.Image8Y;
+        W->edge1[y].L.ZbufferY=W->edge2[y].L.ZbufferY=W->edgeM[y].L.ZbufferY=SC->edge1[y].L.ZbufferY;
+        W->edge1[y].L.bpp     =W->edge2[y].L.bpp     =W->edgeM[y].L.bpp     =SC->edge1[y].L.bpp;
+    }
+    Libmemcpy(W->Image8X,SC->Image8X,sizeof(SC->Image8X));
+    Libmemcpy(W->FogRGBAs,SC->FogRGBAs,sizeof(SC->FogRGBAs));
+    W->FunctionBitmapIn        =SC->FunctionBitmapIn;
+    W->FunctionBitmapOut       =SC->FunctionBitmapOut;
+    W->FunctionWriteImageBuffer=SC->FunctionWriteImageBuffer;
+    W->FragBufferDone          =W->FragBuffer;
+    W->FragBufferMaxi          =W->FragBuffer + (SC->FragBufferMaxi - SC->FragBuffer);
+    W->UseFunctionBitmapIn     =SC->UseFunctionBitmapIn;
+    W->yoffset                 =SC->yoffset;
+    W->UseHard                 =FALSE;
+#ifdef AMIGA
+    W->bm                      =SC->bm;
+    W->colorsbm                =SC->colorsbm;
+#endif
+    return(W);
+}
+/*================================================================*/
+void SOFT3D_BinDraw(APTR sc)
+{
+/* draw the binned polygons in bands: the odd bands on core1 if it is free (no emulator running) */
+    struct SOFT3D_context *SC=sc;
+    struct SOFT3D_context *W=NULL;
+    struct bin3D *Bins;
+    struct binstate3D S;
+    struct binjob3D Job0,Job1;
+    ULONG FlatRGBA;
+    WORD PolyPnb;
+
+    if(SC==NULL)            return;
+    Bins=SC->Bins;
+    if(Bins==NULL)            return;
+    if(Bins->Polys==0)        return;
+
+SFUNCTION(SOFT3D_BinDraw)
+    BinGetState(SC,&S);            /* SC continue with its current state after */
+    COPYRGBA(&FlatRGBA,SC->FlatRGBA.L);
+    PolyPnb=SC->PolyPnb;
+    Libmemcpy(Bins->PolyPix,SC->PolyPix,sizeof(SC->PolyPix));    /* BinPoly() or DrawPolyP() still need them */
+    SOFT3D_Flush(SC);
+
+    Job0.SC=SC;
+    Job0.Bins=Bins;
+    Job0.band=0;
+    Job0.step=1;
+
+    if(BinCanShare(SC))
+    if(core1_job_available())
+        W=BinWorkSC(SC);
+
+    if(W!=NULL)
+    {
+        Job1.SC=W;
+        Job1.Bins=Bins;
+        Job1.band=1;
+        Job1.step=2;
+        Job0.step=2;
+        core1_job_start(BinDrawBands,&Job1);
+    }
+    BinDrawBands(&Job0);
+    if(W!=NULL)
+    if(!core1_job_wait())            /* core1 stopped: draw its bands here */
+        BinDrawBands(&Job1);
+
+    BinSetState(SC,&S);
+    COPYRGBA(SC->FlatRGBA.L,&FlatRGBA);
+    SC->PolyPnb=PolyPnb;
+    SC->PolyLarge=Bins->PolyLarge;
+    Libmemcpy(SC->PolyPix,Bins->PolyPix,sizeof(SC->PolyPix));
+    Bins->Snb=0;
+    Bins->Polys=0;
+    Bins->Used=0;
 }
 /*================================================================*/
 void DrawPolyP(struct SOFT3D_context *SC)
@@ -5738,7 +6542,7 @@ void DrawPolyP(struct SOFT3D_context *SC)
     struct point3D PolyMin;
     struct point3D PolyMax;
     WORD Pnb,n;
-    BOOL FaceCCW;
+    BOOL FaceCCW,UseBins;
     UBYTE ColorChange,ColorTransp,ColorWhite,FlatChange;
 
     DEBUG_SOFT3D("%s start\n",__FUNCTION__);
@@ -5756,6 +6560,9 @@ void DrawPolyP(struct SOFT3D_context *SC)
         return;
     }
 
+    if(SC->PolyPnb < 3)
+        SOFT3D_BinDraw(SC);            /* points & lines are not binned so draw what is before them */
+
     P=SC->PolyP;
     Pnb=SC->PolyPnb;
 
@@ -5947,12 +6754,23 @@ void DrawPolyP(struct SOFT3D_context *SC)
         SC->state.Changed=FALSE;
     }
 
+    UseBins=BinUse(SC);
+    if(UseBins)
+    if(Pnb>=3)
+    {
+        BinPoly(SC);
+        DEBUG_SOFT3D("%s end binned\n",__FUNCTION__);
+        return;
+    }
+
     switch(Pnb)
     {
         case 1:  DrawPointPix(SC); break;
         case 2:  DrawLinePix(SC);  break;
         default: DrawPolyPix(SC);  break;
     }
+    if(UseBins)
+        SOFT3D_Flush(SC);            /* nothing left in FragBuffer when binning again */
     DEBUG_SOFT3D("%s end\n",__FUNCTION__);
 
 }
@@ -6311,12 +7129,9 @@ void *SOFT3D_CreateTexture(APTR sc,APTR pt,UWORD large,UWORD high,UWORD format,U
 {
     struct SOFT3D_context *SC=sc;
     struct SOFT3D_texture *ST;
-    UBYTE *Tex8V;
-    UBYTE *ptmm;
-    float TexelsPerU,TexelsPerV,nf;
-    UWORD BytesPerTexel,BytesPerLine,n,m,bits;
+    UWORD bits;
     UBYTE BitmapName[40];
-    ULONG Tsize,MMsize;
+    ULONG Tsize;
     UBYTE UseMip=TexFlags AND 1;
 
 #ifndef W3D_R8G8B8
@@ -6347,57 +7162,17 @@ SFUNCTION(SOFT3D_CreateTexture)
 /* add to linkage */
     ST->nextST =SC->firstST;
     SC->firstST=ST;
-    ST->ptmm=NULL;
-
-/* Create texture index */
-    BytesPerTexel=bits/8;
-    BytesPerLine =ST->large*BytesPerTexel;
-
-    TexelsPerU=((float)ST->large)/256.0;
-    TexelsPerV=((float)ST->high )/256.0;
-    Tex8V=ST->pt;
 
     Tsize=ST->large*ST->high*ST->bits/8;
+    ST->checksum=TextureChecksum(ST->pt,Tsize);
+    ST->ptmm=NULL;
 
-    if(UseMip)
-    {
-        CreateMipmaps(ST);
-        if(ST->ptmm==NULL)
-        {
-            SOFT3D_FreeTexture(SC,ST);
-            return(NULL);
-        }
-    }
-
-    ptmm=ST->HT.ptmm=ST->ptmm;
-    MMsize=MAXTEXTURE*MAXTEXTURE*ST->bits/8;
-    MLOOP(NBMIPMAPS)
+    if(!ConvertTexture(ST,UseMip))
     {
-        NLOOP(256)
-        {
-            nf=(float)n;
-            ST->MMs[m].Tex8U[n]=       (ULONG)(    BytesPerTexel * (UWORD)(TexelsPerU*nf));
-            ST->MMs[m].Tex8V[n]=Tex8V +(ULONG)( BytesPerLine  * (UWORD)(TexelsPerV*nf));
-            ST->MMs[m].Tex8Ulow[n]=    (ULONG)(    BytesPerTexel * (UWORD)(TexelsPerU*nf/256.0));
-            ST->MMs[m].Tex8Vlow[n]=    (ULONG)(    BytesPerLine  * (UWORD)(TexelsPerV*nf/256.0));
-            if(TexelsPerU<=1.0)
-                    ST->MMs[m].Tex8Ulow[n]=0;
-            if(TexelsPerV<=1.0)
-                    ST->MMs[m].Tex8Vlow[n]=0;
-        }
-
-        if(UseMip)
-        {
-            if(Tsize > MMsize)     /* for smaller texture-models use mipmaps */
-            {
-                Tex8V=ptmm;
-                TexelsPerU=TexelsPerU/2.0;
-                TexelsPerV=TexelsPerV/4.0;
-                ptmm=ptmm+MMsize;
-            }
-            MMsize=MMsize/4;
-        }
+        SOFT3D_FreeTexture(SC,ST);
+        return(NULL);
     }
+    ST->HT.ptmm=ST->ptmm;
 
 
     SC->Tnb++;    ST->Tnum=SC->Tnb;
@@ -6441,6 +7216,7 @@ void SOFT3D_UpdateTexture(APTR sc,APTR st,APTR pt)
 struct SOFT3D_texture *ST=st;
 UBYTE UseMip=ST->TexFlags AND 1;
 LONG Tsize;
+ULONG checksum;
 
     if(!Wazp3D->PrefsIsOpened)        /* if the user dont changing debug states */
     LibDebug=Wazp3D->DebugWazp3D.ON;    /* synchronize soft3d's LibDebug with global debug value "DebugWazp3D" setted with Wazp3-Prefs */
@@ -6452,9 +7228,12 @@ SFUNCTION(SOFT3D_UpdateTexture)
         UseMip=FALSE;
 
     Tsize=ST->large*ST->high*ST->bits/8;
+    checksum=TextureChecksum(pt,Tsize);
+    if(checksum==ST->checksum)            /* same texels: keep the converted texture */
+        {SREM(unchanged); return;}
+    ST->checksum=checksum;
     Libmemcpy(ST->pt,pt,Tsize);
-    if(UseMip)
-        CreateMipmaps(ST);
+    ConvertTexture(ST,UseMip);
     ST->HT.ptmm=ST->ptmm;
 
 #ifdef USEOPENGL
@@ -6794,99 +7573,155 @@ HideFace:
     SC->PolyPnb=0;
     return;
 }
-/*=================================================================*/
-void ReduceBitmap(UBYTE *pt,UBYTE *pt2,UWORD large,UWORD high, WORD bits,WORD ratio)
+/*==========================================================================*/
+ULONG TextureChecksum(UBYTE *pt,ULONG size)
 {
-    UBYTE *RGB2;
-    UBYTE *RGB1;
-    LONG P,L;          /* bytesperpixel, bytesperline */
-    LONG x,y,m,n;
-    LONG r,g,b,a;
-    LONG ratio2;
-    LONG offset;
-
-#ifdef WAZP3DDEBUG
-    if(Wazp3D->DebugSOFT3D.ON) Libprintf("ReduceBitmap/%ld %ldX%ld %ldbits >from %ld to %ld\n",(ULONG)ratio,(ULONG)large,(ULONG)high,(ULONG)bits,(ULONG)pt,(ULONG)pt2);
-#endif
-    if(pt ==NULL) return;
-    if(pt2==NULL) return;
-    L=large * bits /8;
-    P=bits /8;
-    large=large/ratio;
-    high =high /ratio;
-    ratio2=ratio*ratio;
+register ULONG *pt32=(ULONG *)pt;
+register ULONG a=1,b=0;
+register ULONG n=0;
 
-    RGB1=pt;
-    RGB2=pt2;
-
-    YLOOP(high)
+    if((((ULONG)pt) AND 3)==0)
     {
-        XLOOP(large)
-        {
-        r=g=b=a=0;
-        MLOOP(ratio)
-        NLOOP(ratio)
-        {
-            offset=L*m+P*n+L*ratio*y+P*ratio*x;
-            RGB1=&(pt[offset]);
-            r=r+(LONG)RGB1[0];
-            g=g+(LONG)RGB1[1];
-            b=b+(LONG)RGB1[2];
-            if(bits==32)
-                a=a+(LONG)RGB1[3];
-        }
-        r=r/ratio2;
-        g=g/ratio2;
-        b=b/ratio2;
-        a=a/ratio2;
+        NLOOP(size/4)
+            {a+=pt32[n]; b+=a;}
+        n=n*4;
+    }
+    for(;n<size;n++)
+        {a+=pt[n]; b+=a;}
+    return(a ^ (b<<16) ^ (b>>16));
+}
+/*==========================================================================*/
+void TileTexture(struct SOFT3D_texture *ST)
+{
+register UBYTE *RGB=ST->pt;
+register UBYTE *T;
+register UWORD P=ST->bits/8;
+ULONG tiles=TILES(ST->large);
+UWORD x,y;
 
-        RGB2[0]=r;
-        RGB2[1]=g;
-        RGB2[2]=b;
+    YLOOP(ST->high)
+    XLOOP(ST->large)
+    {
+        T=&ST->ptmm[TILEX(x)+TILEY(y,tiles)];
+        T[0]=RGB[0];
+        T[1]=RGB[1];
+        T[2]=RGB[2];
+        T[3]=(P==4)?RGB[3]:255;
+        RGB+=P;
+    }
+}
+/*==========================================================================*/
+void CreateMipmaps(struct SOFT3D_texture *ST)
+{
+UBYTE *pt=ST->ptmm;
+UBYTE *pt2;
+UBYTE *T[4];
+UBYTE *T2;
+UWORD large=ST->large;
+UWORD high =ST->high;
+UWORD large2,high2,x,y,x1,y1,n;
+ULONG tiles,tiles2;
+UBYTE m;
 
-        if(Wazp3D->DebugST.ON)
-            RGB2[1]=ratio*10;
+/* each mipmap is the previous one reduced by 2 (box filter) and follows it in ptmm */
+    for(m=1;m<ST->NbMM;m++)
+    {
+    tiles =TILES(large);
+    large2=NEXTMIPMAP(large);
+    high2 =NEXTMIPMAP(high);
+    tiles2=TILES(large2);
+    pt2=pt+tiles*TILES(high)*64;
 
-        if(bits==32)
-            RGB2[3]=a;
-        RGB2=&(RGB2[P]);
-        }
+    YLOOP(high2)
+    XLOOP(large2)
+    {
+        x1=(2*x+1<large)?2*x+1:2*x;
+        y1=(2*y+1<high )?2*y+1:2*y;
+        T[0]=&pt[TILEX(2*x)+TILEY(2*y,tiles)];
+        T[1]=&pt[TILEX(x1) +TILEY(2*y,tiles)];
+        T[2]=&pt[TILEX(2*x)+TILEY(y1,tiles)];
+        T[3]=&pt[TILEX(x1) +TILEY(y1,tiles)];
+        T2=&pt2[TILEX(x)+TILEY(y,tiles2)];
+        NLOOP(4)
+            T2[n]=(T[0][n]+T[1][n]+T[2][n]+T[3][n]+2)>>2;
     }
 
+    pt=pt2;
+    large=large2;
+    high =high2;
+    }
 }
-/*==================================================================================*/
-void CreateMipmaps(struct SOFT3D_texture *ST)
+/*==========================================================================*/
+BOOL ConvertTexture(struct SOFT3D_texture *ST,UBYTE UseMip)
 {
-UBYTE *ptmm;
-UWORD large,high,reduction;
-ULONG size;
-
+UBYTE *pt;
+ULONG MMsize[NBMIPMAPS];
+ULONG size,tiles;
+UWORD large,high,x,y,n;
+float TexelsPerU,TexelsPerV,nf;
+UBYTE m,level;
 
     large=ST->large;
     high =ST->high;
-    size =ST->large * ST->high * ST->bits / 8;
-    ST->ptmm=MMmalloc(size/3,"mipmaps");         /* size is mathematically false but allways fit */
-    if(ST->ptmm==NULL) return;
-    ptmm=ST->ptmm;
-//    chunk_list_dump(&alloced_chunks, "Alloced");
-//    chunk_list_dump(&freed_chunks, "Freed");
+    size=0;
+    ST->NbMM=0;
+    MLOOP(NBMIPMAPS)
+    {
+        MMsize[m]=TILES(large)*TILES(high)*64;
+        size+=MMsize[m];
+        ST->NbMM++;
+        if(!UseMip) break;
+        if(large==1 && high==1) break;
+        large=NEXTMIPMAP(large);
+        high =NEXTMIPMAP(high);
+    }
 
-    reduction=1;
-next_mipmap:
-#ifdef WAZP3DDEBUG
-    large=large/2;
-    high =high /2;
-    reduction=reduction*2;
+    if(ST->ptmm==NULL)                /* same size when updated so keep it */
+        ST->ptmm=MMmalloc(size,"mipmaps");
+    if(ST->ptmm==NULL) return(FALSE);
 
-    if(Wazp3D->DebugSOFT3D.ON) Libprintf("MipMap %ldX%ld = %ld (%ld)\n",(ULONG)large,(ULONG)high,(ULONG)size,(ULONG)ptmm);
-#endif
-    ReduceBitmap(ST->pt,ptmm,ST->large,ST->high,ST->bits,reduction);
+    TileTexture(ST);
+    if(UseMip)
+        CreateMipmaps(ST);
 
-    size=large * high * ST->bits / 8;
-    ptmm=ptmm+size;
-    if(large>1)
-    if(high>1)
-        goto next_mipmap;
+/* MMs[m] is the biggest mipmap not bigger than (MAXTEXTURE>>m)^2 texels as SelectMipMap() expect */
+    MLOOP(NBMIPMAPS)
+    {
+        pt=ST->ptmm;
+        large=ST->large;
+        high =ST->high;
+        for(level=0;level+1<ST->NbMM;level++)
+        {
+            if((ULONG)large*high <= (ULONG)(MAXTEXTURE>>m)*(MAXTEXTURE>>m))
+                break;
+            pt+=MMsize[level];
+            large=NEXTMIPMAP(large);
+            high =NEXTMIPMAP(high);
+        }
+
+        tiles=TILES(large);
+        TexelsPerU=((float)large)/256.0;
+        TexelsPerV=((float)high )/256.0;
+        NLOOP(256)
+        {
+            nf=(float)n;
+            x=(UWORD)(TexelsPerU*nf);
+            y=(UWORD)(TexelsPerV*nf);
+            ST->MMs[m].Tex8U[n]=      TILEX(x);
+            ST->MMs[m].Tex8V[n]=pt   +TILEY(y,tiles);
+/* tile offsets don't add up (carry out of the 4 texels of a tile) so the big textures add texels then tile them */
+            ST->MMs[m].TexU[n]=x;
+            ST->MMs[m].TexV[n]=y;
+            ST->MMs[m].TexUlow[n]=(UWORD)(TexelsPerU*nf/256.0);
+            ST->MMs[m].TexVlow[n]=(UWORD)(TexelsPerV*nf/256.0);
+            if(TexelsPerU<=1.0)
+                    ST->MMs[m].TexUlow[n]=0;
+            if(TexelsPerV<=1.0)
+                    ST->MMs[m].TexVlow[n]=0;
+        }
+        ST->MMs[m].tiles=tiles;
+    }
+    return(TRUE);
 }
 /*==========================================================================*/
 void AntiAliasImage(void *image,UWORD large,UWORD high)
@@ -59,10 +59,12 @@ extern LOCAL local;
 void cpu_emulator_reset_core0(void);
 void cpu_emulator_reset(void)
 {
+   ps_write_flush();
    cpu_emulator_reset_core0();
    ovl=1;
    m68k_pulse_reset();
    reset_autoconfig();
+   m68k_dcache_flush();   // the Z3 RAM is gone until it is configured again
 //   *(uint32_t *)0x83c00000=0x80000000;
 //   dsb();
 //   *(uint32_t *)0x83c00000=0x00000000;
@@ -71,6 +73,55 @@ void cpu_emulator_reset(void)
 int intlev(void);
 extern "C" void z3660_printf(const TCHAR *format, ...);
 
+// The IPL comes from the GPIO interrupt (ipl_interrupt_handler() in
+// main.cc), which also ends the running slice when the level changes, so
+// the slices don't have to be short to see the IRQs. They start short
+// after a change, as the next one usually follows soon (the handler
+// acknowledging it), and double up to MUSASHI_SLICE_MAX. The interrupt
+// only sets musashi_slice_end (M68K_SLICE_END in m68kconf.h), which is
+// cleared before the level is read: a change after that ends the slice
+// after the instruction it lands in, one before it is seen at the start
+// of the slice. The shared variables are read every MUSASHI_HOUSEKEEPING
+// cycles.
+#define MUSASHI_SLICE_MIN    100
+#define MUSASHI_SLICE_MAX    3200
+#define MUSASHI_HOUSEKEEPING 10000
+volatile int musashi_slice_end=0;
+static int last_irq=-1;
+static int slice=MUSASHI_SLICE_MIN;
+static int housekeeping=MUSASHI_HOUSEKEEPING;
+
+extern "C" void musashi_irq_changed(void)
+{
+   musashi_slice_end=1;
+}
+
+static void musashi_irq(void)
+{
+   musashi_slice_end=0;
+   int irq=intlev();
+   if(irq<0) irq=0;
+   if(irq!=last_irq)
+   {
+      m68k_set_irq(irq);
+      last_irq=irq;
+      slice=MUSASHI_SLICE_MIN;
+   }
+   else if(slice<MUSASHI_SLICE_MAX)
+      slice*=2;
+}
+
+extern "C" void musashi_slice(void)
+{
+   musashi_irq();
+   housekeeping-=m68k_execute(slice);
+   ps_write_flush();
+   if(housekeeping>0)
+      return;
+   housekeeping=MUSASHI_HOUSEKEEPING;
+   bus_timing_check();
+}
+
 void musashi_emulator(void)
 {
    z3660_printf("[Core1] Starting Musashi emulator\n");
@@ -78,19 +129,15 @@ void musashi_emulator(void)
    m68k_set_cpu_type(cpu_type);
    m68k_init();
    cpu_emulator_reset();
+   bus_timing_check();
 
    while(1)
    {
-      int irq=intlev();
-      if(irq<0) irq=0;
-//      if(irq!=last_irq)
-         m68k_set_irq(irq);
-//      last_irq=irq;
-
       if(disasm_enable==0)
-         m68k_execute(100);
+         musashi_slice();
       else
       {
+         musashi_irq();
          m68k_disassemble(disasm_buf, m68k_get_reg(NULL, M68K_REG_PC), cpu_type);
              z3660_printf("REGA: 0:$%.8X 1:$%.8X 2:$%.8X 3:$%.8X 4:$%.8X 5:$%.8X 6:$%.8X 7:$%.8X\n", m68k_get_reg(NULL, M68K_REG_A0), m68k_get_reg(NULL, M68K_REG_A1), m68k_get_reg(NULL, M68K_REG_A2), m68k_get_reg(NULL, M68K_REG_A3), \
                   m68k_get_reg(NULL, M68K_REG_A4), m68k_get_reg(NULL, M68K_REG_A5), m68k_get_reg(NULL, M68K_REG_A6), m68k_get_reg(NULL, M68K_REG_A7));
@@ -277,6 +324,13 @@ void rtg_cache_policy_core1(uint32_t ini, uint32_t fb_policy, uint32_t soft3d_po
 
     finish_MMU_OP();
 }
+// The motherboard RAM from start up to 0x08000000 is mapped to its copy in
+// DDR, for the shadow bank of the UAE emulator (see mobo_ram_shadow_init())
+void mobo_ram_shadow_mmu(uint32_t start)
+{
+   for(unsigned int i=start>>20;i<0x080;i++)
+      setMMU(i*0x100000UL,(MOBO_RAM_SHADOW_ADDRESS+i*0x100000UL-0x07000000)|RAM_CACHE_POLICY);
+}
 extern "C" void write_autoconfig(uint32_t address, uint32_t data)
 {
 #ifdef AUTOCONFIG_ENABLED
@@ -288,6 +342,7 @@ extern "C" void write_autoconfig(uint32_t address, uint32_t data)
          {
             autoConfigBaseFastRam = data&0xFFFF0000;     // FastRAM
             configured|=1;
+            m68k_dcache_flush();
             unsigned int ini=(autoConfigBaseFastRam>>20)&0xFFF;
             z3660_printf("[Core1] Autoconfig Z3 RAM to 0x%03X\n",ini);
             unsigned int end=ini+0x100; // +256 MByte
@@ -678,6 +733,27 @@ unsigned int read_byte(unsigned int address)
    }
    return(ps_read_8(address));
 }
+// Host address of the code at address for the Musashi decode cache (see
+// M68K_DECODE_CACHE), NULL if it isn't memory that only the 68k writes
+extern "C" const uint8_t *m68k_code_pointer(unsigned int address)
+{
+   if(local.load_rom_emu==1)
+   {
+      if(ovl==1 && address<0x00080000)
+         return(ROM+address);
+      if(address>=0x00f80000 && address<0x01000000)
+         return(ROM+address-0x00f80000);
+   }
+   if(local.load_romext_emu==1 && address>=0x00f00000 && address<0x00f80000)
+      return(EXT_ROM+address-0x00f00000);
+#ifdef CPU_RAM
+   if(address>=0x08000000 && address<0x10000000)
+      return((const uint8_t *)RAM+address-0x08000000);
+#endif
+   if(address>=autoConfigBaseFastRam && address<autoConfigBaseFastRam+0x10000000 && (configured&1))
+      return((const uint8_t *)Z3660_Z3RAM_BASE+address-autoConfigBaseFastRam);
+   return(NULL);
+}
 unsigned int  m68k_read_memory_8(unsigned int address)
 {
    return(read_byte(address));
@@ -699,6 +775,7 @@ void m68k_write_memory_8(unsigned int address, unsigned int value)
       {
          ovl = (value & (1 << 0));
          z3660_printf("[Core1] OVL:%x\n", ovl);
+         m68k_dcache_flush();
          if(ovl==0)
          {
             init_ovl_chip_ram_bank();
@@ -740,9 +817,13 @@ void m68k_write_memory_8(unsigned int address, unsigned int value)
       uint32_t add=address-autoConfigBaseRTG;
       if(add<0x6000)
       {
+         ps_write_flush();
          Z3660_RTG_BASE[add]=value&0xFF;
          if(add>=0x2000)
+         {
+            m68k_dcache_flush();   // piscsi reads from disk straight into 68k RAM
             write_scsi_register(add-0x2000,value,0);
+         }
          else
             write_rtg_register(add,value);
       }
@@ -810,9 +891,13 @@ void m68k_write_memory_16(unsigned int address, unsigned int value)
       uint32_t add=address-autoConfigBaseRTG;
       if(add<0x6000)
       {
+         ps_write_flush();
          *(uint16_t*)(Z3660_RTG_BASE+add)=swap16(value);
          if(add>=0x2000)
+         {
+            m68k_dcache_flush();   // piscsi reads from disk straight into 68k RAM
             write_scsi_register(add-0x2000,value,1);
+         }
          else
             write_rtg_register(add,value);
       }
@@ -880,9 +965,13 @@ void m68k_write_memory_32(unsigned int address, unsigned int value)
       uint32_t add=address-autoConfigBaseRTG;
       if(add<0x100000)
       {
+         ps_write_flush();
          *(((uint32_t*)(Z3660_RTG_BASE+add)))=swap32(value);
          if(add>=0x2000)
+         {
+            m68k_dcache_flush();   // piscsi reads from disk straight into 68k RAM
             write_scsi_register(add-0x2000,value,2);
+         }
          else
             write_rtg_register(add,value);
       }
@@ -912,18 +1001,13 @@ void m68k_write_memory_32(unsigned int address, unsigned int value)
    }
    ps_write_32(address,value);
 }
+#ifndef NOP // test/bus_host.h counts them
 #define NOP asm(" nop")
+#endif
 
-inline void NOPX_WRITE(void)
-{
-	for(int i=shared->nops_write;i>0;i--)
-	{
-		NOP;
-	}
-}
-inline void NOPX_READ(void)
+inline void NOPX(uint32_t nops)
 {
-	for(int i=shared->nops_read;i>0;i--)
+	for(int i=nops;i>0;i--)
 	{
 		NOP;
 	}
@@ -943,27 +1027,108 @@ void check_bus_error(uint32_t v,uint32_t address)
 //#define READ_THROUGH_REGS
 //#define WRITE_THROUGH_REGS
 extern "C" void make_dummy_address_bank(uint32_t address);
+
+// Bus timing. The acks are polled with a delay of NOPs between polls (and
+// before the first read poll, which would otherwise see the ack of the
+// last cycle). The delay is kept per region of the Amiga address space.
+// bus_timing_calibrate() looks for the shortest delay that reads and
+// writes chip RAM right, at boot and every time core0 changes the bus
+// clock, and the regions whose ack is as slow as chip RAM's or slower
+// take it too. Timeouts and bus errors in a region make its delay longer.
+// shared->nops_read/nops_write (INR/DNR/INW/DNW in the console) are kept
+// as a floor.
+#define BUS_NOPS_DEFAULT 2         // the hand tuned delay, until calibrated
+#define BUS_NOPS_MAX     16
+#define BUS_NOPS_MARGIN  1         // the delays just over the shortest one must pass too
+#define BUS_CAL_ROUNDS   64        // rounds of patterns a delay has to pass
+#define BUS_CAL_READS    8         // reads to measure the ack of a region
+#define BUS_FAULT_STEP   4         // faults in a region that make its delay longer
+#define BUS_TIMEOUT      10000
+
+enum { BUS_CHIP, BUS_ZORRO2, BUS_CIA, BUS_CUSTOM, BUS_ROM, BUS_ZORRO3, BUS_REGIONS };
+const char *bus_region_name[BUS_REGIONS]={"chip","zorro2","cia","custom","rom","zorro3"};
+// address read to measure the ack of every region, 0 if there is none safe to read
+const uint32_t bus_region_probe[BUS_REGIONS]={0,0,0x00BFE001,0x00DFF004,0x00F80000,0};
+const uint32_t bus_region_size[BUS_REGIONS]={4,4,1,2,4,4};
+
+typedef struct {
+   uint32_t nops_read;
+   uint32_t nops_write;
+   uint32_t ack_polls;             // fewest polls of a read ack, 0 if not measured
+   uint32_t timeouts;
+   uint32_t bus_errors;
+   uint32_t faults;                // since the delay was last made longer
+} BUS_TIMING;
+#define BUS_TIMING_DEFAULT {BUS_NOPS_DEFAULT,BUS_NOPS_DEFAULT,0,0,0,0}
+BUS_TIMING bus_timing[BUS_REGIONS]={BUS_TIMING_DEFAULT,BUS_TIMING_DEFAULT,BUS_TIMING_DEFAULT,
+                                    BUS_TIMING_DEFAULT,BUS_TIMING_DEFAULT,BUS_TIMING_DEFAULT};
+uint32_t bus_timing_changes=0xFFFFFFFF;  // shared->bus_clock_changes when it was calibrated
+uint32_t bus_ack_polls=0;              // polls of the last read ack
+
+static inline int bus_region(uint32_t address)
+{
+   if(address>=0x01000000) return(BUS_ZORRO3);
+   if(address< 0x00200000) return(BUS_CHIP);
+   if(address< 0x00A00000) return(BUS_ZORRO2);
+   if(address< 0x00C00000) return(BUS_CIA);
+   if(address< 0x00E00000) return(BUS_CUSTOM);
+   return(BUS_ROM);
+}
+static inline uint32_t bus_nops_read(uint32_t address)
+{
+   uint32_t nops=bus_timing[bus_region(address)].nops_read;
+   return(nops>shared->nops_read?nops:shared->nops_read);
+}
+static inline uint32_t bus_nops_write(uint32_t address)
+{
+   uint32_t nops=bus_timing[bus_region(address)].nops_write;
+   return(nops>shared->nops_write?nops:shared->nops_write);
+}
+extern "C" void bus_timing_fault(uint32_t address, int bus_error)
+{
+   int region=bus_region(address);
+   BUS_TIMING *t=&bus_timing[region];
+   if(bus_error)
+      t->bus_errors++;
+   else
+      t->timeouts++;
+   if(++t->faults<BUS_FAULT_STEP)
+      return;
+   t->faults=0;
+   if(t->nops_read>=BUS_NOPS_MAX && t->nops_write>=BUS_NOPS_MAX)
+      return;
+   if(t->nops_read<BUS_NOPS_MAX)
+      t->nops_read++;
+   if(t->nops_write<BUS_NOPS_MAX)
+      t->nops_write++;
+   printf("[Core1] Bus timing: %s faults, NOPS READ %ld WRITE %ld\n",
+      bus_region_name[region],t->nops_read,t->nops_write);
+}
+
 void wait_read_ack(uint32_t address)
 {
-   long int timeout=10000;
+   uint32_t nops=bus_nops_read(address);
+   long int timeout=BUS_TIMEOUT;
    do {
-      NOPX_READ();
+      NOPX(nops);
       timeout--;
    }
    while(read_reg(0x14)==0
 		   && timeout>0
 		   );          // read ack
+   bus_ack_polls=BUS_TIMEOUT-timeout;
    if(timeout<=0)
    {
 	   if(read_reg(0x14)==0)
 	   {
 		   do {
-			   NOPX_READ();
+			   NOPX(nops);
 			   timeout--;
 		   }
 		   while(read_reg(0x14)==0);
 
 		   printf("READ Memory access timeout: 0x%08lx\n",address);
+		   bus_timing_fault(address,0);
 //		   if(address>=0x01000000 && address<0x08000000) // mobo RAM space
 //			   make_dummy_address_bank(address);
 	   }
@@ -971,12 +1136,13 @@ void wait_read_ack(uint32_t address)
 }
 void wait_write_ack(uint32_t address)
 {
-   long int timeout=10000;
+   uint32_t nops=bus_nops_write(address);
+   long int timeout=BUS_TIMEOUT;
    while(read_reg(0x14)==0
 		   && timeout>0
 		   )          // read ack
    {
-      NOPX_WRITE();
+      NOPX(nops);
       timeout--;
    }
    if(timeout<=0)
@@ -984,12 +1150,13 @@ void wait_write_ack(uint32_t address)
 	   if(read_reg(0x14)==0)
 	   {
 		   do {
-			   NOPX_WRITE();
+			   NOPX(nops);
 			   timeout--;
 		   }
 		   while(read_reg(0x14)==0);
 
 		   printf("WRITE Memory access timeout: 0x%08lx\n",address);
+		   bus_timing_fault(address,0);
 //		   if(address>=0x01000000 && address<0x08000000) // mobo RAM space
 //			   make_dummy_address_bank(address);
 	   }
@@ -997,6 +1164,7 @@ void wait_write_ack(uint32_t address)
 }
 
 int write_pending=0;
+uint32_t write_pending_address;     // acked on the next cycle
 uint32_t last_bank=-1;
 inline void arm_write_amiga_long(uint32_t address, uint32_t data)
 {
@@ -1013,8 +1181,8 @@ inline void arm_write_amiga_long(uint32_t address, uint32_t data)
    if(write_pending)
    {
       write_pending=0;
-      wait_write_ack(address);
-      check_bus_error(read_reg(0x14),address);
+      wait_write_ack(write_pending_address);
+      check_bus_error(read_reg(0x14),write_pending_address);
    }
 #endif
 #ifdef WRITE_THROUGH_REGS
@@ -1031,12 +1199,13 @@ inline void arm_write_amiga_long(uint32_t address, uint32_t data)
    NOP;
 #endif
    write_pending=1;
+   write_pending_address=address;
 #ifndef WRITE_FINISH_DELAYED
    if(write_pending)
    {
       write_pending=0;
-      wait_write_ack(address);
-      check_bus_error(read_reg(0x14),address);
+      wait_write_ack(write_pending_address);
+      check_bus_error(read_reg(0x14),write_pending_address);
    }
 #endif
 }
@@ -1055,8 +1224,8 @@ inline void arm_write_amiga_word(uint32_t address, uint32_t data)
    if(write_pending)
    {
       write_pending=0;
-      wait_write_ack(address);
-      check_bus_error(read_reg(0x14),address);
+      wait_write_ack(write_pending_address);
+      check_bus_error(read_reg(0x14),write_pending_address);
    }
 #endif
 #ifdef WRITE_THROUGH_REGS
@@ -1073,12 +1242,13 @@ inline void arm_write_amiga_word(uint32_t address, uint32_t data)
    NOP;
 #endif
    write_pending=1;
+   write_pending_address=address;
 #ifndef WRITE_FINISH_DELAYED
    if(write_pending)
    {
       write_pending=0;
-      wait_write_ack(address);
-      check_bus_error(read_reg(0x14),address);
+      wait_write_ack(write_pending_address);
+      check_bus_error(read_reg(0x14),write_pending_address);
    }
 #endif
 }
@@ -1097,8 +1267,8 @@ inline void arm_write_amiga_byte(uint32_t address, uint32_t data)
    if(write_pending)
    {
       write_pending=0;
-      wait_write_ack(address);
-      check_bus_error(read_reg(0x14),address);
+      wait_write_ack(write_pending_address);
+      check_bus_error(read_reg(0x14),write_pending_address);
    }
 #endif
 #ifdef WRITE_THROUGH_REGS
@@ -1115,12 +1285,13 @@ inline void arm_write_amiga_byte(uint32_t address, uint32_t data)
    NOP;
 #endif
    write_pending=1;
+   write_pending_address=address;
 #ifndef WRITE_FINISH_DELAYED
    if(write_pending)
    {
       write_pending=0;
-      wait_write_ack(address);
-      check_bus_error(read_reg(0x14),address);
+      wait_write_ack(write_pending_address);
+      check_bus_error(read_reg(0x14),write_pending_address);
    }
 #endif
 }
@@ -1141,8 +1312,8 @@ inline uint32_t arm_read_amiga_long(uint32_t address)
    if(write_pending)
    {
       write_pending=0;
-      wait_write_ack(address);
-      check_bus_error(read_reg(0x14),address);
+      wait_write_ack(write_pending_address);
+      check_bus_error(read_reg(0x14),write_pending_address);
    }
 #endif
 #ifdef READ_THROUGH_REGS
@@ -1175,8 +1346,8 @@ inline uint32_t arm_read_amiga_word(uint32_t address)
    if(write_pending)
    {
       write_pending=0;
-      wait_write_ack(address);
-      check_bus_error(read_reg(0x14),address);
+      wait_write_ack(write_pending_address);
+      check_bus_error(read_reg(0x14),write_pending_address);
    }
 #endif
 #ifdef READ_THROUGH_REGS
@@ -1209,8 +1380,8 @@ inline uint32_t arm_read_amiga_byte(uint32_t address)
    if(write_pending)
    {
       write_pending=0;
-      wait_write_ack(address);
-      check_bus_error(read_reg(0x14),address);
+      wait_write_ack(write_pending_address);
+      check_bus_error(read_reg(0x14),write_pending_address);
    }
 #endif
 #ifdef READ_THROUGH_REGS
@@ -1227,8 +1398,100 @@ inline uint32_t arm_read_amiga_byte(uint32_t address)
    return(data_read);
 }
 
+// Write combining for the motherboard RAM. Byte and word writes to the
+// same longword are kept in wc_data (bus lanes, as arm_write_amiga_*() take
+// them) and go out as one long cycle when the longword is complete, or as
+// the fewest aligned cycles that cover the written lanes when it is flushed.
+// Anything that could see the order of the writes flushes first: every
+// read, every write outside chip and motherboard RAM (custom chips, CIAs,
+// autoconfig...), the cache instructions and reset, and the CPU loops after
+// WC_TIMEOUT polls without a new write.
+#define WRITE_COMBINE
+#define WC_TIMEOUT 64
+#define WC_NONE 0xFFFFFFFF
+uint32_t wc_address=WC_NONE;  // longword of the pending write
+uint32_t wc_data;
+uint32_t wc_mask;             // lanes written, 8 is address+0, 1 is address+3
+int wc_age;
+
+static inline int wc_ram(uint32_t address)
+{
+   return(address<0x00200000                              // chip RAM
+      || (address>=0x07000000 && address<0x08000000));    // motherboard fast RAM
+}
+static inline uint32_t wc_lanes(uint32_t mask)
+{
+   return(((mask&8)?0xFF000000:0)|((mask&4)?0x00FF0000:0)
+         |((mask&2)?0x0000FF00:0)|((mask&1)?0x000000FF:0));
+}
+extern "C" void ps_write_flush(void)
+{
+   uint32_t address=wc_address;
+   uint32_t mask=wc_mask;
+   if(address==WC_NONE)
+      return;
+   wc_address=WC_NONE;
+   if(mask==0xF)
+   {
+      arm_write_amiga_long(address,wc_data);
+      return;
+   }
+   for(int n=0;n<4;)
+   {
+      uint32_t lane=8>>n;
+      if((mask&lane)==0)
+         n++;
+      else if((n&1)==0 && (mask&(lane>>1)))
+      {
+         // an aligned pair, the middle one would be a word at an odd address
+         arm_write_amiga_word(address+n,wc_data);
+         n+=2;
+      }
+      else
+      {
+         arm_write_amiga_byte(address+n,wc_data);
+         n++;
+      }
+   }
+}
+extern "C" void ps_write_tick(void)
+{
+   if(wc_address!=WC_NONE && --wc_age<=0)
+      ps_write_flush();
+}
+static inline void wc_write(uint32_t address, uint32_t data, uint32_t mask)
+{
+   if(wc_address!=address)
+   {
+      ps_write_flush();
+      wc_address=address;
+      wc_mask=0;
+   }
+   uint32_t lanes=wc_lanes(mask);
+   wc_data=(wc_data&~lanes)|(data&lanes);
+   wc_mask|=mask;
+   wc_age=WC_TIMEOUT;
+   if(wc_mask==0xF)
+      ps_write_flush();
+}
+
 extern "C" void ps_write_32(unsigned int address, unsigned int value)
 {
+#ifdef WRITE_COMBINE
+   if(wc_ram(address))
+   {
+      uint32_t shift=(address&3)*8;
+      if(shift==0)
+         wc_write(address,value,0xF);
+      else
+      {
+         wc_write(address&~3  ,value>>shift      ,0xF>>(address&3));
+         wc_write((address&~3)+4,value<<(32-shift),(0xF<<(4-(address&3)))&0xF);
+      }
+      return;
+   }
+   ps_write_flush();
+#endif
    switch(address&3)
    {
       case 0:
@@ -1252,6 +1515,29 @@ extern "C" void ps_write_32(unsigned int address, unsigned int value)
 }
 extern "C" void ps_write_16(unsigned int address, unsigned int value)
 {
+#ifdef WRITE_COMBINE
+   if(wc_ram(address))
+   {
+      switch(address&3)
+      {
+         case 0:
+            wc_write(address  ,value<<16,0xC);
+            break;
+         case 1:
+            wc_write(address-1,value<< 8,0x6);
+            break;
+         case 2:
+            wc_write(address-2,value    ,0x3);
+            break;
+         case 3:
+            wc_write(address-3,value>> 8,0x1);
+            wc_write(address+1,value<<24,0x8);
+            break;
+      }
+      return;
+   }
+   ps_write_flush();
+#endif
    switch(address&3)
    {
       case 0:
@@ -1272,6 +1558,14 @@ extern "C" void ps_write_16(unsigned int address, unsigned int value)
 }
 extern "C" void ps_write_8(unsigned int address, unsigned int value)
 {
+#ifdef WRITE_COMBINE
+   if(wc_ram(address))
+   {
+      wc_write(address&~3,value<<(24-(address&3)*8),8>>(address&3));
+      return;
+   }
+   ps_write_flush();
+#endif
    switch(address&3)
    {
       case 0:
@@ -1291,6 +1585,9 @@ extern "C" void ps_write_8(unsigned int address, unsigned int value)
 
 extern "C" unsigned int ps_read_8(unsigned int address)
 {
+#ifdef WRITE_COMBINE
+   ps_write_flush();
+#endif
    switch(address&3)
    {
       case 0:
@@ -1306,6 +1603,9 @@ extern "C" unsigned int ps_read_8(unsigned int address)
 }
 extern "C" unsigned int ps_read_16(unsigned int address)
 {
+#ifdef WRITE_COMBINE
+   ps_write_flush();
+#endif
    switch(address&3)
    {
       case 0:
@@ -1327,6 +1627,9 @@ extern "C" unsigned int ps_read_16(unsigned int address)
 }
 extern "C" unsigned int ps_read_32(unsigned int address)
 {
+#ifdef WRITE_COMBINE
+   ps_write_flush();
+#endif
    switch(address&3)
    {
       case 0:
@@ -1352,6 +1655,265 @@ extern "C" unsigned int ps_read_32(unsigned int address)
    }
 }
 
+// Block transfers between ARM memory and the motherboard bus. This side of
+// the FPGA has no burst cycle, so a block goes out as the fewest aligned
+// cycles that cover it: a byte and/or a word up to a longword boundary,
+// longwords, then a word and/or a byte. The next longword is put together
+// while the bus still runs the last one. Every cycle's status is checked
+// once it is acked, and the copy stops at the first bus error. Both return
+// the bytes copied, len when there was no error.
+#define BUS_STATUS_BERR 2
+uint32_t bus_shadow_start=0x08000000;  // motherboard RAM above this is served from its DDR copy
+extern "C" int bus_amiga_ram(uint32_t address, uint32_t len)
+{
+   uint32_t last=address+len-1;
+   return(len!=0 && last>=address && wc_ram(address) && wc_ram(last)
+      && (last<0x00200000 || (address>=0x07000000 && last<bus_shadow_start)));
+}
+static inline uint32_t bus_write_status(uint32_t address)
+{
+   if(write_pending)
+   {
+      write_pending=0;
+      wait_write_ack(address);
+   }
+   if(read_reg(0x14)!=BUS_STATUS_BERR)
+      return(read_reg(0x14));
+   bus_timing_fault(address,1);
+   return(BUS_STATUS_BERR);
+}
+extern "C" uint32_t bus_copy_to_amiga(uint32_t address, const uint8_t *src, uint32_t len)
+{
+   uint32_t done=0,last=0,last_n=0;
+   ps_write_flush();
+   while(done<len)
+   {
+      uint32_t a=address+done;
+      uint32_t left=len-done;
+      const uint8_t *p=src+done;
+      uint32_t data,n;
+      if((a&3)==0 && left>=4)
+      {
+         data=(p[0]<<24)|(p[1]<<16)|(p[2]<<8)|p[3];
+         n=4;
+      }
+      else if((a&1)==0 && left>=2)
+      {
+         data=(p[0]<<8)|p[1];
+         if((a&2)==0)
+            data<<=16;
+         n=2;
+      }
+      else
+      {
+         data=p[0]<<(24-(a&3)*8);
+         n=1;
+      }
+      if(last_n && bus_write_status(last)==BUS_STATUS_BERR)
+         return(done-last_n);
+      if(n==4)
+         arm_write_amiga_long(a,data);
+      else if(n==2)
+         arm_write_amiga_word(a,data);
+      else
+         arm_write_amiga_byte(a,data);
+      last=a;
+      last_n=n;
+      done+=n;
+   }
+   if(last_n && bus_write_status(last)==BUS_STATUS_BERR)
+      return(done-last_n);
+   return(done);
+}
+extern "C" uint32_t bus_copy_from_amiga(uint8_t *dst, uint32_t address, uint32_t len)
+{
+   uint32_t done=0;
+   ps_write_flush();
+   while(done<len)
+   {
+      uint32_t a=address+done;
+      uint32_t left=len-done;
+      uint8_t *p=dst+done;
+      if((a&3)==0 && left>=4)
+      {
+         uint32_t data=arm_read_amiga_long(a);
+         if(read_reg(0x14)==BUS_STATUS_BERR)
+         {
+            bus_timing_fault(a,1);
+            return(done);
+         }
+         p[0]=data>>24;
+         p[1]=data>>16;
+         p[2]=data>>8;
+         p[3]=data;
+         done+=4;
+      }
+      else if((a&1)==0 && left>=2)
+      {
+         uint32_t data=arm_read_amiga_word(a);
+         if(read_reg(0x14)==BUS_STATUS_BERR)
+         {
+            bus_timing_fault(a,1);
+            return(done);
+         }
+         if((a&2)==0)
+            data>>=16;
+         p[0]=data>>8;
+         p[1]=data;
+         done+=2;
+      }
+      else
+      {
+         uint32_t data=arm_read_amiga_byte(a);
+         if(read_reg(0x14)==BUS_STATUS_BERR)
+         {
+            bus_timing_fault(a,1);
+            return(done);
+         }
+         p[0]=data>>(24-(a&3)*8);
+         done++;
+      }
+   }
+   return(done);
+}
+
+// Bus timing calibration (see wait_read_ack()). Stale data from a read
+// that was acked too early, or a write lost to a short delay, can only be
+// told from good data in RAM, so the search runs on 16 bytes of chip RAM
+// nobody reads meanwhile: above the ROM overlay at boot, the 68k vectors
+// 4 to 7 later on (the emulated 68k doesn't run while this does). The
+// delay under test is used for reads (the writes take the longest one) or
+// for writes (checked with the longest read delay).
+static int bus_probe(uint32_t address, uint32_t nops, int write, uint32_t round)
+{
+   BUS_TIMING *t=&bus_timing[BUS_CHIP];
+   uint32_t pattern[4];
+   int ok=1;
+   for(uint32_t i=0;i<4;i++)
+      pattern[i]=(round*0x9E3779B9)^(0x5AA5F00F+i*0x11111111);
+   t->nops_read=write?BUS_NOPS_MAX:nops;
+   t->nops_write=write?nops:BUS_NOPS_MAX;
+   for(int i=0;i<4;i++)
+      arm_write_amiga_long(address+i*4,pattern[i]);
+   for(int i=0;i<8;i++) // every other read gets new data on the bus
+      if(arm_read_amiga_long(address+(i&3)*4)!=pattern[i&3])
+         ok=0;
+   return(ok);
+}
+// shortest delay that passes BUS_CAL_ROUNDS rounds with the next
+// BUS_NOPS_MARGIN delays passing too, that one plus the margin is returned
+static int bus_search(uint32_t address, int write)
+{
+   uint32_t passed=0;
+   for(uint32_t nops=0;nops<=BUS_NOPS_MAX;nops++)
+   {
+      int ok=1;
+      for(uint32_t round=0;round<BUS_CAL_ROUNDS && ok;round++)
+         ok=bus_probe(address,nops,write,round);
+      if(!ok)
+         passed=0;
+      else if(++passed>BUS_NOPS_MARGIN)
+         return(nops);
+   }
+   return(-1);
+}
+// fewest polls of the read ack at address with the delay of chip RAM
+static uint32_t bus_measure(uint32_t address, uint32_t size)
+{
+   uint32_t polls=BUS_TIMEOUT;
+   for(int i=0;i<BUS_CAL_READS;i++)
+   {
+      if(size==1)
+         arm_read_amiga_byte(address);
+      else if(size==2)
+         arm_read_amiga_word(address);
+      else
+         arm_read_amiga_long(address);
+      if(read_reg(0x14)==BUS_STATUS_BERR)
+         return(0);
+      if(bus_ack_polls<polls)
+         polls=bus_ack_polls;
+   }
+   return(polls);
+}
+static void bus_timing_calibrate(void)
+{
+   uint32_t address=ovl?0x00080000:0x00000010;
+   uint32_t floor_read=shared->nops_read;
+   uint32_t floor_write=shared->nops_write;
+   uint32_t saved[4];
+   int nops_read,nops_write;
+
+   ps_write_flush();
+   shared->nops_read=0;
+   shared->nops_write=0;
+   for(int r=0;r<BUS_REGIONS;r++)
+   {
+      bus_timing[r].nops_read=BUS_NOPS_MAX;
+      bus_timing[r].nops_write=BUS_NOPS_MAX;
+      bus_timing[r].ack_polls=0;
+      bus_timing[r].faults=0;
+   }
+   for(int i=0;i<4;i++)
+      saved[i]=arm_read_amiga_long(address+i*4);
+   nops_read=bus_search(address,0);
+   nops_write=nops_read<0?-1:bus_search(address,1);
+   bus_timing[BUS_CHIP].nops_read=BUS_NOPS_MAX;
+   bus_timing[BUS_CHIP].nops_write=BUS_NOPS_MAX;
+   for(int i=0;i<4;i++)
+      arm_write_amiga_long(address+i*4,saved[i]);
+
+   if(nops_read<0 || nops_write<0)
+   {
+      for(int r=0;r<BUS_REGIONS;r++)
+      {
+         bus_timing[r].nops_read=BUS_NOPS_DEFAULT;
+         bus_timing[r].nops_write=BUS_NOPS_DEFAULT;
+      }
+      shared->nops_read=floor_read;
+      shared->nops_write=floor_write;
+      printf("[Core1] Bus timing: calibration failed, NOPS READ %d WRITE %d\n",
+         BUS_NOPS_DEFAULT,BUS_NOPS_DEFAULT);
+      return;
+   }
+
+   bus_timing[BUS_CHIP].nops_read=nops_read;
+   bus_timing[BUS_CHIP].nops_write=nops_write;
+   bus_timing[BUS_CHIP].ack_polls=bus_measure(address,4);
+   for(int r=0;r<BUS_REGIONS;r++)
+   {
+      BUS_TIMING *t=&bus_timing[r];
+      if(r==BUS_CHIP)
+         continue;
+      // nothing to measure in the expansion space: chip RAM's delay and the margin
+      t->nops_read=nops_read+BUS_NOPS_MARGIN;
+      t->nops_write=nops_write+BUS_NOPS_MARGIN;
+      if(bus_region_probe[r]==0)
+         continue;
+      t->nops_read=nops_read;
+      t->nops_write=nops_write;
+      t->ack_polls=bus_measure(bus_region_probe[r],bus_region_size[r]);
+      // an ack faster than chip RAM's wasn't checked, it keeps the hand tuned delay
+      if(t->ack_polls<bus_timing[BUS_CHIP].ack_polls)
+      {
+         t->nops_read=nops_read>BUS_NOPS_DEFAULT?nops_read:BUS_NOPS_DEFAULT;
+         t->nops_write=nops_write>BUS_NOPS_DEFAULT?nops_write:BUS_NOPS_DEFAULT;
+      }
+   }
+   printf("[Core1] Bus timing (NOPS READ, WRITE, ack polls):\n");
+   for(int r=0;r<BUS_REGIONS;r++)
+      printf("  %-6s %2ld %2ld %4ld\n",bus_region_name[r],
+         bus_timing[r].nops_read,bus_timing[r].nops_write,bus_timing[r].ack_polls);
+}
+// calibrates at the first call and after core0 configures the clocks again
+extern "C" void bus_timing_check(void)
+{
+   if(shared->bus_clock_changes==bus_timing_changes)
+      return;
+   bus_timing_changes=shared->bus_clock_changes;
+   bus_timing_calibrate();
+}
+
 unsigned int  m68k_read_disassembler_8(unsigned int address)
 {
    return(read_byte(address));
@@ -14,6 +14,9 @@
 #include <inttypes.h>
 
 extern "C" void musashi_emulator(void);
+extern "C" void musashi_irq_changed(void);
+extern "C" void musashi_slice(void);
+extern volatile int musashi_slice_end;
 /*
 #define be16toh(A) (A)
 #define htobe16(A) (A)
@@ -23,15 +26,25 @@ extern "C" void musashi_emulator(void);
 extern "C" void ps_write_32(unsigned int address, unsigned int value);
 extern "C" void ps_write_16(unsigned int address, unsigned int value);
 extern "C" void ps_write_8(unsigned int address, unsigned int value);
+extern "C" void ps_write_flush(void);
+extern "C" void ps_write_tick(void);
 extern "C" unsigned int ps_read_8(unsigned int address);
 extern "C" unsigned int ps_read_16(unsigned int address);
 extern "C" unsigned int ps_read_32(unsigned int address);
+extern uint32_t bus_shadow_start;
+void mobo_ram_shadow_mmu(uint32_t start);
+extern "C" int bus_amiga_ram(uint32_t address, uint32_t len);
+extern "C" uint32_t bus_copy_to_amiga(uint32_t address, const uint8_t *src, uint32_t len);
+extern "C" uint32_t bus_copy_from_amiga(uint8_t *dst, uint32_t address, uint32_t len);
+extern "C" void bus_timing_fault(uint32_t address, int bus_error);
+extern "C" void bus_timing_check(void);
 extern "C" unsigned int  m68k_read_memory_8(unsigned int address);
 extern "C" unsigned int  m68k_read_memory_16(unsigned int address);
 extern "C" unsigned int  m68k_read_memory_32(unsigned int address);
 extern "C" void m68k_write_memory_8(unsigned int address, unsigned int value);
 extern "C" void m68k_write_memory_16(unsigned int address, unsigned int value);
 extern "C" void m68k_write_memory_32(unsigned int address, unsigned int value);
+extern "C" const uint8_t *m68k_code_pointer(unsigned int address);
 #define swap32(a) __builtin_bswap32(a)
 #define swap16(a) __builtin_bswap16(a)
 
@@ -182,6 +182,8 @@ extern "C" void write_scsi_register(uint16_t zaddr,uint32_t zdata,int type)
 
 
     while(shared->write_scsi==1){NOP;}
+    if(zaddr==PISCSI_CMD_ADDR2)
+        addr2=zdata;    // length of the next read
 }
 
 extern "C" uint32_t read_scsi_register(uint16_t zaddr,int type)
@@ -232,7 +234,16 @@ extern "C" uint32_t read_scsi_register(uint16_t zaddr,int type)
     	}
     }
     while(shared->read_scsi==1){NOP;}
-    return(shared->read_scsi_data);
+    uint32_t data=shared->read_scsi_data;
+    if(zaddr==PISCSI_CMD_USED_DMA && data!=0 && bus_amiga_ram(data,addr2))
+    {
+        // The read was staged in the SCSI buffer for the driver to copy it to
+        // motherboard RAM with the 68k. Copy it from here as one block and
+        // tell the driver there is nothing left to do.
+        if(bus_copy_to_amiga(data,(uint8_t *)SCSI_NO_DMA_ADDRESS,addr2)==addr2)
+            return(0);
+    }
+    return(data);
 }
 /*
 uint32_t video_formatter_read(uint16_t op)
@@ -317,16 +328,20 @@ void ipl_interrupt_handler(void *CallBackRef, u32 Bank, u32 Status)
 
     do {
         uint32_t read2=*(volatile uint32_t*)(XPAR_PS7_GPIO_0_BASEADDR+XGPIOPS_DATA_RO_OFFSET);
-        read_irq2 =(read1>>(PS_MIO_0   ))&1;
-        read_irq2|=(read1>>(PS_MIO_9 -1))&2;
-        read_irq2|=(read1>>(PS_MIO_12-2))&4;
+        read_irq2 =(read2>>(PS_MIO_0   ))&1;
+        read_irq2|=(read2>>(PS_MIO_9 -1))&2;
+        read_irq2|=(read2>>(PS_MIO_12-2))&4;
         if(read_irq1!=read_irq2)
         {
         	read_irq1=read_irq2;
         	read_irq2=0xFFFFFFFF;
         }
     }while (read_irq1!=read_irq2);
-    read_irq=read_irq2;
+    if(read_irq!=read_irq2)
+    {
+        read_irq=read_irq2;
+        musashi_irq_changed();
+    }
 //    z3660_printf("Interrupt!\n");
 }
 
@@ -521,6 +536,36 @@ int fpga_interrupt_connect(void)
 	return(XST_SUCCESS);
 }
 
+// CPU boot mode: there is no emulator to run, so core0 uses this core to
+// run its own jobs (soft3d bands). They are core0 code working on core0
+// data, so take the MMU table of core0 (the RTG and Amiga windows are only
+// mapped there) and call whatever core0 posts in shared->core1_job.
+void core1_worker(void)
+{
+    uint32_t *table=(uint32_t *)shared->core1_job_arg;
+    uint32_t *ptr=&MMUTable;
+
+    for(int i=0x010;i<0x080;i++) // core0 image, where its MMU table is
+        SetTlbAttributes(i*0x100000UL,RAM_CACHE_POLICY);
+    finish_Attributes();
+    for(int i=0;i<0x1000;i++)
+        ptr[i]=table[i];
+    finish_Attributes();
+
+    shared->shared_data=0; // ack to core0
+    while(1)
+    {
+        if(shared->core1_job)
+        {
+            void (*job)(void *)=(void (*)(void *))shared->core1_job;
+            job((void *)shared->core1_job_arg);
+            Xil_L1DCacheFlush();
+            dsb();
+            shared->core1_job=0;
+        }
+    }
+}
+
 int main()
 {
     Xil_ICacheEnable();
@@ -574,6 +619,9 @@ int main()
 
     init_shared();
 
+    if(shared->core1_worker)
+        core1_worker(); // never returns
+
     configure_gpio();
 
     Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_DATA_ABORT_INT    , DataAbortHandler,0);
@@ -28,6 +28,7 @@ extern int enabled;
 // Reset Input signal
 #define n040RSTI     10 // MIO 10
 
+#ifndef read_reg // test/bus_host.h puts the host tests' bus behind these
 #define REG_BASE_ADDRESS XPAR_Z3660_0_BASEADDR
 
 #define write_reg64(Offset,Data) (*(volatile uint64_t *)(REG_BASE_ADDRESS+(Offset)))=(Data)
@@ -41,6 +42,7 @@ extern int enabled;
 #define write_mem16(Offset,Data) (*(volatile uint32_t *)(REG_BASE_ADDRESS+0x08000000+((Offset&0x00FFFFFF)<<2)))=(Data)
 #define write_mem8(Offset,Data)  (*(volatile uint32_t *)(REG_BASE_ADDRESS+0x0C000000+((Offset&0x00FFFFFF)<<2)))=(Data)
 #define read_reg(Offset) (*(volatile uint32_t *)(REG_BASE_ADDRESS+(Offset)))
+#endif
 
 // Some amiga write and read definitions
 #define WRITE_ (0<<1)
@@ -87,6 +89,18 @@ typedef struct {
 	volatile uint32_t disassemble;         // 0xFFFF0088
 	volatile uint32_t musashi_step;        // 0xFFFF008C
 	volatile uint32_t reset_emulator_dis;  // 0xFFFF0090
+	volatile uint32_t core1_worker;        // 0xFFFF0094
+	volatile uint32_t core1_job;           // 0xFFFF0098
+	volatile uint32_t core1_job_arg;       // 0xFFFF009C
+	volatile uint32_t jit_romcache_size;   // 0xFFFF00A0
+	volatile uint32_t jit_romcache_save;   // 0xFFFF00A4
+	volatile uint32_t bus_clock_changes;   // 0xFFFF00A8
+	volatile uint32_t mobo_ram_shadow;     // 0xFFFF00AC
+	volatile uint32_t mobo_ram_writeback;  // 0xFFFF00B0
+	volatile uint32_t jit_profile;         // 0xFFFF00B4
+	volatile uint32_t jit_profile_top;     // 0xFFFF00B8
+	volatile uint32_t jit_profile_save;    // 0xFFFF00BC
+	volatile uint32_t jit_profile_size;    // 0xFFFF00C0
 } SHARED;
 
 enum BOOTMODE{
@@ -96,6 +110,12 @@ enum BOOTMODE{
 	UAEJIT,
 	BOOTMODE_NUM
 };
+enum MOBOSHADOW{
+	SHADOW_NO,
+	SHADOW_WRITETHROUGH,
+	SHADOW_WRITEBACK,
+	MOBOSHADOW_NUM
+};
 typedef struct {
    uint32_t load_rom_emu;
    uint32_t load_romext_emu;
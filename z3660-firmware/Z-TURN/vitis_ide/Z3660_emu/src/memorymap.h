@@ -28,6 +28,11 @@
 #define RX_BACKLOG_ADDRESS          0x07EF0000 // 32 * 2048 space (64 kB) --------
 #define TX_FRAME_ADDRESS            0x07F00000
 #define RX_FRAME_ADDRESS            0x07F10000
+#define MOBO_RAM_SHADOW_ADDRESS     0x17000000 // copy of the motherboard RAM (0x07000000-0x07FFFFFF), free DDR below RTG_BASE, core1's MMU maps it at 0x07000000
+#define JIT_PROFILE_ADDRESS         0x3FC00000 // JIT hot block profile, core1 memory, saved by core0
+#define JIT_PROFILE_SIZE            0x00100000
+#define JIT_ROMCACHE_ADDRESS        0x3FD00000 // JIT traces of the kickstart, core1 memory, loaded and saved by core0
+#define JIT_ROMCACHE_SIZE           0x00100000
 #define USB_BLOCK_STORAGE_ADDRESS   0x3FE10000 // FIXME move all of these to a memory table header file
 #define SCSI_NO_DMA_ADDRESS         (RTG_BASE+0x80000)
 #define BOOT_ROM_ADDRESS            (RTG_BASE+0x6000)
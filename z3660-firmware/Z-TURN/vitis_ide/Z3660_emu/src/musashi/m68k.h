@@ -352,6 +352,13 @@ void m68k_pulse_halt(void);
 void m68k_pulse_bus_error(void);
 
 
+/* Forget the decoded instructions (see M68K_DECODE_CACHE in m68kconf.h).
+ * Call it when memory the code runs from is written by someone else than
+ * the CPU, or when the memory map changes.
+ */
+void m68k_dcache_flush(void);
+
+
 /* Context switching to allow multiple CPUs */
 
 /* Get the size of the cpu context in bytes */
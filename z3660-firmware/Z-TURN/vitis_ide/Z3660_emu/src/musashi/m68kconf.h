@@ -167,10 +167,31 @@ void cpu_set_fc(int fc);
 #define M68K_INSTRUCTION_CALLBACK(pc) your_instruction_hook_function(pc)
 
 
+/* If ON, m68k_execute() also returns after the instruction during which
+ * the (volatile) M68K_SLICE_END_FLAG was set. An interrupt handler can set
+ * it at any time, unlike calling m68k_end_timeslice(), which changes the
+ * cycles the running instruction may be taking its own from.
+ */
+#define M68K_SLICE_END              OPT_ON
+#define M68K_SLICE_END_FLAG         musashi_slice_end
+
+
 /* If ON, the CPU will emulate the 4-byte prefetch queue of a real 68000 */
 #define M68K_EMULATE_PREFETCH       OPT_OFF
 
 
+/* If ON, code in memory the host can point to (M68K_CODE_POINTER returns
+ * the host address of a 68k page, or NULL) is fetched straight from it,
+ * and the opcode and handler of every instruction run from it are kept,
+ * so the next time it is run it isn't decoded again. The CPU writes
+ * drop the instructions they hit. Anything else changing that memory or
+ * the memory map must call m68k_dcache_flush().
+ * Needs M68K_EMULATE_PREFETCH and M68K_EMULATE_PMMU off.
+ */
+#define M68K_DECODE_CACHE           OPT_ON
+#define M68K_CODE_POINTER(A)        m68k_code_pointer(A)
+
+
 /* If ON, the CPU will generate address error exceptions if it tries to
  * access a word or longword at an odd address.
  * NOTE: This is only emulated properly for 68000 mode.
@@ -45,6 +45,7 @@ extern unsigned char m68ki_cycles[][0x10000];
 extern void (*m68ki_instruction_jump_table[0x10000])(void); /* opcode handler jump table */
 extern void m68ki_build_opcode_table(void);
 
+#include <string.h>
 #include "m68k.h"
 #include "m68kops.h"
 #include "m68kcpu.h"
@@ -61,6 +62,16 @@ int  m68ki_remaining_cycles = 0;                     /* Number of clocks remaini
 uint m68ki_tracing = 0;
 uint m68ki_address_space;
 
+#if M68K_DECODE_CACHE
+m68ki_dc_entry m68ki_dc_entries[M68K_DC_ENTRIES];
+static uint m68ki_dc_gen = 1;                        /* the entries start zeroed */
+static struct
+{
+	uint page;
+	const uint8* host;
+} m68ki_dc_pages[M68K_DC_PAGES];                     /* see m68ki_dcache_page() */
+#endif /* M68K_DECODE_CACHE */
+
 #ifdef M68K_LOG_ENABLE
 const char *const m68ki_cpu_names[] =
 {
@@ -942,6 +953,40 @@ void m68k_set_cpu_type(unsigned int cpu_type)
 	}
 }
 
+#if M68K_DECODE_CACHE
+/* Move the fetch window to the page of pc */
+static void m68ki_dcache_page(uint pc)
+{
+	uint page = pc & ~(M68K_DC_PAGE_SIZE - 1);
+	uint slot = (page / M68K_DC_PAGE_SIZE) & (M68K_DC_PAGES - 1);
+
+	if(m68ki_dc_pages[slot].page != page)
+	{
+		m68ki_dc_pages[slot].page = page;
+		m68ki_dc_pages[slot].host = (const uint8*)M68K_CODE_POINTER(ADDRESS_68K(page));
+	}
+	CPU_FETCH_START = page;
+	CPU_FETCH_HOST = m68ki_dc_pages[slot].host;
+}
+#endif /* M68K_DECODE_CACHE */
+
+void m68k_dcache_flush(void)
+{
+#if M68K_DECODE_CACHE
+	int i;
+
+	if(++m68ki_dc_gen == 0)
+	{
+		memset(m68ki_dc_entries, 0, sizeof(m68ki_dc_entries));
+		m68ki_dc_gen = 1;
+	}
+	for(i = 0; i < M68K_DC_PAGES; i++)
+		m68ki_dc_pages[i].page = 1;                  /* no page starts at an odd address */
+	CPU_FETCH_START = 1;
+	CPU_FETCH_HOST = NULL;
+#endif /* M68K_DECODE_CACHE */
+}
+
 /* Execute some instructions until we use up num_cycles clock cycles */
 /* ASG: removed per-instruction interrupt checks */
 int m68k_execute(int num_cycles)
@@ -992,13 +1037,40 @@ int m68k_execute(int num_cycles)
 			}
 
 			/* Read an instruction and call its handler */
-			REG_IR = m68ki_read_imm_16();
-			m68ki_instruction_jump_table[REG_IR]();
+#if M68K_DECODE_CACHE
+			if((REG_PC & ~(M68K_DC_PAGE_SIZE - 1)) != CPU_FETCH_START)
+				m68ki_dcache_page(REG_PC);
+			if(CPU_FETCH_HOST && !(REG_PC & 1))
+			{
+				uint pc = ADDRESS_68K(REG_PC);
+				m68ki_dc_entry* dc = &m68ki_dc_entries[(pc >> 1) & (M68K_DC_ENTRIES - 1)];
+				if(dc->pc != pc || dc->gen != m68ki_dc_gen)
+				{
+					const uint8* p = CPU_FETCH_HOST + (REG_PC - CPU_FETCH_START);
+					dc->pc = pc;
+					dc->gen = m68ki_dc_gen;
+					dc->ir = (p[0] << 8) | p[1];
+					dc->handler = m68ki_instruction_jump_table[dc->ir];
+				}
+				REG_IR = dc->ir;
+				REG_PC += 2;
+				dc->handler();
+			}
+			else
+#endif /* M68K_DECODE_CACHE */
+			{
+				REG_IR = m68ki_read_imm_16();
+				m68ki_instruction_jump_table[REG_IR]();
+			}
 			USE_CYCLES(CYC_INSTRUCTION[REG_IR]);
 
 			/* Trace m68k_exception, if necessary */
 			m68ki_exception_if_trace(); /* auto-disable (see m68kcpu.h) */
+#if M68K_SLICE_END
+		} while(GET_CYCLES() > 0 && !M68K_SLICE_END_FLAG);
+#else
 		} while(GET_CYCLES() > 0);
+#endif /* M68K_SLICE_END */
 
 		/* set previous PC to current PC for the next entry into the loop */
 		REG_PPC = REG_PC;
@@ -1083,6 +1155,7 @@ void m68k_init(void)
 		m68ki_build_opcode_table();
 		emulation_initialized = 1;
 	}
+	m68k_dcache_flush();
 
 	m68k_set_int_ack_callback(NULL);
 	m68k_set_bkpt_ack_callback(NULL);
@@ -1108,6 +1181,9 @@ void m68k_pulse_reset(void)
 	/* Disable the PMMU on reset */
 	m68ki_cpu.pmmu_enabled = 0;
 
+	/* The memory map may have changed (overlay) */
+	m68k_dcache_flush();
+
 	/* Clear all stop levels and eat up all remaining cycles */
 	CPU_STOPPED = 0;
 	SET_CYCLES(0);
@@ -1166,6 +1242,7 @@ unsigned int m68k_get_context(void* dst)
 void m68k_set_context(void* src)
 {
 	if(src) m68ki_cpu = *(m68ki_cpu_core*)src;
+	m68k_dcache_flush();
 }
 
 /* ======================================================================== */
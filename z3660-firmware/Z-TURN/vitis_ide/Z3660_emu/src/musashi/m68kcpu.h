@@ -361,6 +361,8 @@ typedef uint32 uint64;
 #define CPU_STOPPED      m68ki_cpu.stopped
 #define CPU_PREF_ADDR    m68ki_cpu.pref_addr
 #define CPU_PREF_DATA    m68ki_cpu.pref_data
+#define CPU_FETCH_START  m68ki_cpu.fetch_start
+#define CPU_FETCH_HOST   m68ki_cpu.fetch_host
 #define CPU_ADDRESS_MASK m68ki_cpu.address_mask
 #define CPU_SR_MASK      m68ki_cpu.sr_mask
 #define CPU_INSTR_MODE   m68ki_cpu.instr_mode
@@ -959,6 +961,8 @@ typedef struct
 	int    pmmu_enabled; /* Indicates if the PMMU is enabled */
 	int    fpu_just_reset; /* Indicates the FPU was just reset */
 	uint reset_cycles;
+	uint fetch_start;  /* Page the instructions are fetched from (decode cache) */
+	const uint8* fetch_host; /* Host address of that page, NULL if it isn't memory */
 
 	/* Clocks required for instructions / exceptions */
 	uint cyc_bcc_notake_b;
@@ -1025,6 +1029,52 @@ static inline void m68ki_check_interrupts(void);            /* ASG: check for in
 char* m68ki_disassemble_quick(unsigned int pc, unsigned int cpu_type);
 
 
+/* ======================================================================== */
+/* ============================= DECODE CACHE ============================= */
+/* ======================================================================== */
+
+#if M68K_DECODE_CACHE
+
+#if M68K_EMULATE_PREFETCH || M68K_EMULATE_PMMU
+#error "M68K_DECODE_CACHE needs M68K_EMULATE_PREFETCH and M68K_EMULATE_PMMU off"
+#endif
+
+#define M68K_DC_PAGE_SIZE 0x1000  /* fetch window */
+#define M68K_DC_PAGES     64      /* host addresses of the last pages run */
+#define M68K_DC_ENTRIES   0x10000 /* instructions, direct mapped on the PC */
+
+/* An instruction is kept where its PC says, and only used while pc and gen
+ * match: m68k_dcache_flush() drops all of them with gen++.
+ */
+typedef struct
+{
+	uint pc;
+	uint gen;
+	void (*handler)(void);
+	uint16 ir;
+} m68ki_dc_entry;
+
+extern m68ki_dc_entry m68ki_dc_entries[M68K_DC_ENTRIES];
+
+/* A CPU write drops the instructions it hits */
+static inline void m68ki_dcache_write(uint address, uint size)
+{
+	uint pc = ADDRESS_68K(address) & ~1;
+	uint words = ((address & 1) + size + 1) >> 1;
+
+	do
+	{
+		m68ki_dc_entry* dc = &m68ki_dc_entries[(pc >> 1) & (M68K_DC_ENTRIES - 1)];
+		if(dc->pc == pc)
+			dc->pc = 1;  /* no instruction starts at an odd address */
+		pc += 2;
+	} while(--words);
+}
+#else
+#define m68ki_dcache_write(A, S)
+#endif /* M68K_DECODE_CACHE */
+
+
 /* ======================================================================== */
 /* =========================== UTILITY FUNCTIONS ========================== */
 /* ======================================================================== */
@@ -1064,6 +1114,17 @@ static inline uint m68ki_read_imm_16(void)
 	return result;
 }
 #else
+#if M68K_DECODE_CACHE
+	{
+		uint offset = REG_PC - CPU_FETCH_START;
+		if(offset <= M68K_DC_PAGE_SIZE - 2 && CPU_FETCH_HOST)
+		{
+			const uint8* p = CPU_FETCH_HOST + offset;
+			REG_PC += 2;
+			return (p[0] << 8) | p[1];
+		}
+	}
+#endif /* M68K_DECODE_CACHE */
 	REG_PC += 2;
 	return m68k_read_immediate_16(ADDRESS_68K(REG_PC-2));
 #endif /* M68K_EMULATE_PREFETCH */
@@ -1109,6 +1170,17 @@ static inline uint m68ki_read_imm_32(void)
 #else
 	m68ki_set_fc(FLAG_S | FUNCTION_CODE_USER_PROGRAM); /* auto-disable (see m68kcpu.h) */
 	m68ki_check_address_error(REG_PC, MODE_READ, FLAG_S | FUNCTION_CODE_USER_PROGRAM); /* auto-disable (see m68kcpu.h) */
+#if M68K_DECODE_CACHE
+	{
+		uint offset = REG_PC - CPU_FETCH_START;
+		if(offset <= M68K_DC_PAGE_SIZE - 4 && CPU_FETCH_HOST)
+		{
+			const uint8* p = CPU_FETCH_HOST + offset;
+			REG_PC += 4;
+			return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+		}
+	}
+#endif /* M68K_DECODE_CACHE */
 	REG_PC += 4;
 	return m68k_read_immediate_32(ADDRESS_68K(REG_PC-4));
 #endif /* M68K_EMULATE_PREFETCH */
@@ -1171,6 +1243,7 @@ static inline void m68ki_write_8_fc(uint address, uint fc, uint value)
 	    address = pmmu_translate_addr(address);
 #endif
 
+	m68ki_dcache_write(address, 1);
 	m68k_write_memory_8(ADDRESS_68K(address), value);
 }
 static inline void m68ki_write_16_fc(uint address, uint fc, uint value)
@@ -1184,6 +1257,7 @@ static inline void m68ki_write_16_fc(uint address, uint fc, uint value)
 	    address = pmmu_translate_addr(address);
 #endif
 
+	m68ki_dcache_write(address, 2);
 	m68k_write_memory_16(ADDRESS_68K(address), value);
 }
 static inline void m68ki_write_32_fc(uint address, uint fc, uint value)
@@ -1197,6 +1271,7 @@ static inline void m68ki_write_32_fc(uint address, uint fc, uint value)
 	    address = pmmu_translate_addr(address);
 #endif
 
+	m68ki_dcache_write(address, 4);
 	m68k_write_memory_32(ADDRESS_68K(address), value);
 }
 
@@ -1212,6 +1287,7 @@ static inline void m68ki_write_32_pd_fc(uint address, uint fc, uint value)
 	    address = pmmu_translate_addr(address);
 #endif
 
+	m68ki_dcache_write(address, 4);
 	m68k_write_memory_32_pd(ADDRESS_68K(address), value);
 }
 #endif
@@ -36230,15 +36230,7 @@ uae_u32 REGPARAM2 op_f600_0_ff(uae_u32 opcode)
 	memda = get_dilong(2);
 	memsa &= ~15;
 	memda &= ~15;
-	uae_u32 v[4];
-	v[0] = get_long(memsa);
-	v[1] = get_long(memsa + 4);
-	v[2] = get_long(memsa + 8);
-	v[3] = get_long(memsa + 12);
-	put_long(memda , v[0]);
-	put_long(memda + 4, v[1]);
-	put_long(memda + 8, v[2]);
-	put_long(memda + 12, v[3]);
+	memory_move16(memsa, memda);
 	m68k_areg(regs, srcreg) += 16;
 	m68k_incpc(6);
 	return 8 * CYCLE_UNIT / 2;
@@ -36254,15 +36246,7 @@ uae_u32 REGPARAM2 op_f608_0_ff(uae_u32 opcode)
 	memda = m68k_areg(regs, dstreg);
 	memsa &= ~15;
 	memda &= ~15;
-	uae_u32 v[4];
-	v[0] = get_long(memsa);
-	v[1] = get_long(memsa + 4);
-	v[2] = get_long(memsa + 8);
-	v[3] = get_long(memsa + 12);
-	put_long(memda , v[0]);
-	put_long(memda + 4, v[1]);
-	put_long(memda + 8, v[2]);
-	put_long(memda + 12, v[3]);
+	memory_move16(memsa, memda);
 	m68k_areg(regs, dstreg) += 16;
 	m68k_incpc(6);
 	return 8 * CYCLE_UNIT / 2;
@@ -36278,15 +36262,7 @@ uae_u32 REGPARAM2 op_f610_0_ff(uae_u32 opcode)
 	memda = get_dilong(2);
 	memsa &= ~15;
 	memda &= ~15;
-	uae_u32 v[4];
-	v[0] = get_long(memsa);
-	v[1] = get_long(memsa + 4);
-	v[2] = get_long(memsa + 8);
-	v[3] = get_long(memsa + 12);
-	put_long(memda , v[0]);
-	put_long(memda + 4, v[1]);
-	put_long(memda + 8, v[2]);
-	put_long(memda + 12, v[3]);
+	memory_move16(memsa, memda);
 	m68k_incpc(6);
 	return 8 * CYCLE_UNIT / 2;
 }
@@ -36301,15 +36277,7 @@ uae_u32 REGPARAM2 op_f618_0_ff(uae_u32 opcode)
 	memda = m68k_areg(regs, dstreg);
 	memsa &= ~15;
 	memda &= ~15;
-	uae_u32 v[4];
-	v[0] = get_long(memsa);
-	v[1] = get_long(memsa + 4);
-	v[2] = get_long(memsa + 8);
-	v[3] = get_long(memsa + 12);
-	put_long(memda , v[0]);
-	put_long(memda + 4, v[1]);
-	put_long(memda + 8, v[2]);
-	put_long(memda + 12, v[3]);
+	memory_move16(memsa, memda);
 	m68k_incpc(6);
 	return 8 * CYCLE_UNIT / 2;
 }
@@ -36322,15 +36290,7 @@ uae_u32 REGPARAM2 op_f620_0_ff(uae_u32 opcode)
 	uaecptr mems = m68k_areg(regs, srcreg) & ~15, memd;
 	dstreg = (get_diword (2) >> 12) & 7;
 	memd = m68k_areg(regs, dstreg) & ~15;
-	uae_u32 v[4];
-	v[0] = get_long(mems);
-	v[1] = get_long(mems + 4);
-	v[2] = get_long(mems + 8);
-	v[3] = get_long(mems + 12);
-	put_long(memd , v[0]);
-	put_long(memd + 4, v[1]);
-	put_long(memd + 8, v[2]);
-	put_long(memd + 12, v[3]);
+	memory_move16(mems, memd);
 	if (srcreg != dstreg)
 	m68k_areg(regs, srcreg) += 16;
 	m68k_areg(regs, dstreg) += 16;
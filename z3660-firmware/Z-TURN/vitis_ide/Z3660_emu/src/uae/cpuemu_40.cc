@@ -36346,15 +36346,7 @@ uae_u32 REGPARAM2 op_f600_40_ff(uae_u32 opcode)
 	memda = get_dilong(2);
 	memsa &= ~15;
 	memda &= ~15;
-	uae_u32 v[4];
-	v[0] = get_long_jit(memsa);
-	v[1] = get_long_jit(memsa + 4);
-	v[2] = get_long_jit(memsa + 8);
-	v[3] = get_long_jit(memsa + 12);
-	put_long_jit(memda , v[0]);
-	put_long_jit(memda + 4, v[1]);
-	put_long_jit(memda + 8, v[2]);
-	put_long_jit(memda + 12, v[3]);
+	move16_jit(memsa, memda);
 	m68k_areg(regs, srcreg) += 16;
 	m68k_incpc(6);
 	return 8 * CYCLE_UNIT / 2;
@@ -36370,15 +36362,7 @@ uae_u32 REGPARAM2 op_f608_40_ff(uae_u32 opcode)
 	memda = m68k_areg(regs, dstreg);
 	memsa &= ~15;
 	memda &= ~15;
-	uae_u32 v[4];
-	v[0] = get_long_jit(memsa);
-	v[1] = get_long_jit(memsa + 4);
-	v[2] = get_long_jit(memsa + 8);
-	v[3] = get_long_jit(memsa + 12);
-	put_long_jit(memda , v[0]);
-	put_long_jit(memda + 4, v[1]);
-	put_long_jit(memda + 8, v[2]);
-	put_long_jit(memda + 12, v[3]);
+	move16_jit(memsa, memda);
 	m68k_areg(regs, dstreg) += 16;
 	m68k_incpc(6);
 	return 8 * CYCLE_UNIT / 2;
@@ -36394,15 +36378,7 @@ uae_u32 REGPARAM2 op_f610_40_ff(uae_u32 opcode)
 	memda = get_dilong(2);
 	memsa &= ~15;
 	memda &= ~15;
-	uae_u32 v[4];
-	v[0] = get_long_jit(memsa);
-	v[1] = get_long_jit(memsa + 4);
-	v[2] = get_long_jit(memsa + 8);
-	v[3] = get_long_jit(memsa + 12);
-	put_long_jit(memda , v[0]);
-	put_long_jit(memda + 4, v[1]);
-	put_long_jit(memda + 8, v[2]);
-	put_long_jit(memda + 12, v[3]);
+	move16_jit(memsa, memda);
 	m68k_incpc(6);
 	return 8 * CYCLE_UNIT / 2;
 }
@@ -36417,15 +36393,7 @@ uae_u32 REGPARAM2 op_f618_40_ff(uae_u32 opcode)
 	memda = m68k_areg(regs, dstreg);
 	memsa &= ~15;
 	memda &= ~15;
-	uae_u32 v[4];
-	v[0] = get_long_jit(memsa);
-	v[1] = get_long_jit(memsa + 4);
-	v[2] = get_long_jit(memsa + 8);
-	v[3] = get_long_jit(memsa + 12);
-	put_long_jit(memda , v[0]);
-	put_long_jit(memda + 4, v[1]);
-	put_long_jit(memda + 8, v[2]);
-	put_long_jit(memda + 12, v[3]);
+	move16_jit(memsa, memda);
 	m68k_incpc(6);
 	return 8 * CYCLE_UNIT / 2;
 }
@@ -36438,15 +36406,7 @@ uae_u32 REGPARAM2 op_f620_40_ff(uae_u32 opcode)
 	uaecptr mems = m68k_areg(regs, srcreg) & ~15, memd;
 	dstreg = (get_diword (2) >> 12) & 7;
 	memd = m68k_areg(regs, dstreg) & ~15;
-	uae_u32 v[4];
-	v[0] = get_long_jit(mems);
-	v[1] = get_long_jit(mems + 4);
-	v[2] = get_long_jit(mems + 8);
-	v[3] = get_long_jit(mems + 12);
-	put_long_jit(memd , v[0]);
-	put_long_jit(memd + 4, v[1]);
-	put_long_jit(memd + 8, v[2]);
-	put_long_jit(memd + 12, v[3]);
+	move16_jit(mems, memd);
 	if (srcreg != dstreg)
 	m68k_areg(regs, srcreg) += 16;
 	m68k_areg(regs, dstreg) += 16;
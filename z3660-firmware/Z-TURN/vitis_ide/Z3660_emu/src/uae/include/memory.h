@@ -697,6 +697,7 @@ uae_u8 dma_get_byte(uaecptr addr);
 void memory_put_long(uaecptr, uae_u32);
 void memory_put_word(uaecptr, uae_u32);
 void memory_put_byte(uaecptr, uae_u32);
+void memory_move16(uaecptr, uaecptr);
 
 STATIC_INLINE void put_long (uaecptr addr, uae_u32 l)
 {
@@ -764,6 +765,13 @@ STATIC_INLINE void put_byte_jit(uaecptr addr, uae_u32 l)
 #endif
 	memory_put_byte(addr, l);
 }
+STATIC_INLINE void move16_jit(uaecptr src, uaecptr dst)
+{
+#ifdef JIT
+	special_mem |= get_mem_bank(src).jit_read_flag | get_mem_bank(dst).jit_write_flag;
+#endif
+	memory_move16(src, dst);
+}
 
 /*
 * Store host pointer v at addr
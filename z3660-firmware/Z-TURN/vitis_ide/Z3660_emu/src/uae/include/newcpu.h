@@ -152,6 +152,7 @@ struct regstruct
 	uae_u32* raw_cputbl_count;
 	uintptr mem_banks;
 	uintptr cache_tags;
+	uintptr jit_pages;
 #endif
 };
 
@@ -206,6 +206,15 @@ STATIC_INLINE void raw_reg_to_flags(int r)
 	MSR_CPSRf_r(r);
 }
 
+/* Marks the 4 KB page of a direct store to 68k memory, see compemu_pages.h */
+STATIC_INLINE void raw_mark_page_written(RR4 adr)
+{
+  uintptr idx = (uintptr) &(regs.jit_pages) - (uintptr) &regs;
+  LDR_rRI(REG_WORK2, R_REGSTRUCT, idx);
+  LSR_rri(REG_WORK3, adr, JIT_PAGE_SHIFT);
+  STRB_rRR(REG_WORK3, REG_WORK2, REG_WORK3);
+}
+
 
 //
 // compuemu_support used raw calls
@@ -303,6 +312,21 @@ LOWFUNC(WRITE,RMW,1,compemu_raw_dec_m,(MEMRW d))
 }
 LENDFUNC(WRITE,RMW,1,compemu_raw_dec_m,(MEMRW ds))
 
+/* 64 bit counter, low word first */
+LOWFUNC(WRITE,RMW,1,compemu_raw_inc_m64,(MEMRW d))
+{
+  clobber_flags();
+
+  LOAD_U32(REG_WORK2, d);
+  LDR_rR(REG_WORK1, REG_WORK2);
+  ADDS_rri(REG_WORK1, REG_WORK1, 1);
+  STR_rR(REG_WORK1, REG_WORK2);
+  LDR_rRI(REG_WORK1, REG_WORK2, 4);
+  ADC_rri(REG_WORK1, REG_WORK1, 0);
+  STR_rRI(REG_WORK1, REG_WORK2, 4);
+}
+LENDFUNC(WRITE,RMW,1,compemu_raw_inc_m64,(MEMRW d))
+
 STATIC_INLINE void compemu_raw_call(uintptr t)
 {
   LOAD_U32(REG_WORK1, t);
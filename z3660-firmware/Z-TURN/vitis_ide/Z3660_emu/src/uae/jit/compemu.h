@@ -361,7 +361,10 @@ typedef struct blockinfo_t {
 
   uae_u8 optlevel;
   uae_u8 needed_flags;
+  uae_u8 exit_flags;   /* flags left valid for its successors */
+  uae_u8 branch_end;   /* ends with a Bcc or DBcc linked to both successors */
   uae_u8 status;
+  uae_u8 page_tracked; /* all its code is in RAM watched by compemu_pages */
 
   dependency  dep[2];  /* Holds things we depend on */
   dependency* deplist; /* List of things that depend on this */
@@ -1063,6 +1063,7 @@ MIDFUNC(2,fp_from_exten_mr,(RR4 adr, FR s))
 
 	adr = readreg(adr);
 	s = f_readreg(s);
+  raw_mark_page_written(adr);
   raw_fp_from_exten_mr(adr, s);
 	f_unlock(s);
 	unlock2(adr);
@@ -1085,6 +1086,7 @@ MIDFUNC(2,fp_from_double_mr,(RR4 adr, FR s))
 {
 	adr = readreg(adr);
 	s = f_readreg(s);
+  raw_mark_page_written(adr);
   raw_fp_from_double_mr(adr, s);
 	f_unlock(s);
 	unlock2(adr);
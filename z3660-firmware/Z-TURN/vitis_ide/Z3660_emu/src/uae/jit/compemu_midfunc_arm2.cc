@@ -4876,6 +4876,7 @@ MIDFUNC(2,jnf_MOVE16,(RR4 d, RR4 s))
 	s = readreg(s);
 	d = readreg(d);
 
+  raw_mark_page_written(d);
   PUSH_REGS((1 << d));
   
 	BIC_rri(REG_WORK3, s, 0x0000000F);
@@ -7905,6 +7906,7 @@ MIDFUNC(2,jnf_MEM_WRITE_OFF_b,(RR4 adr, RR4 b))
 //  STRB_rRR(b, adr, R_MEMSTART);
   MOV_rr(REG_WORK1, b);
   STRB_rRR(REG_WORK1, adr, R_MEMSTART);
+  raw_mark_page_written(adr);
   
   unlock2(b);
   unlock2(adr);
@@ -7918,6 +7920,7 @@ MIDFUNC(2,jnf_MEM_WRITE_OFF_w,(RR4 adr, RR4 w))
   
   REV16_rr(REG_WORK1, w);
   STRH_rRR(REG_WORK1, adr, R_MEMSTART);
+  raw_mark_page_written(adr);
   
   unlock2(w);
   unlock2(adr);
@@ -7931,6 +7934,7 @@ MIDFUNC(2,jnf_MEM_WRITE_OFF_l,(RR4 adr, RR4 l))
   
   REV_rr(REG_WORK1, l);
   STR_rRR(REG_WORK1, adr, R_MEMSTART);
+  raw_mark_page_written(adr);
   
   unlock2(l);
   unlock2(adr);
@@ -0,0 +1,50 @@
+/*
+ * compemu_pages.cc - Page based detection of self-modifying code
+ *
+ * See compemu_pages.h
+ */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#if defined(JIT)
+
+#include "jit/compemu_pages.h"
+
+uae_u8 jit_page_written[JIT_PAGE_COUNT];
+bool jit_pages_foreign = false;
+
+void jit_pages_init(void)
+{
+    for (uae_u32 page = 0; page < JIT_PAGE_COUNT; page++)
+        jit_page_written[page] = (uae_u8)~page;
+    jit_pages_foreign = false;
+}
+
+/* Has any page of [start, start + len) been written since it was cleaned? */
+bool jit_pages_written(uaecptr start, uae_u32 len)
+{
+    uae_u32 first = (start - JIT_PAGE_SLACK) >> JIT_PAGE_SHIFT;
+    uae_u32 last = (start + len - 1) >> JIT_PAGE_SHIFT;
+
+    if (start < JIT_PAGE_SLACK)
+        first = 0;
+    for (uae_u32 page = first; page <= last; page++) {
+        if (jit_page_written[page] == (uae_u8)page)
+            return true;
+    }
+    return false;
+}
+
+void jit_pages_clean(uaecptr start, uae_u32 len)
+{
+    uae_u32 first = (start - JIT_PAGE_SLACK) >> JIT_PAGE_SHIFT;
+    uae_u32 last = (start + len - 1) >> JIT_PAGE_SHIFT;
+
+    if (start < JIT_PAGE_SLACK)
+        first = 0;
+    for (uae_u32 page = first; page <= last; page++)
+        jit_page_written[page] = (uae_u8)~page;
+}
+
+#endif /* JIT */
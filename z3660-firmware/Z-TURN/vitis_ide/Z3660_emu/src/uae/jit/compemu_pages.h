@@ -0,0 +1,43 @@
+/*
+ * compemu_pages.h - Page based detection of self-modifying code
+ *
+ * Every 68k store to a RAM bank the JIT can translate from marks the
+ * 4 KB page it hits. On a cache flush (CINV/CPUSH) only the blocks that
+ * sit on a marked page need their checksum rechecked, the others are
+ * kept active.
+ *
+ * A page is marked when its byte holds the low byte of its own page
+ * number, and clean when it holds the complement. That way a store is
+ * marked from the JIT with a single STRB of the shifted address and no
+ * constant register.
+ */
+
+#ifndef COMPEMU_PAGES_H
+#define COMPEMU_PAGES_H
+
+#include "sysdeps.h"
+
+#define JIT_PAGE_SHIFT 12
+#define JIT_PAGE_COUNT (1 << (32 - JIT_PAGE_SHIFT))
+#define JIT_PAGE_SLACK 16   /* a store straddling into the next page is seen on its first page */
+
+extern uae_u8 jit_page_written[JIT_PAGE_COUNT];
+extern bool jit_pages_foreign;
+
+STATIC_INLINE void jit_page_mark(uaecptr addr)
+{
+    jit_page_written[addr >> JIT_PAGE_SHIFT] = (uae_u8)(addr >> JIT_PAGE_SHIFT);
+}
+
+/* Memory was written by someone the marks can't see (core0 "DMA" for
+   the SCSI emulation), the next flush checks every block again. */
+STATIC_INLINE void jit_pages_foreign_write(void)
+{
+    jit_pages_foreign = true;
+}
+
+void jit_pages_init(void);
+bool jit_pages_written(uaecptr start, uae_u32 len);
+void jit_pages_clean(uaecptr start, uae_u32 len);
+
+#endif /* COMPEMU_PAGES_H */
@@ -0,0 +1,261 @@
+/*
+ * compemu_profile.cc - Hot block profiler of the JIT
+ *
+ * See compemu_profile.h
+ */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#if defined(JIT)
+
+#include <string.h>
+#include <xil_cache.h>
+#include <xpseudo_asm_gcc.h>
+#include <xtime_l.h>
+#include "options.h"
+#include "include/memory.h"
+#include "newcpu.h"
+#include "compemu.h"
+#include "jit/compemu_profile.h"
+#include "../../main.h"
+#include "../../memorymap.h"
+#include "../../musashi/m68k.h"
+
+#define TABLE_SIZE (1 << JIT_PROFILE_BITS)
+#define TOP_MAX    64
+
+extern SHARED *shared;
+
+bool jit_profile_on = false;
+
+static jit_profile_block table[TABLE_SIZE];
+static jit_profile_header stats;
+static XTime start_time;
+static XTime stop_time;
+static XTime compile_start;
+static XTime compile_ticks;
+
+static inline uae_u64 ticks_us(XTime ticks)
+{
+    return ticks / (COUNTS_PER_SECOND / 1000000);
+}
+
+static inline uae_u32 slot(uaecptr pc)
+{
+    return ((pc >> 1) * 2654435761u) >> (32 - JIT_PROFILE_BITS);
+}
+
+static void reset(void)
+{
+    memset(table, 0, sizeof(table));
+    memset(&stats, 0, sizeof(stats));
+    compile_ticks = 0;
+    XTime_GetTime(&start_time);
+}
+
+/* Called by compile_block() before it emits the block, returns the counters
+   of the block (NULL when the table has no room for it) */
+jit_profile_block* jit_profile_compile(uaecptr pc, int blocklen, int optlevel)
+{
+    jit_profile_block* pb = NULL;
+    uae_u32 s = slot(pc);
+
+    XTime_GetTime(&compile_start);
+    stats.compiles++;
+    for (int i = 0; i < JIT_PROFILE_PROBE; i++, s = (s + 1) & (TABLE_SIZE - 1)) {
+        if (table[s].compiles == 0 || table[s].pc == pc) {
+            pb = &table[s];
+            break;
+        }
+    }
+    if (!pb) {
+        stats.dropped++;
+        return NULL;
+    }
+    if (pb->compiles) {
+        if (optlevel > pb->optlevel)
+            stats.promotions++;
+        else
+            stats.recompiles++;
+    }
+    pb->pc = pc;
+    pb->compiles++;
+    pb->insns = blocklen;
+    pb->optlevel = optlevel;
+    return pb;
+}
+
+/* ... and once it is done */
+void jit_profile_compiled(jit_profile_block* pb, uae_u32 native, uae_u8 flags)
+{
+    XTime now;
+
+    XTime_GetTime(&now);
+    compile_ticks += now - compile_start;
+    if (pb) {
+        pb->native = native;
+        pb->flags = flags;
+    }
+}
+
+void jit_profile_flushed(void)
+{
+    stats.flushes++;
+}
+
+static void fill_header(jit_profile_header* h)
+{
+    XTime now = stop_time;
+
+    if (jit_profile_on)
+        XTime_GetTime(&now);
+    *h = stats;
+    h->magic = JIT_PROFILE_MAGIC;
+    h->version = JIT_PROFILE_VERSION;
+    h->count = 0;
+    h->compile_us = ticks_us(compile_ticks);
+    h->elapsed_us = ticks_us(now - start_time);
+}
+
+/* Header and used blocks of the table to buf, returns the bytes written */
+uae_u32 jit_profile_export(uae_u8* buf, uae_u32 max)
+{
+    jit_profile_header* h = (jit_profile_header*)buf;
+    jit_profile_block* out = (jit_profile_block*)(h + 1);
+    uae_u32 room = (max - sizeof(jit_profile_header)) / sizeof(jit_profile_block);
+
+    fill_header(h);
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        if (table[i].compiles == 0)
+            continue;
+        if (h->count < room)
+            out[h->count++] = table[i];
+        else
+            h->dropped++;
+    }
+    return sizeof(jit_profile_header) + h->count * sizeof(jit_profile_block);
+}
+
+/* The printf of core1 has no 64 bit conversions */
+static const char* u64_str(char* buf, uae_u64 v)
+{
+    char* p = buf + 20;
+
+    *p = 0;
+    do {
+        *--p = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    return p;
+}
+
+/* Tenths of a percent */
+static uae_u32 permille(uae_u64 part, uae_u64 total)
+{
+    return total ? (uae_u32)(part * 1000 / total) : 0;
+}
+
+static inline uae_u64 weight(const jit_profile_block* pb)
+{
+    return pb->execs * pb->insns;
+}
+
+static void disassemble(uaecptr pc, int count)
+{
+    uae_u8 bytes[32];
+    char text[128];
+
+    while (count--) {
+        for (int i = 0; i < (int)sizeof(bytes); i += 2) {
+            uae_u16 w = memory_get_word(pc + i);
+            bytes[i] = w >> 8;
+            bytes[i + 1] = w;
+        }
+        uae_u32 len = m68k_disassemble_raw(text, pc, bytes, NULL, M68K_CPU_TYPE_68040);
+        write_log("          %08X  %s\n", pc, text);
+        if (len == 0)
+            break;
+        pc += len;
+    }
+}
+
+/* List the n blocks that ran the most 68k instructions (runs times
+   instructions of the trace) with their first instructions */
+void jit_profile_top(int n)
+{
+    jit_profile_block* top[TOP_MAX];
+    jit_profile_header h;
+    uae_u64 total = 0;
+    int blocks = 0;
+    int found = 0;
+    char b1[21], b2[21], b3[21];
+
+    if (n > TOP_MAX)
+        n = TOP_MAX;
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        jit_profile_block* pb = &table[i];
+        int j;
+
+        if (pb->compiles == 0)
+            continue;
+        blocks++;
+        total += weight(pb);
+        if (found == n && weight(pb) <= weight(top[n - 1]))
+            continue;
+        if (found < n)
+            found++;
+        for (j = found - 1; j > 0 && weight(top[j - 1]) < weight(pb); j--)
+            top[j] = top[j - 1];
+        top[j] = pb;
+    }
+    fill_header(&h);
+
+    write_log("JIT profile %s: %d blocks, %d compiles (%d recompiles, %d promotions), %d flushes, %d not counted\n",
+        jit_profile_on ? "running" : "stopped", blocks, h.compiles, h.recompiles, h.promotions, h.flushes, h.dropped);
+    write_log("Compiling %s us of %s us, %s 68k instructions run in compiled blocks\n",
+        u64_str(b1, h.compile_us), u64_str(b2, h.elapsed_us), u64_str(b3, total));
+    write_log("  # 68k addr         runs  insns    insns run    %%  comp opt  ARM bytes\n");
+    for (int i = 0; i < found; i++) {
+        jit_profile_block* pb = top[i];
+        uae_u32 pm = permille(weight(pb), total);
+
+        write_log("%3d %08X %12s %6d %12s %2d.%d %5d %3d %10d%s\n",
+            i + 1, pb->pc, u64_str(b1, pb->execs), pb->insns, u64_str(b2, weight(pb)),
+            pm / 10, pm % 10, pb->compiles, pb->optlevel, pb->native,
+            (pb->flags & JIT_PROFILE_ROM) ? " ROM" : "");
+        disassemble(pb->pc, pb->insns < JIT_PROFILE_DIS ? pb->insns : JIT_PROFILE_DIS);
+    }
+}
+
+/* Requests of the core0 debug console */
+void jit_profile_tasks(void)
+{
+    bool on = shared->jit_profile != 0;
+
+    if (on != jit_profile_on) {
+        // every block is compiled again, with or without the stub
+        jit_profile_on = false;
+        flush_icache_hard(3);
+        if (on)
+            reset();
+        else
+            XTime_GetTime(&stop_time);
+        jit_profile_on = on;
+        write_log("JIT: profiler %s\n", on ? "on" : "off");
+    }
+    if (shared->jit_profile_top) {
+        jit_profile_top(shared->jit_profile_top);
+        shared->jit_profile_top = 0;
+    }
+    if (shared->jit_profile_save == 1) {
+        uae_u32 size = jit_profile_export((uae_u8*)JIT_PROFILE_ADDRESS, JIT_PROFILE_SIZE);
+        Xil_L1DCacheFlush();
+        shared->jit_profile_size = size;
+        dsb();
+        shared->jit_profile_save = 2;
+        write_log("JIT: saving the profile (%d bytes)\n", size);
+    }
+}
+
+#endif /* JIT */
@@ -0,0 +1,71 @@
+/*
+ * compemu_profile.h - Hot block profiler of the JIT
+ *
+ * While the profiler is on, every block compiled starts with a stub
+ * that counts its runs in a table keyed by the 68k address of the block.
+ * The table outlives the blockinfos (a hard flush frees them), so it
+ * also counts how many times each address was compiled. The JIT counts
+ * the blocks it compiles, recompiles and promotes to a higher
+ * optimisation level, and the time spent doing it.
+ *
+ * Turning the profiler on or off flushes the translation cache, so all
+ * blocks are compiled again with or without the stub. Runs of a block
+ * before it is first compiled (the countdown in the interpreter) are
+ * not counted.
+ *
+ * The core0 debug console turns it on and off ('JP'), lists the hottest
+ * blocks with their first instructions ('JPT') and saves the table to
+ * the SD card ('JPS'), where Z3660_system/jit_profile.py reads it.
+ */
+
+#ifndef COMPEMU_PROFILE_H
+#define COMPEMU_PROFILE_H
+
+#include "sysdeps.h"
+
+#define JIT_PROFILE_MAGIC   0x504A335A  /* "Z3JP" */
+#define JIT_PROFILE_VERSION 1
+#define JIT_PROFILE_BITS    14          /* 16384 68k addresses counted */
+#define JIT_PROFILE_PROBE   16          /* table slots tried for an address */
+#define JIT_PROFILE_DIS     4           /* instructions shown per block on the console */
+
+#define JIT_PROFILE_ROM     0x01        /* block flags */
+#define JIT_PROFILE_TRACKED 0x02        /* RAM watched by compemu_pages */
+
+/* The file saved on the SD card is the header and then count blocks,
+   all little endian. */
+
+typedef struct {
+    uae_u32 magic;
+    uae_u32 version;
+    uae_u32 count;                      /* blocks after the header */
+    uae_u32 dropped;                    /* blocks that found no room in the table */
+    uae_u32 compiles;                   /* blocks compiled */
+    uae_u32 recompiles;                 /* ... again at the same or a lower level */
+    uae_u32 promotions;                 /* ... again at a higher level */
+    uae_u32 flushes;                    /* hard flushes of the translation cache */
+    uae_u64 compile_us;                 /* time spent compiling */
+    uae_u64 elapsed_us;                 /* time profiled */
+} jit_profile_header;
+
+typedef struct {
+    uae_u32 pc;                         /* 68k address */
+    uae_u32 compiles;                   /* 0: free slot */
+    uae_u64 execs;                      /* runs, counted by the block stub */
+    uae_u16 insns;                      /* 68k instructions in the last trace */
+    uae_u8  optlevel;                   /* of the last compile */
+    uae_u8  flags;
+    uae_u32 native;                     /* bytes of ARM code of the last compile */
+} jit_profile_block;
+
+extern bool jit_profile_on;
+
+jit_profile_block* jit_profile_compile(uaecptr pc, int blocklen, int optlevel);
+void jit_profile_compiled(jit_profile_block* pb, uae_u32 native, uae_u8 flags);
+void jit_profile_flushed(void);
+
+uae_u32 jit_profile_export(uae_u8* buf, uae_u32 max);
+void jit_profile_top(int n);
+void jit_profile_tasks(void);
+
+#endif /* COMPEMU_PROFILE_H */
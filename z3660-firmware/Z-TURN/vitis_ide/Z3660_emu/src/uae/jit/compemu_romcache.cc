@@ -0,0 +1,242 @@
+/*
+ * compemu_romcache.cc - Kickstart blocks kept across boots
+ *
+ * See compemu_romcache.h
+ */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#if defined(JIT)
+
+#include <string.h>
+#include <xil_cache.h>
+#include <xpseudo_asm_gcc.h>
+#include "options.h"
+#include "include/memory.h"
+#include "newcpu.h"
+#include "comptbl.h"
+#include "compemu.h"
+#include "jit/compemu_romcache.h"
+#include "../../main.h"
+#include "../../memorymap.h"
+
+#define ROM_START 0x00F80000
+#define ROM_SIZE  0x00080000
+
+extern SHARED *shared;
+extern LOCAL local;
+extern uint8_t *ROM;
+
+bool jit_romcache_replay = false;
+
+static uae_u8* cache_buf = NULL;
+static uae_u32 cache_max;
+static jit_romcache_header* hdr = NULL;
+static uae_u32 seen[ROM_SIZE / 2 / 32];    /* ROM words that start a saved trace */
+static uae_u32 added;                      /* traces since the last save */
+static uae_u32 quiet;                      /* blocks compiled since the last new trace */
+static int saves;
+
+/* FNV-1a */
+uae_u32 jit_romcache_hash(uae_u32 hash, const void* p, uae_u32 len)
+{
+    const uae_u8* b = (const uae_u8*)p;
+
+    while (len--)
+        hash = (hash ^ *b++) * 16777619;
+    return hash;
+}
+
+static inline uae_u32 trace_size(uae_u32 blocklen)
+{
+    return 8 + blocklen * 4 + ((blocklen + 3) & ~3);
+}
+
+static inline bool trace_location_ok(uae_u32 addr)
+{
+    return addr >= ROM_START && addr < ROM_START + ROM_SIZE && (addr & 1) == 0;
+}
+
+static inline bool trace_seen(uae_u32 addr)
+{
+    uae_u32 w = (addr - ROM_START) >> 1;
+    return (seen[w >> 5] >> (w & 31)) & 1;
+}
+
+static inline void trace_set_seen(uae_u32 addr)
+{
+    uae_u32 w = (addr - ROM_START) >> 1;
+    seen[w >> 5] |= 1 << (w & 31);
+}
+
+/* Walk the traces of a loaded buffer, false if any of them is broken */
+static bool traces_ok(const uae_u8* p, uae_u32 size, uae_u32 count)
+{
+    uae_u32 pos = 0;
+
+    while (pos < size) {
+        uae_u32 blocklen;
+        const uae_u32* loc;
+
+        if (size - pos < 8)
+            return false;
+        blocklen = ((const uae_u32*)(p + pos))[1];
+        if (blocklen == 0 || blocklen > MAXRUN || trace_size(blocklen) > size - pos)
+            return false;
+        loc = (const uae_u32*)(p + pos + 8);
+        for (uae_u32 i = 0; i < blocklen; i++) {
+            if (!trace_location_ok(loc[i]))
+                return false;
+        }
+        pos += trace_size(blocklen);
+        count--;
+    }
+    return count == 0;
+}
+
+/* Take buf (max bytes) as the trace buffer. The first loaded bytes are what
+   core0 read from the SD card: they are kept when they are a valid buffer
+   for this ROM and JIT build, otherwise the buffer starts empty. Returns the
+   number of traces kept. */
+uae_u32 jit_romcache_open(uae_u8* buf, uae_u32 max, uae_u32 loaded, uae_u32 build_id, uae_u32 rom_hash)
+{
+    const uae_u8* traces = buf + sizeof(jit_romcache_header);
+
+    cache_buf = buf;
+    cache_max = max;
+    hdr = (jit_romcache_header*)buf;
+    memset(seen, 0, sizeof(seen));
+    added = 0;
+    quiet = 0;
+    saves = 0;
+
+    if (loaded < sizeof(jit_romcache_header) || loaded > max
+            || hdr->magic != JIT_ROMCACHE_MAGIC
+            || hdr->build_id != build_id
+            || hdr->rom_hash != rom_hash
+            || hdr->size != loaded - sizeof(jit_romcache_header)
+            || hdr->check != jit_romcache_hash(2166136261u, traces, hdr->size)
+            || !traces_ok(traces, hdr->size, hdr->count)) {
+        hdr->magic = JIT_ROMCACHE_MAGIC;
+        hdr->build_id = build_id;
+        hdr->rom_hash = rom_hash;
+        hdr->count = 0;
+        hdr->size = 0;
+        hdr->check = 0;
+        return 0;
+    }
+
+    for (uae_u32 pos = 0; pos < hdr->size; pos += trace_size(((const uae_u32*)(traces + pos))[1]))
+        trace_set_seen(((const uae_u32*)(traces + pos))[2]);
+    return hdr->count;
+}
+
+/* Keep a ROM trace compiled at optimisation level 2 */
+bool jit_romcache_add(const cpu_history* pc_hist, int blocklen, int totcycles)
+{
+    uae_u32 start = (uae_u32)(uintptr)pc_hist[0].location;
+    uae_u8* p;
+
+    if (!hdr || !trace_location_ok(start) || trace_seen(start))
+        return false;
+    if (shared->jit_romcache_save)
+        return false;   /* core0 is writing the buffer, the trace is kept next time */
+    if (trace_size(blocklen) > cache_max - sizeof(jit_romcache_header) - hdr->size)
+        return false;
+    for (int i = 0; i < blocklen; i++) {
+        if (!trace_location_ok((uae_u32)(uintptr)pc_hist[i].location))
+            return false;
+    }
+
+    p = cache_buf + sizeof(jit_romcache_header) + hdr->size;
+    ((uae_u32*)p)[0] = totcycles;
+    ((uae_u32*)p)[1] = blocklen;
+    for (int i = 0; i < blocklen; i++) {
+        ((uae_u32*)p)[2 + i] = (uae_u32)(uintptr)pc_hist[i].location;
+        p[8 + blocklen * 4 + i] = pc_hist[i].specmem;
+    }
+    for (int i = blocklen; i & 3; i++)
+        p[8 + blocklen * 4 + i] = 0;
+
+    hdr->size += trace_size(blocklen);
+    hdr->count++;
+    trace_set_seen(start);
+    added++;
+    quiet = 0;
+    return true;
+}
+
+/* Read the trace at *pos and move *pos to the next one. Returns the block
+   length, 0 after the last trace. */
+int jit_romcache_get(uae_u32* pos, cpu_history* pc_hist, int* totcycles)
+{
+    const uae_u8* p;
+    int blocklen;
+
+    if (!hdr || *pos >= hdr->size)
+        return 0;
+    p = cache_buf + sizeof(jit_romcache_header) + *pos;
+    *totcycles = ((const uae_u32*)p)[0];
+    blocklen = ((const uae_u32*)p)[1];
+    for (int i = 0; i < blocklen; i++) {
+        pc_hist[i].location = (uae_u16*)(uintptr)((const uae_u32*)p)[2 + i];
+        pc_hist[i].specmem = p[8 + blocklen * 4 + i];
+    }
+    *pos += trace_size(blocklen);
+    return blocklen;
+}
+
+/* Finish the header, returns the bytes to save */
+uae_u32 jit_romcache_seal(void)
+{
+    if (!hdr)
+        return 0;
+    hdr->check = jit_romcache_hash(2166136261u, cache_buf + sizeof(jit_romcache_header), hdr->size);
+    return sizeof(jit_romcache_header) + hdr->size;
+}
+
+void jit_romcache_init(void)
+{
+    if (!hdr) {
+        uae_u32 build_id = jit_romcache_hash(2166136261u, "JIT", 3) ^ JIT_ROMCACHE_VERSION;
+        uae_u32 rom_hash;
+        uae_u32 count;
+
+        if (local.load_rom_emu != 1)
+            return;   /* ROM on the motherboard, it can't be checked */
+        for (int i = 0; op_smalltbl_0_comp_ff[i].opcode < 65536; i++)
+            build_id = jit_romcache_hash(build_id, &op_smalltbl_0_comp_ff[i].handler, sizeof(compop_func*));
+        for (int i = 0; op_smalltbl_0_comp_nf[i].opcode < 65536; i++)
+            build_id = jit_romcache_hash(build_id, &op_smalltbl_0_comp_nf[i].handler, sizeof(compop_func*));
+        rom_hash = jit_romcache_hash(2166136261u, ROM, ROM_SIZE);
+
+        count = jit_romcache_open((uae_u8*)JIT_ROMCACHE_ADDRESS, JIT_ROMCACHE_SIZE,
+            shared->jit_romcache_size, build_id, rom_hash);
+        write_log("JIT: %d ROM traces loaded (%d bytes from SD)\n", count, shared->jit_romcache_size);
+    }
+    jit_romcache_replay = hdr->count > 0;
+}
+
+/* Called for every block compiled. Once the boot has settled (no new ROM
+   trace for a while) hand the buffer to core0 to be saved. */
+void jit_romcache_tick(void)
+{
+    uae_u32 size;
+
+    if (!hdr || added < (saves ? JIT_ROMCACHE_MIN_NEW : 1))
+        return;
+    if (++quiet < JIT_ROMCACHE_QUIET || shared->jit_romcache_save)
+        return;
+
+    size = jit_romcache_seal();
+    Xil_L1DCacheFlush();
+    shared->jit_romcache_size = size;
+    dsb();
+    shared->jit_romcache_save = 1;
+    write_log("JIT: saving %d ROM traces (%d bytes)\n", hdr->count, size);
+    added = 0;
+    saves++;
+}
+
+#endif /* JIT */
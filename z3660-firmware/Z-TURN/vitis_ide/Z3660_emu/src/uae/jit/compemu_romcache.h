@@ -0,0 +1,55 @@
+/*
+ * compemu_romcache.h - Kickstart blocks kept across boots
+ *
+ * The Kickstart blocks the JIT translates are the same on every boot.
+ * The traces of the ROM blocks that reach optimisation level 2 (address
+ * and special memory flags of every instruction, cycles of the trace)
+ * are kept in a buffer that core0 saves to the SD card, and on the next
+ * boot they are compiled again before the first block, so the ROM runs
+ * translated from the start instead of being interpreted and counted
+ * down first.
+ *
+ * The traces are saved rather than the ARM code: the code holds the
+ * absolute addresses of blockinfos, cache tags and literal pools, and
+ * compiling a trace again needs no relocation at all.
+ *
+ * A saved buffer is only used with the same ROM image (hash of the
+ * 512 KB loaded by core0) and the same JIT build (hash of the compile
+ * tables).
+ */
+
+#ifndef COMPEMU_ROMCACHE_H
+#define COMPEMU_ROMCACHE_H
+
+#include "sysdeps.h"
+#include "compemu.h"
+
+#define JIT_ROMCACHE_MAGIC   0x524A335A  /* "Z3JR" */
+#define JIT_ROMCACHE_VERSION 1
+#define JIT_ROMCACHE_QUIET   2048        /* blocks compiled without a new ROM trace before saving */
+#define JIT_ROMCACHE_MIN_NEW 16          /* new traces worth saving again */
+
+typedef struct {
+    uae_u32 magic;
+    uae_u32 build_id;
+    uae_u32 rom_hash;
+    uae_u32 count;                       /* traces */
+    uae_u32 size;                        /* bytes of traces after the header */
+    uae_u32 check;                       /* hash of those bytes */
+} jit_romcache_header;
+
+/* Every trace is uae_u32 totcycles, uae_u32 blocklen, blocklen uae_u32
+   68k addresses and blocklen specmem bytes padded to 4 bytes. */
+
+extern bool jit_romcache_replay;
+
+uae_u32 jit_romcache_hash(uae_u32 hash, const void* p, uae_u32 len);
+uae_u32 jit_romcache_open(uae_u8* buf, uae_u32 max, uae_u32 loaded, uae_u32 build_id, uae_u32 rom_hash);
+bool jit_romcache_add(const cpu_history* pc_hist, int blocklen, int totcycles);
+int jit_romcache_get(uae_u32* pos, cpu_history* pc_hist, int* totcycles);
+uae_u32 jit_romcache_seal(void);
+
+void jit_romcache_init(void);
+void jit_romcache_tick(void);
+
+#endif /* COMPEMU_ROMCACHE_H */
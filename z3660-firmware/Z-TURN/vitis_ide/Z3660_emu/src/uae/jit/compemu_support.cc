@@ -42,9 +42,15 @@
 #include "custom.h"
 #include "comptbl.h"
 #include "compemu.h"
+#include "jit/compemu_pages.h"
+#include "jit/compemu_romcache.h"
+#include "jit/compemu_profile.h"
 #include <uae/uaestring.h>
 #include <string.h>
 //#include <SDL.h>
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
 
 #ifdef __MACH__
 // Needed for sys_cache_invalidate to on the JIT space region, Mac OS X specific
@@ -389,7 +395,10 @@ void invalidate_block(blockinfo* bi)
     bi->direct_handler = NULL;
     set_dhtu(bi, bi->direct_pen);
     bi->needed_flags = 0xff;
+    bi->exit_flags = FLAG_ALL;
+    bi->branch_end = 0;
     bi->status = BI_INVALID;
+    bi->page_tracked = 0;
     for (i = 0; i < 2; i++) {
         bi->dep[i].jmp_off = NULL;
         bi->dep[i].target = NULL;
@@ -397,6 +406,25 @@ void invalidate_block(blockinfo* bi)
     remove_deps(bi);
 }
 
+/* bi was thrown away, so the blocks that left out flags it set again
+   go too (see successor_flags()) */
+static void invalidate_flag_users(blockinfo* bi)
+{
+    dependency* x = bi->deplist;
+
+    while (x) {
+        blockinfo* src = x->source;
+
+        if (src != bi && src->exit_flags != FLAG_ALL) {
+            invalidate_block(src); /* unlinks its deps from the list */
+            invalidate_flag_users(src);
+            x = bi->deplist;
+        } else {
+            x = x->next;
+        }
+    }
+}
+
 STATIC_INLINE void create_jmpdep(blockinfo* bi, int i, uae_u32* jmpaddr, uae_u32 target)
 {
     blockinfo* tbi = get_blockinfo_addr((void*)(uintptr)target);
@@ -1897,6 +1925,76 @@ void alloc_cache(void)
     }
 }
 
+/* Sum and xor of the longs of a direct bank range, len is in bytes and
+   a partial long at the end counts as a whole one */
+STATIC_INLINE void checksum_direct_c(const uae_u32* pos, uae_s32 len, uae_u32* k1, uae_u32* k2)
+{
+    uae_u32 s = *k1;
+    uae_u32 x = *k2;
+
+    while (len > 0) {
+        s += *pos;
+        x ^= *pos;
+        pos++;
+        len -= 4;
+    }
+    *k1 = s;
+    *k2 = x;
+}
+
+#ifdef __ARM_NEON__
+/* 64 bytes per loop in lanes, the lanes are folded at the end so the
+   sum and xor are the same as the long by long ones */
+static void checksum_direct_neon(const uae_u32* pos, uae_s32 len, uae_u32* k1, uae_u32* k2)
+{
+    uint32x4_t s0 = vdupq_n_u32(0);
+    uint32x4_t s1 = vdupq_n_u32(0);
+    uint32x4_t x0 = vdupq_n_u32(0);
+    uint32x4_t x1 = vdupq_n_u32(0);
+
+    while (len >= 64) {
+        uint32x4_t a = vld1q_u32(pos);
+        uint32x4_t b = vld1q_u32(pos + 4);
+        uint32x4_t c = vld1q_u32(pos + 8);
+        uint32x4_t d = vld1q_u32(pos + 12);
+        __builtin_prefetch(pos + 32);
+        s0 = vaddq_u32(s0, vaddq_u32(a, b));
+        s1 = vaddq_u32(s1, vaddq_u32(c, d));
+        x0 = veorq_u32(x0, veorq_u32(a, b));
+        x1 = veorq_u32(x1, veorq_u32(c, d));
+        pos += 16;
+        len -= 64;
+    }
+    s0 = vaddq_u32(s0, s1);
+    x0 = veorq_u32(x0, x1);
+    uint32x2_t s = vadd_u32(vget_low_u32(s0), vget_high_u32(s0));
+    uint32x2_t x = veor_u32(vget_low_u32(x0), vget_high_u32(x0));
+    *k1 += vget_lane_u32(s, 0) + vget_lane_u32(s, 1);
+    *k2 ^= vget_lane_u32(x, 0) ^ vget_lane_u32(x, 1);
+    checksum_direct_c(pos, len, k1, k2);
+}
+#define checksum_direct checksum_direct_neon
+#else
+#define checksum_direct checksum_direct_c
+#endif
+
+/* A checksum range, aligned down to a long. Returns false for the ones
+   that are not summed at all */
+STATIC_INLINE bool checksum_range(checksum_info* csi, uae_u32** pos, uae_s32* len)
+{
+    uintptr tmp = (uintptr)csi->start_p;
+
+    *len = csi->length + (tmp & 3);
+    *pos = (uae_u32*)(tmp & ~((uintptr)3));
+    return *len >= 0 && *len <= MAX_CHECKSUM_LEN;
+}
+
+STATIC_INLINE bool checksum_is_direct(uae_u32* pos, uae_s32 len)
+{
+    return get_mem_bank(pos).baseaddr_direct_r != 0 &&
+           get_mem_bank(pos + len).baseaddr_direct_r != 0;
+}
+
 static void calc_checksum(blockinfo* bi, uae_u32* c1, uae_u32* c2)
 {
     uae_u32 k1 = 0;
@@ -1904,24 +2002,28 @@ static void calc_checksum(blockinfo* bi, uae_u32* c1, uae_u32* c2)
 
     checksum_info* csi = bi->csi;
     while (csi) {
-        uae_s32 len = csi->length;
-        uintptr tmp = (uintptr)csi->start_p;
+        uae_s32 len;
         uae_u32* pos;
 
-        len += (tmp & 3);
-        tmp &= ~((uintptr)3);
-        pos = (uae_u32*)tmp;
-
-       	if (len >= 0 && len <= MAX_CHECKSUM_LEN) {
-       		if(get_mem_bank(pos).baseaddr_direct_r!=0 &&
-               get_mem_bank(pos+len).baseaddr_direct_r!=0)
+       	if (checksum_range(csi, &pos, &len)) {
+       		if(checksum_is_direct(pos, len))
             {
-                while (len > 0) {
-                    k1 += *pos;
-                    k2 ^= *pos;
-                    pos++;
-                    len -= 4;
-    	        }
+                /* The ranges of a block's traces overlap by up to
+                   LONGEST_68K_INST, the ones that overlap or touch the
+                   next one are summed once over their union */
+                uae_u32* end = pos + ((len + 3) >> 2);
+                uae_u32* npos;
+                uae_s32 nlen;
+                while (csi->next && checksum_range(csi->next, &npos, &nlen) &&
+                       checksum_is_direct(npos, nlen) &&
+                       npos <= end && npos + ((nlen + 3) >> 2) >= pos) {
+                    if (npos < pos)
+                        pos = npos;
+                    if (npos + ((nlen + 3) >> 2) > end)
+                        end = npos + ((nlen + 3) >> 2);
+                    csi = csi->next;
+                }
+                checksum_direct(pos, (uae_s32)(end - pos) * 4, &k1, &k2);
             }
             else
             {
@@ -2028,6 +2130,7 @@ STATIC_INLINE int block_check_checksum(blockinfo* bi)
         /* This block actually changed. We need to invalidate it,
            and set it up to be recompiled */
         invalidate_block(bi);
+        invalidate_flag_users(bi);
         raise_in_cl_list(bi);
     }
     return isgood;
@@ -2040,7 +2143,13 @@ static int called_check_checksum(blockinfo* bi)
 
     for (i = 0; i < 2 && isgood; i++) {
         if (bi->dep[i].jmp_off) {
-            isgood = block_check_checksum(bi->dep[i].target);
+            blockinfo* tbi = bi->dep[i].target;
+
+            isgood = block_check_checksum(tbi);
+            /* It left out flags for a block that is waiting to be compiled */
+            if (isgood && bi->exit_flags != FLAG_ALL && tbi != bi &&
+                tbi->status != BI_ACTIVE && tbi->status != BI_CHECKING)
+                isgood = 0;
         }
     }
     return isgood;
@@ -2235,6 +2344,8 @@ void build_comp(void)
 #endif
     regs.mem_banks = (uintptr)mem_banks;
     regs.cache_tags = (uintptr)cache_tags;
+    regs.jit_pages = (uintptr)jit_page_written;
+    jit_pages_init();
 
     for (opcode = 0; opcode < 65536; opcode++) {
         reset_compop(opcode);
@@ -2311,6 +2422,7 @@ void build_comp(void)
         cache_tags[i + 1].bi = NULL;
     }
     compemu_reset();
+    jit_romcache_init();
 }
 
 void flush_icache_hard(int n)
@@ -2320,6 +2432,9 @@ void flush_icache_hard(int n)
 
     blockinfo* bi, * dbi;
 
+    if (jit_profile_on)
+        jit_profile_flushed();
+
     bi = active;
     while (bi) {
         cache_tags[cacheline(bi->pc_p)].handler = (cpuop_func*)popall_execute_normal;
@@ -2350,14 +2465,77 @@ void flush_icache_hard(int n)
 }
 
 
+/* Code in RAM that only the 68k writes can be watched with the page
+   marks. Chip RAM and the motherboard may be changed by the Amiga's own
+   DMA and the RTG RAM by the core0 blitter, blocks there are always
+   checksummed again after a flush. */
+STATIC_INLINE bool bank_tracked(addrbank* ab)
+{
+    return ab->baseaddr_direct_w != 0 && (ab->flags & ABFLAG_RTG) == 0;
+}
+
+static bool block_in_tracked_ram(blockinfo* bi)
+{
+    for (checksum_info* csi = bi->csi; csi; csi = csi->next) {
+        if (!bank_tracked(&get_mem_bank(csi->start_p)) ||
+            !bank_tracked(&get_mem_bank(csi->start_p + csi->length - 1)))
+            return false;
+    }
+    return true;
+}
+
+static bool block_pages_written(blockinfo* bi)
+{
+    for (checksum_info* csi = bi->csi; csi; csi = csi->next) {
+        if (jit_pages_written((uaecptr)csi->start_p, csi->length))
+            return true;
+    }
+    return false;
+}
+
+STATIC_INLINE void set_need_check(blockinfo* bi)
+{
+    uae_u32 cl = cacheline(bi->pc_p);
+
+    if (bi == cache_tags[cl + 1].bi)
+        cache_tags[cl].handler = (cpuop_func*)popall_check_checksum;
+    bi->handler_to_use = (cpuop_func*)popall_check_checksum;
+    set_dhtu(bi, bi->direct_pcc);
+    bi->status = BI_NEED_CHECK;
+}
+
+/* bi has to be checked, so the blocks that left out flags it set again
+   are checked with it, even when their own pages were not written.
+   Returns the number of blocks moved to the dormant list. */
+static int check_flag_users(blockinfo* bi)
+{
+    int moved = 0;
+
+    for (dependency* x = bi->deplist; x; x = x->next) {
+        blockinfo* src = x->source;
+
+        if (src->status == BI_ACTIVE && src->exit_flags != FLAG_ALL && src->csi) {
+            set_need_check(src);
+            remove_from_list(src);
+            add_to_dormant(src);
+            moved += 1 + check_flag_users(src);
+        }
+    }
+    return moved;
+}
+
 /* "Soft flushing" --- instead of actually throwing everything away,
    we simply mark everything as "needs to be checked".
+   Blocks whose pages were not written since the last flush don't need
+   to be checked and stay active.
 */
 
 void flush_icache(int n)
 {
     blockinfo* bi;
     blockinfo* bi2;
+    int moved = 0;
+    bool foreign = jit_pages_foreign;
 
     if (!active)
         return;
@@ -2365,30 +2543,37 @@ void flush_icache(int n)
     bi = active;
     while (bi) {
         uae_u32 cl = cacheline(bi->pc_p);
-        if (bi->status == BI_INVALID || bi->status == BI_NEED_RECOMP) {
-            if (bi == cache_tags[cl + 1].bi)
+        bi2 = bi;
+        bi = bi->next;
+        if (bi2->status == BI_INVALID || bi2->status == BI_NEED_RECOMP) {
+            if (bi2 == cache_tags[cl + 1].bi)
                 cache_tags[cl].handler = (cpuop_func*)popall_execute_normal;
-            bi->handler_to_use = (cpuop_func*)popall_execute_normal;
-            set_dhtu(bi, bi->direct_pen);
-            bi->status = BI_INVALID;
+            bi2->handler_to_use = (cpuop_func*)popall_execute_normal;
+            set_dhtu(bi2, bi2->direct_pen);
+            bi2->status = BI_INVALID;
+        } else if (!foreign && bi2->page_tracked && !block_pages_written(bi2)) {
+            continue;
         } else {
-            if (bi == cache_tags[cl + 1].bi)
-                cache_tags[cl].handler = (cpuop_func*)popall_check_checksum;
-            bi->handler_to_use = (cpuop_func*)popall_check_checksum;
-            set_dhtu(bi, bi->direct_pcc);
-            bi->status = BI_NEED_CHECK;
+            set_need_check(bi2);
         }
-        bi2 = bi;
-        bi = bi->next;
+        remove_from_list(bi2);
+        add_to_dormant(bi2);
+        moved++;
     }
-    /* bi2 is now the last entry in the active list */
-    bi2->next = dormant;
-    if (dormant)
-        dormant->prev_p = &(bi2->next);
 
-    dormant = active;
-    active->prev_p = &dormant;
-    active = NULL;
+    /* The blocks added by check_flag_users() go in front of them */
+    bi = dormant;
+    for (int i = moved; i > 0; i--, bi = bi->next)
+        moved += check_flag_users(bi);
+
+    /* Every block on a written page is now checked by its checksum, so
+       the pages can start over. The moved blocks are at the head of the
+       dormant list. */
+    for (bi = dormant; moved > 0; bi = bi->next, moved--) {
+        for (checksum_info* csi = bi->csi; csi; csi = csi->next)
+            jit_pages_clean((uaecptr)csi->start_p, csi->length);
+    }
+    jit_pages_foreign = false;
 }
 
 int failure;
@@ -2400,9 +2585,155 @@ STATIC_INLINE unsigned int get_opcode_cft_map(unsigned int f)
 //#define DO_GET_OPCODE(a) (get_opcode_cft_map((uae_u16)*(a)))
 #define DO_GET_OPCODE(a) (memory_get_word((uint32_t)a))
 
+/* Flags live before each instruction of the trace when exit_flags are
+   live after it, returns the ones live on entry */
+static uae_u8 trace_liveflags(cpu_history* pc_hist, int blocklen, uae_u8* liveflags, uae_u8 exit_flags)
+{
+    liveflags[blocklen] = exit_flags;
+    for (int i = blocklen - 1; i >= 0; i--) {
+        uae_u32 op = DO_GET_OPCODE(pc_hist[i].location);
+
+        liveflags[i] = ((liveflags[i + 1] & (~prop[op].set_flags)) | prop[op].use_flags);
+        if (prop[op].is_addx && (liveflags[i + 1] & FLAG_Z) == 0)
+            liveflags[i] &= ~FLAG_Z;
+    }
+    return liveflags[0];
+}
+
+/* Cross-block flag liveness
+ *
+ * A trace ending with a conditional branch (Bcc or DBcc) has two
+ * successors known before it is compiled, and once compiled the branch
+ * links it to both of them with create_jmpdep(). When they are compiled
+ * already, the block only leaves valid the flags they need (their
+ * needed_flags) and drops the rest, like it does inside a block.
+ *
+ * The deplist of each block then holds the blocks that relied on its
+ * needed_flags:
+ * - when they grow (its code changed, or it was compiled from another
+ *   trace) those blocks are thrown away, and the ones relying on them;
+ * - when they shrink, those blocks are compiled again to drop more.
+ * A block that has to be checked after a soft flush takes them along,
+ * so none of them runs before the code it relied on was checked.
+ *
+ * As with the flags dropped inside a block, the SR stacked by an
+ * interrupt taken between the blocks may hold flags the successor sets
+ * again.
+ */
+
+/* Flags the block tbi needs from a block jumping to it */
+STATIC_INLINE uae_u8 successor_flags(blockinfo* tbi, bool from_rom)
+{
+    /* A block in ROM is never checked again, it only relies on ROM blocks */
+    if (!tbi || tbi->status != BI_ACTIVE || (from_rom && tbi->csi))
+        return FLAG_ALL;
+    return tbi->needed_flags & FLAG_ALL;
+}
+
+/* The two successors of a trace ending with a compiled Bcc or DBcc */
+static bool trace_branch_targets(cpu_history* pc_hist, int blocklen, uintptr* targets)
+{
+    uintptr pc = (uintptr)pc_hist[blocklen - 1].location;
+    uae_u32 op = DO_GET_OPCODE(pc);
+    uae_s32 disp;
+
+    if (!compfunctbl[op] || !nfcompfunctbl[op])
+        return false;
+    if ((op & 0xf000) == 0x6000 && (op & 0x0e00) != 0) { /* not BRA or BSR */
+        disp = (uae_s8)op;
+        targets[1] = pc + 2;
+        if (disp == 0) {
+            disp = (uae_s16)memory_get_word(pc + 2);
+            targets[1] = pc + 4;
+        } else if (disp == -1) {
+            disp = (uae_s32)memory_get_long(pc + 2);
+            targets[1] = pc + 6;
+        }
+    } else if ((op & 0xf0f8) == 0x50c8) {
+        disp = (uae_s16)memory_get_word(pc + 2);
+        targets[1] = pc + 4;
+    } else {
+        return false;
+    }
+    targets[0] = pc + 2 + disp;
+    return true;
+}
+
+/* The exit flags bi would get if it was compiled again now, never fewer
+   than compile_block() gives it */
+static uae_u8 branch_exit_flags(blockinfo* bi)
+{
+    uae_u8 exit_flags = 0;
+
+    for (int i = 0; i < 2; i++) {
+        blockinfo* tbi = bi->dep[i].target;
+
+        if (tbi == bi)
+            exit_flags |= bi->needed_flags & FLAG_ALL;
+        else
+            exit_flags |= successor_flags(tbi, bi->csi == NULL);
+    }
+    return exit_flags;
+}
+
+/* bi was compiled: the blocks that dropped flags it needs now are thrown
+   away, the ones that could drop more are compiled again */
+static void update_flag_users(blockinfo* bi)
+{
+    dependency* x = bi->deplist;
+
+    while (x) {
+        blockinfo* src = x->source;
+
+        if (src != bi && (bi->needed_flags & ~src->exit_flags & FLAG_ALL)) {
+            invalidate_block(src);
+            invalidate_flag_users(src);
+            x = bi->deplist;
+        } else if (src != bi && src->status == BI_ACTIVE && src->branch_end &&
+                   (src->exit_flags & ~branch_exit_flags(src))) {
+            /* Its code is the same, so are the flags it needs. Compile it
+               again straight at level 2. */
+            invalidate_block(src);
+            src->count = -1;
+            x = bi->deplist;
+        } else {
+            x = x->next;
+        }
+    }
+}
+
+static bool replaying_rom_traces = false;
+
+/* Compile the ROM traces saved on an earlier boot straight at optimisation
+   level 2, see compemu_romcache.h */
+static void replay_rom_traces(void)
+{
+    static cpu_history hist[MAXRUN];
+    uae_u32 pos = 0;
+    int blocklen, totcycles;
+    int count = 0;
+
+    jit_romcache_replay = false;
+    replaying_rom_traces = true;
+    while ((blocklen = jit_romcache_get(&pos, hist, &totcycles)) > 0) {
+        alloc_blockinfos();
+        blockinfo* bi = get_blockinfo_addr_new(hist[0].location);
+        if (bi->status != BI_INVALID)
+            continue;
+        bi->count = -1;
+        compile_block(hist, blocklen, totcycles);
+        count++;
+    }
+    replaying_rom_traces = false;
+    jit_log("%d ROM traces compiled", count);
+}
+
 void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
 {
     if (cache_enabled && compiled_code && currprefs.cpu_model >= 68020) {
+        if (jit_romcache_replay)
+            replay_rom_traces();
+
 #ifdef PROFILE_COMPILE_TIME
         compile_count++;
         clock_t start_time = clock();
@@ -2433,6 +2764,10 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
             optlev = 2;
             bi->count = -2;
         }
+        bool profiling = jit_profile_on;
+        jit_profile_block* prof = NULL;
+        if (profiling)
+            prof = jit_profile_compile((uintptr)pc_hist[0].location, blocklen, optlev);
 
         remove_deps(bi); /* We are about to create new code */
         bi->optlevel = optlev;
@@ -2440,7 +2775,6 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
         free_checksum_info_chain(bi->csi);
         bi->csi = NULL;
 
-        liveflags[blocklen] = FLAG_ALL; /* All flags needed afterwards */
         i = blocklen;
         while (i--) {
             uae_u16* currpcp = pc_hist[i].location;
@@ -2456,10 +2790,6 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
                 max_pcp = (uintptr)currpcp;
             }
             min_pcp = (uintptr)currpcp;
-
-            liveflags[i] = ((liveflags[i + 1] & (~prop[op].set_flags)) | prop[op].use_flags);
-            if (prop[op].is_addx && (liveflags[i + 1] & FLAG_Z) == 0)
-                liveflags[i] &= ~FLAG_Z;
         }
 
         checksum_info* csi = alloc_checksum_info();
@@ -2468,7 +2798,29 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
         csi->next = bi->csi;
         bi->csi = csi;
 
-        bi->needed_flags = liveflags[0];
+        /* Only the flags its successors need are left valid at the end */
+        uae_u8 exit_flags = FLAG_ALL;
+        uintptr targets[2];
+        bool branch_end = optlev > 1 && trace_branch_targets(pc_hist, blocklen, targets);
+        if (branch_end) {
+            bool loops = false;
+
+            exit_flags = 0;
+            for (i = 0; i < 2; i++) {
+                blockinfo* tbi = get_blockinfo_addr((void*)targets[i]);
+
+                if (tbi == bi)
+                    loops = true;
+                else
+                    exit_flags |= successor_flags(tbi, trace_in_rom);
+            }
+            /* A loop on itself also needs the flags read before it sets them */
+            if (loops)
+                exit_flags |= trace_liveflags(pc_hist, blocklen, liveflags, exit_flags);
+        }
+        bi->exit_flags = exit_flags;
+        bi->branch_end = branch_end;
+        bi->needed_flags = trace_liveflags(pc_hist, blocklen, liveflags, exit_flags);
 
         /* This is the non-direct handler */
         was_comp = 0;
@@ -2478,6 +2830,8 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
         bi->status = BI_COMPILING;
         current_block_start_target = (uintptr)get_target();
 
+        if (prof) /* Count the runs of the block */
+            compemu_raw_inc_m64((uintptr) & (prof->execs));
         if (bi->count >= 0) { /* Need to generate countdown code */
             compemu_raw_set_pc_i((uintptr)pc_hist[0].location);
             compemu_raw_dec_m((uintptr) & (bi->count));
@@ -2545,12 +2899,13 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
                     compemu_raw_inc_opcount(opcode);
 #endif
 
-                    if (i < blocklen - 1) {
+                    /* Also after the last one: an instruction setting T0,
+                       T1 or M (MOVE to SR, RTE) ends the block, and the
+                       next one must not be entered with the bit set */
 #if defined(CPU_arm) && !defined(ARMV6T2) && !defined(CPU_AARCH64)
-                        data_check_end(8, 64);
+                    data_check_end(8, 64);
 #endif
-                        compemu_raw_maybe_do_nothing(scaled_cycles(totcycles));
-                    }
+                    compemu_raw_maybe_do_nothing(scaled_cycles(totcycles));
                 } else if (may_raise_exception) {
 #if defined(CPU_arm) && !defined(ARMV6T2) && !defined(CPU_AARCH64)
                     data_check_end(8, 64);
@@ -2650,9 +3005,11 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
             // No need to checksum that block trace on cache invalidation
             free_checksum_info_chain(bi->csi);
             bi->csi = NULL;
+            bi->page_tracked = 0;
             add_to_dormant(bi);
         } else {
             calc_checksum(bi, &(bi->c1), &(bi->c2));
+            bi->page_tracked = block_in_tracked_ram(bi);
             add_to_active(bi);
         }
 
@@ -2675,18 +3032,27 @@ void compile_block(cpu_history* pc_hist, int blocklen, int totcycles)
         current_compile_p = get_target();
         raise_in_cl_list(bi);
         bi->nexthandler = current_compile_p;
+        if (profiling)
+            jit_profile_compiled(prof, current_compile_p - (uae_u8*)current_block_start_target,
+                (trace_in_rom ? JIT_PROFILE_ROM : 0) | (bi->page_tracked ? JIT_PROFILE_TRACKED : 0));
+        bi->status = BI_ACTIVE;
+        update_flag_users(bi);
 
         /* We will flush soon, anyway, so let's do it now */
         if (current_compile_p >= MAX_COMPILE_PTR)
             flush_icache_hard(3);
 
-        bi->status = BI_ACTIVE;
-
 #ifdef PROFILE_COMPILE_TIME
         compile_time += (clock() - start_time);
 #endif
-        /* Account for compilation time */
-        do_extra_cycles(totcycles);
+        if (!replaying_rom_traces) {
+            if (trace_in_rom && optlev > 1)
+                jit_romcache_add(pc_hist, blocklen, totcycles);
+            jit_romcache_tick();
+
+            /* Account for compilation time */
+            do_extra_cycles(totcycles);
+        }
     }
 }
 
@@ -23,6 +23,9 @@
 //#include "custom.h"
 #include "events.h"
 #include "newcpu.h"
+#ifdef JIT
+#include "jit/compemu_pages.h"
+#endif
 //#include "autoconf.h"
 //#include "savestate.h"
 //#include "ar.h"
@@ -44,6 +47,9 @@
 //#include "casablanca.h"
 
 extern uae_u8* natmem_offset, * natmem_offset_end;
+extern "C" int bus_amiga_ram(uint32_t address, uint32_t len);
+extern "C" uint32_t bus_copy_to_amiga(uint32_t address, const uint8_t *src, uint32_t len);
+extern "C" uint32_t bus_copy_from_amiga(uint8_t *dst, uint32_t address, uint32_t len);
 
 #ifdef AMIBERRY
 extern void memory_map_dump(void);
@@ -3830,6 +3836,9 @@ void memory_put_long(uaecptr addr, uae_u32 v)
 //		m = ab->baseaddr_direct_w + addr;
 		m = (uae_u8*)addr;
 		*((uae_u32*)m)=swap32(v);
+#ifdef JIT
+		jit_page_mark(addr);
+#endif
 	}
 }
 void memory_put_word(uaecptr addr, uae_u32 v)
@@ -3844,6 +3853,9 @@ void memory_put_word(uaecptr addr, uae_u32 v)
 //		m = ab->baseaddr_direct_w + addr;
 		m = (uae_u8*)addr;
 		*((uae_u16*)m)=swap16(v);
+#ifdef JIT
+		jit_page_mark(addr);
+#endif
 	}
 }
 void memory_put_byte(uaecptr addr, uae_u32 v)
@@ -3858,7 +3870,39 @@ void memory_put_byte(uaecptr addr, uae_u32 v)
 //		m = ab->baseaddr_direct_w + addr;
 		m = (uae_u8*)addr;
 		*m = (uae_u8)v;
+#ifdef JIT
+		jit_page_mark(addr);
+#endif
+	}
+}
+
+/* A MOVE16 line between direct RAM and the motherboard RAM is one block
+   transfer on the bus, anything else is done a longword at a time. */
+void memory_move16(uaecptr src, uaecptr dst)
+{
+	addrbank *sab = &get_mem_bank(src);
+	addrbank *dab = &get_mem_bank(dst);
+	uae_u32 v[4];
+
+	if (sab->baseaddr_direct_r && !dab->baseaddr_direct_w && bus_amiga_ram(dst, 16)) {
+		if (bus_copy_to_amiga(dst, (uae_u8*)src, 16) == 16)
+			return;
+	} else if (dab->baseaddr_direct_w && !sab->baseaddr_direct_r && bus_amiga_ram(src, 16)) {
+		if (bus_copy_from_amiga((uae_u8*)dst, src, 16) == 16) {
+#ifdef JIT
+			jit_page_mark(dst);
+#endif
+			return;
+		}
 	}
+	v[0] = memory_get_long(src);
+	v[1] = memory_get_long(src + 4);
+	v[2] = memory_get_long(src + 8);
+	v[3] = memory_get_long(src + 12);
+	memory_put_long(dst, v[0]);
+	memory_put_long(dst + 4, v[1]);
+	memory_put_long(dst + 8, v[2]);
+	memory_put_long(dst + 12, v[3]);
 }
 
 uae_u8 *memory_get_real_address(uaecptr addr)
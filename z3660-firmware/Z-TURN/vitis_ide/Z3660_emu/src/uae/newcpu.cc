@@ -65,6 +65,10 @@
 /* Need to have these somewhere */
 bool check_prefs_changed_comp (bool checkonly) { return false; }
 #endif
+
+extern "C" void ps_write_flush(void);
+extern "C" void ps_write_tick(void);
+
 /* For faster JIT cycles handling */
 int pissoff = 0;
 
@@ -783,6 +787,7 @@ void flush_cpu_caches_040(uae_u16 opcode)
    int cache = (opcode >> 6) & 3;
    int scope = (opcode >> 3) & 3;
 
+   ps_write_flush();
    for (int k = 0; k < 2; k++) {
       if (cache & (1 << k)) {
          if (scope == 3) {
@@ -2081,6 +2086,7 @@ void m68k_reset_newcpu(bool hardreset)
 {
    uae_u32 v;
 
+   ps_write_flush();
    pissoff = 0;
 
    regs.halted = 0;
@@ -2505,6 +2511,7 @@ void z3660_tasks(void);
 static inline void check_uae_int_request(void)
 {
    z3660_tasks();
+   ps_write_tick();
 #if INT_IPL_ON_THIS_CORE == 0
    if(shared->int_available)
    {
@@ -3547,9 +3554,13 @@ static void m68k_run_jit(void)
             return;
          }
       }
-      // If T0, T1 or M got set: run normal emulation loop
+      // If T0, T1 or M got set: run normal emulation loop, one instruction
+      // at a time. The translations are kept: the compiled code is left on
+      // the SPCFLAG_END_COMPILE set by MakeFromSR() when these bits change,
+      // and it is only entered again from here once they are clear. The
+      // stores of the loop mark the JIT pages like the compiled ones, so a
+      // later cache flush still sees the code they change.
       if (regs.t0 || regs.t1 || regs.m) {
-         flush_icache(3);
          struct regstruct* r = &regs;
          bool exit = false;
          while (!exit && (regs.t0 || regs.t1 || regs.m)) {
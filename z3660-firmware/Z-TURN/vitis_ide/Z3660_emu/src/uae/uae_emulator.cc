@@ -10,7 +10,10 @@
 #include "xgpiops.h"
 #include "maccess.h"
 #include "memory.h"
+#include "jit/compemu_pages.h"
+#include "jit/compemu_profile.h"
 #include "../memorymap.h"
+#include <xil_cache.h>
 
 LOCAL local;
 extern int ovl;
@@ -28,6 +31,8 @@ void reset_autoconfig(void);
 
 //cycle exact 68000
 extern "C" void m68k_write_memory_32(unsigned int address, unsigned int value);
+extern "C" void ps_write_flush(void);
+extern "C" void bus_timing_check(void);
 extern "C" void write_rtg_register(uint16_t zaddr,uint32_t zdata);
 extern "C" void write_scsi_register(uint16_t zaddr,uint32_t zdata,int type);
 extern "C" uint32_t read_scsi_register(uint16_t zaddr,int type);
@@ -131,14 +136,17 @@ unsigned int direct_read_8(uaecptr add)
 void direct_write_32(uaecptr add, unsigned int data)
 {
    *(uint32_t *)add=swap32(data);
+   jit_page_mark(add);
 }
 void direct_write_16(uaecptr add, unsigned int data)
 {
    *(uint16_t *)add=swap16(data);
+   jit_page_mark(add);
 }
 void direct_write_8(uaecptr add, unsigned int data)
 {
    *(uint8_t *)add=data&0xFF;
+   jit_page_mark(add);
 }
 extern uint32_t autoConfigBaseFastRam;
 extern uint32_t autoConfigBaseRTG;
@@ -164,16 +172,19 @@ void z3ram_write_32(uaecptr address, unsigned int data)
 {
    uint32_t add=address-autoConfigBaseFastRam;
    *(uint32_t *)(Z3660_Z3RAM_BASE+add)=swap32(data);
+   jit_page_mark(address);
 }
 void z3ram_write_16(uaecptr address, unsigned int data)
 {
    uint32_t add=address-autoConfigBaseFastRam;
    *(uint16_t *)(Z3660_Z3RAM_BASE+add)=swap16(data);
+   jit_page_mark(address);
 }
 void z3ram_write_8(uaecptr address, unsigned int data)
 {
    uint32_t add=address-autoConfigBaseFastRam;
    *(uint8_t *)(Z3660_Z3RAM_BASE+add)=data&0xFF;
+   jit_page_mark(address);
 }
 extern "C" uint32_t read_autoconfig(uint32_t address);
 unsigned int auto_read_32(uaecptr address)
@@ -314,16 +325,42 @@ unsigned int rtg_regs_read_8(uaecptr address)
    else
 	   return(read_scsi_register(add-0x2000,0));
 }
+// The RTG RAM is write-through for this core, so the video output and
+// core0 always see what the 68k wrote (and the vblank ISR flushes L1 once
+// per frame). The other way round, after core0 has drawn into the RTG RAM
+// (write_rtg_register() waits for it) the lines this core may still have
+// cached are dropped, so the 68k reads the new pixels from its direct bank.
+#define REG_ZZ_FILLRECT       0x134
+#define REG_ZZ_FILLTEMPLATE   0x13C
+#define REG_ZZ_P2C            0x154
+#define REG_ZZ_P2D            0x15C
+#define REG_ZZ_INVERTRECT     0x170
+#define REG_ZZ_BLITTER_DMA_OP 0x180
+#define REG_ZZ_ACC_OP         0x184
+#define REG_ZZ_SOFT3D_OP      0x270
+static inline void write_rtg_register_sync(uint32_t add, uint32_t data)
+{
+   write_rtg_register(add,data);
+   if((add>=REG_ZZ_FILLRECT && add<=REG_ZZ_FILLTEMPLATE)
+   || (add>=REG_ZZ_P2C && add<=REG_ZZ_P2D)
+   ||  add==REG_ZZ_INVERTRECT || add==REG_ZZ_BLITTER_DMA_OP
+   ||  add==REG_ZZ_ACC_OP || add==REG_ZZ_SOFT3D_OP)
+      Xil_L1DCacheFlush();
+}
 void rtg_regs_write_32(uaecptr address, unsigned int data)
 {
    uint32_t add=address-autoConfigBaseRTG;
    *(uint32_t *)(Z3660_RTG_BASE+add)=swap32(data);
    if(add<0x6000)
    {
+	   ps_write_flush();            // the board registers see the 68k writes in order
 	   if(add<0x2000)
-		  write_rtg_register(add,data);
+		  write_rtg_register_sync(add,data);
 	   else
+	   {
+		  jit_pages_foreign_write();   // piscsi reads from disk straight into 68k RAM
 		  write_scsi_register(add-0x2000,data,2);
+	   }
    }
 }
 void rtg_regs_write_16(uaecptr address, unsigned int data)
@@ -332,10 +369,14 @@ void rtg_regs_write_16(uaecptr address, unsigned int data)
    *(uint16_t *)(Z3660_RTG_BASE+add)=swap16(data);
    if(add<0x6000)
    {
+	   ps_write_flush();
 	   if(add<0x2000)
-		  write_rtg_register(add,data);
+		  write_rtg_register_sync(add,data);
 	   else
+	   {
+		  jit_pages_foreign_write();   // piscsi reads from disk straight into 68k RAM
 		  write_scsi_register(add-0x2000,data,1);
+	   }
    }
 }
 void rtg_regs_write_8(uaecptr address, unsigned int data)
@@ -344,10 +385,14 @@ void rtg_regs_write_8(uaecptr address, unsigned int data)
    Z3660_RTG_BASE[add]=data;
    if(add<0x6000)
    {
+	   ps_write_flush();
 	   if(add<0x2000)
-		   write_rtg_register(add,data);
+		   write_rtg_register_sync(add,data);
 	   else
+	   {
+		   jit_pages_foreign_write();   // piscsi reads from disk straight into 68k RAM
 		   write_scsi_register(add-0x2000,data,0);
+	   }
    }
 }
 unsigned int rtg_read_32(uaecptr address)
@@ -584,25 +629,23 @@ addrbank rtg_regs_bank = {
       rtg_regs_write_32, rtg_regs_write_16, rtg_regs_write_8,
       dummy_xlate, rtg_check, NULL, NULL, NULL,
       rtg_regs_read_32, rtg_regs_read_16,
-      ABFLAG_NONE, MB_READ, MB_WRITE
+      ABFLAG_IO, MB_READ, MB_WRITE
 };
 addrbank rtg_bank = {
       rtg_read_32, rtg_read_16, rtg_read_8,
       rtg_write_32, rtg_write_16, rtg_write_8,
       dummy_xlate, rtg_check, NULL, NULL, NULL,
       rtg_read_32, rtg_read_16,
-      ABFLAG_NONE, MB_READ, MB_WRITE
-/*      ABFLAG_RAM | ABFLAG_DIRECTACCESS, 0, 0, // <--- Direct memory is faster if it's NOT "special_mem"
+      ABFLAG_RAM | ABFLAG_RTG | ABFLAG_DIRECTACCESS, 0, 0, // <--- Direct memory is faster if it's NOT "special_mem"
       NULL, // sub_banks
       0xFFFFFFFF, //mask
       0, // startmask
       0, // start
-      0x08000000, // allocated_size 128 MByte
-      0x08000000, // reserved_size 128 MByte
-      (uae_u8*)RTG_BASE, // baseaddr_direct_r
-      (uae_u8*)RTG_BASE, // baseaddr_direct_w
-      RTG_BASE, // startaccessmask
-      */
+      0x07E00000, // allocated_size 126 MByte (128 MByte less the registers)
+      0x07E00000, // reserved_size 126 MByte
+      (uae_u8*)0, // baseaddr_direct_r, set by init_rtg_bank()
+      (uae_u8*)0, // baseaddr_direct_w, set by init_rtg_bank()
+      0, // startaccessmask, set by init_rtg_bank()
 };
 addrbank dmmy_bank = {
       dummy_read, dummy_read, dummy_read,
@@ -632,9 +675,170 @@ extern "C" void init_z3_ram_bank(unsigned int ini)
 extern "C" void init_rtg_bank(unsigned int ini)
 {
    uint32_t dir=ini<<4;
-   RANGE_MAP(dir+0x0000,dir+0x0020,rtg_regs_bank); // RTG Registers
+   // RTG RAM is mapped by the MMU at the autoconfig address (see
+   // rtg_cache_policy_core1()), so the 68k address is the ARM address
+   uaecptr ram=(dir+0x0020)<<16;
+   rtg_bank.baseaddr_direct_r=(uae_u8 *)ram;
+   rtg_bank.baseaddr_direct_w=(uae_u8 *)ram;
+   rtg_bank.startaccessmask=ram;
+   RANGE_MAP(dir+0x0000,dir+0x0020,rtg_regs_bank); // RTG Registers and SCSI
    RANGE_MAP(dir+0x0020,dir+0x0800,rtg_bank); // RTG RAM
 }
+// Motherboard RAM shadow (mobo_ram_shadow in z3660cfg.txt). Only the
+// emulated CPU uses the motherboard fast RAM, so when the emulation starts
+// the RAM found on the board is copied to MOBO_RAM_SHADOW_ADDRESS and
+// served from there. The MMU maps the copy at the address of the RAM, so
+// the 68k address is the ARM address and the bank is direct like the CPU
+// RAM. With WRITEBACK the 68k writes only the copy, and core0 asks for it
+// to be written to the board before it reboots the ARM (an Amiga reset, a
+// new boot mode) and on MRW in the console. With WRITETHROUGH the writes
+// also go to the board, but the reads still come from the copy.
+// Anything else writing the board's RAM (a Zorro bus master) is not seen,
+// and the block copies of the SCSI emulation leave it alone (see
+// bus_amiga_ram()), so the driver copies through the 68k instead.
+#define MOBO_RAM_START   0x07000000
+#define MOBO_RAM_END     0x08000000
+#define MOBO_RAM_SECTION 0x00100000
+uint32_t mobo_ram_shadow=SHADOW_NO;
+void mbsh_write_32(uaecptr add, unsigned int data)
+{
+   *(uint32_t *)add=swap32(data);
+   jit_page_mark(add);
+   ps_write_32(add,data);
+}
+void mbsh_write_16(uaecptr add, unsigned int data)
+{
+   *(uint16_t *)add=swap16(data);
+   jit_page_mark(add);
+   ps_write_16(add,data);
+}
+void mbsh_write_8(uaecptr add, unsigned int data)
+{
+   *(uint8_t *)add=data;
+   jit_page_mark(add);
+   ps_write_8(add,data);
+}
+addrbank mbsh_bank = {
+      direct_read_32, direct_read_16, direct_read_8,
+      direct_write_32, direct_write_16, direct_write_8,
+      dummy_xlate, drct_check, NULL, NULL, NULL,
+      direct_read_32, direct_read_16,
+      ABFLAG_RAM | ABFLAG_DIRECTACCESS, 0, 0,
+      NULL, // sub_banks
+      0xFFFFFFFF, //mask
+      0, // startmask
+      0, // start
+      0, // allocated_size, set by mobo_ram_shadow_init()
+      0, // reserved_size, set by mobo_ram_shadow_init()
+      (uae_u8*)0, // baseaddr_direct_r, set by mobo_ram_shadow_init()
+      (uae_u8*)0, // baseaddr_direct_w, set by mobo_ram_shadow_init()
+      0, // startaccessmask, set by mobo_ram_shadow_init()
+};
+static void mobo_ram_pattern(uint8_t *p, uint32_t address)
+{
+   uint32_t v=0x5A3C96E1^address;
+   for(int i=0;i<4;i++)
+   {
+      p[i]=v>>(24-i*8);
+      p[i+4]=~p[i];                   // the bus doesn't keep the pattern by itself
+   }
+}
+// The RAM grows down from MOBO_RAM_END. Every 1 MB section gets its own
+// pattern, down to the first one that doesn't keep it or that overwrites
+// one above (the address decoder mirrors a smaller RAM). Returns the
+// start of the RAM found, the bytes tested are restored.
+static uint32_t mobo_ram_probe(void)
+{
+   uint8_t saved[MOBO_RAM_END/MOBO_RAM_SECTION-MOBO_RAM_START/MOBO_RAM_SECTION][8];
+   uint8_t pattern[8],back[8];
+   uint32_t start=MOBO_RAM_END;
+   uint32_t address=MOBO_RAM_END;
+   while(address>MOBO_RAM_START)
+   {
+      int ok;
+      address-=MOBO_RAM_SECTION;
+      if(bus_copy_from_amiga(saved[(address-MOBO_RAM_START)/MOBO_RAM_SECTION],address,8)!=8)
+         break;
+      mobo_ram_pattern(pattern,address);
+      ok=bus_copy_to_amiga(address,pattern,8)==8
+         && bus_copy_from_amiga(back,address,8)==8 && memcmp(back,pattern,8)==0;
+      for(uint32_t above=address+MOBO_RAM_SECTION;ok && above<MOBO_RAM_END;above+=MOBO_RAM_SECTION)
+      {
+         mobo_ram_pattern(pattern,above);
+         ok=bus_copy_from_amiga(back,above,8)==8 && memcmp(back,pattern,8)==0;
+      }
+      if(!ok)
+         break;
+      start=address;
+   }
+   // lowest first, so a mirror gets the bytes of the section it mirrors
+   for(;address<MOBO_RAM_END;address+=MOBO_RAM_SECTION)
+      bus_copy_to_amiga(address,saved[(address-MOBO_RAM_START)/MOBO_RAM_SECTION],8);
+   return(start);
+}
+// before the MMU table is finished
+void mobo_ram_shadow_init(void)
+{
+   uint32_t start;
+   mobo_ram_shadow=shared->mobo_ram_shadow;
+   bus_shadow_start=MOBO_RAM_END;
+   if(mobo_ram_shadow==SHADOW_NO)
+      return;
+   start=mobo_ram_probe();
+   if(start==MOBO_RAM_END)
+   {
+      z3660_printf("[Core1] Motherboard RAM shadow: no RAM found\n");
+      mobo_ram_shadow=SHADOW_NO;
+      return;
+   }
+   mobo_ram_shadow_mmu(start);
+   mbsh_bank.allocated_size=MOBO_RAM_END-start;
+   mbsh_bank.reserved_size=MOBO_RAM_END-start;
+   mbsh_bank.baseaddr_direct_r=(uae_u8 *)start;
+   mbsh_bank.startaccessmask=start;
+   if(mobo_ram_shadow==SHADOW_WRITEBACK)
+   {
+      mbsh_bank.baseaddr_direct_w=(uae_u8 *)start;
+      mbsh_bank.lput=direct_write_32;
+      mbsh_bank.wput=direct_write_16;
+      mbsh_bank.bput=direct_write_8;
+      mbsh_bank.jit_write_flag=0;
+   }
+   else
+   {
+      mbsh_bank.baseaddr_direct_w=0;
+      mbsh_bank.lput=mbsh_write_32;
+      mbsh_bank.wput=mbsh_write_16;
+      mbsh_bank.bput=mbsh_write_8;
+      mbsh_bank.jit_write_flag=S_WRITE;
+   }
+   bus_shadow_start=start;
+   RANGE_MAP(start>>16,MOBO_RAM_END>>16,mbsh_bank); // Mother Board RAM copy
+}
+// after the MMU table is finished
+void mobo_ram_shadow_load(void)
+{
+   uint32_t start=bus_shadow_start;
+   if(mobo_ram_shadow==SHADOW_NO)
+      return;
+   if(bus_copy_from_amiga((uint8_t *)start,start,MOBO_RAM_END-start)!=MOBO_RAM_END-start)
+      z3660_printf("[Core1] Motherboard RAM shadow: bus error loading the copy\n");
+   z3660_printf("[Core1] Motherboard RAM shadow 0x%08lX-0x%08lX %s\n",start,MOBO_RAM_END-1,
+      mobo_ram_shadow==SHADOW_WRITEBACK?"WRITEBACK":"WRITETHROUGH");
+}
+// the request is cleared when the board is written, core0 waits for it
+void mobo_ram_writeback(void)
+{
+   uint32_t start=bus_shadow_start;
+   if(mobo_ram_shadow==SHADOW_WRITEBACK)
+   {
+      if(bus_copy_to_amiga(start,(const uint8_t *)start,MOBO_RAM_END-start)!=MOBO_RAM_END-start)
+         z3660_printf("[Core1] Motherboard RAM shadow: bus error writing back\n");
+      else
+         z3660_printf("[Core1] Motherboard RAM written back\n");
+   }
+   shared->mobo_ram_writeback=0;
+}
 int maxcycles = 64*512; //256*512
 extern void init_mem_banks (void);
 extern void finish_Attributes(void);
@@ -648,6 +852,7 @@ extern "C" void make_dummy_address_bank(uint32_t address)
 void uae_emulator(int enable_jit)
 {
    z3660_printf("[Core1] Starting UAE%s emulator\n",enable_jit?"JIT":"");
+   bus_timing_check();
    currprefs.cpu_model              = changed_prefs.cpu_model=68040;
    currprefs.fpu_model              = changed_prefs.fpu_model=68040;
    currprefs.mmu_model              = changed_prefs.mmu_model=68040;
@@ -717,6 +922,7 @@ void uae_emulator(int enable_jit)
       RANGE_MAP(0x00F0,0x00F8,slow_bank);//mobo_bank); // Mother Board bank ( Mobo ROM )
    }
    RANGE_MAP(0x0100,0x0800,dmmy_bank);//mbrm_bank); // Mother Board bank ( Mother board RAM )
+   mobo_ram_shadow_init();
    RANGE_MAP(0x0800,0x1000,drct_bank); // Direct bank ( CPU RAM )
    RANGE_MAP(0x1000,0x1800,dflt_bank); // Direct bank ( extended CPU RAM )
    RANGE_MAP(0x1800,0x4000,dmmy_bank); // Slow bank ( Z3 Expansion space )
@@ -728,6 +934,7 @@ void uae_emulator(int enable_jit)
    ptr[0x00F]=((uint32_t)&MMUL2Table)|0x1E1;
 
    finish_Attributes();
+   mobo_ram_shadow_load();
 #ifdef SHOW_MMU_TABLES
    {
    	printf("Core 1 MMUTable 0x%08lX\n",(uint32_t)(&MMUTable));
@@ -783,6 +990,10 @@ void z3660_tasks(void)
    static long int count=1000000;
    if(--count>0) return;
    count=1000000;
+   bus_timing_check();
+   if(shared->mobo_ram_writeback)
+      mobo_ram_writeback();
+   jit_profile_tasks();
    int jit_enabled=shared->jit_enabled;
    if(jit_enabled!=jit_enabled_last)
    {
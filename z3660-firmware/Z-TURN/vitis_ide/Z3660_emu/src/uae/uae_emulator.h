@@ -9,6 +9,9 @@
 #define SRC_UAE_UAE_EMULATOR_H_
 
 void uae_emulator(int enable_jit);
+void mobo_ram_shadow_init(void);
+void mobo_ram_shadow_load(void);
+void mobo_ram_writeback(void);
 
 
 #endif /* SRC_UAE_UAE_EMULATOR_H_ */
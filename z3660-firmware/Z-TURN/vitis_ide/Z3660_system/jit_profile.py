@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+#
+# Summary of z3660_jit_profile.bin, the JIT hot block profile saved to the
+# SD card by the 'JPS' debug console command.
+# The format is described in Z3660_emu/src/uae/jit/compemu_profile.h
+#
+# usage: jit_profile.py [-n 20] [--csv] z3660_jit_profile.bin
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x504A335A  # "Z3JP"
+VERSION = 1
+
+HEADER = struct.Struct("<8I2Q")
+BLOCK = struct.Struct("<IIQHBBI")
+
+FLAG_ROM = 0x01
+FLAG_TRACKED = 0x02
+
+# 68k address ranges of the Z3660 memory map
+REGIONS = (
+    (0x00000000, 0x00200000, "chip"),
+    (0x00F00000, 0x00F80000, "ext rom"),
+    (0x00F80000, 0x01000000, "rom"),
+    (0x07000000, 0x08000000, "mobo"),
+    (0x08000000, 0x18000000, "fast"),
+    (0x40000000, 0x80000000, "z3"),
+)
+
+
+class ProfileError(Exception):
+    pass
+
+
+def parse(data):
+    if len(data) < HEADER.size:
+        raise ProfileError("file too short for the header")
+    (magic, version, count, dropped, compiles, recompiles, promotions,
+     flushes, compile_us, elapsed_us) = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        raise ProfileError("bad magic 0x%08X" % magic)
+    if version != VERSION:
+        raise ProfileError("unknown version %d" % version)
+    if len(data) != HEADER.size + count * BLOCK.size:
+        raise ProfileError("%d bytes for %d blocks" % (len(data), count))
+    header = {
+        "count": count,
+        "dropped": dropped,
+        "compiles": compiles,
+        "recompiles": recompiles,
+        "promotions": promotions,
+        "flushes": flushes,
+        "compile_us": compile_us,
+        "elapsed_us": elapsed_us,
+    }
+    blocks = []
+    for i in range(count):
+        pc, bcompiles, execs, insns, optlevel, flags, native = \
+            BLOCK.unpack_from(data, HEADER.size + i * BLOCK.size)
+        blocks.append({
+            "pc": pc,
+            "compiles": bcompiles,
+            "execs": execs,
+            "insns": insns,
+            "optlevel": optlevel,
+            "flags": flags,
+            "native": native,
+            "run": execs * insns,
+        })
+    return header, blocks
+
+
+def region(pc):
+    for start, end, name in REGIONS:
+        if start <= pc < end:
+            return name
+    return "other"
+
+
+def percent(part, total):
+    return 100.0 * part / total if total else 0.0
+
+
+def summarise(header, blocks, top=20):
+    total = sum(b["run"] for b in blocks)
+    regions = {}
+    levels = {}
+    for b in blocks:
+        r = regions.setdefault(region(b["pc"]), [0, 0])
+        r[0] += 1
+        r[1] += b["run"]
+        levels[b["optlevel"]] = levels.get(b["optlevel"], 0) + b["run"]
+    hot = sorted(blocks, key=lambda b: b["run"], reverse=True)[:top]
+    churn = sorted((b for b in blocks if b["compiles"] > 1),
+                   key=lambda b: (b["compiles"], b["run"]), reverse=True)[:top]
+    return {
+        "total": total,
+        "regions": regions,
+        "levels": levels,
+        "hot": hot,
+        "churn": churn,
+    }
+
+
+def report(header, summary, out):
+    total = summary["total"]
+    elapsed = header["elapsed_us"]
+    out.write("%d blocks in %.1f s, %d not counted\n" % (
+        header["count"], elapsed / 1e6, header["dropped"]))
+    out.write("%d compiles, %d recompiles, %d promotions, %d hard flushes\n" % (
+        header["compiles"], header["recompiles"], header["promotions"],
+        header["flushes"]))
+    out.write("compiling %.3f s (%.1f%%)\n" % (
+        header["compile_us"] / 1e6, percent(header["compile_us"], elapsed)))
+    out.write("%d 68k instructions run in compiled blocks\n\n" % total)
+
+    out.write("region      blocks  insns run\n")
+    for name, (count, run) in sorted(summary["regions"].items(),
+                                     key=lambda r: r[1][1], reverse=True):
+        out.write("%-8s %9d  %5.1f%%\n" % (name, count, percent(run, total)))
+    out.write("\nopt level  insns run\n")
+    for level, run in sorted(summary["levels"].items()):
+        out.write("%9d  %5.1f%%\n" % (level, percent(run, total)))
+
+    out.write("\n  # 68k addr         runs  insns     insns run      %  comp opt region\n")
+    for i, b in enumerate(summary["hot"]):
+        out.write("%3d %08X %12d %6d %13d %5.1f %5d %3d %s%s\n" % (
+            i + 1, b["pc"], b["execs"], b["insns"], b["run"],
+            percent(b["run"], total), b["compiles"], b["optlevel"],
+            region(b["pc"]), "" if b["flags"] & FLAG_TRACKED else " untracked"))
+
+    if summary["churn"]:
+        out.write("\nmost compiled\n")
+        out.write("  # 68k addr  comp opt         runs region\n")
+        for i, b in enumerate(summary["churn"]):
+            out.write("%3d %08X %5d %3d %12d %s\n" % (
+                i + 1, b["pc"], b["compiles"], b["optlevel"], b["execs"],
+                region(b["pc"])))
+
+
+def write_csv(blocks, out):
+    out.write("pc,execs,insns,run,compiles,optlevel,native,rom,tracked\n")
+    for b in sorted(blocks, key=lambda b: b["run"], reverse=True):
+        out.write("0x%08X,%d,%d,%d,%d,%d,%d,%d,%d\n" % (
+            b["pc"], b["execs"], b["insns"], b["run"], b["compiles"],
+            b["optlevel"], b["native"], 1 if b["flags"] & FLAG_ROM else 0,
+            1 if b["flags"] & FLAG_TRACKED else 0))
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Z3660 JIT hot block profile")
+    parser.add_argument("file")
+    parser.add_argument("-n", type=int, default=20, help="blocks listed")
+    parser.add_argument("--csv", action="store_true", help="all blocks as CSV")
+    args = parser.parse_args(argv)
+
+    with open(args.file, "rb") as f:
+        data = f.read()
+    try:
+        header, blocks = parse(data)
+    except ProfileError as e:
+        sys.stderr.write("%s: %s\n" % (args.file, e))
+        return 1
+    if args.csv:
+        write_csv(blocks, sys.stdout)
+    else:
+        report(header, summarise(header, blocks, args.n), sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,397 @@
+/*
+ * ax_mixer_test.c
+ *
+ *  Compares ax_mixer_render() with a reference mixer written the plain way,
+ *  one output frame at a time, for looping, one-shot, backwards and double
+ *  buffered sounds and AHISF_IMM changes. The driver side (the SoundFunc
+ *  queueing the next buffer) is played by the test.
+ *
+ *  Built twice by the Makefile: with the C kernel and with the NEON one
+ *  (host stand-in of the intrinsics in stub/neon).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "ax_mixer.h"
+#include "memorymap.h"
+
+#define BE(x) __builtin_bswap32(x)
+#define MAX_FRAMES (AUDIO_BYTES_PER_PERIOD/4)
+#define CHANNELS 12
+#define SOUNDS 24
+
+void DEBUG_AUDIO(const char *format, ...)
+{
+   (void)format;
+}
+
+static volatile AX_MIXER_CMD* cmd;
+static uint8_t* pool;
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+/* ---- reference mixer ---- */
+
+typedef struct {
+   int active;
+   const uint8_t* data;
+   uint32_t type;
+   uint32_t length;
+   int dir;
+   uint64_t pos;          // 16.16 frames
+   uint32_t freq;
+   int32_t volume;
+   uint32_t pan;
+   uint32_t sound_seq, freq_seq, vol_seq;
+   uint32_t started;
+} REF_VOICE;
+
+static REF_VOICE ref[AX_MIXER_MAX_CHANNELS];
+
+static int16_t be16(const uint8_t* p)
+{
+   return (int16_t)((p[0] << 8) | p[1]);
+}
+
+static void ref_frame(const REF_VOICE* v, int32_t idx, int32_t* l, int32_t* r)
+{
+   switch (v->type) {
+   case AX_MIXER_TYPE_M8S:  *l = *r = (int8_t)v->data[idx] * 256; break;
+   case AX_MIXER_TYPE_M16S: *l = *r = be16(v->data + idx * 2); break;
+   case AX_MIXER_TYPE_S8S:  *l = (int8_t)v->data[idx * 2] * 256; *r = (int8_t)v->data[idx * 2 + 1] * 256; break;
+   default:                 *l = be16(v->data + idx * 4); *r = be16(v->data + idx * 4 + 2); break;
+   }
+}
+
+// AHI Fixed volume and pan to the Q14 gain of one side
+static int32_t ref_gain(const REF_VOICE* v, int32_t master, int right)
+{
+   int64_t vol = ((int64_t)v->volume * master) >> 16;
+   int64_t pan = v->pan > 0x10000 ? 0x10000 : v->pan;
+   int64_t side = right ? pan : 0x10000 - pan;
+   int stereo = v->type == AX_MIXER_TYPE_S8S || v->type == AX_MIXER_TYPE_S16S;
+
+   if (stereo)
+      side = side * 2 > 0x10000 ? 0x10000 : side * 2;
+   int64_t g = ((vol * side) >> 16) >> 2;
+   return g > 32767 ? 32767 : g < -32768 ? -32768 : (int32_t)g;
+}
+
+static void ref_start(REF_VOICE* v, volatile AX_MIXER_CHANNEL* c, int queued)
+{
+   int32_t length = (int32_t)BE(c->next_length);
+   uint32_t offset = BE(c->next_offset);
+
+   if (queued) {
+      v->freq = BE(c->next_freq);
+      v->volume = (int32_t)BE(c->next_volume);
+      v->pan = BE(c->next_pan);
+   }
+   v->active = offset != AX_MIXER_NOSOUND && length != 0;
+   if (v->active) {
+      v->data = (const uint8_t*)(uintptr_t)(RTG_BASE + offset);
+      v->type = BE(c->next_type);
+      v->length = length < 0 ? -length : length;
+      v->dir = length < 0 ? -1 : 1;
+   }
+}
+
+static void ref_render(int16_t* out, int frames, int mix_freq)
+{
+   int32_t master = (int32_t)BE(cmd->master_volume);
+   int n = BE(cmd->num_channels);
+
+   for (int i = 0; i < n; i++) {
+      volatile AX_MIXER_CHANNEL* c = &cmd->ch[i];
+      REF_VOICE* v = &ref[i];
+
+      if (BE(c->freq_seq) != v->freq_seq) {
+         v->freq_seq = BE(c->freq_seq);
+         v->freq = BE(c->freq);
+      }
+      if (BE(c->vol_seq) != v->vol_seq) {
+         v->vol_seq = BE(c->vol_seq);
+         v->volume = (int32_t)BE(c->volume);
+         v->pan = BE(c->pan);
+      }
+      if (BE(c->sound_seq) != v->sound_seq) {
+         v->sound_seq = BE(c->sound_seq);
+         v->pos = 0;
+         ref_start(v, c, 0);
+      }
+   }
+   for (int f = 0; f < frames; f++) {
+      int32_t acc[2] = { 0, 0 };
+
+      for (int i = 0; i < n; i++) {
+         REF_VOICE* v = &ref[i];
+         int32_t s[2];
+
+         if (!v->active)
+            continue;
+         ref_frame(v, v->dir * (int32_t)(v->pos >> 16), &s[0], &s[1]);
+         acc[0] += (s[0] * ref_gain(v, master, 0)) >> 14;
+         acc[1] += (s[1] * ref_gain(v, master, 1)) >> 14;
+         v->pos += ((uint64_t)v->freq << 16) / mix_freq;
+         if ((v->pos >> 16) >= v->length) {
+            uint64_t over = v->pos - ((uint64_t)v->length << 16);
+
+            ref_start(v, &cmd->ch[i], 1);
+            v->started++;
+            if (v->active)
+               v->pos = (((over >> 16) % v->length) << 16) | (over & 0xFFFF);
+         }
+      }
+      for (int k = 0; k < 2; k++)
+         out[f * 2 + k] = acc[k] > 32767 ? 32767 : acc[k] < -32768 ? -32768 : acc[k];
+   }
+}
+
+/* ---- sounds and the driver side ---- */
+
+typedef struct {
+   uint32_t offset;       // card offset of frame 0
+   uint32_t type;
+   uint32_t frames;
+} SOUND;
+
+static SOUND sounds[SOUNDS];
+static const uint32_t frame_bytes[AX_MIXER_TYPE_NUM] = { 1, 2, 2, 4 };
+
+enum { MODE_LOOP, MODE_ONESHOT, MODE_DOUBLE, MODE_BACKWARDS };
+
+typedef struct {
+   int mode;
+   int sound[2];          // double buffering plays them in turn
+   int playing;
+   uint32_t started;
+} PLAYER;
+
+static PLAYER players[AX_MIXER_MAX_CHANNELS];
+
+static void make_sounds(void)
+{
+   uint32_t top = AUDIO_MIXER_SAMPLE_ADDRESS;
+
+   for (int i = 0; i < SOUNDS; i++) {
+      SOUND* s = &sounds[i];
+      s->type = rand() % AX_MIXER_TYPE_NUM;
+      s->frames = i == 0 ? 1 : 1 + rand() % (i < 4 ? 8 : 3000);
+      s->offset = top;
+      top += (s->frames * frame_bytes[s->type] + 15) & ~15;
+      for (uint32_t b = 0; b < s->frames * frame_bytes[s->type]; b++)
+         pool[s->offset - AUDIO_MIXER_SAMPLE_ADDRESS + b] = rand();
+   }
+}
+
+// like intAHIsub_SetSound(): the whole sound, backwards from its last frame
+static void queue_sound(volatile AX_MIXER_CHANNEL* c, int sound, int backwards)
+{
+   if (sound < 0) {
+      c->next_offset = BE(AX_MIXER_NOSOUND);
+      return;
+   }
+   SOUND* s = &sounds[sound];
+   if (backwards) {
+      c->next_offset = BE(s->offset + (s->frames - 1) * frame_bytes[s->type]);
+      c->next_length = BE(-(int32_t)s->frames);
+   } else {
+      c->next_offset = BE(s->offset);
+      c->next_length = BE(s->frames);
+   }
+   c->next_type = BE(s->type);
+}
+
+static uint32_t random_freq(void)
+{
+   static const uint32_t f[] = { 0, 8000, 11025, 22050, 44100, 48000, 96000, 200000 };
+   return f[rand() % 8] + (rand() % 3 == 0 ? rand() % 1000 : 0);
+}
+
+static void set_queued_params(volatile AX_MIXER_CHANNEL* c)
+{
+   c->next_freq = BE(random_freq());
+   c->next_volume = BE(rand() % 4 == 0 ? -(rand() % 0x18000) : rand() % 0x18000);
+   c->next_pan = BE(rand() % 0x12000);
+}
+
+static void start_channel(int i)
+{
+   volatile AX_MIXER_CHANNEL* c = &cmd->ch[i];
+   PLAYER* p = &players[i];
+
+   p->mode = rand() % 4;
+   p->sound[0] = rand() % SOUNDS;
+   p->sound[1] = rand() % SOUNDS;
+   p->playing = 0;
+   set_queued_params(c);
+   queue_sound(c, p->sound[0], p->mode == MODE_BACKWARDS);
+   c->freq = c->next_freq;
+   c->volume = c->next_volume;
+   c->pan = c->next_pan;
+   c->freq_seq = BE(BE(c->freq_seq) + 1);
+   c->vol_seq = BE(BE(c->vol_seq) + 1);
+   c->sound_seq = BE(BE(c->sound_seq) + 1);
+   // what plays when it ends
+   switch (p->mode) {
+   case MODE_ONESHOT: queue_sound(c, -1, 0); break;
+   case MODE_DOUBLE: queue_sound(c, p->sound[1], 0); break;
+   default: break;   // loops on itself
+   }
+}
+
+// the SoundFunc of the player: a queued sound started on channel i
+static void sound_func(int i)
+{
+   volatile AX_MIXER_CHANNEL* c = &cmd->ch[i];
+   PLAYER* p = &players[i];
+
+   if (p->mode == MODE_DOUBLE) {
+      queue_sound(c, p->sound[p->playing], 0);
+      p->playing ^= 1;
+   }
+   if (rand() % 8 == 0)
+      set_queued_params(c);
+}
+
+static void imm_change(int i)
+{
+   volatile AX_MIXER_CHANNEL* c = &cmd->ch[i];
+
+   switch (rand() % 3) {
+   case 0:
+      c->freq = BE(random_freq());
+      c->freq_seq = BE(BE(c->freq_seq) + 1);
+      break;
+   case 1:
+      c->volume = BE(rand() % 0x10000);
+      c->pan = BE(rand() % 0x10001);
+      c->vol_seq = BE(BE(c->vol_seq) + 1);
+      break;
+   default:
+      start_channel(i);
+      break;
+   }
+}
+
+/* ---- tests ---- */
+
+static void reset(int channels)
+{
+   memset((void*)cmd, 0, sizeof(*cmd));
+   memset(ref, 0, sizeof(ref));
+   memset(players, 0, sizeof(players));
+   for (int i = 0; i < AX_MIXER_MAX_CHANNELS; i++)
+      cmd->ch[i].next_offset = BE(AX_MIXER_NOSOUND);
+   cmd->num_channels = BE(channels);
+   cmd->master_volume = BE(0x10000);
+   ax_mixer_set_cmd_block((uint8_t*)cmd);
+}
+
+static void test_random(int seed)
+{
+   static int16_t out[MAX_FRAMES * 2], expect[MAX_FRAMES * 2];
+   static const int mix_freqs[] = { 22050, 44100, 48000 };
+   long frames_total = 0, starts = 0;
+
+   srand(seed);
+   reset(1 + rand() % CHANNELS);
+   int channels = BE(cmd->num_channels);
+   int mix_freq = mix_freqs[rand() % 3];
+   cmd->master_volume = BE(0x4000 + rand() % 0x10000);
+   for (int i = 0; i < channels; i++)
+      start_channel(i);
+
+   for (int period = 0; period < 400; period++) {
+      int frames = rand() % 4 == 0 ? 1 + rand() % MAX_FRAMES : mix_freq / 50;
+
+      ax_mixer_render(out, frames, mix_freq);
+      ref_render(expect, frames, mix_freq);
+      frames_total += frames;
+
+      int first = -1;
+      for (int k = 0; k < frames * 2 && first < 0; k++)
+         if (out[k] != expect[k])
+            first = k;
+      CHECK(first < 0, "seed %d period %d: frame %d is %d, expected %d", seed, period,
+            first / 2, out[first < 0 ? 0 : first], expect[first < 0 ? 0 : first]);
+      if (first >= 0)
+         return;
+
+      // the driver side: SoundFunc for the queued sounds that started
+      uint32_t mask = BE(cmd->started_mask);
+      for (int i = 0; i < channels; i++) {
+         uint32_t started = BE(cmd->sound_started[i]);
+         CHECK(!!(mask & (1u << i)) == (started != players[i].started),
+               "seed %d: started_mask %08x for channel %d", seed, mask, i);
+         CHECK(started == ref[i].started, "seed %d channel %d: %u starts, expected %u",
+               seed, i, started, ref[i].started);
+         while (players[i].started != started) {
+            players[i].started++;
+            starts++;
+            sound_func(i);
+         }
+      }
+      if (rand() % 6 == 0)
+         imm_change(rand() % channels);
+   }
+   if (seed == 1)
+      printf("seed 1: %d channels, %ld frames at %d Hz, %ld queued sounds started\n",
+             channels, frames_total, mix_freq, starts);
+}
+
+// a sound outside of the sample pool never plays
+static void test_illegal(void)
+{
+   static int16_t out[MAX_FRAMES * 2];
+   static const struct { uint32_t offset; int32_t length; } bad[] = {
+      { AUDIO_MIXER_SAMPLE_ADDRESS - 2, 100 },
+      { AUDIO_MIXER_SAMPLE_ADDRESS + AUDIO_MIXER_SAMPLE_SIZE - 4, 3 },
+      { AUDIO_MIXER_SAMPLE_ADDRESS + 2, -3 },
+      { AUDIO_MIXER_SAMPLE_ADDRESS, 0x7FFFFFFF },
+      { 0, 16 },
+   };
+
+   for (int b = 0; b < (int)(sizeof(bad) / sizeof(bad[0])); b++) {
+      reset(1);
+      volatile AX_MIXER_CHANNEL* c = &cmd->ch[0];
+      c->freq = BE(48000);
+      c->volume = BE(0x10000);
+      c->pan = BE(0x8000);
+      c->next_offset = BE(bad[b].offset);
+      c->next_type = BE(AX_MIXER_TYPE_S16S);
+      c->next_length = BE(bad[b].length);
+      c->freq_seq = c->vol_seq = c->sound_seq = BE(1);
+      memset(pool, 0x55, 64);
+      ax_mixer_render(out, 64, 48000);
+      int silent = 1;
+      for (int k = 0; k < 128; k++)
+         silent &= out[k] == 0;
+      CHECK(silent, "illegal sound %d played", b);
+   }
+}
+
+int main(void)
+{
+   uint8_t* base = mmap((void*)(uintptr_t)(RTG_BASE + AUDIO_MIXER_SAMPLE_ADDRESS), 0x1000000,
+                        PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (base == MAP_FAILED) {
+      perror("mmap");
+      return 2;
+   }
+   pool = base;
+   cmd = (volatile AX_MIXER_CMD*)(uintptr_t)(RTG_BASE + AUDIO_MIXER_CMD_ADDRESS);
+
+   srand(7);
+   make_sounds();
+   for (int seed = 1; seed <= 60; seed++)
+      test_random(seed);
+   test_illegal();
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return failures != 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * bus_copy_test.cc
+ *
+ *  The block transfers of cpu_emulator.cc (bus_copy_to_amiga(),
+ *  bus_copy_from_amiga()) on the mock bus of bus_host.cc, random blocks of
+ *  chip RAM at every alignment:
+ *  - the bytes arrive, the fewest aligned cycles: a byte and/or a word up
+ *    to a longword, longwords, a word and/or a byte
+ *  - a bus error in the block: the copy stops at the cycle that had it and
+ *    returns the bytes before it, nothing after it is written
+ *  - a write combined by ps_write_*() is on the bus before a copy starts
+ *  - bus_amiga_ram() takes chip RAM and the board's fast RAM below
+ *    bus_shadow_start, not the custom chips, an empty block or one running
+ *    out of RAM
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bus_host.h"
+
+extern "C" {
+void ps_write_8(unsigned int address, unsigned int value);
+void ps_write_flush(void);
+int bus_amiga_ram(uint32_t address, uint32_t len);
+uint32_t bus_copy_to_amiga(uint32_t address, const uint8_t *src, uint32_t len);
+uint32_t bus_copy_from_amiga(uint8_t *dst, uint32_t address, uint32_t len);
+}
+extern uint32_t bus_shadow_start;
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+// the cycles of a block, up to the one holding stop: their count and the bytes before that one
+static uint32_t plan(uint32_t a, uint32_t len, uint32_t stop, uint32_t *before)
+{
+   uint32_t cycles = 0, x = a;
+   *before = len;
+   while (x < a + len) {
+      uint32_t left = a + len - x;
+      uint32_t n = ((x & 3) == 0 && left >= 4) ? 4 : ((x & 1) == 0 && left >= 2) ? 2 : 1;
+      cycles++;
+      if (stop >= x && stop < x + n) {
+         *before = x - a;
+         break;
+      }
+      x += n;
+   }
+   return(cycles);
+}
+
+static void test_random(void)
+{
+   uint8_t src[512], dst[512];
+
+   srand(43);
+   for (int r = 0; r < 20000; r++) {
+      uint32_t a = 0x1000 + rand() % 64, len = rand() % 300;
+      int to = rand() & 1;
+      uint32_t berr = (rand() % 4 == 0 && len) ? a + rand() % len : 0xFFFFFFFF;
+      uint8_t *ram = bus_host_ram(a);
+      for (uint32_t i = 0; i < sizeof(src); i++)
+         src[i] = rand();
+      memset(dst, 0xEE, sizeof(dst));
+      if (to)
+         memset(ram, 0xEE, len);
+      else
+         memcpy(ram, src, len);
+      ps_write_flush();
+      bus_host_idle();
+      bus_host_reset();
+      bus_host_berr_start = berr;
+      bus_host_berr_end = berr + 1;
+
+      uint32_t got = to ? bus_copy_to_amiga(a, src, len) : bus_copy_from_amiga(dst, a, len);
+      bus_host_idle();
+      uint32_t want, cycles = plan(a, len, berr, &want);
+      if (got != want) {
+         CHECK(0, "round %d: %u bytes copied %s 0x%08x, %u expected (%u bytes, bus error at 0x%08x)", r, got,
+               to ? "to" : "from", a, want, len, berr);
+         return;
+      }
+      if (bus_host_cycles != cycles || bus_host_misaligned) {
+         CHECK(0, "round %d: %u cycles (%u misaligned), %u expected", r, bus_host_cycles, bus_host_misaligned, cycles);
+         return;
+      }
+      uint32_t bad = 0;
+      for (uint32_t i = 0; i < len; i++)
+         if (to)
+            bad += ram[i] != (i < got ? src[i] : 0xEE);
+         else
+            bad += i < got && dst[i] != src[i];
+      if (bad) {
+         CHECK(0, "round %d: %u bytes wrong copying %s 0x%08x", r, bad, to ? "to" : "from", a);
+         return;
+      }
+   }
+   bus_host_reset();
+}
+
+static void test_combined(void)
+{
+   uint8_t b[4];
+
+   bus_host_ram(0x2000)[1] = 0;
+   ps_write_8(0x2001, 0x5A);
+   CHECK(bus_copy_from_amiga(b, 0x2000, 4) == 4 && b[1] == 0x5A, "combined write not on the bus first");
+}
+
+static void test_ram(void)
+{
+   CHECK(bus_amiga_ram(0x001FFFF0, 16), "end of chip RAM");
+   CHECK(!bus_amiga_ram(0x001FFFF8, 16), "past chip RAM");
+   CHECK(!bus_amiga_ram(0x00BFE001, 1), "CIA");
+   CHECK(!bus_amiga_ram(0x00001000, 0), "empty block");
+   CHECK(!bus_amiga_ram(0xFFFFFFF0, 0x20), "block wrapping around");
+   bus_shadow_start = 0x07800000;
+   CHECK(bus_amiga_ram(0x07000000, 16), "board fast RAM");
+   CHECK(!bus_amiga_ram(0x077FFFF0, 32), "into the shadowed RAM");
+   CHECK(!bus_amiga_ram(0x07800000, 16), "shadowed RAM");
+   bus_shadow_start = 0x08000000;
+   CHECK(bus_amiga_ram(0x07FFFFF0, 16), "end of the board fast RAM");
+}
+
+int main(int argc, char **argv)
+{
+   bus_host_reset();
+   test_random();
+   test_combined();
+   test_ram();
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
@@ -0,0 +1,205 @@
+/*
+ * bus_host.cc
+ *
+ *  The mock motherboard bus of bus_host.h and what else cpu_emulator.cc
+ *  needs on the host: Musashi, core0 and the UAE banks, as stand-ins doing
+ *  nothing.
+ *
+ *  A cycle starts with a write to a bus window and is acked its latency
+ *  ticks later, at the first poll of the status register after that. The
+ *  status of the last cycle is still read for bus_host_stale ticks after
+ *  the start of a read: the data register then has the last data. A poll
+ *  that saw no ack needs bus_host_settle ticks before the next one, or the
+ *  cycle is lost, as it is when the next cycle starts before the ack.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "bus_host.h"
+#include "main.h"
+
+BUS_HOST_CYCLE bus_host_log[BUS_HOST_LOG];
+uint32_t bus_host_cycles;
+uint32_t bus_host_misaligned;
+uint64_t bus_host_time;
+uint32_t bus_host_latency;
+uint32_t (*bus_host_latency_at)(uint32_t address);
+uint32_t bus_host_stale;
+uint32_t bus_host_settle;
+uint32_t bus_host_berr_start, bus_host_berr_end;
+void (*bus_host_cycle_hook)(const BUS_HOST_CYCLE *c);
+int bus_host_ipl;
+
+static uint8_t chip[HOST_CHIP_SIZE];
+static uint8_t fast[HOST_MOBO_END - HOST_MOBO_START];
+
+static uint32_t bank;
+static uint32_t status = 1, data_reg;
+static struct {
+   int running;
+   int lost;
+   uint64_t start, busy_poll;
+   uint32_t latency;
+   BUS_HOST_CYCLE c;
+   uint32_t n;         // in the log
+} cur;
+
+uint8_t *bus_host_ram(uint32_t address)
+{
+   if (address < HOST_CHIP_SIZE)
+      return(chip + address);
+   if (address >= HOST_MOBO_START && address < HOST_MOBO_END)
+      return(fast + address - HOST_MOBO_START);
+   return(NULL);
+}
+
+void bus_host_reset(void)
+{
+   bus_host_cycles = 0;
+   bus_host_misaligned = 0;
+   bus_host_latency = 4;
+   bus_host_latency_at = NULL;
+   bus_host_stale = 0;
+   bus_host_settle = 0;
+   bus_host_berr_start = bus_host_berr_end = 0;
+   bus_host_cycle_hook = NULL;
+   cur.running = 0;
+   status = 1;
+}
+
+static void finish(void)
+{
+   BUS_HOST_CYCLE *c = &cur.c;
+   cur.running = 0;
+   if (cur.lost)
+      c->status = 0;
+   else if (c->address + c->size > bus_host_berr_start && c->address < bus_host_berr_end)
+      c->status = 2;
+   else {
+      c->status = 1;
+      if (!c->write)
+         c->data = 0;
+      for (int i = 0; i < c->size; i++) {
+         uint8_t *p = bus_host_ram(c->address + i);
+         int shift = 24 - 8 * ((c->address + i) & 3);
+         if (c->write) {
+            if (p)
+               *p = c->data >> shift;
+         } else
+            c->data |= (p ? *p : 0xFF) << shift;
+      }
+      if (!c->write)
+         data_reg = c->data;
+   }
+   status = c->status ? c->status : 1;
+   if (cur.n < BUS_HOST_LOG)
+      bus_host_log[cur.n] = *c;
+}
+
+static void start(int size, uint32_t offset, uint32_t data, int write)
+{
+   bus_host_time++;
+   if (cur.running) {
+      if (bus_host_time < cur.start + cur.latency)
+         cur.lost = 1;
+      finish();
+   }
+   cur.running = 1;
+   cur.lost = 0;
+   cur.start = bus_host_time;
+   cur.busy_poll = 0;
+   cur.c.address = (bank << 24) | (offset & 0x00FFFFFF);
+   cur.c.data = data;
+   cur.c.size = size;
+   cur.c.write = write;
+   cur.c.status = 0;
+   cur.latency = bus_host_latency_at ? bus_host_latency_at(cur.c.address) : bus_host_latency;
+   cur.n = bus_host_cycles++;
+   if (cur.n < BUS_HOST_LOG)
+      bus_host_log[cur.n] = cur.c;
+   if ((size == 2 && (cur.c.address & 1)) || (size == 4 && (cur.c.address & 3)))
+      bus_host_misaligned++;
+   if (bus_host_cycle_hook)
+      bus_host_cycle_hook(&cur.c);
+}
+
+void bus_host_idle(void)
+{
+   bus_host_time += cur.latency;
+   if (cur.running)
+      finish();
+}
+
+void bus_host_nop(void)
+{
+   bus_host_time++;
+}
+
+void bus_host_write_reg(uint32_t offset, uint32_t data)
+{
+   bus_host_time++;
+   if (offset == 0x18)
+      bank = data & 0xFF;
+}
+
+uint32_t bus_host_read_reg(uint32_t offset)
+{
+   bus_host_time++;
+   if (offset == 0x1C)
+      return(data_reg);
+   if (offset != 0x14)
+      return(0);
+   if (!cur.running)
+      return(status);
+   if (bus_host_time >= cur.start + cur.latency) {
+      finish();
+      return(status);
+   }
+   if (!cur.c.write && bus_host_time <= cur.start + bus_host_stale)
+      return(status);
+   if (cur.busy_poll && bus_host_time < cur.busy_poll + bus_host_settle)
+      cur.lost = 1;
+   cur.busy_poll = bus_host_time;
+   return(0);
+}
+
+void bus_host_write_mem(int size, uint32_t offset, uint32_t data)
+{
+   start(size, offset, data, 1);
+}
+
+void bus_host_read_mem(int size, uint32_t offset)
+{
+   start(size, offset, 0, 0);
+}
+
+// core0 and the rest of core1
+static SHARED host_shared;
+SHARED *shared = &host_shared;
+LOCAL local;
+uint32_t MMUTable;
+
+extern "C" {
+unsigned int READ_NBG_ARM(void) { return(0); }
+void cpu_emulator_reset_core0(void) {}
+void init_ovl_chip_ram_bank(void) {}
+void init_rtg_bank(unsigned int ini) {}
+void init_z3_ram_bank(unsigned int ini) {}
+int intlev(void) { return(bus_host_ipl); }
+uint32_t read_rtg_register(uint16_t zaddr) { return(0); }
+void write_rtg_register(uint16_t zaddr, uint32_t zdata) {}
+uint32_t read_scsi_register(uint16_t zaddr, int type) { return(0); }
+void write_scsi_register(uint16_t zaddr, uint32_t zdata, int type) {}
+void z3660_printf(const char *format, ...) {}
+unsigned int m68k_disassemble(char *str_buff, unsigned int pc, unsigned int cpu_type) { return(0); }
+#ifndef BUS_HOST_MUSASHI
+void m68k_dcache_flush(void) {}
+int m68k_execute(int num_cycles) { return(num_cycles); }
+unsigned int m68k_get_reg(void *context, int reg) { return(0); }
+void m68k_init(void) {}
+void m68k_pulse_reset(void) {}
+void m68k_set_cpu_type(unsigned int cpu_type) {}
+void m68k_set_irq(unsigned int int_level) {}
+#endif
+}
@@ -0,0 +1,72 @@
+/*
+ * bus_host.h
+ *
+ *  The tests of the motherboard bus code of cpu_emulator.cc build it with
+ *  this header first: the FPGA registers and the bus windows of main.h and
+ *  the NOPs of the delays go to the mock bus of bus_host.cc. The mock runs
+ *  one cycle at a time on chip RAM and the board's fast RAM, keeps a log of
+ *  the cycles and has a clock (one tick per NOP or register access) for the
+ *  acks and the delays. Built with BUS_HOST_MUSASHI, it leaves Musashi to
+ *  the real one.
+ */
+
+#ifndef BUS_HOST_H_
+#define BUS_HOST_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HOST_CHIP_SIZE  0x00200000
+#define HOST_MOBO_START 0x07000000
+#define HOST_MOBO_END   0x08000000
+
+typedef struct {
+   uint32_t address;  // the whole address, bank register and window
+   uint32_t data;     // bus lanes
+   uint8_t size;      // 1, 2 or 4
+   uint8_t write;
+   uint8_t status;    // when it ends: 1 acked, 2 bus error, 0 lost (or still running)
+} BUS_HOST_CYCLE;
+
+#define BUS_HOST_LOG 4096
+extern BUS_HOST_CYCLE bus_host_log[BUS_HOST_LOG];
+extern uint32_t bus_host_cycles;     // cycles started, the log keeps the first BUS_HOST_LOG
+extern uint32_t bus_host_misaligned; // words at odd addresses and longs not on a longword
+
+extern uint64_t bus_host_time;
+extern uint32_t bus_host_latency;    // ticks from the start of a cycle to its ack
+extern uint32_t (*bus_host_latency_at)(uint32_t address);  // NULL: bus_host_latency everywhere
+extern uint32_t bus_host_stale;      // ticks the ack of the last cycle is still seen, its data read
+extern uint32_t bus_host_settle;     // ticks a poll that saw no ack needs before the next one
+extern uint32_t bus_host_berr_start, bus_host_berr_end;  // cycles touching these end with a bus error
+extern void (*bus_host_cycle_hook)(const BUS_HOST_CYCLE *c);  // called as a cycle starts, NULL: none
+extern int bus_host_ipl;             // what intlev() returns
+
+uint8_t *bus_host_ram(uint32_t address);  // NULL where the bus has no RAM
+void bus_host_reset(void);                // empty log, the default timing
+void bus_host_idle(void);                 // time passes, the running cycle ends
+
+void bus_host_nop(void);
+void bus_host_write_reg(uint32_t offset, uint32_t data);
+uint32_t bus_host_read_reg(uint32_t offset);
+void bus_host_write_mem(int size, uint32_t offset, uint32_t data);
+void bus_host_read_mem(int size, uint32_t offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define NOP bus_host_nop()
+#define write_reg(Offset,Data)   bus_host_write_reg((Offset),(Data))
+#define read_reg(Offset)         bus_host_read_reg(Offset)
+#define read_mem32(Offset)       bus_host_read_mem(4,(Offset))
+#define read_mem16(Offset)       bus_host_read_mem(2,(Offset))
+#define read_mem8(Offset)        bus_host_read_mem(1,(Offset))
+#define write_mem32(Offset,Data) bus_host_write_mem(4,(Offset),(Data))
+#define write_mem16(Offset,Data) bus_host_write_mem(2,(Offset),(Data))
+#define write_mem8(Offset,Data)  bus_host_write_mem(1,(Offset),(Data))
+
+#endif /* BUS_HOST_H_ */
@@ -0,0 +1,245 @@
+/*
+ * bus_timing_test.cc
+ *
+ *  The bus timing calibration of cpu_emulator.cc (bus_timing_check(),
+ *  bus_timing_fault()) on the mock bus of bus_host.cc, for buses with
+ *  acks, stale reads and settle times of their own:
+ *  - chip RAM gets the shortest delays from which on every longer one reads
+ *    and writes right, plus the margin, and the delays it gets read and
+ *    write right
+ *  - the 16 bytes the search runs on are put back, at boot (ROM overlay)
+ *    and later on
+ *  - the expansion space gets chip RAM's delays and the margin, a region
+ *    acking as slow as chip RAM or slower chip RAM's delays, a faster one
+ *    at least the hand tuned delay
+ *  - no calibration again until the bus clock changes, a new one on a
+ *    slower bus gets longer delays
+ *  - a bus no delay works on: the hand tuned delays and the console floors
+ *  - faults in a region make its delays longer every BUS_FAULT_STEP, up to
+ *    BUS_NOPS_MAX, other regions keep theirs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <initializer_list>
+#include "bus_host.h"
+#include "main.h"
+
+// as in cpu_emulator.cc
+#define BUS_NOPS_DEFAULT 2
+#define BUS_NOPS_MAX     16
+#define BUS_NOPS_MARGIN  1
+#define BUS_FAULT_STEP   4
+enum { BUS_CHIP, BUS_ZORRO2, BUS_CIA, BUS_CUSTOM, BUS_ROM, BUS_ZORRO3, BUS_REGIONS };
+
+extern "C" {
+typedef struct {
+   uint32_t nops_read;
+   uint32_t nops_write;
+   uint32_t ack_polls;
+   uint32_t timeouts;
+   uint32_t bus_errors;
+   uint32_t faults;
+} BUS_TIMING;
+extern BUS_TIMING bus_timing[BUS_REGIONS];
+extern int ovl;
+extern SHARED *shared;
+void ps_write_32(unsigned int address, unsigned int value);
+unsigned int ps_read_32(unsigned int address);
+void ps_write_flush(void);
+void bus_timing_check(void);
+void bus_timing_fault(uint32_t address, int bus_error);
+}
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+#define WORK 0x00001000    // chip RAM the test reads and writes, away from the calibration
+
+// the bus of a test: the ack latency, the stale reads and the settle time
+static void bus(uint32_t latency, uint32_t stale, uint32_t settle)
+{
+   ps_write_flush();
+   bus_host_idle();
+   bus_host_reset();
+   bus_host_latency = latency;
+   bus_host_stale = stale;
+   bus_host_settle = settle;
+}
+
+// random longwords written and read back on chip RAM with these delays
+static int works(uint32_t nops_read, uint32_t nops_write, int rounds)
+{
+   uint32_t v[4];
+   int ok = 1;
+   bus_timing[BUS_CHIP].nops_read = nops_read;
+   bus_timing[BUS_CHIP].nops_write = nops_write;
+   for (int r = 0; r < rounds && ok; r++) {
+      for (int i = 0; i < 4; i++) {
+         v[i] = rand() * 65536u + rand();
+         ps_write_32(WORK + i * 4, v[i]);
+      }
+      for (int i = 0; i < 16; i++) {
+         int k = rand() % 4;
+         ok &= ps_read_32(WORK + k * 4) == v[k];
+      }
+   }
+   ps_write_flush();
+   bus_host_idle();
+   return(ok);
+}
+
+// the shortest read (write) delay from which on every one up to the longest works
+static uint32_t shortest(int write)
+{
+   uint32_t best = BUS_NOPS_MAX + 1;
+   for (int nops = BUS_NOPS_MAX; nops >= 0; nops--) {
+      if (!(write ? works(BUS_NOPS_MAX, nops, 64) : works(nops, BUS_NOPS_MAX, 64)))
+         break;
+      best = nops;
+   }
+   return(best);
+}
+
+static void calibrate(void)
+{
+   shared->bus_clock_changes++;
+   bus_timing_check();
+}
+
+static void test_chip(uint32_t latency, uint32_t stale, uint32_t settle)
+{
+   bus(latency, stale, settle);
+   uint32_t r = shortest(0), w = shortest(1);
+   if (r + BUS_NOPS_MARGIN > BUS_NOPS_MAX || w + BUS_NOPS_MARGIN > BUS_NOPS_MAX) {
+      CHECK(0, "bus %u/%u/%u: no delay to calibrate", latency, stale, settle);
+      return;
+   }
+   shared->nops_read = shared->nops_write = 0;
+   calibrate();
+   BUS_TIMING *t = bus_timing;
+   CHECK(t[BUS_CHIP].nops_read == r + BUS_NOPS_MARGIN && t[BUS_CHIP].nops_write == w + BUS_NOPS_MARGIN,
+         "bus %u/%u/%u: chip RAM calibrated to %u/%u, shortest %u/%u", latency, stale, settle,
+         t[BUS_CHIP].nops_read, t[BUS_CHIP].nops_write, r, w);
+   for (int z : { BUS_ZORRO2, BUS_ZORRO3 })
+      CHECK(t[z].nops_read == t[BUS_CHIP].nops_read + BUS_NOPS_MARGIN
+            && t[z].nops_write == t[BUS_CHIP].nops_write + BUS_NOPS_MARGIN,
+            "bus %u/%u/%u: expansion space %u/%u", latency, stale, settle, t[z].nops_read, t[z].nops_write);
+   CHECK(works(t[BUS_CHIP].nops_read, t[BUS_CHIP].nops_write, 1000), "bus %u/%u/%u: calibrated delays fail",
+         latency, stale, settle);
+   if (r > 0)
+      CHECK(!works(r - 1, BUS_NOPS_MAX, 1000), "bus %u/%u/%u: a read delay of %u works", latency, stale, settle,
+            r - 1);
+}
+
+static void test_restore(void)
+{
+   for (int o : { 1, 0 }) {
+      uint32_t a = o ? 0x00080000 : 0x00000010;
+      uint8_t before[16];
+      bus(12, 5, 4);
+      ovl = o;
+      for (int i = 0; i < 16; i++)
+         before[i] = bus_host_ram(a)[i] = 0x40 + i;
+      calibrate();
+      CHECK(memcmp(bus_host_ram(a), before, 16) == 0, "ovl %d: 0x%08x not put back", o, a);
+   }
+   ovl = 1;
+}
+
+static uint32_t region_latency(uint32_t address)
+{
+   if (address >= 0x00BFE000 && address < 0x00C00000)
+      return(40);     // CIA, slower than chip RAM
+   if (address >= 0x00DFF000 && address < 0x00E00000)
+      return(2);      // custom chips, faster
+   return(8);
+}
+
+static void test_regions(void)
+{
+   bus(8, 0, 0);
+   bus_host_latency_at = region_latency;
+   calibrate();
+   BUS_TIMING *t = bus_timing;
+   uint32_t r = t[BUS_CHIP].nops_read, w = t[BUS_CHIP].nops_write;
+   CHECK(r < BUS_NOPS_DEFAULT || w < BUS_NOPS_DEFAULT, "chip RAM %u/%u: no faster region to tell", r, w);
+   CHECK(t[BUS_CIA].ack_polls > t[BUS_CHIP].ack_polls && t[BUS_CIA].nops_read == r && t[BUS_CIA].nops_write == w,
+         "slower CIA: %u/%u, %u polls, chip RAM %u/%u, %u polls", t[BUS_CIA].nops_read, t[BUS_CIA].nops_write,
+         t[BUS_CIA].ack_polls, r, w, t[BUS_CHIP].ack_polls);
+   CHECK(t[BUS_ROM].ack_polls == t[BUS_CHIP].ack_polls && t[BUS_ROM].nops_read == r && t[BUS_ROM].nops_write == w,
+         "ROM as fast as chip RAM: %u/%u", t[BUS_ROM].nops_read, t[BUS_ROM].nops_write);
+   CHECK(t[BUS_CUSTOM].ack_polls < t[BUS_CHIP].ack_polls
+         && t[BUS_CUSTOM].nops_read == (r > BUS_NOPS_DEFAULT ? r : BUS_NOPS_DEFAULT)
+         && t[BUS_CUSTOM].nops_write == (w > BUS_NOPS_DEFAULT ? w : BUS_NOPS_DEFAULT),
+         "faster custom chips: %u/%u", t[BUS_CUSTOM].nops_read, t[BUS_CUSTOM].nops_write);
+}
+
+static void test_changes(void)
+{
+   bus(12, 5, 4);
+   calibrate();
+   uint32_t r = bus_timing[BUS_CHIP].nops_read, w = bus_timing[BUS_CHIP].nops_write;
+   bus_host_reset();
+   bus_host_latency = 20;
+   bus_host_stale = 9;
+   bus_host_settle = 7;
+   bus_timing_check();
+   CHECK(bus_host_cycles == 0, "calibrated again without a clock change: %u cycles", bus_host_cycles);
+   calibrate();
+   CHECK(bus_timing[BUS_CHIP].nops_read > r && bus_timing[BUS_CHIP].nops_write > w,
+         "slower bus: %u/%u, %u/%u before", bus_timing[BUS_CHIP].nops_read, bus_timing[BUS_CHIP].nops_write, r, w);
+}
+
+static void test_broken(void)
+{
+   bus(12, 5, 4);
+   bus_host_berr_start = 0x00080000;   // bus errors where the search runs
+   bus_host_berr_end = 0x00080010;
+   shared->nops_read = 3;
+   shared->nops_write = 5;
+   calibrate();
+   for (int i = 0; i < BUS_REGIONS; i++)
+      CHECK(bus_timing[i].nops_read == BUS_NOPS_DEFAULT && bus_timing[i].nops_write == BUS_NOPS_DEFAULT,
+            "broken bus: region %d %u/%u", i, bus_timing[i].nops_read, bus_timing[i].nops_write);
+   CHECK(shared->nops_read == 3 && shared->nops_write == 5, "broken bus: floors %u/%u", shared->nops_read,
+         shared->nops_write);
+   shared->nops_read = shared->nops_write = 0;
+}
+
+static void test_faults(void)
+{
+   BUS_TIMING *chip = &bus_timing[BUS_CHIP], *cia = &bus_timing[BUS_CIA];
+   *chip = (BUS_TIMING){ 3, 5, 0, 0, 0, 0 };
+   *cia = (BUS_TIMING){ 4, 4, 0, 0, 0, 0 };
+   for (int i = 1; i < BUS_FAULT_STEP; i++)
+      bus_timing_fault(0x00001000, 0);
+   CHECK(chip->nops_read == 3 && chip->nops_write == 5, "longer before %d faults", BUS_FAULT_STEP);
+   bus_timing_fault(0x00001000, 1);
+   CHECK(chip->nops_read == 4 && chip->nops_write == 6 && chip->timeouts == BUS_FAULT_STEP - 1
+         && chip->bus_errors == 1, "after %d faults: %u/%u", BUS_FAULT_STEP, chip->nops_read, chip->nops_write);
+   CHECK(cia->nops_read == 4 && cia->nops_write == 4, "CIA changed by chip RAM faults");
+   for (int i = 0; i < 100 * BUS_FAULT_STEP; i++)
+      bus_timing_fault(0x001FFFFC, 0);
+   CHECK(chip->nops_read == BUS_NOPS_MAX && chip->nops_write == BUS_NOPS_MAX, "past the longest delay: %u/%u",
+         chip->nops_read, chip->nops_write);
+}
+
+int main(int argc, char **argv)
+{
+   srand(44);
+   test_chip(4, 0, 0);
+   test_chip(12, 5, 4);
+   test_chip(20, 9, 7);
+   test_chip(30, 2, 11);
+   test_restore();
+   test_regions();
+   test_changes();
+   test_broken();
+   test_faults();
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
@@ -0,0 +1,226 @@
+/*
+ * bus_wc_test.cc
+ *
+ *  The write combining of cpu_emulator.cc (ps_write_*() to chip and
+ *  motherboard RAM) on the mock bus of bus_host.cc:
+ *  - a flush of every set of written lanes goes out as a long, aligned
+ *    words and bytes: no word at an odd address, no lane written twice,
+ *    no lane not written
+ *  - two words or four bytes of a longword, and a long at any alignment,
+ *    go out as long cycles
+ *  - a read, a write to the custom chips and WC_TIMEOUT ticks flush the
+ *    pending write first, a write to another longword flushes it too
+ *  - random reads and writes of all sizes and alignments, to RAM and to
+ *    the custom chips, against a plain memory: the same bytes in RAM, each
+ *    read sees every write before it, the custom chips get their writes in
+ *    order
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "bus_host.h"
+
+extern "C" {
+void ps_write_8(unsigned int address, unsigned int value);
+void ps_write_16(unsigned int address, unsigned int value);
+void ps_write_32(unsigned int address, unsigned int value);
+unsigned int ps_read_8(unsigned int address);
+unsigned int ps_read_16(unsigned int address);
+unsigned int ps_read_32(unsigned int address);
+void ps_write_flush(void);
+void ps_write_tick(void);
+}
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+#define CUSTOM 0x00DFF180  // COLOR00, no RAM behind it
+
+// nothing pending, an empty log
+static void clean(void)
+{
+   ps_write_flush();
+   bus_host_idle();
+   bus_host_reset();
+}
+
+static void test_flush(void)
+{
+   for (uint32_t base : { 0x00001000u, 0x07F00000u })
+      for (uint32_t mask = 1; mask < 16; mask++) {
+         uint8_t lanes[4] = { 0 };
+         clean();
+         memset(bus_host_ram(base), 0, 4);
+         for (int l = 0; l < 4; l++)
+            if (mask & (8 >> l))
+               ps_write_8(base + l, 0x11 * (l + 1));
+         CHECK(bus_host_cycles == (mask == 0xF), "0x%08x mask %x: %u cycles before the flush", base, mask,
+               bus_host_cycles);
+         ps_write_flush();
+         bus_host_idle();
+         for (uint32_t i = 0; i < bus_host_cycles; i++) {
+            const BUS_HOST_CYCLE *c = &bus_host_log[i];
+            CHECK(c->write && c->address >= base && c->address + c->size <= base + 4
+                  && c->address % c->size == 0, "0x%08x mask %x: cycle %u of %u bytes at 0x%08x", base, mask, i,
+                  c->size, c->address);
+            for (uint32_t a = c->address; a < c->address + c->size && a - base < 4; a++)
+               lanes[a - base]++;
+         }
+         int expected = mask == 0xF ? 1 : 0;
+         for (int n = 0; mask != 0xF && n < 4; n++)
+            if ((mask & (8 >> n)) && (n & 1) == 0 && (mask & (4 >> n)))
+               expected++, n++;
+            else if (mask & (8 >> n))
+               expected++;
+         CHECK((int)bus_host_cycles == expected, "0x%08x mask %x: %u cycles, %d expected", base, mask,
+               bus_host_cycles, expected);
+         for (int l = 0; l < 4; l++)
+            CHECK(lanes[l] == ((mask & (8 >> l)) ? 1 : 0) && bus_host_ram(base)[l] == (lanes[l] ? 0x11 * (l + 1) : 0),
+                  "0x%08x mask %x: lane %d written %d times", base, mask, l, lanes[l]);
+         CHECK(bus_host_misaligned == 0, "0x%08x mask %x: misaligned cycle", base, mask);
+      }
+}
+
+static void test_merge(void)
+{
+   clean();
+   ps_write_16(0x2000, 0x1234);
+   ps_write_16(0x2002, 0x5678);
+   CHECK(bus_host_cycles == 1 && bus_host_log[0].size == 4 && bus_host_log[0].data == 0x12345678,
+         "two words: %u cycles", bus_host_cycles);
+
+   clean();
+   for (int i = 0; i < 4; i++)
+      ps_write_8(0x07000010 + i, 0xA0 + i);
+   CHECK(bus_host_cycles == 1 && bus_host_log[0].size == 4 && bus_host_log[0].data == 0xA0A1A2A3,
+         "four bytes: %u cycles", bus_host_cycles);
+
+   // a long at +1 to +3: the first longword goes out when the second one starts
+   for (uint32_t off = 1; off < 4; off++) {
+      clean();
+      ps_write_32(0x3000 + off, 0xCAFEBABE);
+      ps_write_32(0x3004 + off, 0xDEADBEEF);
+      ps_write_32(0x3008 + off, 0x01020304);
+      ps_write_flush();
+      int longs = 0;
+      for (uint32_t i = 0; i < bus_host_cycles; i++)
+         longs += bus_host_log[i].address == 0x3004 && bus_host_log[i].size == 4;
+      CHECK(longs == 1 && bus_host_misaligned == 0, "long at +%u: %d long cycles at 0x3004", off, longs);
+      CHECK(ps_read_32(0x3004 + off) == 0xDEADBEEF, "long at +%u: read back", off);
+   }
+}
+
+static void test_order(void)
+{
+   clean();
+   ps_write_8(0x4001, 0x55);
+   CHECK(ps_read_8(0x4001) == 0x55 && bus_host_cycles == 2 && bus_host_log[0].write, "read: pending write not first");
+
+   clean();
+   ps_write_16(0x4002, 0x6666);
+   ps_write_16(CUSTOM, 0x0F00);
+   CHECK(bus_host_cycles == 2 && bus_host_log[0].address == 0x4002 && bus_host_log[1].address == CUSTOM,
+         "custom chips: pending write not first");
+
+   clean();
+   ps_write_8(0x4004, 0x77);
+   ps_write_8(0x4008, 0x88);
+   CHECK(bus_host_cycles == 1 && bus_host_log[0].address == 0x4004, "other longword: no flush");
+
+   clean();
+   ps_write_8(0x400C, 0x99);
+   for (int i = 0; i < 63; i++)
+      ps_write_tick();
+   CHECK(bus_host_cycles == 0, "flushed before WC_TIMEOUT");
+   ps_write_tick();
+   CHECK(bus_host_cycles == 1, "not flushed after WC_TIMEOUT");
+}
+
+static void test_random(void)
+{
+   static const uint32_t bases[] = { 0x00010000, 0x001FFF00, 0x07000000, 0x07FFFF00 };
+   std::vector<uint8_t> ref(4 * 256);
+   std::vector<uint32_t> custom;
+
+   srand(42);
+   for (int b = 0; b < 4; b++)
+      for (int i = 0; i < 256; i++)
+         ref[b * 256 + i] = bus_host_ram(bases[b])[i] = rand();
+   clean();
+   uint32_t custom_first = 0;
+   for (int op = 0; op < 200000; op++) {
+      int b = rand() % 4;
+      uint32_t off = rand() % 252;
+      uint32_t a = bases[b] + off;
+      uint8_t *r = &ref[b * 256 + off];
+      uint32_t v = rand() * 65536u + rand();
+      switch (rand() % 10) {
+      case 0: ps_write_8(a, v & 0xFF); r[0] = v; break;
+      case 1: ps_write_16(a, v & 0xFFFF); r[0] = v >> 8; r[1] = v; break;
+      case 2:
+      case 3: ps_write_32(a, v); r[0] = v >> 24; r[1] = v >> 16; r[2] = v >> 8; r[3] = v; break;
+      case 4: {
+         uint32_t got = ps_read_8(a);
+         if (got != r[0]) {
+            CHECK(0, "op %d: byte at 0x%08x is 0x%02x, 0x%02x written", op, a, got, r[0]);
+            return;
+         }
+         break;
+      }
+      case 5: {
+         uint32_t got = ps_read_16(a), want = r[0] << 8 | r[1];
+         if (got != want) {
+            CHECK(0, "op %d: word at 0x%08x is 0x%04x, 0x%04x written", op, a, got, want);
+            return;
+         }
+         break;
+      }
+      case 6: {
+         uint32_t got = ps_read_32(a), want = r[0] << 24 | r[1] << 16 | r[2] << 8 | r[3];
+         if (got != want) {
+            CHECK(0, "op %d: long at 0x%08x is 0x%08x, 0x%08x written", op, a, got, want);
+            return;
+         }
+         break;
+      }
+      case 7:
+         if (bus_host_cycles >= BUS_HOST_LOG)
+            break;
+         if (custom.empty())
+            custom_first = bus_host_cycles;
+         ps_write_16(CUSTOM, v & 0xFFFF);
+         custom.push_back(v & 0xFFFF);
+         break;
+      default:
+         ps_write_tick();
+         break;
+      }
+   }
+   ps_write_flush();
+   bus_host_idle();
+   for (int b = 0; b < 4; b++)
+      CHECK(memcmp(bus_host_ram(bases[b]), &ref[b * 256], 256) == 0, "RAM at 0x%08x differs", bases[b]);
+   CHECK(bus_host_misaligned == 0, "%u misaligned cycles", bus_host_misaligned);
+   size_t k = 0;
+   for (uint32_t i = custom_first; i < bus_host_cycles && i < BUS_HOST_LOG; i++)
+      if (bus_host_log[i].address == CUSTOM) {
+         if (k >= custom.size() || bus_host_log[i].data >> 16 != custom[k])
+            break;
+         k++;
+      }
+   CHECK(k == custom.size(), "custom chip writes: %zu of %zu in order", k, custom.size());
+}
+
+int main(int argc, char **argv)
+{
+   test_flush();
+   test_merge();
+   test_order();
+   test_random();
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
@@ -0,0 +1,248 @@
+/*
+ * heap_test.c
+ *
+ *  The TLSF heap of soft3d (wazp3d/heap.c) at its firmware address:
+ *  - random heap_alloc()/heap_free() of all sizes: each block is aligned on
+ *    a cache line, in the heap, no other block writes in it, heap_check()
+ *    finds the block list and the free lists right and the stats count the
+ *    blocks. All freed, the heap is one free block again
+ *  - the heap full: heap_alloc() fails and counts it, largest_free can be
+ *    allocated, a block too big fails
+ *  - heap_collect() frees what is not reachable from the stack and keeps
+ *    what is, through the blocks
+ *
+ *  Then the time per heap_alloc()/heap_free() against the libc ones, with
+ *  soft3d-like sizes.
+ *
+ *  Usage: heap_test [iterations of the random test]
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xil_types.h"
+#include "memorymap.h"
+#include "wazp3d/heap.h"
+#include "soft3d_host.h"
+
+#define BLOCKS 4096
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+static void *p[BLOCKS];
+static size_t sz[BLOCKS];
+static uint8_t tag[BLOCKS];
+
+static uint64_t rnd_s = 88172645463325252ull;
+static uint64_t rnd(void)
+{
+   rnd_s ^= rnd_s << 13;
+   rnd_s ^= rnd_s >> 7;
+   rnd_s ^= rnd_s << 17;
+   return(rnd_s);
+}
+
+// small ones, points, W x H textures, up to 1 MB
+static size_t rsize(void)
+{
+   switch (rnd() % 8) {
+   case 0:  return(1 + rnd() % 16);
+   case 1:
+   case 2:  return(1 + rnd() % 256);
+   case 3:
+   case 4:  return(1 + rnd() % 4096);
+   case 5:  return(28 * (1 + rnd() % 3000));
+   case 6:  return(4 * (1 << (rnd() % 9)) * (1 << (rnd() % 9)));
+   default: return(1 + rnd() % (1 << 20));
+   }
+}
+
+static int intact(int i)
+{
+   const uint8_t *b = p[i];
+   for (size_t k = 0; k < sz[i]; k += 97)
+      if (b[k] != tag[i])
+         return(0);
+   return(b[sz[i] - 1] == tag[i]);
+}
+
+static void test_random(long iterations)
+{
+   size_t live = 0, count = 0;
+   Heap_Stats st;
+
+   for (long it = 0; it < iterations; it++) {
+      int i = rnd() % BLOCKS;
+      if (p[i]) {
+         if (!intact(i)) {
+            CHECK(0, "iteration %ld: block of %zu bytes written", it, sz[i]);
+            return;
+         }
+         heap_free(p[i]);
+         p[i] = NULL;
+         live -= sz[i];
+         count--;
+      } else {
+         sz[i] = rsize();
+         p[i] = heap_alloc(sz[i]);
+         if (p[i] == NULL)
+            continue;
+         uint8_t *b = p[i];
+         if (((uintptr_t)b & (HEAP_ALIGN - 1)) != 0 || b < (uint8_t *)Z3_SOFT3D_ADDR_BUFFERS
+             || b + sz[i] > (uint8_t *)Z3_SOFT3D_ADDR_BUFFERS + HEAP_SIZE_BYTES) {
+            CHECK(0, "iteration %ld: block at %p", it, b);
+            return;
+         }
+         tag[i] = rnd();
+         memset(b, tag[i], sz[i]);
+         live += sz[i];
+         count++;
+      }
+      if ((it & 0xFFFF) == 0) {
+         int errors = heap_check();
+         heap_get_stats(&st);
+         if (errors || st.used_blocks != count || st.used_bytes < live) {
+            CHECK(0, "iteration %ld: heap_check %d, %zu used blocks (%zu bytes) for %zu (%zu)", it,
+                  errors, st.used_blocks, st.used_bytes, count, live);
+            return;
+         }
+      }
+   }
+   heap_dump("random");
+   heap_get_stats(&st);
+   CHECK(st.failed_allocs > 0, "the heap was never full");
+
+   for (int i = 0; i < BLOCKS; i++)
+      if (p[i]) {
+         CHECK(intact(i), "block %d written", i);
+         heap_free(p[i]);
+         p[i] = NULL;
+      }
+   heap_get_stats(&st);
+   CHECK(st.free_blocks == 1 && st.used_blocks == 0 && st.used_bytes == 0,
+         "all freed: %zu free blocks, %zu used blocks", st.free_blocks, st.used_blocks);
+   CHECK(st.largest_free > HEAP_SIZE_BYTES - 2 * HEAP_ALIGN, "all freed: largest %zu", st.largest_free);
+   CHECK(heap_check() == 0, "all freed: heap_check %d", heap_check());
+}
+
+static void test_full(void)
+{
+   Heap_Stats st;
+   int n = 0;
+
+   heap_get_stats(&st);
+   uint32_t failed = st.failed_allocs;
+   CHECK(heap_alloc(HEAP_SIZE_BYTES + 1) == NULL, "bigger than the heap");
+   CHECK(heap_alloc(0) == NULL, "0 bytes");
+
+   // 64 KB blocks up to the end, every other one freed: room for 64 KB
+   // only, in holes
+   while (n < BLOCKS && (p[n] = heap_alloc(65536)) != NULL)
+      n++;
+   CHECK(n > 200 && n < BLOCKS, "%d blocks of 64 KB", n);
+   for (int i = 0; i < n; i += 2) {
+      heap_free(p[i]);
+      p[i] = NULL;
+   }
+   heap_get_stats(&st);
+   CHECK(st.failed_allocs == failed + 2, "%lu failed allocs counted", (unsigned long)(st.failed_allocs - failed));
+   CHECK(st.largest_free >= 65536 && st.largest_free < 3 * 65536, "largest %zu", st.largest_free);
+   void *big = heap_alloc(st.largest_free);
+   CHECK(big != NULL, "largest_free %zu can't be allocated", st.largest_free);
+   heap_free(big);
+   CHECK(heap_alloc(4 * 65536) == NULL, "256 KB in 64 KB holes");
+   CHECK(heap_check() == 0, "full: heap_check %d", heap_check());
+
+   for (int i = 1; i < n; i += 2) {
+      heap_free(p[i]);
+      p[i] = NULL;
+   }
+   heap_get_stats(&st);
+   CHECK(st.free_blocks == 1 && st.used_blocks == 0, "full then freed: %zu free blocks", st.free_blocks);
+}
+
+// the stack is cleared after the garbage so only the roots point to the heap
+__attribute__((noinline)) static void garbage(void)
+{
+   for (int i = 0; i < 100; i++) {
+      volatile void *g = heap_alloc(1000 + i * 37);
+      (void)g;
+   }
+}
+
+__attribute__((noinline)) static void clobber(void)
+{
+   volatile uintptr_t junk[4096] __attribute__((unused));
+   for (int i = 0; i < 4096; i++)
+      junk[i] = 0;
+}
+
+__attribute__((noinline)) static void test_collect(void)
+{
+   void *volatile root = heap_alloc(64);
+   void **child = heap_alloc(5000);
+   Heap_Stats st;
+
+   ((void **)root)[0] = child;
+   child[0] = heap_alloc(77);
+   memset(child[0], 0x5A, 77);
+   child = NULL;
+   garbage();
+   clobber();
+   heap_get_stats(&st);
+   CHECK(st.used_blocks == 103, "%zu used blocks before", st.used_blocks);
+   heap_collect();
+   heap_get_stats(&st);
+   CHECK(st.used_blocks == 3, "%zu used blocks after heap_collect()", st.used_blocks);
+   CHECK(heap_check() == 0, "collect: heap_check %d", heap_check());
+   child = ((void **)root)[0];
+   CHECK(((uint8_t *)child[0])[76] == 0x5A, "the block of a block was freed");
+   heap_free(child[0]);
+   heap_free(child);
+   heap_free(root);
+}
+
+static void bench(void)
+{
+   static void *b[512];
+   double t[2];
+
+   for (int lib = 0; lib < 2; lib++) {
+      rnd_s = 12345;
+      double t0 = host_now();
+      for (long it = 0; it < 4000000; it++) {
+         int i = rnd() % 512;
+         if (b[i]) {
+            lib ? free(b[i]) : heap_free(b[i]);
+            b[i] = NULL;
+         } else {
+            size_t n = (rnd() % 4) ? 16 + rnd() % 2048 : 4096 + rnd() % 32768;
+            b[i] = lib ? malloc(n) : heap_alloc(n);
+         }
+      }
+      t[lib] = (host_now() - t0) * 1e9 / 4000000;
+      for (int i = 0; i < 512; i++) {
+         lib ? free(b[i]) : heap_free(b[i]);
+         b[i] = NULL;
+      }
+   }
+   printf("per alloc or free: %.1f ns heap, %.1f ns libc\n", t[0], t[1]);
+}
+
+int main(int argc, char **argv)
+{
+   uintptr_t top;
+
+   soft3d_host_init();
+   stack_base = &top;
+   test_random(argc > 1 ? atol(argv[1]) : 2000000);
+   test_full();
+   test_collect();
+   bench();
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
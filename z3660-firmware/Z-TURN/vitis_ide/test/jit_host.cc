@@ -0,0 +1,249 @@
+/*
+ * jit_host.cc
+ *
+ *  The raw functions of the JIT recorded at the address they emit to and
+ *  run from there (see jit_host.h), and what else newcpu.cc and the JIT
+ *  need on the host: the CPU tables other than the 68040 ones, the FPU,
+ *  the interrupts and core0, as stand-ins doing nothing.
+ *
+ *  The ARM registers the raw functions use are kept as host words, and
+ *  the conditions as the two the raw functions set: DEC_M (the countdown
+ *  of a block) and CMP_PC (the PC the block was compiled for). Where a raw
+ *  function branches to is read from the B instructions it emitted, so the
+ *  blocks linked or sent to another handler later are followed as on the
+ *  board. The exits (the popall_* stubs) call the C function and return,
+ *  as the compiled code returns to m68k_run_jit() through it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <map>
+#include <vector>
+#include "sysconfig.h"
+#include "sysdeps.h"
+#include "options.h"
+#include "include/memory.h"
+#include "newcpu.h"
+#include "events.h"
+#include "cputbl.h"
+#include "jit/compemu.h"
+#include "jit_host.h"
+
+#define ARM_PAR1 0   // REG_PAR1 of codegen_arm.cc, the opcode of the interpreter call
+
+void (*jit_host_insn_hook)(uint32_t opcode, uintptr_t pc_p);
+uint32_t jit_host_blocks;
+uint32_t jit_host_insns;
+
+typedef struct {
+   int op;
+   uintptr_t a, b;
+} JIT_HOST_RAW;
+
+// by address, a raw function emitting nothing shares it with the next one
+static std::map<uintptr_t, std::vector<JIT_HOST_RAW> > code;
+static uintptr_t last_at;
+
+void jit_host_emit(const void *at, int op, uintptr_t a, uintptr_t b)
+{
+   uintptr_t p = (uintptr_t)at;
+   if (p < last_at)   // the cache started over
+      code.erase(code.lower_bound(p), code.end());
+   last_at = p;
+   code[p].push_back({ op, a, b });
+}
+
+static void fail(const char *what, uintptr_t p)
+{
+   printf("jit_host: %s at %p\n", what, (void *)p);
+   abort();
+}
+
+// the n-th B emitted by the raw function from p, up to the next one
+static uintptr_t branch(uintptr_t p, int n)
+{
+   auto next = code.upper_bound(p);
+   uintptr_t end = next == code.end() ? p + 64 : next->first;
+   for (; p < end; p += 4) {
+      uint32_t w = *(uint32_t *)p;
+      if ((w >> 28) != 0xF && ((w >> 25) & 7) == 5 && !(w & 0x01000000) && n-- == 0)
+         return(p + 8 + ((int32_t)(w << 8) >> 6));
+   }
+   fail("no branch", p);
+   return(0);
+}
+
+static void store(uintptr_t d, uintptr_t v)
+{
+   if (d == (uintptr_t)&regs.pc_p)
+      regs.pc_p = (uae_u8 *)v;
+   else
+      *(uae_u32 *)d = (uae_u32)v;
+}
+
+static uintptr_t handler(uintptr_t pc)
+{
+   return((uintptr_t)((cacheline *)regs.cache_tags)[cacheline(pc)].handler);
+}
+
+void jit_host_run(void)
+{
+   uintptr_t r[16] = { 0 };
+   bool lt = false, eq = false;
+   uintptr_t p = handler((uintptr_t)regs.pc_p);
+
+   for (;;) {
+      auto at = code.lower_bound(p);
+      if (at == code.end())
+         fail("nothing emitted", p);
+      p = at->first;
+      uintptr_t to = 0;
+      for (const JIT_HOST_RAW &e : at->second) {
+         switch (e.op) {
+         case JIT_HOST_INC_OPCOUNT:
+         case JIT_HOST_INIT_R_REGSTRUCT:
+            break;
+         case JIT_HOST_CMP_PC:
+            eq = (uae_u32)(uintptr_t)regs.pc_p == (uae_u32)e.a;
+            break;
+         case JIT_HOST_SET_PC_I:
+            regs.pc_p = (uae_u8 *)e.a;
+            break;
+         case JIT_HOST_MOV_L_MI:
+            store(e.a, e.b);
+            break;
+         case JIT_HOST_MOV_L_MR:
+            store(e.a, r[e.b]);
+            break;
+         case JIT_HOST_MOV_L_RI:
+            r[e.a] = e.b;
+            break;
+         case JIT_HOST_MOV_L_RM:
+            r[e.a] = e.b == (uintptr_t)&regs.pc_p ? (uintptr_t)regs.pc_p : *(uae_u32 *)e.b;
+            break;
+         case JIT_HOST_MOV_L_RR:
+            r[e.a] = r[e.b];
+            break;
+         case JIT_HOST_DEC_M:
+            lt = --*(uae_s32 *)e.a < 0;
+            break;
+         case JIT_HOST_INC_M64:
+            ++*(uae_u64 *)e.a;
+            break;
+         case JIT_HOST_CALL:
+         case JIT_HOST_CALL_R: {
+            cpuop_func *f = (cpuop_func *)(e.op == JIT_HOST_CALL ? e.a : r[e.a]);
+            if (jit_host_insn_hook)
+               jit_host_insn_hook((uae_u32)r[ARM_PAR1], (uintptr_t)regs.pc_p);
+            jit_host_insns++;
+            f((uae_u32)r[ARM_PAR1]);
+            break;
+         }
+         case JIT_HOST_HANDLE_EXCEPT:
+            if (regs.jit_exception) {
+               r[ARM_PAR1] = e.a;
+               to = branch(p, 1);
+            }
+            break;
+         case JIT_HOST_EXECUTE_NORMAL:
+         case JIT_HOST_CHECK_CHECKSUM:
+            // to the popall_*_setpc stub, which stores the PC first
+            regs.pc_p = *(uae_u8 **)e.a;
+            to = branch(p, 0);
+            break;
+         case JIT_HOST_EXEC_NOSTATS:
+            regs.pc_p = (uae_u8 *)e.a;
+            to = branch(p, 0);
+            break;
+         case JIT_HOST_MAYBE_RECOMPILE:
+            if (lt)
+               to = branch(p, 0);
+            break;
+         case JIT_HOST_JMP:
+            if (((*(uint32_t *)p >> 25) & 7) == 5) {
+               to = branch(p, 0);
+               break;
+            }
+            // out of the cache: a popall_* stub leaving the compiled code
+            ((void (*)(void))e.a)();
+            return;
+         case JIT_HOST_JMP_PC_TAG:
+            to = handler((uintptr_t)regs.pc_p);
+            break;
+         case JIT_HOST_MAYBE_CACHEMISS:
+            if (!eq)
+               to = branch(p, 0);
+            break;
+         case JIT_HOST_MAYBE_DO_NOTHING:
+            if (regs.spcflags) {
+               countdown -= (uae_s32)e.a;
+               to = branch(p, 1);
+            }
+            break;
+         case JIT_HOST_ENDBLOCK_PC_INREG:
+            jit_host_blocks++;
+            countdown -= (uae_s32)e.b;
+            to = countdown < 0 ? branch(p, 0) : handler(r[e.a]);
+            break;
+         case JIT_HOST_ENDBLOCK_PC_ISCONST:
+            jit_host_blocks++;
+            countdown -= (uae_s32)e.a;
+            if (countdown >= 0) {
+               to = branch(p, 0);
+            } else {
+               regs.pc_p = (uae_u8 *)e.b;
+               to = branch(p, 1);
+            }
+            break;
+         default:
+            // the branches of compiled opcodes, there are none
+            fail("raw function not run on the host", p);
+         }
+         if (to)
+            break;
+      }
+      if (to) {
+         p = to;
+      } else {
+         auto next = code.upper_bound(p);
+         if (next == code.end())
+            fail("ran past the code", p);
+         p = next->first;
+      }
+   }
+}
+
+// the CPU tables of newcpu.cc other than the 68040 ones, empty
+#define NO_CPUTBL(n) const struct cputbl op_smalltbl_##n[] = { { NULL, 0 } };
+NO_CPUTBL(1) NO_CPUTBL(2) NO_CPUTBL(3) NO_CPUTBL(4) NO_CPUTBL(5) NO_CPUTBL(11) NO_CPUTBL(12)
+NO_CPUTBL(13) NO_CPUTBL(14) NO_CPUTBL(42) NO_CPUTBL(43) NO_CPUTBL(44) NO_CPUTBL(45)
+
+// the rest of the firmware
+uint8_t *ROM;
+int read_irq;
+extern "C" int intlev(void) { return(-1); }
+void do_cycles_ce(int cycles) {}
+extern "C" void cpu_emulator_reset_core0(void) {}
+extern "C" void ps_write_tick(void) {}
+extern "C" unsigned int m68k_disassemble_raw(char *str_buff, unsigned int pc, const unsigned char *opdata,
+                                             const unsigned char *argdata, unsigned int cpu_type) { return(0); }
+void fpuop_arithmetic(uae_u32 opcode, uae_u16 extra) {}
+void fpuop_dbcc(uae_u32 opcode, uae_u16 extra) {}
+void fpuop_scc(uae_u32 opcode, uae_u16 extra) {}
+void fpuop_trapcc(uae_u32 opcode, uaecptr oldpc, uae_u16 extra) {}
+void fpuop_bcc(uae_u32 opcode, uaecptr oldpc, uae_u32 extra) {}
+void fpuop_save(uae_u32 opcode) {}
+void fpuop_restore(uae_u32 opcode) {}
+void fpu_reset(void) {}
+
+void jit_abort(const TCHAR *format, ...)
+{
+   va_list ap;
+   va_start(ap, format);
+   vprintf(format, ap);
+   va_end(ap);
+   printf("\n");
+   abort();
+}
@@ -0,0 +1,43 @@
+/*
+ * jit_host.h
+ *
+ *  The tests of the JIT build newcpu.cc, the 68040 interpreter and
+ *  compemu_support.cc with the ARM code generator, with the headers of
+ *  stub/jit first. The ARM code is emitted as on the board, and the
+ *  wrapper of codegen_arm.cc also records the raw functions (the
+ *  compemu_raw_* of compemu_support.cc) at the address they emit to.
+ *  With no compiled opcodes every instruction of a block is a call to the
+ *  interpreter, and a block is nothing but these raw functions:
+ *  jit_host_run() runs them, in place of the pushall_call_handler the
+ *  compiled code is entered through, taking the branches from the ARM
+ *  code emitted. jit_host.cc also has what else the emulator needs, as
+ *  stand-ins doing nothing.
+ */
+
+#ifndef JIT_HOST_H_
+#define JIT_HOST_H_
+
+#include <stdint.h>
+
+enum {
+   JIT_HOST_INC_OPCOUNT, JIT_HOST_CMP_PC, JIT_HOST_SET_PC_I, JIT_HOST_MOV_L_MI, JIT_HOST_MOV_L_MR,
+   JIT_HOST_MOV_L_RI, JIT_HOST_MOV_L_RM, JIT_HOST_MOV_L_RR, JIT_HOST_DEC_M, JIT_HOST_INC_M64,
+   JIT_HOST_CALL, JIT_HOST_CALL_R, JIT_HOST_JCC_L_ONLY, JIT_HOST_HANDLE_EXCEPT, JIT_HOST_EXECUTE_NORMAL,
+   JIT_HOST_CHECK_CHECKSUM, JIT_HOST_EXEC_NOSTATS, JIT_HOST_MAYBE_RECOMPILE, JIT_HOST_JMP,
+   JIT_HOST_JMP_PC_TAG, JIT_HOST_MAYBE_CACHEMISS, JIT_HOST_MAYBE_DO_NOTHING, JIT_HOST_BRANCH,
+   JIT_HOST_INIT_R_REGSTRUCT, JIT_HOST_ENDBLOCK_PC_INREG, JIT_HOST_ENDBLOCK_PC_ISCONST,
+};
+
+// a raw function emitted at the address given
+void jit_host_emit(const void *at, int op, uintptr_t a, uintptr_t b);
+
+// the compiled code entered, returns when it is left
+void jit_host_run(void);
+
+// called with the opcode and the PC before each instruction run from a
+// block, NULL: none
+extern void (*jit_host_insn_hook)(uint32_t opcode, uintptr_t pc_p);
+extern uint32_t jit_host_blocks;      // blocks entered
+extern uint32_t jit_host_insns;       // instructions run from them
+
+#endif /* JIT_HOST_H_ */
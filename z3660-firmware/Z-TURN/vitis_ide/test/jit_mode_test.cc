@@ -0,0 +1,174 @@
+/*
+ * jit_mode_test.cc
+ *
+ *  The JIT in trace and master mode (m68k_run_jit() in uae/newcpu.cc),
+ *  with the real newcpu.cc, 68040 interpreter and compemu_support.cc, the
+ *  blocks run as jit_host.cc records them. A 68k program in CPU RAM turns
+ *  the cache on, runs a loop setting T1 for two instructions and clearing
+ *  it again, with a trace handler ending in RTE, then enters master mode,
+ *  patches a subroutine compiled before, leaves master mode, does a CINVA
+ *  and calls the subroutine in a loop:
+ *  - no instruction of a block runs with T0, T1 or M set
+ *  - every instruction of a block is the one in memory, the code changed
+ *    in master mode is not run from a block older than the CINVA
+ *  - the loops and the trace handler run as many times as they should
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <sys/mman.h>
+#include "sysconfig.h"
+#include "sysdeps.h"
+#include "options.h"
+#include "include/memory.h"
+#include "newcpu.h"
+#include "main.h"
+#include "jit_host.h"
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+extern addrbank drct_bank, dmmy_bank;
+extern SHARED *shared;
+extern void *pushall_call_handler;
+void fill_prefetch_quick(void);
+void m68k_reset_newcpu(bool hardreset);
+void build_cpufunctbl(void);
+
+#define RAM     0x08000000   // the CPU RAM, drct_bank, the vectors at its start
+#define RAM_END 0x10000000
+#define CODE    0x08001000
+#define SUB     0x08002000
+#define TRACE   0x08003000
+#define ERR     0x08003100   // every other vector
+#define END     (CODE + 76)
+#define STACK   0x08008000
+
+static jmp_buf done;
+static uint32_t traced;      // instructions of a block run with T0, T1 or M set
+static uint32_t stale;       // instructions of a block not the one in memory
+static uintptr_t stopped;
+
+static void insn(uint32_t opcode, uintptr_t pc_p)
+{
+   // cycles left, the blocks run linked to each other as they do on the
+   // board once an IRQ has set the countdown (check_uae_int_request())
+   countdown = 1 << 20;
+   if (regs.t0 || regs.t1 || regs.m)
+      traced++;
+   if (do_get_mem_word((uae_u16 *)pc_p) != opcode)
+      stale++;
+   if (pc_p == END || pc_p == ERR) {
+      stopped = pc_p;
+      longjmp(done, 1);
+   }
+}
+
+static void load(uint32_t address, const uint16_t *code, int words)
+{
+   for (int i = 0; i < words; i++)
+      do_put_mem_word((uae_u16 *)(uintptr_t)(address + i * 2), code[i]);
+}
+
+static void boot(void)
+{
+   static const uint16_t code[] = {
+      0x203C, 0x0000, 0x8000,          //        move.l  #$8000,d0
+      0x4E7B, 0x0002,                  //        movec   d0,cacr      the cache on
+      0x7C00,                          //        moveq   #0,d6
+      0x7A00,                          //        moveq   #0,d5
+      0x7E63,                          //        moveq   #99,d7
+      0x43F9, SUB >> 16, SUB & 0xFFFF, //        lea     SUB,a1
+      0x4E91,                          // loop1: jsr     (a1)         SUB a block of its own
+      0x3F3C, 0x0000,                  //        move.w  #0,-(sp)     format 0
+      0x487A, 0x0008,                  //        pea     trace(pc)
+      0x3F3C, 0xA700,                  //        move.w  #$A700,-(sp) T1
+      0x4E73,                          //        rte
+      0x4E71,                          // trace: nop
+      0x46FC, 0x2700,                  //        move    #$2700,sr
+      0x51CF, 0xFFE8,                  //        dbra    d7,loop1
+      0x007C, 0x1000,                  //        ori     #$1000,sr    M
+      0x33FC, 0x5486, SUB >> 16, SUB & 0xFFFF,  // move.w #$5486,SUB  addq.l #1,d6 -> addq.l #2,d6
+      0x027C, 0xEFFF,                  //        andi    #$EFFF,sr
+      0xF498,                          //        cinva   ic
+      0x7E63,                          //        moveq   #99,d7
+      0x7C00,                          //        moveq   #0,d6
+      0x4E91,                          // loop2: jsr     (a1)
+      0x51CF, 0xFFFC,                  //        dbra    d7,loop2
+      0x41FA, 0xFFFE,                  // END:   lea     END(pc),a0
+      0x4ED0,                          //        jmp     (a0)         a BRA would not end the block
+   };
+   static const uint16_t sub[] = { 0x5286, 0x4E75 };    // addq.l #1,d6, rts
+   static const uint16_t trace[] = { 0x5285, 0x4E73 };  // addq.l #1,d5, rte
+   static const uint16_t err[] = { 0x41FA, 0xFFFE, 0x4ED0 };  // lea *(pc),a0, jmp (a0)
+
+   for (int i = 0; i < MEMORY_BANKS; i++)
+      mem_banks[i] = i >= (RAM >> 16) && i < (RAM_END >> 16) ? &drct_bank : &dmmy_bank;
+   for (int v = 2; v < 256; v++)
+      do_put_mem_long((uae_u32 *)(uintptr_t)(RAM + v * 4), ERR);
+   do_put_mem_long((uae_u32 *)(uintptr_t)(RAM + 9 * 4), TRACE);
+   load(CODE, code, sizeof(code) / 2);
+   load(SUB, sub, 2);
+   load(TRACE, trace, 2);
+   load(ERR, err, 3);
+}
+
+// as uae_emulator() starts the CPU, with the JIT on
+static void run(void)
+{
+   currprefs.cpu_model              = changed_prefs.cpu_model = 68040;
+   currprefs.fpu_model              = changed_prefs.fpu_model = 0;
+   currprefs.mmu_model              = changed_prefs.mmu_model = 0;
+   currprefs.cpu_compatible         = changed_prefs.cpu_compatible = false;
+   currprefs.address_space_24       = changed_prefs.address_space_24 = false;
+   currprefs.cpu_cycle_exact        = changed_prefs.cpu_cycle_exact = false;
+   currprefs.cpu_memory_cycle_exact = changed_prefs.cpu_memory_cycle_exact = false;
+   currprefs.m68k_speed             = changed_prefs.m68k_speed = -1;
+   currprefs.comptrustbyte          = changed_prefs.comptrustbyte = true;
+   currprefs.cachesize              = changed_prefs.cachesize = 1024;
+   shared->jit_enabled = 1;
+
+   m68k_reset_newcpu(1);
+   init_m68k();
+   build_cpufunctbl();
+   pushall_call_handler = (void *)jit_host_run;
+   regs.vbr = RAM;
+   regs.s = 1;
+   regs.intmask = 7;
+   regs.isp = m68k_areg(regs, 7) = STACK;
+   regs.msp = STACK - 0x1000;
+   MakeSR();
+   m68k_setpc_normal(CODE);
+   fill_prefetch_quick();
+   set_cycles(start_cycles);
+   regs.stopped = false;
+   set_special(0);
+   jit_host_insn_hook = insn;
+   if (!setjmp(done))
+      m68k_go(1);
+   jit_host_insn_hook = NULL;
+}
+
+int main(int argc, char **argv)
+{
+   if (mmap((void *)RAM, RAM_END - RAM, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0) != (void *)RAM) {
+      printf("no memory at 0x%08x\n", RAM);
+      return(1);
+   }
+   boot();
+   run();
+   CHECK(stopped == END, "stopped at 0x%08lx", (unsigned long)stopped);
+   CHECK(jit_host_blocks > 100, "%u blocks run", jit_host_blocks);
+   CHECK(traced == 0, "%u instructions of a block run with T0, T1 or M set", traced);
+   CHECK(stale == 0, "%u instructions of a block not the one in memory", stale);
+   CHECK(m68k_dreg(regs, 6) == 200, "patched subroutine: d6 %u", m68k_dreg(regs, 6));
+   CHECK(m68k_dreg(regs, 5) == 100, "%u traces", m68k_dreg(regs, 5));
+   printf("%u blocks, %u instructions run from them\n", jit_host_blocks, jit_host_insns);
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
@@ -0,0 +1,107 @@
+/*
+ * jit_pages_test.cc
+ *
+ *  The page marks of the JIT (jit/compemu_pages.cc) that tell a cache flush
+ *  which blocks may have been written:
+ *  - after jit_pages_init() no page of the 4 GB is marked
+ *  - a mark is seen by any range on its page and by a range starting up to
+ *    JIT_PAGE_SLACK bytes into the next page (a store straddling the pages),
+ *    not by the ranges around it
+ *  - jit_pages_clean() clears the pages of its range and the slack
+ *  - the first and last pages of the address space
+ *  - random marks, checks and cleans against a plain set of pages
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sysconfig.h"
+#include "sysdeps.h"
+#include "jit/compemu_pages.h"
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+static bool marked_ref[JIT_PAGE_COUNT];
+
+static uae_u32 first_page(uaecptr start)
+{
+   return(start < JIT_PAGE_SLACK ? 0 : (start - JIT_PAGE_SLACK) >> JIT_PAGE_SHIFT);
+}
+
+static void test_marks(void)
+{
+   jit_pages_init();
+   uae_u32 marked = 0;
+   for (uae_u32 p = 0; p < JIT_PAGE_COUNT; p++)
+      marked += jit_page_written[p] == (uae_u8)p;
+   CHECK(marked == 0, "%u pages marked after init", marked);
+   CHECK(!jit_pages_written(0x08001000, 0x100), "written after init");
+
+   jit_page_mark(0x08001234);
+   CHECK(jit_pages_written(0x08001000, 0x100), "start of the page");
+   CHECK(jit_pages_written(0x08001ff0, 0x100), "range into the next page");
+   CHECK(!jit_pages_written(0x08002100, 0x100), "next page");
+   CHECK(!jit_pages_written(0x08000000, 0x800), "page before");
+   CHECK(jit_pages_written(0x08002000 + JIT_PAGE_SLACK - 4, 0x40), "straddling store not seen");
+   CHECK(!jit_pages_written(0x08002000 + JIT_PAGE_SLACK, 0x40), "after the slack");
+   jit_pages_clean(0x08001100, 0x10);
+   CHECK(!jit_pages_written(0x08001000, 0x1000), "not cleaned");
+
+   jit_page_mark(0x4012fffc);
+   CHECK(jit_pages_written(0x40100000, 0x40000), "256 KB range");
+   CHECK(!jit_pages_written(0x40130010, 0x40000), "256 KB range after");
+   jit_pages_clean(0x40100000, 0x40000);
+   CHECK(!jit_pages_written(0x40100000, 0x40000), "256 KB range not cleaned");
+
+   jit_page_mark(0);
+   CHECK(jit_pages_written(4, 8), "page 0");
+   jit_pages_clean(4, 8);
+   CHECK(!jit_pages_written(0, 8), "page 0 not cleaned");
+   jit_page_mark(0xfffff000);
+   CHECK(jit_pages_written(0xfffff100, 0x100), "last page");
+   jit_pages_clean(0xfffff100, 0xf00);
+   CHECK(!jit_pages_written(0xfffff000, 0x1000), "last page not cleaned");
+
+   CHECK(!jit_pages_foreign, "foreign write after init");
+   jit_pages_foreign_write();
+   CHECK(jit_pages_foreign, "foreign write not seen");
+}
+
+static void test_random(void)
+{
+   jit_pages_init();
+   srand(1);
+   for (int i = 0; i < 200000; i++) {
+      uaecptr a = ((uae_u32)rand() << 8) ^ rand();
+      if (rand() & 1) {
+         jit_page_mark(a);
+         marked_ref[a >> JIT_PAGE_SHIFT] = true;
+         continue;
+      }
+      uae_u32 len = 1 + rand() % 20000;
+      if ((uae_u64)a + len > 0x100000000ull)
+         continue;
+      bool written = false;
+      for (uae_u32 p = first_page(a); p <= (a + len - 1) >> JIT_PAGE_SHIFT; p++)
+         written |= marked_ref[p];
+      if (jit_pages_written(a, len) != written) {
+         CHECK(0, "operation %d: 0x%08x %u bytes, %d expected", i, a, len, written);
+         return;
+      }
+      if (rand() % 4 == 0) {
+         jit_pages_clean(a, len);
+         for (uae_u32 p = first_page(a); p <= (a + len - 1) >> JIT_PAGE_SHIFT; p++)
+            marked_ref[p] = false;
+      }
+   }
+}
+
+int main(int argc, char **argv)
+{
+   test_marks();
+   test_random();
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
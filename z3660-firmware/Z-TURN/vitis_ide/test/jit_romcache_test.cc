@@ -0,0 +1,209 @@
+/*
+ * jit_romcache_test.cc
+ *
+ *  The Kickstart traces of the JIT kept across boots (jit/compemu_romcache.cc),
+ *  the buffer at its firmware address:
+ *  - random traces added, sealed, copied as core0 saves and loads them and
+ *    opened again: jit_romcache_get() gives back each trace as it was added,
+ *    in order. A trace starting where a saved one starts and a trace out of
+ *    the ROM are not added
+ *  - another ROM or JIT build, a byte changed, a truncated file or a file
+ *    bigger than the buffer: the buffer is dropped and starts empty
+ *  - jit_romcache_init() then jit_romcache_tick(): the buffer is handed to
+ *    core0 after JIT_ROMCACHE_QUIET blocks without a new trace, nothing is
+ *    added while core0 saves it, the next boot loads it with the same keys
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <vector>
+#include "sysconfig.h"
+#include "sysdeps.h"
+#include "options.h"
+#include "include/memory.h"
+#include "newcpu.h"
+#include "jit/compemu.h"
+#include "jit/compemu_romcache.h"
+#include "main.h"
+#include "memorymap.h"
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+// what the module takes from the emulator and core0
+static SHARED host_shared;
+SHARED *shared = &host_shared;
+LOCAL local;
+static uint8_t rom[0x80000];
+uint8_t *ROM = rom;
+
+static uae_u32 h1(uae_u32) { return(0); }
+static uae_u32 h2(uae_u32) { return(0); }
+extern const struct comptbl op_smalltbl_0_comp_ff[] = { { h1, 0, 1 }, { h2, 0, 2 }, { 0, 0, 65536 } };
+extern const struct comptbl op_smalltbl_0_comp_nf[] = { { h2, 0, 1 }, { 0, 0, 65536 } };
+
+extern "C" void z3660_printf(const TCHAR *format, ...)
+{
+}
+
+static uae_u8 *buf;             // the buffer at JIT_ROMCACHE_ADDRESS
+static uae_u8 file[JIT_ROMCACHE_SIZE];
+
+struct trace {
+   int cycles;
+   std::vector<uae_u32> location;
+   std::vector<uae_u8> specmem;
+};
+static cpu_history hist[MAXRUN];
+
+static void to_hist(const trace &t)
+{
+   for (size_t i = 0; i < t.location.size(); i++) {
+      hist[i].location = (uae_u16 *)(uintptr_t)t.location[i];
+      hist[i].specmem = t.specmem[i];
+   }
+}
+
+static trace random_trace(void)
+{
+   trace t;
+   int len = 1 + (rand() % 8 == 0 ? rand() % MAXRUN : rand() % 20);
+   t.cycles = rand() % 100000;
+   for (int i = 0; i < len; i++) {
+      t.location.push_back(0xF80000 + (rand() % 0x40000) * 2);
+      t.specmem.push_back(rand());
+   }
+   return(t);
+}
+
+static void test_round_trip(int round)
+{
+   std::vector<trace> added;
+
+   memset(buf, 0xAA, JIT_ROMCACHE_SIZE);
+   CHECK(jit_romcache_open(buf, JIT_ROMCACHE_SIZE, 0, 123, 456) == 0, "round %d: empty buffer not empty", round);
+   int n = 1 + rand() % 3000;
+   for (int k = 0; k < n; k++) {
+      trace t = random_trace();
+      to_hist(t);
+      if (jit_romcache_add(hist, t.location.size(), t.cycles))
+         added.push_back(t);
+   }
+   if (!added.empty()) {
+      to_hist(added[0]);
+      CHECK(!jit_romcache_add(hist, added[0].location.size(), 1), "round %d: trace added twice", round);
+   }
+   trace ram = { 1, { 0x08000000 }, { 0 } };
+   to_hist(ram);
+   CHECK(!jit_romcache_add(hist, 1, 1), "round %d: trace out of the ROM added", round);
+
+   uae_u32 size = jit_romcache_seal();
+   memcpy(file, buf, size);
+   memset(buf, 0x55, JIT_ROMCACHE_SIZE);
+   memcpy(buf, file, size);
+   uae_u32 count = jit_romcache_open(buf, JIT_ROMCACHE_SIZE, size, 123, 456);
+   CHECK(count == added.size(), "round %d: %u traces loaded, %zu added", round, count, added.size());
+
+   uae_u32 pos = 0;
+   int cycles, len;
+   size_t k = 0;
+   while ((len = jit_romcache_get(&pos, hist, &cycles)) > 0 && k < added.size()) {
+      const trace &t = added[k++];
+      bool same = len == (int)t.location.size() && cycles == t.cycles;
+      for (int i = 0; same && i < len; i++)
+         same = (uae_u32)(uintptr_t)hist[i].location == t.location[i] && hist[i].specmem == t.specmem[i];
+      if (!same) {
+         CHECK(0, "round %d: trace %zu differs", round, k - 1);
+         return;
+      }
+   }
+   CHECK(k == added.size(), "round %d: %zu traces read, %zu added", round, k, added.size());
+   if (!added.empty()) {
+      to_hist(added.back());
+      CHECK(!jit_romcache_add(hist, added.back().location.size(), 1), "round %d: loaded trace added again", round);
+   }
+
+   memcpy(buf, file, size);
+   CHECK(jit_romcache_open(buf, JIT_ROMCACHE_SIZE, size, 124, 456) == 0, "round %d: other JIT build", round);
+   memcpy(buf, file, size);
+   CHECK(jit_romcache_open(buf, JIT_ROMCACHE_SIZE, size, 123, 457) == 0, "round %d: other ROM", round);
+   if (size > sizeof(jit_romcache_header)) {
+      memcpy(buf, file, size);
+      buf[sizeof(jit_romcache_header) + rand() % (size - sizeof(jit_romcache_header))] ^= 1 + rand() % 255;
+      CHECK(jit_romcache_open(buf, JIT_ROMCACHE_SIZE, size, 123, 456) == 0, "round %d: changed byte", round);
+      memcpy(buf, file, size);
+      CHECK(jit_romcache_open(buf, JIT_ROMCACHE_SIZE, size - 4, 123, 456) == 0, "round %d: truncated", round);
+   }
+   CHECK(jit_romcache_open(buf, JIT_ROMCACHE_SIZE, JIT_ROMCACHE_SIZE + 1, 123, 456) == 0, "round %d: too big", round);
+}
+
+// the keys jit_romcache_init() opens the buffer with
+static void keys(uae_u32 *build_id, uae_u32 *rom_hash)
+{
+   *build_id = jit_romcache_hash(2166136261u, "JIT", 3) ^ JIT_ROMCACHE_VERSION;
+   for (int i = 0; op_smalltbl_0_comp_ff[i].opcode < 65536; i++)
+      *build_id = jit_romcache_hash(*build_id, &op_smalltbl_0_comp_ff[i].handler, sizeof(compop_func *));
+   for (int i = 0; op_smalltbl_0_comp_nf[i].opcode < 65536; i++)
+      *build_id = jit_romcache_hash(*build_id, &op_smalltbl_0_comp_nf[i].handler, sizeof(compop_func *));
+   *rom_hash = jit_romcache_hash(2166136261u, ROM, sizeof(rom));
+}
+
+static void test_save(void)
+{
+   memset(buf, 0, JIT_ROMCACHE_SIZE);
+   shared->jit_romcache_size = 0;
+   shared->jit_romcache_save = 0;
+   local.load_rom_emu = 1;
+   jit_romcache_init();
+   CHECK(!jit_romcache_replay, "replay of an empty buffer");
+
+   trace t = { 7, { 0xF80010, 0xF80012 }, { 1, 2 } };
+   to_hist(t);
+   CHECK(jit_romcache_add(hist, 2, 7), "trace not added");
+   for (int i = 0; i < JIT_ROMCACHE_QUIET - 1; i++)
+      jit_romcache_tick();
+   CHECK(!shared->jit_romcache_save, "saved before %d quiet blocks", JIT_ROMCACHE_QUIET);
+   jit_romcache_tick();
+   CHECK(shared->jit_romcache_save == 1, "not saved after %d quiet blocks", JIT_ROMCACHE_QUIET);
+   uae_u32 size = shared->jit_romcache_size;
+   memcpy(file, buf, size);
+
+   trace busy = { 7, { 0xF80020 }, { 0 } };
+   to_hist(busy);
+   CHECK(!jit_romcache_add(hist, 1, 7), "trace added while core0 saves");
+   shared->jit_romcache_save = 0;
+
+   // the next boot: core0 loaded the file, the same ROM and build
+   uae_u32 build_id, rom_hash;
+   keys(&build_id, &rom_hash);
+   memset(buf, 0, JIT_ROMCACHE_SIZE);
+   memcpy(buf, file, size);
+   CHECK(jit_romcache_open(buf, JIT_ROMCACHE_SIZE, size, build_id, rom_hash) == 1, "saved trace not loaded");
+   uae_u32 pos = 0;
+   int cycles;
+   CHECK(jit_romcache_get(&pos, hist, &cycles) == 2 && cycles == 7 && (uintptr_t)hist[1].location == 0xF80012,
+         "saved trace differs");
+}
+
+int main(int argc, char **argv)
+{
+   buf = (uae_u8 *)mmap((void *)JIT_ROMCACHE_ADDRESS, JIT_ROMCACHE_SIZE, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+   if (buf != (uae_u8 *)JIT_ROMCACHE_ADDRESS) {
+      printf("can't map the buffer at 0x%08X\n", JIT_ROMCACHE_ADDRESS);
+      return(2);
+   }
+   srand(1);
+   for (size_t i = 0; i < sizeof(rom); i++)
+      rom[i] = rand();
+
+   test_save(); // first: jit_romcache_init() opens the buffer only once
+   for (int round = 0; round < 50; round++)
+      test_round_trip(round);
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
@@ -0,0 +1,289 @@
+/*
+ * m68k_dcache_test.cc
+ *
+ *  The decode cache of Musashi (M68K_DECODE_CACHE in musashi/m68kconf.h).
+ *  Built twice by the Makefile, with the cache and without it: the build
+ *  without it writes the register traces to the file given, the one with
+ *  it runs the same code and compares.
+ *  - random memory run as 68040 code from a reset, one instruction at a
+ *    time, on pages the host can point to and on pages it can't: the same
+ *    registers after every instruction, whatever the code writes over
+ *    itself, with blocks of memory changed behind the CPU and
+ *    m68k_dcache_flush() now and then
+ *  - a loop patching the instruction of a subroutine it calls runs the
+ *    new instruction every time
+ *  - a word written at an odd address drops the instruction at the next
+ *    one
+ *  - operands running into the next page
+ *  - an instruction changed behind the CPU, or a page the memory map moved,
+ *    runs after m68k_dcache_flush()
+ *  The pages are apart on the host, a read past the end of one is caught.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "m68k.h"
+
+#define MEM_SIZE    0x80000  // mirrored over the whole address space
+#define CODE_START  0x10000  // the host points to the pages from here up to MEM_SIZE
+#define PAGE        0x1000   // M68K_DC_PAGE_SIZE
+#define GAP         64       // between the pages on the host, reading it is a bug
+#define ROM         0x14000  // the page the overlay maps to rom
+#define STEPS       4000
+#define SEEDS       200
+
+static uint8_t pool[MEM_SIZE / PAGE * (PAGE + GAP)];
+static uint8_t rom[PAGE + GAP];
+static int ovl;
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+// the host byte behind a 68k address, no two pages next to each other
+static uint8_t *at(uint32_t address)
+{
+   address &= MEM_SIZE - 1;
+   if (ovl && address / PAGE == ROM / PAGE)
+      return(rom + address % PAGE);
+   return(pool + address / PAGE * (PAGE + GAP) + address % PAGE);
+}
+
+static void clear(void)
+{
+   memset(pool, 0xA5, sizeof(pool));
+   for (uint32_t a = 0; a < MEM_SIZE; a++)
+      *at(a) = 0;
+}
+
+extern "C" {
+unsigned int m68k_read_memory_8(unsigned int address)
+{
+   return(*at(address));
+}
+unsigned int m68k_read_memory_16(unsigned int address)
+{
+   return(m68k_read_memory_8(address) << 8 | m68k_read_memory_8(address + 1));
+}
+unsigned int m68k_read_memory_32(unsigned int address)
+{
+   return(m68k_read_memory_16(address) << 16 | m68k_read_memory_16(address + 2));
+}
+void m68k_write_memory_8(unsigned int address, unsigned int value)
+{
+   *at(address) = value;
+}
+void m68k_write_memory_16(unsigned int address, unsigned int value)
+{
+   m68k_write_memory_8(address, value >> 8);
+   m68k_write_memory_8(address + 1, value);
+}
+void m68k_write_memory_32(unsigned int address, unsigned int value)
+{
+   m68k_write_memory_16(address, value >> 16);
+   m68k_write_memory_16(address + 2, value);
+}
+unsigned int m68k_read_immediate_16(unsigned int address) { return(m68k_read_memory_16(address)); }
+unsigned int m68k_read_immediate_32(unsigned int address) { return(m68k_read_memory_32(address)); }
+unsigned int m68k_read_disassembler_8(unsigned int address) { return(m68k_read_memory_8(address)); }
+unsigned int m68k_read_disassembler_16(unsigned int address) { return(m68k_read_memory_16(address)); }
+unsigned int m68k_read_disassembler_32(unsigned int address) { return(m68k_read_memory_32(address)); }
+// not the mirrors: a write through one wouldn't drop what was decoded from another
+const uint8_t *m68k_code_pointer(unsigned int address)
+{
+   return(address >= CODE_START && address < MEM_SIZE ? at(address) : NULL);
+}
+}
+void cpu_emulator_reset(void) {}
+void cpu_set_fc(int fc) {}
+volatile int musashi_slice_end;
+
+static uint32_t reg(m68k_register_t r)
+{
+   return(m68k_get_reg(NULL, r));
+}
+
+static void load(uint32_t address, const uint16_t *code, int words)
+{
+   for (int i = 0; i < words; i++)
+      m68k_write_memory_16(address + i * 2, code[i]);
+}
+
+static void boot(uint32_t pc)
+{
+   m68k_write_memory_32(0, 0x0007FF00);
+   m68k_write_memory_32(4, pc);
+   m68k_pulse_reset();
+}
+
+static void run(int steps)
+{
+   for (int i = 0; i < steps; i++)
+      m68k_execute(1);
+}
+
+static uint64_t trace(uint32_t seed)
+{
+   uint64_t hash = 0xCBF29CE484222325ull;
+   srand(seed);
+   for (uint32_t i = 0; i < MEM_SIZE; i++)
+      *at(i) = rand();
+   boot(seed & 1 ? CODE_START + (rand() & 0x7FFE) : 0x1000 + (rand() & 0x7FFE));
+   for (int step = 0; step < STEPS; step++) {
+      if (step % 500 == 499) {
+         // a block changed behind the CPU, as the SCSI DMA does
+         uint32_t a = rand() % (MEM_SIZE - 256);
+         for (int i = 0; i < 256; i++)
+            *at(a + i) = rand();
+         m68k_dcache_flush();
+      }
+      m68k_execute(1);
+      for (int r = M68K_REG_D0; r <= M68K_REG_SR; r++)
+         hash = (hash ^ reg((m68k_register_t)r)) * 0x100000001B3ull;
+   }
+   return(hash);
+}
+
+static void test_traces(const char *file)
+{
+#if M68K_DECODE_CACHE
+   FILE *f = fopen(file, "r");
+   if (!f) {
+      CHECK(0, "no traces in %s", file);
+      return;
+   }
+   for (uint32_t seed = 0; seed < SEEDS; seed++) {
+      unsigned long long want;
+      if (fscanf(f, "%llx", &want) != 1) {
+         CHECK(0, "%s: %u traces, %u expected", file, seed, SEEDS);
+         break;
+      }
+      uint64_t got = trace(seed);
+      if (got != want) {
+         CHECK(0, "seed %u: the registers differ without the decode cache", seed);
+         break;
+      }
+   }
+#else
+   FILE *f = fopen(file, "w");
+   if (!f) {
+      CHECK(0, "can't write %s", file);
+      return;
+   }
+   for (uint32_t seed = 0; seed < SEEDS; seed++)
+      fprintf(f, "%016llx\n", (unsigned long long)trace(seed));
+#endif
+   fclose(f);
+}
+
+static void test_patch(void)
+{
+   static const uint16_t code[] = {
+      0x7000,                  //       moveq   #0,d0
+      0x7200,                  //       moveq   #0,d1
+      0x41F9, 0x0001, 0x2000,  //       lea     $12000,a0
+      0x30BC, 0x5281,          // loop: move.w  #$5281,(a0)   addq.l #1,d1
+      0x4E90,                  //       jsr     (a0)
+      0x30BC, 0x5481,          //       move.w  #$5481,(a0)   addq.l #2,d1
+      0x4E90,                  //       jsr     (a0)
+      0x5240,                  //       addq.w  #1,d0
+      0xB07C, 0x0064,          //       cmp.w   #100,d0
+      0x66EC,                  //       bne.s   loop
+      0x60FE,                  //       bra.s   *
+   };
+   static const uint16_t sub[] = { 0x4E71, 0x4E75 };  // nop, rts
+
+   clear();
+   load(0x11000, code, sizeof(code) / 2);
+   load(0x12000, sub, 2);
+   boot(0x11000);
+   run(2000);
+   CHECK(reg(M68K_REG_D0) == 100 && reg(M68K_REG_D1) == 300, "patched subroutine: d0 %u d1 %u", reg(M68K_REG_D0),
+         reg(M68K_REG_D1));
+}
+
+static void test_flush(void)
+{
+   static const uint16_t code[] = {
+      0x7401,                  // loop: moveq   #1,d2
+      0x60FC,                  //       bra.s   loop
+   };
+
+   clear();
+   load(0x13000, code, 2);
+   boot(0x13000);
+   run(10);
+   CHECK(reg(M68K_REG_D2) == 1, "d2 %u", reg(M68K_REG_D2));
+   *at(0x13001) = 0x02;        // moveq #2,d2
+   m68k_dcache_flush();
+   run(10);
+   CHECK(reg(M68K_REG_D2) == 2, "changed behind the CPU and flushed: d2 %u", reg(M68K_REG_D2));
+
+   // the memory map changed: the page is somewhere else on the host
+   load(ROM, code, 2);
+   boot(ROM);
+   run(10);
+   memcpy(rom, at(ROM), PAGE);
+   rom[1] = 0x03;              // moveq #3,d2
+   ovl = 1;
+   m68k_dcache_flush();
+   run(10);
+   ovl = 0;
+   CHECK(reg(M68K_REG_D2) == 3, "page mapped somewhere else and flushed: d2 %u", reg(M68K_REG_D2));
+}
+
+static void test_odd(void)
+{
+   static const uint16_t code[] = {
+      0x7200,                          // moveq   #0,d1
+      0x41F9, 0x0001, 0x2000,          // lea     $12000,a0
+      0x4E90,                          // jsr     (a0)
+      0x33FC, 0x0054, 0x0001, 0x1FFF,  // move.w  #$0054,$11FFF   addq.l #1,d1 -> addq.l #2,d1
+      0x4E90,                          // jsr     (a0)
+      0x60FE,                          // bra.s   *
+   };
+   static const uint16_t sub[] = { 0x5281, 0x4E75 };  // addq.l #1,d1, rts
+
+   clear();
+   load(0x11800, code, sizeof(code) / 2);
+   load(0x12000, sub, 2);
+   boot(0x11800);
+   run(20);
+   CHECK(reg(M68K_REG_D1) == 3, "word written at an odd address: d1 %u", reg(M68K_REG_D1));
+}
+
+static void test_cross(void)
+{
+   static const uint16_t code[] = {
+      0x263C, 0x1234, 0x5678,          // move.l  #$12345678,d3   at the end of a page
+      0x4EF9, 0x0001, 0x5FFE,          // jmp     $15FFE
+   };
+   static const uint16_t last[] = {
+      0x383C, 0xABCD,                  // move.w  #$ABCD,d4       the last word of a page
+      0x60FE,                          // bra.s   *
+   };
+
+   clear();
+   load(0x14FFC, code, sizeof(code) / 2);
+   load(0x15FFE, last, sizeof(last) / 2);
+   boot(0x14FFC);
+   run(5);
+   CHECK(reg(M68K_REG_D3) == 0x12345678 && reg(M68K_REG_D4) == 0xABCD, "operands across pages: d3 0x%08x d4 0x%08x",
+         reg(M68K_REG_D3), reg(M68K_REG_D4));
+}
+
+int main(int argc, char **argv)
+{
+   freopen("/dev/null", "w", stderr);   // the core's complaints about the random code
+   m68k_set_cpu_type(M68K_CPU_TYPE_68040);
+   m68k_init();
+   test_patch();
+   test_flush();
+   test_odd();
+   test_cross();
+   test_traces(argc > 1 ? argv[1] : "m68k_dcache.trace");
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
@@ -0,0 +1,226 @@
+/*
+ * mp3_decode_test.c
+ *
+ *  decode_mp3_samples() in FIFO mode (the MHI way) against the plain
+ *  mp3dec_ex_read() of the whole file: the output has to be bit identical,
+ *  whatever the room for the read-ahead, with the read-ahead parked (ring
+ *  silenced) and the ring restarted elsewhere. After decode_mp3_drop_ahead()
+ *  (ring collision) the output goes on right after the dropped samples,
+ *  nothing is played twice. A read callback that returns too much stops the
+ *  decoder with MP3D_E_IOERROR.
+ *
+ *  Then the time per period with the direct decode and with the
+ *  mp3dec_ex_read_frame() copy (no room for a whole frame).
+ *
+ *  Usage: mp3_decode_test file.mp3
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mp3/mp3.h"
+#include "mp3/minimp3_ex.h"
+
+#define FIFO_SIZE (64*1024)
+#define PERIOD_SAMPLES 1920 // 20 ms at 48 kHz, stereo
+#define PERIODS 8
+
+extern mp3dec_ex_t mp3d;
+extern mp3dec_io_t mp3io;
+
+static uint8_t* file;
+static size_t file_size;
+static int16_t* ref;
+static size_t ref_samples;
+
+static uint8_t fifo[FIFO_SIZE];
+static size_t file_pos;
+static unsigned long write_idx;
+static int16_t ring[PERIODS * PERIOD_SAMPLES + MP3_FRAME_ROOM_SAMPLES];
+static int failures;
+static int drops; // read-aheads dropped, only the direct decode makes them
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+// what the driver does in fillFifo(): top up the FIFO as far as it is read
+static void fill_fifo(void)
+{
+   unsigned long r = fifo_get_read_index();
+   while (file_pos < file_size && (write_idx + 1) % FIFO_SIZE != r) {
+      fifo[write_idx] = file[file_pos++];
+      write_idx = (write_idx + 1) % FIFO_SIZE;
+   }
+   fifo_set_write_index(write_idx);
+}
+
+static void start(void)
+{
+   file_pos = 0;
+   write_idx = 0;
+   fifo_clear();
+   fill_fifo();
+   decode_mp3_init_fifo(fifo, FIFO_SIZE);
+}
+
+static void make_reference(void)
+{
+   mp3dec_ex_t dec;
+   if (mp3dec_ex_open_buf(&dec, file, file_size, MP3D_DO_NOT_SCAN)) {
+      printf("can't open the reference decoder\n");
+      exit(1);
+   }
+   size_t max = file_size * 200; // > 1152*2 samples per 48 bytes frame
+   ref = malloc(max * sizeof(int16_t));
+   ref_samples = mp3dec_ex_read(&dec, ref, max);
+   mp3dec_ex_close(&dec);
+}
+
+// compare one period with the reference at pos, the part after the end
+// of the stream has to be silence
+static void check_period(const int16_t* out, size_t pos, int bytes, int seed, int k)
+{
+   int samples = bytes / 2;
+   size_t n = pos < ref_samples ? ref_samples - pos : 0;
+   if (n > PERIOD_SAMPLES)
+      n = PERIOD_SAMPLES;
+   CHECK(samples == (int)n, "seed %d period %d: %d samples, %zu expected", seed, k, samples, n);
+   CHECK(memcmp(out, ref + pos, n * 2) == 0, "seed %d period %d: PCM differs at %zu", seed, k, pos);
+   for (int i = n; i < PERIOD_SAMPLES; i++)
+      if (out[i]) {
+         CHECK(0, "seed %d period %d: not silenced at %d", seed, k, i);
+         break;
+      }
+}
+
+static void test_stream(int seed)
+{
+   srand(seed);
+   start();
+   size_t pos = 0;
+   int period = 0;
+
+   for (int k = 0; pos < ref_samples; k++) {
+      int16_t* out = ring + period * PERIOD_SAMPLES;
+      // as much room as the played periods after this one (audio_ring_space())
+      int played = PERIODS - 1 - period;
+      int room = PERIOD_SAMPLES;
+      if (played)
+         room += (rand() % (played < 3 ? played + 1 : 3)) * PERIOD_SAMPLES;
+      else
+         room += rand() % 2 ? MP3_FRAME_ROOM_SAMPLES : 0;
+
+      fill_fifo();
+      int bytes = decode_mp3_samples(out, PERIOD_SAMPLES, room);
+      check_period(out, pos, bytes, seed, k);
+      pos += PERIOD_SAMPLES;
+
+      switch (rand() % 16) {
+      case 0:
+         // audio_silence(): the ring is cleared
+         decode_mp3_park_ahead();
+         memset(ring, 0, sizeof(ring));
+         break;
+      case 1:
+         // overrun restart, the read-ahead was not played where it is
+         period = 0;
+         continue;
+      case 2:
+         // ring collision: the read-ahead is played where it is, the next
+         // period has to start after it
+         decode_mp3_drop_ahead();
+         if (pos != mp3d.cur_sample)
+            drops++;
+         pos = mp3d.cur_sample;
+         period = 0;
+         continue;
+      }
+      period = (period + 1) % PERIODS;
+   }
+}
+
+static size_t read_too_much(void* buf, size_t size, void* user_data)
+{
+   memset(buf, 0x55, size);
+   return(size + 1);
+}
+
+static void test_ioerror(void)
+{
+   start();
+   int16_t* out = ring;
+   int bytes = decode_mp3_samples(out, PERIOD_SAMPLES, PERIOD_SAMPLES + MP3_FRAME_ROOM_SAMPLES);
+   CHECK(bytes == PERIOD_SAMPLES * 2, "first period: %d bytes", bytes);
+
+   // the input buffer is kept filled beyond MINIMP3_BUF_SIZE, use up to
+   // 64 periods to get to the next read
+   mp3io.read = read_too_much;
+   for (int k = 0; k < 64 && !mp3d.last_error; k++)
+      bytes = decode_mp3_samples(out, PERIOD_SAMPLES, PERIOD_SAMPLES + MP3_FRAME_ROOM_SAMPLES);
+   CHECK(mp3d.last_error == MP3D_E_IOERROR, "last_error %d", mp3d.last_error);
+   CHECK(mp3d.input_filled <= mp3d.file.size, "input_filled %zu > %zu", mp3d.input_filled, mp3d.file.size);
+   // what was decoded before the error is still played, then nothing
+   int after = 0;
+   for (int k = 0; k < 3; k++)
+      after += decode_mp3_samples(out, PERIOD_SAMPLES, PERIOD_SAMPLES + MP3_FRAME_ROOM_SAMPLES);
+   CHECK(after <= MINIMP3_MAX_SAMPLES_PER_FRAME * 2, "%d bytes decoded after the error", after);
+   mp3dec_ex_close(&mp3d);
+}
+
+static double bench(int room)
+{
+   struct timespec t0, t1;
+   int periods = 0;
+   clock_gettime(CLOCK_MONOTONIC, &t0);
+   for (int rep = 0; rep < 20; rep++) {
+      start();
+      for (size_t pos = 0; pos < ref_samples; pos += PERIOD_SAMPLES, periods++) {
+         fill_fifo();
+         decode_mp3_samples(ring, PERIOD_SAMPLES, room);
+      }
+      mp3dec_ex_close(&mp3d);
+   }
+   clock_gettime(CLOCK_MONOTONIC, &t1);
+   return(((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / periods);
+}
+
+int main(int argc, char** argv)
+{
+   if (argc != 2) {
+      printf("usage: %s file.mp3\n", argv[0]);
+      return(2);
+   }
+   FILE* f = fopen(argv[1], "rb");
+   if (!f) {
+      printf("can't open %s\n", argv[1]);
+      return(2);
+   }
+   fseek(f, 0, SEEK_END);
+   file_size = ftell(f);
+   fseek(f, 0, SEEK_SET);
+   file = malloc(file_size);
+   if (fread(file, 1, file_size, f) != file_size) {
+      printf("can't read %s\n", argv[1]);
+      return(2);
+   }
+   fclose(f);
+
+   make_reference();
+
+   for (int seed = 0; seed < 40; seed++) {
+      test_stream(seed);
+      if (seed == 0)
+         printf("%zu bytes, %d Hz, %zu samples\n", file_size, mp3_get_hz(), ref_samples);
+      mp3dec_ex_close(&mp3d);
+   }
+   CHECK(drops, "no read-ahead dropped");
+   test_ioerror();
+
+   double direct = bench(PERIOD_SAMPLES + MP3_FRAME_ROOM_SAMPLES);
+   double copy = bench(PERIOD_SAMPLES);
+   printf("per period: %.0f ns direct, %.0f ns through the frame buffer\n", direct, copy);
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
@@ -0,0 +1,19 @@
+/*
+ * musashi_host.h
+ *
+ *  The Musashi configuration of the host tests (MUSASHI_CNF): the one of
+ *  the firmware, with the decode cache off when HOST_DECODE_CACHE_OFF is
+ *  defined, and the memory of the test (m68k_dcache_test.cc) behind it.
+ */
+
+#ifndef MUSASHI_HOST_H_
+#define MUSASHI_HOST_H_
+
+#include "m68kconf.h"
+
+#ifdef HOST_DECODE_CACHE_OFF
+#undef M68K_DECODE_CACHE
+#define M68K_DECODE_CACHE OPT_OFF
+#endif
+
+#endif /* MUSASHI_HOST_H_ */
@@ -0,0 +1,173 @@
+/*
+ * musashi_irq_test.cc
+ *
+ *  The slices of the Musashi loop (musashi_slice() in cpu_emulator.cc),
+ *  run by the real Musashi from chip RAM on the mock bus of bus_host.cc,
+ *  with a simulated IRQ source asserting a random level now and then
+ *  from the middle of a bus cycle, as the GPIO interrupt does, and
+ *  dropping it when the handler writes INTREQ:
+ *  - every IRQ is taken, within a few bus cycles of its assertion
+ *  - the level dropping is seen before the handler returns, no IRQ is
+ *    taken twice
+ *  - without IRQs the slices grow to MUSASHI_SLICE_MAX
+ *  The latency and the cycles per slice are printed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bus_host.h"
+#include "main.h"
+#include "m68k.h"
+
+// as in cpu_emulator.cc
+#define MUSASHI_SLICE_MAX 3200
+
+extern "C" {
+extern int ovl;
+void bus_timing_check(void);
+void musashi_slice(void);
+void musashi_irq_changed(void);
+}
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+#define MAIN        0x00000400
+#define HANDLER     0x00000500
+#define INTREQ      0x00DFF09C
+#define LATENCY_MAX 16         // bus cycles, the instruction the IRQ lands in and the exception
+
+// the IRQ source, the time is in bus cycles
+static struct {
+   int on;
+   int level;
+   uint64_t now, next, asserted;
+   int pending;                // asserted, its vector not read yet
+   uint32_t asserted_n, taken;
+   uint64_t latency_sum, latency_max;
+} irq;
+
+static void ipl(int level)
+{
+   if (bus_host_ipl != level) {
+      bus_host_ipl = level;
+      musashi_irq_changed();
+   }
+}
+
+static void source(const BUS_HOST_CYCLE *c)
+{
+   irq.now++;
+   if (c->write && c->address == INTREQ) {
+      irq.level = 0;
+      irq.next = irq.now + 200 + rand() % 5000;
+      ipl(0);
+      return;
+   }
+   if (irq.pending && !c->write && c->address == 0x60u + 4 * irq.level) {
+      uint64_t l = irq.now - irq.asserted;
+      irq.latency_sum += l;
+      if (l > irq.latency_max)
+         irq.latency_max = l;
+      irq.taken++;
+      irq.pending = 0;
+   }
+   if (irq.on && irq.level == 0 && irq.now >= irq.next) {
+      irq.level = 1 + rand() % 6;
+      irq.asserted = irq.now;
+      irq.asserted_n++;
+      irq.pending = 1;
+      ipl(irq.level);
+   }
+}
+
+static void w16(uint32_t address, uint16_t v)
+{
+   bus_host_ram(address)[0] = v >> 8;
+   bus_host_ram(address)[1] = v;
+}
+
+static void w32(uint32_t address, uint32_t v)
+{
+   w16(address, v >> 16);
+   w16(address + 2, v);
+}
+
+static void boot(void)
+{
+   static const uint16_t code[] = {
+      0x46FC, 0x2000,          //       move    #$2000,sr
+      0x207C, 0x0000, 0x1000,  //       movea.l #$1000,a0
+      0x5280,                  // loop: addq.l  #1,d0
+      0x2080,                  //       move.l  d0,(a0)
+      0x60FA,                  //       bra.s   loop
+   };
+   static const uint16_t handler[] = {
+      0x33FC, 0x0001, 0x00DF, 0xF09C,  // move.w  #1,INTREQ
+      0x5287,                          // addq.l  #1,d7
+      0x4E73,                          // rte
+   };
+
+   w32(0, 0x00008000);
+   w32(4, MAIN);
+   for (int v = 25; v <= 31; v++)
+      w32(v * 4, HANDLER);
+   for (unsigned i = 0; i < sizeof(code) / 2; i++)
+      w16(MAIN + i * 2, code[i]);
+   for (unsigned i = 0; i < sizeof(handler) / 2; i++)
+      w16(HANDLER + i * 2, handler[i]);
+   m68k_set_cpu_type(M68K_CPU_TYPE_68030);
+   m68k_init();
+   m68k_pulse_reset();
+}
+
+static void test_latency(void)
+{
+   memset(&irq, 0, sizeof(irq));
+   irq.on = 1;
+   irq.next = 1000;
+   while (irq.now < 2000000)
+      musashi_slice();
+   irq.on = 0;
+   CHECK(irq.asserted_n > 200, "only %u IRQs", irq.asserted_n);
+   CHECK(irq.taken + irq.pending == irq.asserted_n, "%u IRQs, %u taken", irq.asserted_n, irq.taken);
+   CHECK(m68k_get_reg(NULL, M68K_REG_D7) == irq.taken, "handler run %u times, %u IRQs taken",
+         m68k_get_reg(NULL, M68K_REG_D7), irq.taken);
+   CHECK(irq.latency_max <= LATENCY_MAX, "IRQ latency up to %llu bus cycles", (unsigned long long)irq.latency_max);
+}
+
+static double test_slices(void)
+{
+   // the cycles of the loop, from a slice run straight
+   uint32_t d0 = m68k_get_reg(NULL, M68K_REG_D0);
+   int cycles = m68k_execute(1000000);
+   double per_loop = (double)cycles / (m68k_get_reg(NULL, M68K_REG_D0) - d0);
+
+   ipl(0);
+   musashi_slice();
+   d0 = m68k_get_reg(NULL, M68K_REG_D0);
+   for (int i = 0; i < 100; i++)
+      musashi_slice();
+   double per_slice = (m68k_get_reg(NULL, M68K_REG_D0) - d0) * per_loop / 100;
+   CHECK(per_slice > MUSASHI_SLICE_MAX * 0.9, "%.0f cycles per slice without IRQs", per_slice);
+   return(per_slice);
+}
+
+int main(int argc, char **argv)
+{
+   srand(47);
+   bus_host_reset();
+   bus_host_cycle_hook = source;
+   ovl = 0;
+   boot();
+   bus_timing_check();   // as musashi_emulator() does first
+   test_latency();
+   double per_slice = test_slices();
+   printf("IRQ latency %.1f bus cycles, at most %llu, %.0f cycles per slice without IRQs\n",
+          irq.taken ? (double)irq.latency_sum / irq.taken : 0.0, (unsigned long long)irq.latency_max, per_slice);
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
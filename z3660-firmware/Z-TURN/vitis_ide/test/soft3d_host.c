@@ -0,0 +1,66 @@
+/*
+ * soft3d_host.c
+ *
+ *  What soft3d56.c and wazp3d/heap.c need on the host: the RTG memory at
+ *  its firmware address (the heap and the pointers given to the 68k are
+ *  32 bit), core1 as a thread, memcpy_neon() and the debug console.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "xil_types.h"
+#include "debug_console.h"
+#include "memorymap.h"
+#include "wazp3d/heap.h"
+#include "soft3d_host.h"
+
+DEBUG_CONSOLE debug_console;
+int host_core1 = 1;
+
+static pthread_t core1;
+static void (*core1_job)(void *);
+static void *core1_arg;
+
+void soft3d_host_init(void)
+{
+   size_t size = Z3_SOFT3D_ADDR_BUFFERS + HEAP_SIZE_BYTES - RTG_BASE;
+   void *p = mmap((void *)RTG_BASE, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+   if (p != (void *)RTG_BASE) {
+      printf("can't map the RTG memory at 0x%08X\n", RTG_BASE);
+      exit(2);
+   }
+}
+
+void *(memcpy_neon)(void *s1, const void *s2, u32 n)
+{
+   return(memcpy(s1, s2, n));
+}
+
+int core1_job_available(void)
+{
+   return(host_core1);
+}
+
+static void *core1_thread(void *arg)
+{
+   core1_job(core1_arg);
+   return(NULL);
+}
+
+void core1_job_start(void (*job)(void *), void *arg)
+{
+   core1_job = job;
+   core1_arg = arg;
+   pthread_create(&core1, NULL, core1_thread, NULL);
+}
+
+int core1_job_wait(void)
+{
+   pthread_join(core1, NULL);
+   return(1);
+}
@@ -0,0 +1,50 @@
+/*
+ * soft3d_host.h
+ *
+ *  The soft3d tests include wazp3d/soft3d56.c to see its structures, this
+ *  is what they share: the host set up (soft3d_host.c) and the helpers to
+ *  build the big endian points and states the 68k sends.
+ */
+
+#ifndef SOFT3D_HOST_H_
+#define SOFT3D_HOST_H_
+
+#include <stdint.h>
+#include <time.h>
+
+extern int host_core1; // 0: core1_job_available() says no, all the bands on core0
+
+void soft3d_host_init(void);
+
+#ifdef __WAZP3D_H
+static float bef(float f)
+{
+   union { float f; uint32_t i; } u;
+   u.f = f;
+   u.i = __builtin_bswap32(u.i);
+   return(u.f);
+}
+
+static void setp(struct point3D *p, float x, float y, float z, float u, float v, uint32_t rgba)
+{
+   p->x.f = bef(x);
+   p->y.f = bef(y);
+   p->z.f = bef(z);
+   p->w.f = bef(1.0f / (z + 0.5f));
+   p->u.f = bef(u);
+   p->v.f = bef(v);
+   p->RGBA.b[0] = rgba >> 24;
+   p->RGBA.b[1] = rgba >> 16;
+   p->RGBA.b[2] = rgba >> 8;
+   p->RGBA.b[3] = rgba;
+}
+#endif
+
+static inline double host_now(void)
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return(t.tv_sec + t.tv_nsec * 1e-9);
+}
+
+#endif /* SOFT3D_HOST_H_ */
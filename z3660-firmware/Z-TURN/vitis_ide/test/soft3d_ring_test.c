@@ -0,0 +1,389 @@
+/*
+ * soft3d_ring_test.c
+ *
+ *  The command ring of soft3d: the Wazp3D library side is played here as
+ *  the 68k does it (big endian words in the Soft3DData, the register write
+ *  is a call to handle_soft3d_op()).
+ *  - random scenes drawn with the direct OP_SETDRAWSTATE/OP_DRAWPRIMITIVE,
+ *    through the ring and from the ring records captured then copied back
+ *    in the ring in one go: the three images are the same
+ *  - malformed records (more points than the record holds, a state cut
+ *    short, a size not a multiple of 4 or after the write index) are not
+ *    drawn, what was after them in the ring is dropped and the ring works
+ *    again after the next OP_RING
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wazp3d/soft3d56.c"
+#include "soft3d_host.h"
+
+#define SCREEN_LARGE 320
+#define SCREEN_HIGH  240
+#define PRIMS        3000
+#define CAPTURE_SIZE (8 << 20)
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+#define BE(x) __builtin_bswap32((uint32_t)(uintptr_t)(x))
+
+// what the 68k gives by address, 32 bit as it is, out of the soft3d heap
+struct amiga_side {
+   struct WAZP3D_parameters prefs;
+   struct state3D S;
+   struct point3D P[64];
+   uint8_t tex[64 * 64 * 4];
+};
+static struct amiga_side *A = (struct amiga_side *)Z3_SCRATCH_ADDR;
+
+static volatile struct Soft3DRing *ring;
+static uint32_t ringwrite;
+static int usering, mode;
+static uint8_t *capture;
+static uint32_t captured;
+
+static unsigned rnd_s;
+static unsigned rnd(void)
+{
+   rnd_s = rnd_s * 1103515245 + 12345;
+   return((rnd_s >> 8) & 0xFFFFFF);
+}
+
+static float frnd(float a, float b)
+{
+   return(a + (b - a) * (rnd() / 16777216.0f));
+}
+
+static void regw(uint32_t op)
+{
+   handle_soft3d_op(op);
+}
+
+static uint32_t regr(void)
+{
+   return(BE(*(uint32_t *)(RTG_BASE + REG_ZZ_SOFT3D_OP)));
+}
+
+static void ring_rewind(void)
+{
+   regw(OP_RING);
+   usering = regr() == SOFT3D_RING_MAGIC;
+   ringwrite = 0;
+}
+
+static int ring_append(void *sc, uint32_t op, void *data, uint32_t len, uint32_t Pnb, uint32_t prim)
+{
+   uint32_t size = sizeof(struct Soft3DCmd) + ((len + 3) & ~3);
+   if (!usering || sizeof(ring->data) < size)
+      return(0);
+   if (sizeof(ring->data) < ringwrite + size)
+      ring_rewind();
+   struct Soft3DCmd *cmd = (struct Soft3DCmd *)((uintptr_t)ring->data + ringwrite);
+   cmd->op = BE(op);
+   cmd->size = BE(size);
+   cmd->sc = BE(sc);
+   cmd->Pnb = BE(Pnb);
+   cmd->primitive = BE(prim);
+   memcpy(cmd + 1, data, len);
+   if (capture) {
+      memcpy(capture + captured, cmd, size);
+      captured += size;
+   }
+   ringwrite += size;
+   ring->write = BE(ringwrite);
+   return(1);
+}
+
+static void L_SetDrawState(void *sc, struct state3D *S)
+{
+   if (mode && ring_append(sc, OP_SETDRAWSTATE, S, sizeof(*S), 0, 0))
+      return;
+   data3d->offset[0] = BE(sc);
+   data3d->offset[1] = BE(S);
+   regw(OP_SETDRAWSTATE);
+}
+
+static void L_DrawPrimitive(void *sc, struct point3D *P, uint32_t n, uint32_t prim)
+{
+   if (mode && ring_append(sc, OP_DRAWPRIMITIVE, P, sizeof(*P) * n, n, prim))
+      return;
+   data3d->offset[0] = BE(sc);
+   data3d->offset[1] = BE(P);
+   data3d->format[0] = BE(n);
+   data3d->format[1] = BE(prim);
+   regw(OP_DRAWPRIMITIVE);
+}
+
+static void L_Flush(void *sc)
+{
+   data3d->offset[0] = BE(sc);
+   regw(OP_FLUSH);
+}
+
+static void *L_Start(void)
+{
+   memset(&A->prefs, 0, sizeof(A->prefs));
+   A->prefs.Renderer.ON = 1;
+   A->prefs.PerspMode.ON = 1;
+   A->prefs.TexMode.ON = 1;
+   A->prefs.MaxPolyHack = 7;
+   data3d->offset[0] = BE(&A->prefs);
+   regw(OP_START);
+   return((void *)(uintptr_t)regr());
+}
+
+static void L_End(void *sc)
+{
+   data3d->offset[0] = BE(sc);
+   regw(OP_END);
+}
+
+static void *set_up(void *SC, uint8_t *screen)
+{
+   memset(screen, 0x40, SCREEN_LARGE * SCREEN_HIGH * 4);
+   SOFT3D_SetBitmap(SC, NULL, screen, PIXFMT_BGRA32, 0, 0, SCREEN_LARGE, SCREEN_HIGH);
+   SOFT3D_SetClipping(SC, 0, SCREEN_LARGE - 1, 0, SCREEN_HIGH - 1);
+   SOFT3D_ClearZBuffer(SC, 1.0f);
+   for (int i = 0; i < 64 * 64; i++) {
+      A->tex[i * 4] = i * 7;
+      A->tex[i * 4 + 1] = i >> 3;
+      A->tex[i * 4 + 2] = (i * 13) ^ 0x55;
+      A->tex[i * 4 + 3] = (i & 64) ? 255 : 128;
+   }
+   return(SOFT3D_CreateTexture(SC, A->tex, 64, 64, W3D_R8G8B8A8, 0));
+}
+
+// mode 0: direct, 1: ring (and captured), 2: the capture copied in the ring
+static void run(void *SC, uint8_t *screen, int seed, int m)
+{
+   void *ST = set_up(SC, screen);
+   struct state3D *S = &A->S;
+   struct point3D *P = A->P;
+
+   mode = m;
+   usering = 0;
+   if (m)
+      ring_rewind();
+   if (m == 2) {
+      // only the ST of this run differs
+      for (uint32_t at = 0; at < captured;) {
+         struct Soft3DCmd *cmd = (struct Soft3DCmd *)(capture + at);
+         uint32_t size = BE(cmd->size);
+         struct state3D *CS = (struct state3D *)(cmd + 1);
+         if (BE(cmd->op) == OP_SETDRAWSTATE && CS->ST)
+            CS->ST = (void *)(uintptr_t)BE(ST);
+         if (sizeof(ring->data) < ringwrite + size)
+            ring_rewind();
+         memcpy((void *)((uintptr_t)ring->data + ringwrite), cmd, size);
+         ringwrite += size;
+         ring->write = BE(ringwrite);
+         at += size;
+      }
+      L_Flush(SC);
+      SOFT3D_FreeTexture(SC, ST);
+      return;
+   }
+
+   rnd_s = seed;
+   captured = 0;
+   for (int k = 0; k < PRIMS; k++) {
+      memset(S, 0, sizeof(*S));
+      S->Changed = 1;
+      S->ZMode = (rnd() & 1) ? ZMODE(1, W3D_Z_LESS) : ZMODE(0, W3D_Z_ALWAYS);
+      S->BlendMode = (rnd() & 1) ? BLENDREPLACE : BLENDALPHA;
+      S->UseTex = rnd() & 1;
+      S->TexEnvMode = S->UseTex ? ((rnd() & 1) ? W3D_MODULATE : W3D_REPLACE) : 0;
+      S->PerspMode = rnd() % 3;
+      S->UseGouraud = rnd() & 1;
+      S->CurrentRGBA.L[0] = rnd() | 0xFF;
+      S->PointSize = BE(1);
+      S->LineSize = BE(1);
+      S->ST = S->UseTex ? (void *)(uintptr_t)BE(ST) : NULL;
+      L_SetDrawState(SC, S);
+
+      // no W3D_PRIMITIVE_POINTS: DrawPointPix() swaps PointSize again and never ends
+      static const int prims[] = { W3D_PRIMITIVE_TRIANGLES, W3D_PRIMITIVE_TRIFAN, W3D_PRIMITIVE_TRISTRIP,
+                                   W3D_PRIMITIVE_LINES, W3D_PRIMITIVE_LINELOOP, W3D_PRIMITIVE_LINESTRIP };
+      int prim = prims[rnd() % 6], n = 3 + rnd() % 4;
+      if (prim == W3D_PRIMITIVE_TRIANGLES)
+         n = 3 * (1 + rnd() % 4);
+      float cx = frnd(-40, SCREEN_LARGE + 40), cy = frnd(-40, SCREEN_HIGH + 40), r = frnd(2, 120);
+      for (int i = 0; i < n; i++)
+         setp(&P[i], cx + frnd(-r, r), cy + frnd(-r, r), frnd(0.01f, 0.99f), frnd(0, 1), frnd(0, 1),
+              rnd() << 8 | (rnd() & 0xFF));
+      L_DrawPrimitive(SC, P, n, prim);
+      memset(P, 0xAA, sizeof(*P) * n); // the library reuses its arrays at once
+      if ((rnd() & 31) == 0)
+         L_Flush(SC);
+   }
+   L_Flush(SC);
+   SOFT3D_FreeTexture(SC, ST);
+}
+
+static int differ(const uint8_t *a, const uint8_t *b)
+{
+   int n = 0;
+   for (int i = 0; i < SCREEN_LARGE * SCREEN_HIGH * 4; i++)
+      n += a[i] != b[i];
+   return(n);
+}
+
+static void test_replay(void *SC)
+{
+   uint8_t *direct = (uint8_t *)FRAMEBUFFER_ADDRESS;
+   uint8_t *inring = direct + SCREEN_LARGE * SCREEN_HIGH * 4;
+   uint8_t *replay = inring + SCREEN_LARGE * SCREEN_HIGH * 4;
+
+   capture = malloc(CAPTURE_SIZE);
+   for (int seed = 1; seed <= 8; seed++) {
+      run(SC, direct, seed, 0);
+      run(SC, inring, seed, 1);
+      CHECK(ring->read == ring->write, "seed %d: ring not drained", seed);
+      run(SC, replay, seed, 2);
+      int drawn = 0;
+      for (int i = 0; i < SCREEN_LARGE * SCREEN_HIGH * 4; i++)
+         drawn += direct[i] != 0x40;
+      CHECK(drawn > SCREEN_LARGE * SCREEN_HIGH, "seed %d: %d bytes drawn", seed, drawn);
+      CHECK(differ(direct, inring) == 0, "seed %d: ring %d bytes differ", seed, differ(direct, inring));
+      CHECK(differ(direct, replay) == 0, "seed %d: replay %d bytes differ", seed, differ(direct, replay));
+   }
+   free(capture);
+   capture = NULL;
+}
+
+// a flat state of that color
+static void flat_state(struct state3D *S, uint32_t rgba)
+{
+   memset(S, 0, sizeof(*S));
+   S->Changed = 1;
+   S->ZMode = ZMODE(0, W3D_Z_ALWAYS);
+   S->BlendMode = BLENDREPLACE;
+   S->CurrentRGBA.L[0] = BE(rgba);
+   S->PointSize = BE(1);
+   S->LineSize = BE(1);
+}
+
+// a triangle over the whole screen (but its last column)
+static void full_screen(struct point3D *P)
+{
+   setp(&P[0], -10, -10, 0.5f, 0, 0, 0xFF0000FF);
+   setp(&P[1], 3 * SCREEN_LARGE, -10, 0.5f, 0, 0, 0xFF0000FF);
+   setp(&P[2], -10, 3 * SCREEN_HIGH, 0.5f, 0, 0, 0xFF0000FF);
+}
+
+// a record as ring_append() makes it, with the header told what to say
+static void *raw_record(void *sc, uint32_t op, uint32_t size, uint32_t Pnb)
+{
+   struct Soft3DCmd *cmd = (struct Soft3DCmd *)((uintptr_t)ring->data + ringwrite);
+   cmd->op = BE(op);
+   cmd->size = BE(size);
+   cmd->sc = BE(sc);
+   cmd->Pnb = BE(Pnb);
+   cmd->primitive = BE(W3D_PRIMITIVE_TRIANGLES);
+   return(cmd + 1);
+}
+
+static int count_color(const uint8_t *screen, uint32_t bgra)
+{
+   int n = 0;
+   for (int i = 0; i < SCREEN_LARGE * SCREEN_HIGH; i++)
+      n += *(uint32_t *)(screen + i * 4) == bgra;
+   return(n);
+}
+
+static void test_malformed(void *SC)
+{
+   uint8_t *screen = (uint8_t *)FRAMEBUFFER_ADDRESS;
+   uint32_t header = sizeof(struct Soft3DCmd);
+   void *ST = set_up(SC, screen);
+
+   mode = 1;
+   ring_rewind();
+
+   // 3 points in the record, 6 said: the 3 after it (a full screen
+   // triangle in the ring, not appended yet) are not drawn
+   flat_state(&A->S, 0xFF0000FF);
+   ring_append(SC, OP_SETDRAWSTATE, &A->S, sizeof(A->S), 0, 0);
+   struct point3D *P = raw_record(SC, OP_DRAWPRIMITIVE, header + 3 * sizeof(struct point3D), 6);
+   setp(&P[0], 0, 0, 0.5f, 0, 0, 0);
+   setp(&P[1], 1, 0, 0.5f, 0, 0, 0);
+   setp(&P[2], 0, 1, 0.5f, 0, 0, 0);
+   full_screen(P + 3);
+   ringwrite += header + 3 * sizeof(struct point3D);
+   ring->write = BE(ringwrite);
+   L_Flush(SC);
+   CHECK(ring->read == ring->write, "Pnb: the ring is not dropped");
+   CHECK(count_color(screen, 0xFFFF0000) < 8, "Pnb: %d pixels of the points after the record",
+         count_color(screen, 0xFFFF0000));
+
+   // a state of 16 bytes: the green state after it is not set
+   ring_rewind();
+   flat_state(&A->S, 0xFF0000FF);
+   ring_append(SC, OP_SETDRAWSTATE, &A->S, sizeof(A->S), 0, 0);
+   L_Flush(SC);
+   struct state3D *S = raw_record(SC, OP_SETDRAWSTATE, header + 16, 0);
+   flat_state(S, 0x00FF00FF);
+   ringwrite += header + 16;
+   ring->write = BE(ringwrite);
+   L_Flush(SC);
+   CHECK(ring->read == ring->write, "state: the ring is not dropped");
+   ring_rewind();
+   full_screen(A->P);
+   L_DrawPrimitive(SC, A->P, 3, W3D_PRIMITIVE_TRIANGLES);
+   L_Flush(SC);
+   CHECK(count_color(screen, 0xFF00FF00) == 0, "state: %d pixels of the cut state", count_color(screen, 0xFF00FF00));
+   CHECK(count_color(screen, 0xFFFF0000) > SCREEN_LARGE * SCREEN_HIGH * 99 / 100, "state: %d red pixels",
+         count_color(screen, 0xFFFF0000));
+
+   // a size not a multiple of 4, then one after the write index: the
+   // records after them are dropped
+   const uint32_t sizes[] = { header + sizeof(A->S) + 2, header + sizeof(A->S) + 4096 };
+   for (int k = 0; k < 2; k++) {
+      memset(screen, 0x40, SCREEN_LARGE * SCREEN_HIGH * 4);
+      ring_rewind();
+      flat_state(raw_record(SC, OP_SETDRAWSTATE, sizes[k], 0), 0x00FF00FF);
+      ringwrite += header + sizeof(A->S);
+      flat_state(&A->S, 0x00FF00FF);
+      ring_append(SC, OP_SETDRAWSTATE, &A->S, sizeof(A->S), 0, 0);
+      full_screen(A->P);
+      ring_append(SC, OP_DRAWPRIMITIVE, A->P, 3 * sizeof(struct point3D), 3, W3D_PRIMITIVE_TRIANGLES);
+      L_Flush(SC);
+      CHECK(ring->read == ring->write, "size %lu: the ring is not dropped", (unsigned long)sizes[k]);
+      CHECK(count_color(screen, 0xFF00FF00) == 0, "size %lu: %d pixels after the record",
+            (unsigned long)sizes[k], count_color(screen, 0xFF00FF00));
+   }
+
+   // the ring again
+   ring_rewind();
+   flat_state(&A->S, 0x00FF00FF);
+   L_SetDrawState(SC, &A->S);
+   full_screen(A->P);
+   L_DrawPrimitive(SC, A->P, 3, W3D_PRIMITIVE_TRIANGLES);
+   L_Flush(SC);
+   CHECK(count_color(screen, 0xFF00FF00) > SCREEN_LARGE * SCREEN_HIGH * 99 / 100, "after: %d green pixels",
+         count_color(screen, 0xFF00FF00));
+
+   SOFT3D_FreeTexture(SC, ST);
+}
+
+int main(int argc, char **argv)
+{
+   soft3d_host_init();
+   host_core1 = 0; // with 64 bit pointers a second SOFT3D_context doesn't fit in the heap
+   data3d = (volatile struct Soft3DData *)Z3_SOFT3D_ADDR_DATA3D;
+   ring = (volatile struct Soft3DRing *)((uintptr_t)data3d + SOFT3D_RING_OFFSET);
+
+   void *SC = L_Start();
+   CHECK(SC != NULL, "no SOFT3D_context");
+   SOFT3D_AllocZbuffer(SC, SCREEN_LARGE, SCREEN_HIGH);
+   test_replay(SC);
+   test_malformed(SC);
+   L_End(SC);
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
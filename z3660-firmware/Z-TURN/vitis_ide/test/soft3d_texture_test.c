@@ -0,0 +1,236 @@
+/*
+ * soft3d_texture_test.c
+ *
+ *  The 4x4 texel tiles of the soft3d textures. Each texel holds its own x,y
+ *  so a texel read from ptmm tells where it was read:
+ *  - the Tex8U/Tex8V tables (textures up to 256) and the TexU/TexV tables
+ *    plus their low byte part (bigger textures) read the texel they name,
+ *    whatever the size (power of 2 or not), 24 or 32 bits, and each mipmap
+ *  - the big textures keep the sub-texel precision of the low byte of u,v:
+ *    the texel read is at most 1 from u*large/65536
+ *  - a 640x480 texture drawn 1:1 on the screen: the texel of each pixel is
+ *    its x,y or up to 2 before (the edges step u,v from the pixel corner,
+ *    the high and low byte parts are each rounded down). Without the low
+ *    byte part it is up to 3 before (2.5 texels per step of the high byte)
+ *
+ *  Then the time to draw a rotated 1024x1024 and a 640x480 texture on the
+ *  whole screen: the tiles are for the rotated polygons.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "wazp3d/soft3d56.c"
+#include "soft3d_host.h"
+
+#define SCREEN_LARGE 640
+#define SCREEN_HIGH  480
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+static struct WAZP3D_parameters prefs;
+static struct SOFT3D_context *SC;
+static uint8_t *screen = (uint8_t *)FRAMEBUFFER_ADDRESS;
+
+// R = x, G = y, B = x,y high bits. As the 68k ones, out of the soft3d heap
+static uint8_t *make_texels(int large, int high, int bits)
+{
+   uint8_t *pt = (uint8_t *)Z3_SCRATCH_ADDR;
+   uint8_t *p = pt;
+   for (int y = 0; y < high; y++)
+      for (int x = 0; x < large; x++) {
+         *p++ = x;
+         *p++ = y;
+         *p++ = (x >> 8) | ((y >> 8) << 4);
+         if (bits == 32)
+            *p++ = 0xA5;
+      }
+   return(pt);
+}
+
+static void texel_xy(const uint8_t *T, int *x, int *y)
+{
+   *x = T[0] | ((T[2] & 15) << 8);
+   *y = T[1] | ((T[2] >> 4) << 8);
+}
+
+// the texel the fill loops read for u,v in the mipmap m of size large x high
+static void check_texel(struct SOFT3D_texture *ST, int m, int large, int high, int u, int v)
+{
+   struct SOFT3D_mipmap *MM = &ST->MMs[m];
+   int uh = u >> 8, ul = u & 255, vh = v >> 8, vl = v & 255;
+   int x, y;
+
+   // Fill_Tex...(): texture up to 256
+   texel_xy(MM->Tex8V[vh] + MM->Tex8U[uh], &x, &y);
+   CHECK(x == large * uh / 256 && y == high * vh / 256,
+         "%dx%d mm%d u %d v %d: texel %d,%d", large, high, m, u, v, x, y);
+
+   // Fill_BigTexPersp2(): the low byte of u,v too
+   ULONG tx = MM->TexU[uh] + MM->TexUlow[ul];
+   ULONG ty = MM->TexV[vh] + MM->TexVlow[vl];
+   texel_xy(MM->Tex8V[0] + TILEX(tx) + TILEY(ty, MM->tiles), &x, &y);
+   CHECK(x == (int)tx && y == (int)ty, "%dx%d mm%d u %d v %d: big texel %d,%d not %lu,%lu",
+         large, high, m, u, v, x, y, (unsigned long)tx, (unsigned long)ty);
+   int ex = (int)((double)large * u / 65536.0);
+   int ey = (int)((double)high * v / 65536.0);
+   CHECK(x <= ex && x >= ex - 1 && x < large && y <= ey && y >= ey - 1 && y < high,
+         "%dx%d mm%d u %d v %d: big texel %d,%d for %d,%d", large, high, m, u, v, x, y, ex, ey);
+}
+
+// what ConvertTexture() allocated
+static ULONG ptmm_size(struct SOFT3D_texture *ST)
+{
+   ULONG size = 0, large = ST->large, high = ST->high;
+   for (int m = 0; m < ST->NbMM; m++) {
+      size += TILES(large) * TILES(high) * 64;
+      large = NEXTMIPMAP(large);
+      high = NEXTMIPMAP(high);
+   }
+   return(size);
+}
+
+static void test_tables(int large, int high, int bits, int mip)
+{
+   uint8_t *pt = make_texels(large, high, bits);
+   struct SOFT3D_texture *ST = SOFT3D_CreateTexture(SC, pt, large, high, bits == 32 ? W3D_R8G8B8A8 : W3D_R8G8B8, mip);
+   CHECK(ST != NULL, "%dx%d: no texture", large, high);
+   if (ST == NULL)
+      return;
+
+   // the mipmaps are box filtered: only the level 0 keeps the x,y code
+   CHECK(ST->MMs[0].tiles == TILES(large), "%dx%d: %lu tiles", large, high, (unsigned long)ST->MMs[0].tiles);
+   for (int u = 0; u < 65536; u += 97)
+      for (int v = (u * 7) & 127; v < 65536; v += 131)
+         check_texel(ST, 0, large, high, u, v);
+   check_texel(ST, 0, large, high, 65535, 65535);
+
+   // each mipmap is in ptmm, the last texel of its tables too
+   for (int m = 1; m < NBMIPMAPS; m++) {
+      struct SOFT3D_mipmap *MM = &ST->MMs[m];
+      ULONG x = MM->TexU[255] + MM->TexUlow[255];
+      ULONG y = MM->TexV[255] + MM->TexVlow[255];
+      CHECK(MM->Tex8V[0] >= ST->ptmm && x < MM->tiles * 4, "%dx%d mm%d: out of the mipmap", large, high, m);
+      CHECK(MM->Tex8V[0] + TILEX(x) + TILEY(y, MM->tiles) < ST->ptmm + ptmm_size(ST),
+            "%dx%d mm%d: after ptmm", large, high, m);
+   }
+
+   SOFT3D_FreeTexture(SC, ST);
+}
+
+static void set_state(struct SOFT3D_texture *ST)
+{
+   static struct state3D S;
+   memset(&S, 0, sizeof(S));
+   S.Changed = 1;
+   S.ZMode = ZMODE(0, W3D_Z_ALWAYS);
+   S.BlendMode = BLENDREPLACE;
+   S.UseTex = 1;
+   S.TexEnvMode = W3D_REPLACE;
+   S.CurrentRGBA.L[0] = 0xFFFFFFFF;
+   S.PointSize = __builtin_bswap32(1);
+   S.LineSize = __builtin_bswap32(1);
+   S.ST = (void *)(uintptr_t)__builtin_bswap32((uint32_t)(uintptr_t)ST);
+   SOFT3D_SetDrawState(SC, &S);
+}
+
+// the quad (0,0)-(640,480) at an angle, its texture from u,v 0 to 1
+static void draw_quad(float angle, float scale)
+{
+   static struct point3D P[6];
+   static const float cu[4] = { -1, 1, 1, -1 }, cv[4] = { -1, -1, 1, 1 };
+   static const int order[6] = { 0, 1, 2, 0, 2, 3 };
+   float c = cosf(angle * 3.14159265f / 180), s = sinf(angle * 3.14159265f / 180);
+
+   for (int k = 0; k < 6; k++) {
+      int q = order[k];
+      float x = cu[q] * SCREEN_LARGE / 2 * scale, y = cv[q] * SCREEN_HIGH / 2 * scale;
+      setp(&P[k], SCREEN_LARGE / 2 + x * c - y * s, SCREEN_HIGH / 2 + x * s + y * c, 0.5f,
+           (cu[q] + 1) / 2, (cv[q] + 1) / 2, 0xFFFFFFFF);
+   }
+   SOFT3D_DrawPrimitive(SC, P, 6, W3D_PRIMITIVE_TRIANGLES);
+   SOFT3D_BinDraw(SC);
+   SOFT3D_Flush(SC);
+}
+
+static void test_draw(void)
+{
+   uint8_t *pt = make_texels(SCREEN_LARGE, SCREEN_HIGH, 32);
+   struct SOFT3D_texture *ST = SOFT3D_CreateTexture(SC, pt, SCREEN_LARGE, SCREEN_HIGH, W3D_R8G8B8A8, 0);
+   memset(screen, 0, SCREEN_LARGE * SCREEN_HIGH * 4);
+   set_state(ST);
+   draw_quad(0, 1);
+
+   // BGRA screen: R,G,B of the texel at 2,1,0
+   int drawn = 0, far = 0; // pixels with a texel after them or more than 2 before
+   for (int py = 0; py < SCREEN_HIGH; py++)
+      for (int px = 0; px < SCREEN_LARGE; px++) {
+         uint8_t *p = screen + (py * SCREEN_LARGE + px) * 4;
+         if (p[3] == 0)
+            continue;
+         uint8_t T[3] = { p[2], p[1], p[0] };
+         int x, y;
+         texel_xy(T, &x, &y);
+         drawn++;
+         if (x > px || x < px - 2 || y > py || y < py - 2) {
+            if (!far)
+               CHECK(0, "pixel %d,%d: texel %d,%d", px, py, x, y);
+            far++;
+         }
+      }
+   CHECK(drawn > SCREEN_LARGE * SCREEN_HIGH * 95 / 100, "%d pixels drawn", drawn);
+   CHECK(far == 0, "%d pixels too far from their texel", far);
+
+   SOFT3D_FreeTexture(SC, ST);
+}
+
+static void bench(int large, int high)
+{
+   uint8_t *pt = make_texels(large, high, 32);
+   struct SOFT3D_texture *ST = SOFT3D_CreateTexture(SC, pt, large, high, W3D_R8G8B8A8, 0);
+   set_state(ST);
+   printf("%dx%d texture, ms per frame at 0 to 90 degrees:", large, high);
+   for (int angle = 0; angle <= 90; angle += 15) {
+      double t0 = host_now();
+      for (int f = 0; f < 20; f++)
+         draw_quad(angle, 1.25f);
+      printf(" %.2f", (host_now() - t0) * 1000 / 20);
+   }
+   printf("\n");
+   SOFT3D_FreeTexture(SC, ST);
+}
+
+int main(int argc, char **argv)
+{
+   soft3d_host_init();
+   host_core1 = 0; // with 64 bit pointers a second SOFT3D_context doesn't fit in the heap
+   prefs.Renderer.ON = 1;
+   prefs.PerspMode.ON = 1;
+   prefs.TexMode.ON = 1;
+   prefs.MaxPolyHack = 7;
+   SC = SOFT3D_Start(&prefs);
+   SOFT3D_SetBitmap(SC, NULL, screen, PIXFMT_BGRA32, 0, 0, SCREEN_LARGE, SCREEN_HIGH);
+   SOFT3D_SetClipping(SC, 0, SCREEN_LARGE - 1, 0, SCREEN_HIGH - 1);
+
+   static const int sizes[][2] = {
+      { 64, 64 }, { 256, 256 }, { 100, 37 }, { 255, 257 }, { 512, 512 },
+      { 1024, 1024 }, { 640, 480 }, { 300, 700 }, { 1000, 3 },
+   };
+   for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+      for (int bits = 24; bits <= 32; bits += 8) {
+         test_tables(sizes[i][0], sizes[i][1], bits, 0);
+         if (sizes[i][0] == sizes[i][1])
+            test_tables(sizes[i][0], sizes[i][1], bits, 1);
+      }
+   test_draw();
+
+   bench(1024, 1024);
+   bench(640, 480);
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
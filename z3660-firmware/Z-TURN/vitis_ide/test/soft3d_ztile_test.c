@@ -0,0 +1,320 @@
+/*
+ * soft3d_ztile_test.c
+ *
+ *  The hierarchical Z of soft3d (8x8 tiles of the Zbuffer with the min & max
+ *  z of each of their lines, lazy clears):
+ *  - random scenes with the 16 Z modes, clears and WriteZSpan between the
+ *    primitives: each Ztest function gives for each pixel what a plain
+ *    test against a reference Zbuffer gives, the tile bounds are the min &
+ *    max of their lines and ReadZSpan reads the reference. Once with the
+ *    Zbuffer of the bitmap size, once bigger (all of it is cleared)
+ *  - a tile rejects a span from its bounds alone: the Zbuffer behind them
+ *    is not read, a cleared tile stays cleared, a NaN is never rejected
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "wazp3d/soft3d56.c"
+#include "soft3d_host.h"
+
+#define SCREEN_LARGE 320
+#define SCREEN_HIGH  240
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+static struct WAZP3D_parameters prefs;
+static struct SOFT3D_context *SC;
+static uint8_t *screen = (uint8_t *)FRAMEBUFFER_ADDRESS;
+
+static ZBUFF *ref;                 // the Zbuffer without tiles
+static HOOKEDFUNCTION Ztest[16];   // the soft3d Ztest functions
+static unsigned long pixels, passed;
+
+static unsigned rnd_s;
+static unsigned rnd(void)
+{
+   rnd_s = rnd_s * 1103515245 + 12345;
+   return((rnd_s >> 8) & 0xFFFFFF);
+}
+
+static float frnd(float a, float b)
+{
+   return(a + (b - a) * (rnd() / 16777216.0f));
+}
+
+static UBYTE compare(ZBUFF z, ZBUFF zb, int ZMode)
+{
+   switch (ZMode % 8 + 1) {
+   case W3D_Z_NEVER:    return(FALSE);
+   case W3D_Z_LESS:     return(z < zb);
+   case W3D_Z_GEQUAL:   return(z >= zb);
+   case W3D_Z_LEQUAL:   return(z <= zb);
+   case W3D_Z_GREATER:  return(z > zb);
+   case W3D_Z_NOTEQUAL: return(z != zb);
+   case W3D_Z_EQUAL:    return(z == zb);
+   }
+   return(TRUE);
+}
+
+// instead of SC->FunctionZtest: the real one then the same span against ref
+static void check_span(struct SOFT3D_context *SC, int ZMode)
+{
+   union pixel3D *Pix = SC->Pix;
+   ULONG x = Pix->W.x, y = (Pix - SC->edge1) % MAXSCREEN;
+   WORD large = Pix->W.large;
+   ZBUFF z = Pix->L.z, dz = Pix->L.dz;
+
+   Ztest[ZMode](SC);
+   for (WORD n = 0; n < large; n++, z += dz) {
+      ZBUFF *zb = &ref[y * SC->Zlarge + x + n];
+      UBYTE pass = compare(z, *zb, ZMode);
+      if (SC->Ztest[n] != pass) {
+         CHECK(0, "ZMode %d x %lu y %lu: Ztest %d for z %g Zbuffer %g", ZMode,
+               (unsigned long)(x + n), (unsigned long)y, SC->Ztest[n], z, *zb);
+         break;
+      }
+      if (pass && ZMode >= 8)
+         *zb = z;
+      passed += pass;
+   }
+   pixels += large;
+   // Ztest_znever_update() and Ztest_zalways() don't step z
+   if (ZMode % 8 != 0 && ZMode != ZMODE(0, W3D_Z_ALWAYS))
+      CHECK(Pix->L.z == z, "ZMode %d y %lu: span z %g not %g", ZMode, (unsigned long)y, Pix->L.z, z);
+}
+
+#define CHECK_SPAN(m) static void check_span##m(void *SC) { check_span(SC, m); }
+CHECK_SPAN(0)  CHECK_SPAN(1)  CHECK_SPAN(2)  CHECK_SPAN(3)
+CHECK_SPAN(4)  CHECK_SPAN(5)  CHECK_SPAN(6)  CHECK_SPAN(7)
+CHECK_SPAN(8)  CHECK_SPAN(9)  CHECK_SPAN(10) CHECK_SPAN(11)
+CHECK_SPAN(12) CHECK_SPAN(13) CHECK_SPAN(14) CHECK_SPAN(15)
+static const HOOKEDFUNCTION check_spans[16] = {
+   check_span0,  check_span1,  check_span2,  check_span3,
+   check_span4,  check_span5,  check_span6,  check_span7,
+   check_span8,  check_span9,  check_span10, check_span11,
+   check_span12, check_span13, check_span14, check_span15,
+};
+
+static void clear(float fz)
+{
+   ZBUFF z = fz * ZRESIZE;
+   if (z < MINZ) z = MINZ;
+   if (MAXZ < z) z = MAXZ;
+   for (int n = 0; n < SC->Zlarge * SC->Zhigh; n++)
+      ref[n] = z;
+   SOFT3D_ClearZBuffer(SC, fz);
+}
+
+static void write_span(int x, int y, int n)
+{
+   W3D_Double dz[SCREEN_LARGE];
+   UBYTE mask[SCREEN_LARGE];
+   for (int i = 0; i < n; i++) {
+      dz[i] = frnd(-0.1f, 1.1f);
+      mask[i] = rnd() & 1;
+      if (mask[i]) {
+         float fz = dz[i];
+         if (fz < MINZ) fz = MINZ;
+         if (MAXZ < fz) fz = MAXZ;
+         ref[y * SC->Zlarge + x + i] = fz * ZRESIZE;
+      }
+   }
+   SOFT3D_WriteZSpan(SC, x, y, n, dz, mask);
+}
+
+// the bounds of each tile line against the Zbuffer, then the Zbuffer against ref
+static void check_zbuffer(int seed)
+{
+   int bad = 0;
+   for (int ty = 0; ty < (SC->Zhigh + ZTILE - 1) / ZTILE; ty++)
+      for (int tx = 0; tx < SC->ZtilesLarge; tx++) {
+         struct ztile3D *T = &SC->Ztiles[ty * SC->ZtilesLarge + tx];
+         for (int y = ty * ZTILE; y < ty * ZTILE + ZTILE && y < SC->Zhigh; y++) {
+            ZBUFF zmin = INFINITY, zmax = -INFINITY;
+            for (int x = tx * ZTILE; x < tx * ZTILE + ZTILE && x < SC->Zlarge; x++) {
+               ZBUFF z = T->cleared ? SC->Zclear : SC->Zbuffer[y * SC->Zlarge + x];
+               if (z != ref[y * SC->Zlarge + x])
+                  bad++;
+               if (z < zmin) zmin = z;
+               if (zmax < z) zmax = z;
+            }
+            if (!T->cleared && (T->zmin[y % ZTILE] != zmin || T->zmax[y % ZTILE] != zmax))
+               bad++;
+         }
+      }
+   CHECK(bad == 0, "seed %d: %d z or tile lines differ", seed, bad);
+
+   W3D_Double dz[MAXSCREEN];
+   for (int y = 0, n = 0; y < SC->Zhigh && !n; y++) {
+      SOFT3D_ReadZSpan(SC, 0, y, SC->Zlarge, dz);
+      for (int x = 0; x < SC->Zlarge && !n; x++)
+         if ((float)dz[x] != ref[y * SC->Zlarge + x] / ZRESIZE) {
+            CHECK(0, "seed %d: ReadZSpan %d,%d %g not %g", seed, x, y, dz[x], ref[y * SC->Zlarge + x]);
+            n++;
+         }
+   }
+}
+
+static void flush(void)
+{
+   SOFT3D_BinDraw(SC);
+   SOFT3D_Flush(SC);
+}
+
+static void scene(int seed, int Zlarge, int Zhigh)
+{
+   static struct point3D P[64];
+   static struct state3D S;
+   // no W3D_PRIMITIVE_POINTS: DrawPointPix() swaps PointSize twice
+   static const int prims[] = {
+      W3D_PRIMITIVE_TRIANGLES, W3D_PRIMITIVE_TRIFAN, W3D_PRIMITIVE_TRISTRIP,
+      W3D_PRIMITIVE_LINELOOP, W3D_PRIMITIVE_LINESTRIP,
+   };
+
+   SOFT3D_AllocZbuffer(SC, Zlarge, Zhigh);
+   ref = realloc(ref, Zlarge * Zhigh * sizeof(ZBUFF));
+   rnd_s = seed;
+   clear(1.0f);
+
+   for (int k = 0; k < 400; k++) {
+      memset(&S, 0, sizeof(S));
+      S.Changed = 1;
+      S.ZMode = ZMODE(rnd() & 1, 1 + rnd() % 8);
+      S.BlendMode = (rnd() & 1) ? BLENDREPLACE : BLENDALPHA;
+      S.PerspMode = rnd() % 3;
+      S.UseGouraud = rnd() & 1;
+      S.CurrentRGBA.L[0] = rnd() | 0xFF;
+      S.PointSize = __builtin_bswap32(1);
+      S.LineSize = __builtin_bswap32(1);
+      SOFT3D_SetDrawState(SC, &S);
+
+      int prim = prims[rnd() % 5];
+      int n = prim == W3D_PRIMITIVE_TRIANGLES ? 3 * (1 + rnd() % 4) : 3 + rnd() % 4;
+      float cx = frnd(-40, SCREEN_LARGE + 40), cy = frnd(-40, SCREEN_HIGH + 40), r = frnd(2, 120);
+      for (int i = 0; i < n; i++) {
+         // some flat polygons: equal z for the EQUAL modes
+         float z = (k & 3) ? frnd(0.01f, 0.99f) : 0.25f * (1 + (k / 4) % 3);
+         setp(&P[i], cx + frnd(-r, r), cy + frnd(-r, r), z, frnd(0, 1), frnd(0, 1), rnd() << 8 | (rnd() & 0xFF));
+      }
+      SOFT3D_DrawPrimitive(SC, P, n, prim);
+
+      switch (rnd() % 32) {
+      case 0:
+         flush();
+         break;
+      case 1:
+         flush();
+         clear(frnd(-0.1f, 1.1f));
+         break;
+      case 2: {
+         flush();
+         int x = rnd() % SCREEN_LARGE, y = rnd() % SCREEN_HIGH;
+         write_span(x, y, 1 + rnd() % (SCREEN_LARGE - x));
+         break;
+      }
+      }
+   }
+   flush();
+   check_zbuffer(seed);
+}
+
+// the span at x,y of n pixels from z by dz through Ztest[ZMode]
+static void span(int ZMode, int x, int y, int n, ZBUFF z, ZBUFF dz)
+{
+   union pixel3D *Pix = &SC->edge1[y];
+   Pix->W.x = x;
+   Pix->W.large = n;
+   Pix->L.z = z;
+   Pix->L.dz = dz;
+   SC->Pix = Pix;
+   memset(SC->Ztest, 0x55, n);
+   Ztest[ZMode](SC);
+}
+
+static int passed_pixels(int n)
+{
+   int count = 0;
+   for (int i = 0; i < n; i++)
+      count += SC->Ztest[i] == TRUE;
+   return(count);
+}
+
+static void test_rejection(void)
+{
+   SOFT3D_AllocZbuffer(SC, SCREEN_LARGE, SCREEN_HIGH);
+   SOFT3D_ClearZBuffer(SC, 0.5f);
+
+   // line 0 of the tile 0 at 0.2 to 0.3, then a Zbuffer that would pass
+   W3D_Double dz[ZTILE] = { 0.2, 0.25, 0.3, 0.2, 0.25, 0.3, 0.2, 0.25 };
+   UBYTE mask[ZTILE] = { 1, 1, 1, 1, 1, 1, 1, 1 };
+   SOFT3D_WriteZSpan(SC, 0, 0, ZTILE, dz, mask);
+   struct ztile3D *T = &SC->Ztiles[0];
+   CHECK(!T->cleared && T->zmin[0] == 0.2f && T->zmax[0] == 0.3f, "tile bounds %g %g", T->zmin[0], T->zmax[0]);
+   for (int x = 0; x < ZTILE; x++)
+      SC->Zbuffer[x] = 0.9f;
+   span(ZMODE(0, W3D_Z_LESS), 0, 0, ZTILE, 0.5f, 0);
+   CHECK(passed_pixels(ZTILE) == 0, "ZLESS: %d pixels not rejected", passed_pixels(ZTILE));
+   for (int x = 0; x < ZTILE; x++)
+      SC->Zbuffer[x] = 0.0f;
+   span(ZMODE(1, W3D_Z_GREATER), 0, 0, ZTILE, 0.1f, 0);
+   CHECK(passed_pixels(ZTILE) == 0, "ZGREATER: %d pixels not rejected", passed_pixels(ZTILE));
+   // inside the bounds: the Zbuffer is read
+   span(ZMODE(0, W3D_Z_GREATER), 0, 0, ZTILE, 0.25f, 0);
+   CHECK(passed_pixels(ZTILE) == ZTILE, "ZGREATER: %d pixels passed", passed_pixels(ZTILE));
+
+   // a cleared tile (line 8 = tile line 1) rejects from Zclear, still cleared
+   T = &SC->Ztiles[SC->ZtilesLarge];
+   span(ZMODE(1, W3D_Z_LESS), 0, ZTILE, ZTILE, 0.7f, 0);
+   CHECK(passed_pixels(ZTILE) == 0 && T->cleared, "cleared tile: %d pixels, cleared %lu",
+         passed_pixels(ZTILE), (unsigned long)T->cleared);
+   span(ZMODE(1, W3D_Z_LESS), 0, ZTILE, ZTILE, 0.3f, 0);
+   CHECK(passed_pixels(ZTILE) == ZTILE && !T->cleared, "cleared tile: %d pixels, cleared %lu",
+         passed_pixels(ZTILE), (unsigned long)T->cleared);
+   CHECK(T->zmin[0] == 0.3f && T->zmax[0] == 0.3f && T->zmin[1] == 0.5f, "filled tile bounds %g %g %g",
+         T->zmin[0], T->zmax[0], T->zmin[1]);
+
+   // a NaN span is never rejected: the tile is filled to test it
+   T = &SC->Ztiles[SC->ZtilesLarge * 2];
+   span(ZMODE(0, W3D_Z_LESS), 0, 2 * ZTILE, ZTILE, NAN, 0);
+   CHECK(passed_pixels(ZTILE) == 0 && !T->cleared, "NaN span: %d pixels, cleared %lu",
+         passed_pixels(ZTILE), (unsigned long)T->cleared);
+
+   // a span across 3 tiles
+   SOFT3D_ClearZBuffer(SC, 0.5f);
+   span(ZMODE(1, W3D_Z_LESS), 3, 3 * ZTILE, 2 * ZTILE, 0.375f, 1.0f / 64);
+   CHECK(passed_pixels(2 * ZTILE) == 8, "3 tiles span: %d pixels", passed_pixels(2 * ZTILE));
+   CHECK(SC->Ztiles[SC->ZtilesLarge * 3 + 2].cleared, "the tile after the z passed is still cleared");
+}
+
+int main(int argc, char **argv)
+{
+   soft3d_host_init();
+   host_core1 = 0; // with 64 bit pointers a second SOFT3D_context doesn't fit in the heap
+   prefs.Renderer.ON = 1;
+   prefs.PerspMode.ON = 1;
+   prefs.TexMode.ON = 1;
+   prefs.MaxPolyHack = 7;
+   SC = SOFT3D_Start(&prefs);
+   SOFT3D_SetBitmap(SC, NULL, screen, PIXFMT_BGRA32, 0, 0, SCREEN_LARGE, SCREEN_HIGH);
+   SOFT3D_SetClipping(SC, 0, SCREEN_LARGE - 1, 0, SCREEN_HIGH - 1);
+
+   memcpy(Ztest, Functions.Ztest, sizeof(Ztest));
+   memcpy(Functions.Ztest, check_spans, sizeof(check_spans));
+   for (int seed = 1; seed <= 8; seed++)
+      scene(seed, SCREEN_LARGE, SCREEN_HIGH);
+   for (int seed = 9; seed <= 12; seed++)
+      scene(seed, SCREEN_LARGE + 13, SCREEN_HIGH + 5);
+   printf("%lu pixels Z tested, %lu passed\n", pixels, passed);
+   CHECK(passed > pixels / 10 && passed < pixels * 9 / 10, "not a mix of passed and failed pixels");
+   memcpy(Functions.Ztest, Ztest, sizeof(Ztest));
+
+   test_rejection();
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
@@ -0,0 +1,7 @@
+/* Host stand-in for the Xilinx BSP header */
+#ifndef FF_H
+#define FF_H
+
+#include "xil_types.h"
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * Host stand-in around the ARM code generator of the JIT: the ARM code is
+ * emitted as on the board, and each raw function is also recorded at the
+ * address it emits to, for jit_host_run() (see jit_host.h).
+ */
+
+#include "jit_host.h"
+
+#define compemu_raw_inc_opcount arm_compemu_raw_inc_opcount
+#define compemu_raw_cmp_pc arm_compemu_raw_cmp_pc
+#define compemu_raw_set_pc_i arm_compemu_raw_set_pc_i
+#define compemu_raw_mov_l_mi arm_compemu_raw_mov_l_mi
+#define compemu_raw_mov_l_mr arm_compemu_raw_mov_l_mr
+#define compemu_raw_mov_l_ri arm_compemu_raw_mov_l_ri
+#define compemu_raw_mov_l_rm arm_compemu_raw_mov_l_rm
+#define compemu_raw_mov_l_rr arm_compemu_raw_mov_l_rr
+#define compemu_raw_dec_m arm_compemu_raw_dec_m
+#define compemu_raw_inc_m64 arm_compemu_raw_inc_m64
+#define compemu_raw_call arm_compemu_raw_call
+#define compemu_raw_call_r arm_compemu_raw_call_r
+#define compemu_raw_jcc_l_oponly arm_compemu_raw_jcc_l_oponly
+#define compemu_raw_handle_except arm_compemu_raw_handle_except
+#define compemu_raw_execute_normal arm_compemu_raw_execute_normal
+#define compemu_raw_check_checksum arm_compemu_raw_check_checksum
+#define compemu_raw_exec_nostats arm_compemu_raw_exec_nostats
+#define compemu_raw_maybe_recompile arm_compemu_raw_maybe_recompile
+#define compemu_raw_jmp arm_compemu_raw_jmp
+#define compemu_raw_jmp_pc_tag arm_compemu_raw_jmp_pc_tag
+#define compemu_raw_maybe_cachemiss arm_compemu_raw_maybe_cachemiss
+#define compemu_raw_maybe_do_nothing arm_compemu_raw_maybe_do_nothing
+#define compemu_raw_branch arm_compemu_raw_branch
+#define compemu_raw_init_r_regstruct arm_compemu_raw_init_r_regstruct
+#define compemu_raw_endblock_pc_inreg arm_compemu_raw_endblock_pc_inreg
+#define compemu_raw_endblock_pc_isconst arm_compemu_raw_endblock_pc_isconst
+#include_next <jit/codegen_arm.cc>
+#undef compemu_raw_inc_opcount
+#undef compemu_raw_cmp_pc
+#undef compemu_raw_set_pc_i
+#undef compemu_raw_mov_l_mi
+#undef compemu_raw_mov_l_mr
+#undef compemu_raw_mov_l_ri
+#undef compemu_raw_mov_l_rm
+#undef compemu_raw_mov_l_rr
+#undef compemu_raw_dec_m
+#undef compemu_raw_inc_m64
+#undef compemu_raw_call
+#undef compemu_raw_call_r
+#undef compemu_raw_jcc_l_oponly
+#undef compemu_raw_handle_except
+#undef compemu_raw_execute_normal
+#undef compemu_raw_check_checksum
+#undef compemu_raw_exec_nostats
+#undef compemu_raw_maybe_recompile
+#undef compemu_raw_jmp
+#undef compemu_raw_jmp_pc_tag
+#undef compemu_raw_maybe_cachemiss
+#undef compemu_raw_maybe_do_nothing
+#undef compemu_raw_branch
+#undef compemu_raw_init_r_regstruct
+#undef compemu_raw_endblock_pc_inreg
+#undef compemu_raw_endblock_pc_isconst
+
+STATIC_INLINE void compemu_raw_inc_opcount(IM16 op)
+{
+   jit_host_emit(get_target(), JIT_HOST_INC_OPCOUNT, op, 0);
+   arm_compemu_raw_inc_opcount(op);
+}
+STATIC_INLINE void compemu_raw_cmp_pc(IMPTR s)
+{
+   jit_host_emit(get_target(), JIT_HOST_CMP_PC, s, 0);
+   arm_compemu_raw_cmp_pc(s);
+}
+STATIC_INLINE void compemu_raw_set_pc_i(IMPTR s)
+{
+   jit_host_emit(get_target(), JIT_HOST_SET_PC_I, s, 0);
+   arm_compemu_raw_set_pc_i(s);
+}
+STATIC_INLINE void compemu_raw_mov_l_mi(MEMW d, IM32 s)
+{
+   jit_host_emit(get_target(), JIT_HOST_MOV_L_MI, d, (uae_u32)s);
+   arm_compemu_raw_mov_l_mi(d, s);
+}
+STATIC_INLINE void compemu_raw_mov_l_mr(MEMW d, RR4 s)
+{
+   jit_host_emit(get_target(), JIT_HOST_MOV_L_MR, d, s);
+   arm_compemu_raw_mov_l_mr(d, s);
+}
+STATIC_INLINE void compemu_raw_mov_l_ri(W4 d, IM32 s)
+{
+   jit_host_emit(get_target(), JIT_HOST_MOV_L_RI, d, (uae_u32)s);
+   arm_compemu_raw_mov_l_ri(d, s);
+}
+STATIC_INLINE void compemu_raw_mov_l_rm(W4 d, MEMR s)
+{
+   jit_host_emit(get_target(), JIT_HOST_MOV_L_RM, d, s);
+   arm_compemu_raw_mov_l_rm(d, s);
+}
+STATIC_INLINE void compemu_raw_mov_l_rr(W4 d, RR4 s)
+{
+   jit_host_emit(get_target(), JIT_HOST_MOV_L_RR, d, s);
+   arm_compemu_raw_mov_l_rr(d, s);
+}
+STATIC_INLINE void compemu_raw_dec_m(MEMRW d)
+{
+   jit_host_emit(get_target(), JIT_HOST_DEC_M, d, 0);
+   arm_compemu_raw_dec_m(d);
+}
+STATIC_INLINE void compemu_raw_inc_m64(MEMRW d)
+{
+   jit_host_emit(get_target(), JIT_HOST_INC_M64, d, 0);
+   arm_compemu_raw_inc_m64(d);
+}
+STATIC_INLINE void compemu_raw_call(uintptr t)
+{
+   jit_host_emit(get_target(), JIT_HOST_CALL, t, 0);
+   arm_compemu_raw_call(t);
+}
+STATIC_INLINE void compemu_raw_call_r(RR4 r)
+{
+   jit_host_emit(get_target(), JIT_HOST_CALL_R, r, 0);
+   arm_compemu_raw_call_r(r);
+}
+STATIC_INLINE void compemu_raw_jcc_l_oponly(int cc)
+{
+   jit_host_emit(get_target(), JIT_HOST_JCC_L_ONLY, cc, 0);
+   arm_compemu_raw_jcc_l_oponly(cc);
+}
+STATIC_INLINE void compemu_raw_handle_except(IM32 cycles)
+{
+   jit_host_emit(get_target(), JIT_HOST_HANDLE_EXCEPT, cycles, 0);
+   arm_compemu_raw_handle_except(cycles);
+}
+STATIC_INLINE void compemu_raw_execute_normal(MEMR s)
+{
+   jit_host_emit(get_target(), JIT_HOST_EXECUTE_NORMAL, s, 0);
+   arm_compemu_raw_execute_normal(s);
+}
+STATIC_INLINE void compemu_raw_check_checksum(MEMR s)
+{
+   jit_host_emit(get_target(), JIT_HOST_CHECK_CHECKSUM, s, 0);
+   arm_compemu_raw_check_checksum(s);
+}
+STATIC_INLINE void compemu_raw_exec_nostats(IMPTR s)
+{
+   jit_host_emit(get_target(), JIT_HOST_EXEC_NOSTATS, s, 0);
+   arm_compemu_raw_exec_nostats(s);
+}
+STATIC_INLINE void compemu_raw_maybe_recompile(void)
+{
+   jit_host_emit(get_target(), JIT_HOST_MAYBE_RECOMPILE, 0, 0);
+   arm_compemu_raw_maybe_recompile();
+}
+STATIC_INLINE void compemu_raw_jmp(uintptr t)
+{
+   jit_host_emit(get_target(), JIT_HOST_JMP, t, 0);
+   arm_compemu_raw_jmp(t);
+}
+STATIC_INLINE void compemu_raw_jmp_pc_tag(void)
+{
+   jit_host_emit(get_target(), JIT_HOST_JMP_PC_TAG, 0, 0);
+   arm_compemu_raw_jmp_pc_tag();
+}
+STATIC_INLINE void compemu_raw_maybe_cachemiss(void)
+{
+   jit_host_emit(get_target(), JIT_HOST_MAYBE_CACHEMISS, 0, 0);
+   arm_compemu_raw_maybe_cachemiss();
+}
+STATIC_INLINE void compemu_raw_maybe_do_nothing(IM32 cycles)
+{
+   jit_host_emit(get_target(), JIT_HOST_MAYBE_DO_NOTHING, cycles, 0);
+   arm_compemu_raw_maybe_do_nothing(cycles);
+}
+STATIC_INLINE void compemu_raw_branch(IM32 d)
+{
+   jit_host_emit(get_target(), JIT_HOST_BRANCH, d, 0);
+   arm_compemu_raw_branch(d);
+}
+STATIC_INLINE void compemu_raw_init_r_regstruct(IMPTR s)
+{
+   jit_host_emit(get_target(), JIT_HOST_INIT_R_REGSTRUCT, s, 0);
+   arm_compemu_raw_init_r_regstruct(s);
+}
+STATIC_INLINE void compemu_raw_endblock_pc_inreg(RR4 rr_pc, IM32 cycles)
+{
+   jit_host_emit(get_target(), JIT_HOST_ENDBLOCK_PC_INREG, rr_pc, cycles);
+   arm_compemu_raw_endblock_pc_inreg(rr_pc, cycles);
+}
+STATIC_INLINE uae_u32* compemu_raw_endblock_pc_isconst(IM32 cycles, IMPTR v)
+{
+   jit_host_emit(get_target(), JIT_HOST_ENDBLOCK_PC_ISCONST, cycles, v);
+   return(arm_compemu_raw_endblock_pc_isconst(cycles, v));
+}
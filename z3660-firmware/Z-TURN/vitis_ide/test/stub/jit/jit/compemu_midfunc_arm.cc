@@ -0,0 +1,10 @@
+/*
+ * Host stand-in: the mid level functions of the ARM JIT, without the
+ * coprocessor instructions cleaning the caches after the code is emitted.
+ */
+
+#define __asm__
+#define __volatile__(...) (void)0
+#include_next <jit/compemu_midfunc_arm.cc>
+#undef __asm__
+#undef __volatile__
@@ -0,0 +1,21 @@
+/*
+ * Host stand-in: the sysdeps.h of the emulator, for the ARM code generator
+ * of the JIT (ARMv6T2, as the firmware is built) on the host. maccess.h is
+ * taken before CPU_arm is set, for the C byte swaps and not the ARM ones.
+ */
+
+#ifndef HOST_JIT_SYSDEPS_H
+#define HOST_JIT_SYSDEPS_H
+
+#include_next <sysdeps.h>
+#include "maccess.h"
+
+#undef CPU_x86_64
+#undef X86_64_ASSEMBLY
+#undef SAHF_SETO_PROFITABLE
+#define CPU_arm 1
+#define ARM_ASSEMBLY 1
+#define ARMV6_ASSEMBLY 1
+#define ARMV6T2 1
+
+#endif
@@ -0,0 +1,3 @@
+/* cpu_emulator.cc includes musashi/m68k.h with this name, which only a
+   case insensitive file system finds */
+#include "m68k.h"
@@ -0,0 +1,88 @@
+/*
+ * arm_neon.h
+ *
+ *  Host stand-in for the NEON intrinsics, lane by lane in plain C, so the
+ *  NEON paths of the firmware can be checked against their C versions on
+ *  Linux. Build with -D__ARM_NEON__ -Istub/neon. Only the intrinsics used
+ *  by the tested files are here.
+ */
+
+#ifndef HOST_ARM_NEON_H
+#define HOST_ARM_NEON_H
+
+#include <stdint.h>
+#include <string.h>
+
+typedef struct { int16_t v[4]; } int16x4_t;
+typedef struct { int16_t v[8]; } int16x8_t;
+typedef struct { int32_t v[4]; } int32x4_t;
+typedef struct { int32x4_t val[2]; } int32x4x2_t;
+
+static inline int16x4_t vdup_n_s16(int16_t x)
+{
+   int16x4_t r;
+   for (int i = 0; i < 4; i++) r.v[i] = x;
+   return r;
+}
+
+static inline int16x4_t vld1_s16(const int16_t* p)
+{
+   int16x4_t r;
+   memcpy(r.v, p, sizeof(r.v));
+   return r;
+}
+
+static inline void vst1_s16(int16_t* p, int16x4_t a)
+{
+   memcpy(p, a.v, sizeof(a.v));
+}
+
+static inline int32x4_t vld1q_s32(const int32_t* p)
+{
+   int32x4_t r;
+   memcpy(r.v, p, sizeof(r.v));
+   return r;
+}
+
+static inline int32x4x2_t vld2q_s32(const int32_t* p)
+{
+   int32x4x2_t r;
+   for (int i = 0; i < 4; i++) {
+      r.val[0].v[i] = p[i*2+0];
+      r.val[1].v[i] = p[i*2+1];
+   }
+   return r;
+}
+
+static inline void vst2q_s32(int32_t* p, int32x4x2_t a)
+{
+   for (int i = 0; i < 4; i++) {
+      p[i*2+0] = a.val[0].v[i];
+      p[i*2+1] = a.val[1].v[i];
+   }
+}
+
+static inline int32x4_t vaddq_s32(int32x4_t a, int32x4_t b)
+{
+   for (int i = 0; i < 4; i++) a.v[i] += b.v[i];
+   return a;
+}
+
+static inline int32x4_t vmull_s16(int16x4_t a, int16x4_t b)
+{
+   int32x4_t r;
+   for (int i = 0; i < 4; i++) r.v[i] = (int32_t)a.v[i] * b.v[i];
+   return r;
+}
+
+#define vshrq_n_s32(a, n) ({ int32x4_t r_ = (a); for (int i_ = 0; i_ < 4; i_++) r_.v[i_] >>= (n); r_; })
+
+static inline int16x4_t vqmovn_s32(int32x4_t a)
+{
+   int16x4_t r;
+   for (int i = 0; i < 4; i++)
+      r.v[i] = a.v[i] > 32767 ? 32767 : a.v[i] < -32768 ? -32768 : a.v[i];
+   return r;
+}
+
+#endif
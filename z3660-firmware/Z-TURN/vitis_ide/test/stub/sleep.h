@@ -0,0 +1,7 @@
+/* Host stand-in for the Xilinx BSP header */
+#ifndef SLEEP_H
+#define SLEEP_H
+
+#include <unistd.h>
+
+#endif
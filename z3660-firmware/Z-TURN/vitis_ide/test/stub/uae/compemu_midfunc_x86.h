@@ -0,0 +1 @@
+/* The host tests don't emit code: no x86 midfuncs for compemu.h */
@@ -0,0 +1,8 @@
+/*
+ * The sysconfig.h of the emulator leaves the JIT out on x86_64, these
+ * tests build its host independent parts: this one is found first and
+ * adds the real one.
+ */
+
+#define JIT
+#include_next <sysconfig.h>
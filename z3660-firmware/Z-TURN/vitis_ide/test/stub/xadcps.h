@@ -0,0 +1,7 @@
+/* Host stand-in for the Xilinx BSP header */
+#ifndef XADCPS_H
+#define XADCPS_H
+
+#include "xil_types.h"
+
+#endif
@@ -0,0 +1,7 @@
+/* Host stand-in for the Xilinx BSP header */
+#ifndef XAXIVDMA_H
+#define XAXIVDMA_H
+
+#include "xil_types.h"
+
+#endif
@@ -0,0 +1,7 @@
+/* Host stand-in for the Xilinx BSP header */
+#ifndef XCLK_WIZ_H
+#define XCLK_WIZ_H
+
+#include "xil_types.h"
+
+#endif
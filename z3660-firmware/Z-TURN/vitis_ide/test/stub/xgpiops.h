@@ -0,0 +1,10 @@
+/* Host stand-in for the Xilinx BSP header */
+#ifndef XGPIOPS_H
+#define XGPIOPS_H
+
+#include "xil_types.h"
+#include "xparameters.h" // through xplatform_info.h
+
+typedef struct { int unused; } XGpioPs;
+
+#endif
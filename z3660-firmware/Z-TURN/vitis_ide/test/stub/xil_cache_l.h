@@ -0,0 +1,7 @@
+/* Host stand-in for the Xilinx BSP header */
+#ifndef XIL_CACHE_L_H
+#define XIL_CACHE_L_H
+
+#include "xil_cache.h"
+
+#endif
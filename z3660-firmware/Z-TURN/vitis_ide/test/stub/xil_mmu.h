@@ -0,0 +1,19 @@
+/* Host stand-in for the Xilinx BSP header, there is no MMU to set */
+#ifndef XIL_MMU_H
+#define XIL_MMU_H
+
+#include "xil_types.h"
+#include "xpseudo_asm_gcc.h"
+
+#define NORM_NONCACHE  0x11DE2
+#define STRONG_ORDERED 0x00C02
+#define DEVICE_MEMORY  0x00C06
+#define RESERVED       0x00000
+#define NORM_WT_CACHE  0x16DEA
+#define NORM_WB_CACHE  0x15DE6
+
+#define XREG_CP15_INVAL_UTLB_UNLOCKED 0
+#define XREG_CP15_INVAL_BRANCH_ARRAY  0
+#define mtcp(rn, v) ((void)(rn), (void)(v))
+
+#endif
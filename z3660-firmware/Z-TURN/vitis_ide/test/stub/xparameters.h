@@ -0,0 +1,11 @@
+/* Host stand-in for the Xilinx BSP header */
+#ifndef XPARAMETERS_H
+#define XPARAMETERS_H
+
+#include "xil_types.h"
+
+#define XPS_SYS_CTRL_BASEADDR 0xF8000000
+#define XPAR_SCUWDT_0_DEVICE_ID 0
+#define XPAR_PROCESSING_AV_SYSTEM_AUDIO_VIDEO_ENGINE_VIDEO_VIDEO_FORMATTER_0_BASEADDR 0x7FC20000
+
+#endif
@@ -0,0 +1,11 @@
+/* Host stand-in for the Xilinx BSP header */
+#ifndef XPSEUDO_ASM_GCC_H
+#define XPSEUDO_ASM_GCC_H
+
+#include "xil_types.h"
+
+#define dsb() __sync_synchronize()
+#define dmb() __sync_synchronize()
+#define isb() __sync_synchronize()
+
+#endif
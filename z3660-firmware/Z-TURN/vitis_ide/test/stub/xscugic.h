@@ -0,0 +1,9 @@
+/* Host stand-in for the Xilinx BSP header */
+#ifndef XSCUGIC_H
+#define XSCUGIC_H
+
+#include "xil_types.h"
+
+typedef struct { int unused; } XScuGic;
+
+#endif
@@ -0,0 +1,7 @@
+/* Host stand-in for the Xilinx BSP header */
+#ifndef XUARTPS_H
+#define XUARTPS_H
+
+#include "xil_types.h"
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * uae_host.cc
+ *
+ *  What uae_emulator.cc and memory.cc need on the host: the motherboard
+ *  (chip RAM and the board's fast RAM behind the bus cycles and the block
+ *  copies of cpu_emulator.cc), the CPU core, autoconfig, the RTG and SCSI
+ *  registers of core0 and the MMU tables, as stand-ins doing nothing.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "sysconfig.h"
+#include "sysdeps.h"
+#include "options.h"
+#include "include/memory.h"
+#include "newcpu.h"
+#include "main.h"
+#include "uae_host.h"
+
+uint32_t host_mobo_start = HOST_MOBO_END;
+uint32_t host_board_writes;
+
+static uint8_t chip[HOST_CHIP_SIZE];
+static uint8_t fast[HOST_MOBO_END - HOST_MOBO_START];
+
+uint8_t *host_board(uint32_t address)
+{
+   if (address < HOST_CHIP_SIZE)
+      return(chip + address);
+   if (address >= host_mobo_start && address < HOST_MOBO_END)
+      return(fast + address - HOST_MOBO_START);
+   return(NULL);
+}
+
+void host_board_fill(uint32_t seed)
+{
+   for (uint32_t i = 0; i < sizeof(fast); i += 4) {
+      seed = seed * 1664525 + 1013904223;
+      memcpy(fast + i, &seed, 4);
+   }
+}
+
+// the bus cycles: the data lanes as cpu_emulator.cc takes them, no RAM reads 0
+static uint32_t bus_read(uint32_t address, int size)
+{
+   uint32_t v = 0;
+   for (int i = 0; i < size; i++) {
+      uint8_t *p = host_board(address + i);
+      v = (v << 8) | (p ? *p : 0);
+   }
+   return(v);
+}
+
+static void bus_write(uint32_t address, uint32_t value, int size)
+{
+   for (int i = 0; i < size; i++) {
+      uint8_t *p = host_board(address + i);
+      if (p)
+         *p = value >> (8 * (size - 1 - i));
+   }
+   host_board_writes++;
+}
+
+extern "C" unsigned int ps_read_8(unsigned int address) { return(bus_read(address, 1)); }
+extern "C" unsigned int ps_read_16(unsigned int address) { return(bus_read(address, 2)); }
+extern "C" unsigned int ps_read_32(unsigned int address) { return(bus_read(address, 4)); }
+extern "C" void ps_write_8(unsigned int address, unsigned int value) { bus_write(address, value, 1); }
+extern "C" void ps_write_16(unsigned int address, unsigned int value) { bus_write(address, value, 2); }
+extern "C" void ps_write_32(unsigned int address, unsigned int value) { bus_write(address, value, 4); }
+extern "C" void ps_write_flush(void) {}
+extern "C" unsigned int read_byte(unsigned int address) { return(bus_read(address, 1)); }
+extern "C" unsigned int read_word(unsigned int address) { return(bus_read(address, 2)); }
+extern "C" unsigned int read_long(unsigned int address) { return(bus_read(address, 4)); }
+extern "C" void m68k_write_memory_8(unsigned int address, unsigned int value) { bus_write(address, value, 1); }
+extern "C" void m68k_write_memory_16(unsigned int address, unsigned int value) { bus_write(address, value, 2); }
+extern "C" void m68k_write_memory_32(unsigned int address, unsigned int value) { bus_write(address, value, 4); }
+
+// the block copies stop at the first byte with no RAM, as at a bus error
+uint32_t bus_shadow_start = HOST_MOBO_END;
+extern "C" int bus_amiga_ram(uint32_t address, uint32_t len)
+{
+   uint32_t last = address + len - 1;
+   return(len != 0 && last >= address
+      && (last < HOST_CHIP_SIZE || (address >= HOST_MOBO_START && last < bus_shadow_start)));
+}
+extern "C" uint32_t bus_copy_to_amiga(uint32_t address, const uint8_t *src, uint32_t len)
+{
+   uint32_t done = 0;
+   for (uint8_t *p; done < len && (p = host_board(address + done)) != NULL; done++)
+      *p = src[done];
+   host_board_writes++;
+   return(done);
+}
+extern "C" uint32_t bus_copy_from_amiga(uint8_t *dst, uint32_t address, uint32_t len)
+{
+   uint32_t done = 0;
+   for (uint8_t *p; done < len && (p = host_board(address + done)) != NULL; done++)
+      dst[done] = *p;
+   return(done);
+}
+extern "C" void bus_timing_check(void) {}
+
+// core0 and the rest of core1
+static SHARED host_shared;
+SHARED *shared = &host_shared;
+uint32_t MMUTable;
+uint32_t MMUL2Table[256];
+volatile uint8_t *Z3660_RTG_BASE;
+volatile uint8_t *Z3660_Z3RAM_BASE;
+uint32_t autoConfigBaseFastRam;
+uint32_t autoConfigBaseRTG;
+int configured;
+uint32_t host_shadow_mmu;  // the start given to mobo_ram_shadow_mmu()
+
+void mobo_ram_shadow_mmu(uint32_t start) { host_shadow_mmu = start; }
+void finish_Attributes(void) {}
+#ifndef UAE_HOST_NEWCPU     // the tests of the JIT link the real newcpu.cc and events.cc
+int m68k_pc_indirect;
+evt_t currcycle, start_cycles;
+struct regstruct regs;
+void build_cpufunctbl(void) {}
+void doint(void) {}
+void fill_prefetch_quick(void) {}
+void init_m68k(void) {}
+void jit_profile_tasks(void) {}
+void m68k_go(int may_quit) {}
+void m68k_reset_newcpu(bool hardreset) {}
+#endif
+extern "C" uint32_t read_autoconfig(uint32_t address) { return(0); }
+extern "C" void write_autoconfig(uint32_t address, uint32_t data) {}
+extern "C" void reset_autoconfig(void) {}
+extern "C" uint32_t read_rtg_register(uint16_t zaddr) { return(0); }
+extern "C" void write_rtg_register(uint16_t zaddr, uint32_t zdata) {}
+extern "C" uint32_t read_scsi_register(uint16_t zaddr, int type) { return(0); }
+extern "C" void write_scsi_register(uint16_t zaddr, uint32_t zdata, int type) {}
+extern "C" void z3660_printf(const TCHAR *format, ...) {}
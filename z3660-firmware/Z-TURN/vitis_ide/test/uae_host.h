@@ -0,0 +1,25 @@
+/*
+ * uae_host.h
+ *
+ *  The tests of the emulator memory map link the real uae_emulator.cc and
+ *  memory.cc, this is what they share: the motherboard behind ps_read_*(),
+ *  ps_write_*() and the bus block copies (uae_host.cc), with chip RAM and
+ *  fast RAM from host_mobo_start to 0x08000000 as the Amiga sees them.
+ */
+
+#ifndef UAE_HOST_H_
+#define UAE_HOST_H_
+
+#include <stdint.h>
+
+#define HOST_CHIP_SIZE 0x00200000
+#define HOST_MOBO_START 0x07000000
+#define HOST_MOBO_END   0x08000000
+
+extern uint32_t host_mobo_start;    // the fast RAM on the board, 0x08000000 for none
+extern uint32_t host_board_writes;  // bus cycles and block copies that wrote the board
+
+uint8_t *host_board(uint32_t address);  // NULL where the bus has no RAM
+void host_board_fill(uint32_t seed);
+
+#endif /* UAE_HOST_H_ */
@@ -0,0 +1,64 @@
+/*
+ * uae_memmap_test.cc
+ *
+ *  The RTG banks of the emulator memory map (uae/uae_emulator.cc), for the
+ *  autoconfig bases the RTG board can get:
+ *  - init_rtg_bank() maps the first 2 MB (registers, SCSI, boot ROM) to
+ *    rtg_regs_bank and the next 126 MB to rtg_bank, nothing around them
+ *  - rtg_bank is a direct RAM bank: memory_get_real_address() (memory.cc)
+ *    gives the 68k address itself on every page, memory_valid_address()
+ *    takes the whole RAM up to its last longword
+ *  - the register bank is IO, not direct
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "sysconfig.h"
+#include "sysdeps.h"
+#include "options.h"
+#include "include/memory.h"
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+extern addrbank rtg_regs_bank, rtg_bank, dflt_bank;
+extern "C" void init_rtg_bank(unsigned int ini);
+
+static void test_rtg(unsigned int ini)
+{
+   uae_u32 base = ini << 20;
+
+   for (int i = 0; i < MEMORY_BANKS; i++)
+      mem_banks[i] = &dflt_bank;
+   init_rtg_bank(ini);
+
+   CHECK(&get_mem_bank(base - 1) == &dflt_bank, "0x%03x: below the board mapped", ini);
+   CHECK(&get_mem_bank(base + 0x8000000) == &dflt_bank, "0x%03x: above the board mapped", ini);
+   for (uae_u32 a = base; a < base + 0x200000; a += 0x1000)
+      if (&get_mem_bank(a) != &rtg_regs_bank) {
+         CHECK(0, "0x%03x: 0x%08x not in the register bank", ini, a);
+         return;
+      }
+   CHECK(rtg_regs_bank.flags == ABFLAG_IO && rtg_regs_bank.baseaddr_direct_r == NULL,
+         "0x%03x: register bank direct", ini);
+   for (uae_u32 a = base + 0x200000; a < base + 0x8000000; a += 0x1000)
+      if (&get_mem_bank(a) != &rtg_bank || memory_get_real_address(a + 0x10) != (uae_u8 *)(uintptr_t)(a + 0x10)
+          || memory_valid_address(a, 4) != 1) {
+         CHECK(0, "0x%03x: 0x%08x not direct RTG RAM", ini, a);
+         return;
+      }
+   CHECK(rtg_bank.flags == (ABFLAG_RAM | ABFLAG_RTG | ABFLAG_DIRECTACCESS) && !rtg_bank.jit_read_flag
+         && !rtg_bank.jit_write_flag, "0x%03x: RTG RAM flags 0x%x", ini, rtg_bank.flags);
+   CHECK(memory_valid_address(base + 0x8000000 - 4, 4) == 1, "0x%03x: last longword", ini);
+   CHECK(memory_valid_address(base + 0x8000000 - 4, 8) != 1, "0x%03x: past the RAM valid", ini);
+}
+
+int main(int argc, char **argv)
+{
+   for (unsigned int ini : { 0x400u, 0x480u, 0x500u, 0x780u })
+      test_rtg(ini);
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}
@@ -0,0 +1,139 @@
+/*
+ * uae_shadow_test.cc
+ *
+ *  The motherboard RAM shadow of the emulator (mobo_ram_shadow_init(),
+ *  mobo_ram_shadow_load() and mobo_ram_writeback() in uae/uae_emulator.cc)
+ *  on the board of uae_host.cc, with the copy mapped at the address of the
+ *  RAM as core1's MMU does:
+ *  - the RAM found on the board is remapped to the shadow bank, from its
+ *    start up to 0x08000000, the MMU gets the same start, the bank around
+ *    it is left alone and the bytes the probe tested are put back
+ *  - no RAM on the board, or NO: nothing remapped, the board not written
+ *  - the copy has the board's bytes once loaded
+ *  - WRITETHROUGH: 68k writes reach the copy and the board, reads come
+ *    from the copy
+ *  - WRITEBACK: 68k writes reach only the copy until a writeback, which
+ *    writes the whole copy to the board and then clears the request, one
+ *    outside WRITEBACK is cleared without writing the board
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <initializer_list>
+#include "sysconfig.h"
+#include "sysdeps.h"
+#include "options.h"
+#include "include/memory.h"
+#include "main.h"
+#include "uae_host.h"
+#include "uae_emulator.h"
+
+static int failures;
+
+#define CHECK(c, ...) do { if (!(c)) { printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); failures++; } } while (0)
+
+extern addrbank mbsh_bank, dmmy_bank;
+extern uint32_t bus_shadow_start;
+extern uint32_t host_shadow_mmu;
+extern SHARED *shared;
+
+static uint8_t board[HOST_MOBO_END - HOST_MOBO_START];
+
+// the emulation starting with this much RAM on the board
+static void start(uint32_t mode, uint32_t size)
+{
+   host_mobo_start = HOST_MOBO_END - size;
+   host_board_fill(size ^ mode);
+   if (size)
+      memcpy(board + host_mobo_start - HOST_MOBO_START, host_board(host_mobo_start), size);
+   memset((void *)(uintptr_t)HOST_MOBO_START, 0xEE, HOST_MOBO_END - HOST_MOBO_START);
+   for (int i = 0; i < MEMORY_BANKS; i++)
+      mem_banks[i] = &dmmy_bank;
+   host_board_writes = 0;
+   host_shadow_mmu = 0;
+   shared->mobo_ram_shadow = mode;
+   mobo_ram_shadow_init();
+   mobo_ram_shadow_load();
+}
+
+static void test_remap(uint32_t mode, uint32_t size)
+{
+   uint32_t first = HOST_MOBO_END - size;
+   start(mode, size);
+   CHECK(size == 0 || memcmp(host_board(first), board + first - HOST_MOBO_START, size) == 0,
+         "%u %u MB: probed bytes not put back", mode, size >> 20);
+   if (mode == SHADOW_NO || size == 0) {
+      CHECK(bus_shadow_start == HOST_MOBO_END && host_shadow_mmu == 0, "%u %u MB: shadow at 0x%08x", mode,
+            size >> 20, bus_shadow_start);
+      CHECK(&get_mem_bank(HOST_MOBO_END - 4) == &dmmy_bank, "%u %u MB: remapped", mode, size >> 20);
+      if (mode == SHADOW_NO)
+         CHECK(host_board_writes == 0, "NO: board written");
+      return;
+   }
+   CHECK(bus_shadow_start == first && host_shadow_mmu == first, "%u %u MB: shadow at 0x%08x, MMU at 0x%08x",
+         mode, size >> 20, bus_shadow_start, host_shadow_mmu);
+   for (uint32_t a = HOST_MOBO_START; a < HOST_MOBO_END; a += 0x10000)
+      if (&get_mem_bank(a) != (a < first ? &dmmy_bank : &mbsh_bank)) {
+         CHECK(0, "%u %u MB: 0x%08x in the wrong bank", mode, size >> 20, a);
+         break;
+      }
+   CHECK(memory_get_real_address(first + 0x10) == (uae_u8 *)(uintptr_t)(first + 0x10) && memory_valid_address(first, 4),
+         "%u %u MB: shadow not direct", mode, size >> 20);
+   CHECK(memcmp((void *)(uintptr_t)first, board + first - HOST_MOBO_START, size) == 0, "%u %u MB: copy not loaded",
+         mode, size >> 20);
+}
+
+static void test_writethrough(void)
+{
+   start(SHADOW_WRITETHROUGH, 0x00400000);
+   put_long(0x07C00100, 0x12345678);
+   put_word(0x07C00202, 0xABCD);
+   put_byte(0x07FFFFFF, 0x5A);
+   CHECK(host_board(0x07C00100)[0] == 0x12 && host_board(0x07C00100)[3] == 0x78 && host_board(0x07C00202)[0] == 0xAB
+         && host_board(0x07FFFFFF)[0] == 0x5A, "WRITETHROUGH: board not written");
+   CHECK(((uint8_t *)0x07C00100)[0] == 0x12 && ((uint8_t *)0x07C00203)[0] == 0xCD, "WRITETHROUGH: copy not written");
+   host_board(0x07C00100)[0] = 0x99;
+   CHECK(get_long(0x07C00100) == 0x12345678 && get_word(0x07C00202) == 0xABCD, "WRITETHROUGH: read from the board");
+}
+
+static void test_writeback(void)
+{
+   start(SHADOW_WRITEBACK, 0x00800000);
+   uint32_t writes = host_board_writes;
+   put_long(0x07800000, 0xCAFEBABE);
+   put_byte(0x07FFFFFE, 0x42);
+   CHECK(host_board_writes == writes && memcmp(host_board(0x07800000), board + 0x800000, 4) == 0,
+         "WRITEBACK: board written before the writeback");
+   CHECK(get_long(0x07800000) == 0xCAFEBABE, "WRITEBACK: copy not written");
+   shared->mobo_ram_writeback = 1;
+   mobo_ram_writeback();
+   CHECK(shared->mobo_ram_writeback == 0, "WRITEBACK: request not cleared");
+   CHECK(memcmp(host_board(0x07800000), (void *)0x07800000, 0x800000) == 0 && host_board(0x07800000)[0] == 0xCA
+         && host_board(0x07FFFFFE)[0] == 0x42, "WRITEBACK: board differs from the copy");
+
+   start(SHADOW_WRITETHROUGH, 0x00800000);
+   writes = host_board_writes;
+   shared->mobo_ram_writeback = 1;
+   mobo_ram_writeback();
+   CHECK(shared->mobo_ram_writeback == 0 && host_board_writes == writes, "WRITETHROUGH: written back");
+}
+
+int main(int argc, char **argv)
+{
+   // the copy where core1's MMU puts it, at the address of the RAM
+   if (mmap((void *)HOST_MOBO_START, HOST_MOBO_END - HOST_MOBO_START, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0) != (void *)HOST_MOBO_START) {
+      printf("no memory at 0x%08x\n", HOST_MOBO_START);
+      return(1);
+   }
+   for (uint32_t mode : { SHADOW_NO, SHADOW_WRITETHROUGH, SHADOW_WRITEBACK })
+      for (uint32_t size : { 0x0u, 0x00100000u, 0x00800000u, 0x01000000u })
+         test_remap(mode, size);
+   test_writethrough();
+   test_writeback();
+
+   printf(failures ? "%d FAILURES\n" : "ok\n", failures);
+   return(failures != 0);
+}